@@ -0,0 +1,163 @@
+#include "CameraPath.h"
+
+#include <OpenFile.h>
+
+#include "../Logging.h"
+
+#include <cstdio>
+
+static constexpr const char* CameraPathHeader = "# GltfExplorer camera path: time x y z pitch yaw";
+
+void CameraPath::AddKey(const CameraPathKey& key)
+{
+	if (!ENSUREMSG(Keys.empty() || key.Time >= Keys.back().Time, "Camera path keys must be added in time order"))
+		return;
+
+	Keys.push_back(key);
+}
+
+uint32_t CameraPath::GetPlaybackFrameCount() const noexcept
+{
+	if (Keys.empty())
+		return 0u;
+
+	return (uint32_t)ceilf(GetDuration() / PlaybackTimestep) + 1u;
+}
+
+CameraPathKey CameraPath::Sample(float time) const noexcept
+{
+	if (Keys.empty())
+		return {};
+
+	time += Keys.front().Time;
+
+	if (time <= Keys.front().Time)
+		return Keys.front();
+
+	if (time >= Keys.back().Time)
+		return Keys.back();
+
+	// First key after `time`, paths are short enough that a binary search is only about being tidy
+	size_t lo = 0;
+	size_t hi = Keys.size() - 1u;
+	while (lo + 1u < hi)
+	{
+		const size_t mid = (lo + hi) / 2u;
+		if (Keys[mid].Time <= time)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	const CameraPathKey& a = Keys[lo];
+	const CameraPathKey& b = Keys[hi];
+
+	const float span = b.Time - a.Time;
+	const float t = span > 0.0f ? (time - a.Time) / span : 1.0f;
+
+	// FlyCamera wraps yaw at +-360, recorded keys can jump by a full turn between frames
+	float yawDelta = b.Yaw - a.Yaw;
+	while (yawDelta > 180.0f) yawDelta -= 360.0f;
+	while (yawDelta < -180.0f) yawDelta += 360.0f;
+
+	CameraPathKey key;
+	key.Time = time - Keys.front().Time;
+	key.Position = a.Position + (b.Position - a.Position) * t;
+	key.Pitch = a.Pitch + (b.Pitch - a.Pitch) * t;
+	key.Yaw = a.Yaw + yawDelta * t;
+
+	return key;
+}
+
+bool CameraPath::Save(const char* path) const
+{
+	FILE* fp = OpenFile(path, "w");
+
+	if (!ENSUREMSG(fp, "Failed to open camera path for writing (%s)", path))
+		return false;
+
+	fprintf(fp, "%s\n", CameraPathHeader);
+
+	for (const CameraPathKey& key : Keys)
+	{
+		fprintf(fp, "%.9g %.9g %.9g %.9g %.9g %.9g\n", key.Time, key.Position.x, key.Position.y, key.Position.z, key.Pitch, key.Yaw);
+	}
+
+	const bool ok = ferror(fp) == 0;
+	fclose(fp);
+
+	if (!ENSUREMSG(ok, "Failed to write camera path (%s)", path))
+		return false;
+
+	LOGINFO("Wrote %zu camera path keys (%.2fs) to %s", Keys.size(), GetDuration(), path);
+
+	return true;
+}
+
+bool CameraPath::Load(const char* path)
+{
+	FILE* fp = OpenFile(path, "r");
+
+	if (!ENSUREMSG(fp, "Failed to open camera path (%s)", path))
+		return false;
+
+	std::vector<CameraPathKey> keys;
+
+	char line[256];
+	uint32_t lineNumber = 0;
+	bool ok = true;
+
+	while (ok && fgets(line, sizeof(line), fp))
+	{
+		lineNumber++;
+
+		const char* c = line;
+		while (*c == ' ' || *c == '\t')
+			c++;
+
+		if (*c == '#' || *c == '\n' || *c == '\r' || *c == '\0')
+			continue;
+
+		CameraPathKey key;
+		if (sscanf(c, "%f %f %f %f %f %f", &key.Time, &key.Position.x, &key.Position.y, &key.Position.z, &key.Pitch, &key.Yaw) != 6)
+		{
+			LOGERROR("Camera path %s line %u: expected time x y z pitch yaw", path, lineNumber);
+			ok = false;
+		}
+		else if (!keys.empty() && key.Time < keys.back().Time)
+		{
+			LOGERROR("Camera path %s line %u: time goes backwards", path, lineNumber);
+			ok = false;
+		}
+		else
+		{
+			keys.push_back(key);
+		}
+	}
+
+	fclose(fp);
+
+	if (!ok)
+		return false;
+
+	Keys = std::move(keys);
+
+	LOGINFO("Loaded %zu camera path keys (%.2fs) from %s", Keys.size(), GetDuration(), path);
+
+	return true;
+}
+
+float3 CameraPath_GetLookDirection(float pitch, float yaw) noexcept
+{
+	pitch = ConvertToRadians(Clamp(pitch, -89.9f, 89.9f));
+	yaw = ConvertToRadians(yaw);
+
+	const float cosPitch = cosf(pitch);
+
+	return float3{ cosf(yaw) * cosPitch, sinf(pitch), sinf(yaw) * cosPitch };
+}
+
+matrix CameraPath_MakeViewMatrix(const CameraPathKey& key) noexcept
+{
+	return MakeMatrixLookToLH(key.Position, CameraPath_GetLookDirection(key.Pitch, key.Yaw), float3{ 0, 1, 0 });
+}
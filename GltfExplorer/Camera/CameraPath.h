@@ -0,0 +1,52 @@
+#pragma once
+
+#include <SurfMath.h>
+
+#include <vector>
+
+// Angles are in degrees, the same as FlyCamera::SetView
+struct CameraPathKey
+{
+	float Time = 0.0f;
+	float3 Position = {};
+	float Pitch = 0.0f;
+	float Yaw = 0.0f;
+};
+
+// Timestamped camera poses, recorded from the fly camera and played back at a fixed timestep so benchmark runs see the
+// same views from build to build. Stored as text, one key per line, so paths can be diffed and edited by hand.
+class CameraPath
+{
+public:
+
+	static constexpr float PlaybackTimestep = 1.0f / 60.0f;
+
+	void Clear() { Keys.clear(); }
+
+	// Keys must be added in time order
+	void AddKey(const CameraPathKey& key);
+
+	bool Empty() const noexcept { return Keys.empty(); }
+	size_t GetKeyCount() const noexcept { return Keys.size(); }
+	const CameraPathKey& GetKey(size_t index) const noexcept { return Keys[index]; }
+
+	float GetDuration() const noexcept { return Keys.empty() ? 0.0f : Keys.back().Time - Keys.front().Time; }
+
+	// Frames needed to play the whole path at PlaybackTimestep, including both ends
+	uint32_t GetPlaybackFrameCount() const noexcept;
+
+	// Time is measured from the first key. Linear between keys, yaw takes the short way round, times outside the path clamp
+	// to the first or last key.
+	CameraPathKey Sample(float time) const noexcept;
+
+	bool Save(const char* path) const;
+	bool Load(const char* path);
+
+private:
+
+	std::vector<CameraPathKey> Keys;
+};
+
+float3 CameraPath_GetLookDirection(float pitch, float yaw) noexcept;
+
+matrix CameraPath_MakeViewMatrix(const CameraPathKey& key) noexcept;
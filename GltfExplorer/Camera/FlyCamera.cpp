@@ -1,4 +1,5 @@
 #include "FlyCamera.h"
+#include "CameraPath.h"
 #include <imgui.h>
 
 void FlyCamera::SetView(const float3& position, float pitch, float yaw)
@@ -14,14 +15,8 @@ void FlyCamera::SetView(const float3& position, float pitch, float yaw)
 	_camPitch = pitch;
 	_camYaw = yaw;
 
-	pitch = Clamp(pitch, -89.9f, 89.9f);
-
-	yaw = ConvertToRadians(yaw);
-	pitch = ConvertToRadians(pitch);
-
-	float cosPitch = cosf(pitch);
-
-	_lookDir = float3{ cosf(yaw) * cosPitch, sinf(pitch), sinf(yaw) * cosPitch };
+	// Shared with camera path playback so a played back path sees exactly what was recorded
+	_lookDir = CameraPath_GetLookDirection(pitch, yaw);
 
 	_view = MakeMatrixLookToLH(position, _lookDir, float3{ 0, 1, 0 });
 }
@@ -9,6 +9,8 @@ struct FlyCamera : public Camera
 
 	const matrix& GetView() const noexcept { return _view; }
 	const float3& GetPosition() const noexcept { return _position; }
+	float GetPitch() const noexcept { return _camPitch; }
+	float GetYaw() const noexcept { return _camYaw; }
 
 protected:
 	float3 _position;
@@ -0,0 +1,351 @@
+#include "FrameCapture.h"
+
+#include <OpenFile.h>
+
+#include "../Logging.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+using namespace tpr;
+
+static const char* CaptureCommandTypeNames[(uint8_t)CaptureCommandType::COUNT] =
+{
+	"RootSignature",
+	"PipelineState",
+	"RootCBV",
+	"RootDescriptorTable",
+	"RootValue",
+	"VertexCBVs",
+	"PixelCBVs",
+	"VertexSRVs",
+	"PixelSRVs",
+	"IndexBuffer",
+	"VertexBuffers",
+	"RenderTargets",
+	"Viewports",
+	"DefaultScissor",
+	"DrawIndexedInstanced",
+	"DrawInstanced",
+};
+
+static const char* CaptureResourceTypeNames[(uint8_t)CaptureResourceType::COUNT] =
+{
+	"RootSignature",
+	"PipelineState",
+	"ConstantBuffer",
+	"DynamicConstantBuffer",
+	"DynamicVertexBuffer",
+	"DynamicIndexBuffer",
+	"VertexBuffer",
+	"IndexBuffer",
+	"ShaderResourceView",
+	"RenderTargetView",
+	"DepthStencilView",
+};
+
+const char* CaptureCommandType_GetName(CaptureCommandType type)
+{
+	return type < CaptureCommandType::COUNT ? CaptureCommandTypeNames[(uint8_t)type] : "Unknown";
+}
+
+const char* CaptureResourceType_GetName(CaptureResourceType type)
+{
+	return type < CaptureResourceType::COUNT ? CaptureResourceTypeNames[(uint8_t)type] : "Unknown";
+}
+
+CaptureCommand& FrameCaptureStream::BeginCommand(CaptureCommandType type, uint32_t slot, uint16_t count, uint8_t flags)
+{
+	CaptureCommand& cmd = Commands.emplace_back();
+	cmd.Type = type;
+	cmd.Flags = flags;
+	cmd.Count = count;
+	cmd.Slot = slot;
+	cmd.PayloadOffset = (uint32_t)Payload.size();
+	return cmd;
+}
+
+void FrameCaptureStream::PushHandle(CaptureResourceType resourceType, uint64_t handle)
+{
+	Handles.push_back({ (uint32_t)Payload.size(), resourceType });
+	Payload.push_back(handle);
+}
+
+void FrameCaptureStream::RecordHandle(CaptureCommandType type, uint32_t slot, CaptureResourceType resourceType, uint64_t handle, uint8_t flags)
+{
+	BeginCommand(type, slot, 1u, flags);
+	PushHandle(resourceType, handle);
+}
+
+void FrameCaptureStream::RecordValue(CaptureCommandType type, uint32_t slot, uint32_t value)
+{
+	BeginCommand(type, slot, 1u, 0u);
+	Payload.push_back(value);
+}
+
+void FrameCaptureStream::RecordHandles(CaptureCommandType type, uint32_t startSlot, uint32_t count, CaptureResourceType resourceType, const uint64_t* handles, uint8_t flags)
+{
+	BeginCommand(type, startSlot, (uint16_t)count, flags);
+	for (uint32_t i = 0; i < count; i++)
+		PushHandle(resourceType, handles[i]);
+}
+
+void FrameCaptureStream::RecordIndexBuffer(CaptureResourceType resourceType, uint64_t handle, RenderFormat format, uint32_t offset, uint8_t flags)
+{
+	BeginCommand(CaptureCommandType::INDEX_BUFFER, 0u, 1u, flags);
+	PushHandle(resourceType, handle);
+	Payload.push_back((uint64_t)format);
+	Payload.push_back(offset);
+}
+
+void FrameCaptureStream::RecordVertexBuffers(uint32_t startSlot, uint32_t count, CaptureResourceType resourceType, const uint64_t* handles, const uint32_t* strides, const uint32_t* offsets, uint8_t flags)
+{
+	BeginCommand(CaptureCommandType::VERTEX_BUFFERS, startSlot, (uint16_t)count, flags);
+	for (uint32_t i = 0; i < count; i++)
+		PushHandle(resourceType, handles[i]);
+	for (uint32_t i = 0; i < count; i++)
+		Payload.push_back(strides[i]);
+	for (uint32_t i = 0; i < count; i++)
+		Payload.push_back(offsets[i]);
+}
+
+void FrameCaptureStream::RecordRenderTargets(const RenderTargetView_t* rtvs, uint32_t count, DepthStencilView_t dsv)
+{
+	BeginCommand(CaptureCommandType::RENDER_TARGETS, 0u, (uint16_t)count, 0u);
+	for (uint32_t i = 0; i < count; i++)
+		PushHandle(CaptureResourceType::RENDER_TARGET_VIEW, static_cast<uint64_t>(rtvs[i]));
+	PushHandle(CaptureResourceType::DEPTH_STENCIL_VIEW, static_cast<uint64_t>(dsv));
+}
+
+void FrameCaptureStream::RecordViewports(const Viewport* viewports, uint32_t count)
+{
+	BeginCommand(CaptureCommandType::VIEWPORTS, 0u, (uint16_t)count, 0u);
+
+	const size_t bytes = sizeof(Viewport) * count;
+	const size_t words = (bytes + sizeof(uint64_t) - 1u) / sizeof(uint64_t);
+
+	const size_t offset = Payload.size();
+	Payload.resize(offset + words, 0u);
+	memcpy(&Payload[offset], (const void*)viewports, bytes);
+}
+
+void FrameCaptureStream::RecordDefaultScissor()
+{
+	BeginCommand(CaptureCommandType::DEFAULT_SCISSOR, 0u, 0u, 0u);
+}
+
+void FrameCaptureStream::RecordDrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, uint32_t baseVertex, uint32_t startInstance)
+{
+	BeginCommand(CaptureCommandType::DRAW_INDEXED_INSTANCED, 0u, 0u, 0u);
+	Payload.insert(Payload.end(), { indexCount, instanceCount, startIndex, baseVertex, startInstance });
+}
+
+void FrameCaptureStream::RecordDrawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance)
+{
+	BeginCommand(CaptureCommandType::DRAW_INSTANCED, 0u, 0u, 0u);
+	Payload.insert(Payload.end(), { vertexCount, instanceCount, startVertex, startInstance });
+}
+
+FrameCaptureStream* FrameCapture::AddStream()
+{
+	assert(!Finalized);
+	return &Streams.emplace_back();
+}
+
+void FrameCapture::Finalize()
+{
+	if (Finalized)
+		return;
+
+	// Invalid handles stay as ~0 so replay can pass INVALID straight through
+	constexpr uint64_t InvalidIndex = ~0ull;
+
+	std::unordered_map<uint64_t, uint32_t> resourceIndices[(uint8_t)CaptureResourceType::COUNT];
+
+	for (FrameCaptureStream& stream : Streams)
+	{
+		for (const CaptureHandleRef& ref : stream.Handles)
+		{
+			uint64_t& word = stream.Payload[ref.PayloadIndex];
+			if (word == 0u)
+			{
+				word = InvalidIndex;
+				continue;
+			}
+
+			auto [it, inserted] = resourceIndices[(uint8_t)ref.Type].try_emplace(word, (uint32_t)Resources.size());
+			if (inserted)
+			{
+				Resources.push_back({ ref.Type, word });
+			}
+
+			word = it->second;
+		}
+	}
+
+	const auto& srvIndices = resourceIndices[(uint8_t)CaptureResourceType::SHADER_RESOURCE_VIEW];
+	const auto transformsSrv = srvIndices.find(ObjectTransformsSrv);
+	ObjectTransformsSrv = ObjectTransformsSrv != 0u && transformsSrv != srvIndices.end() ? transformsSrv->second : InvalidIndex;
+
+	Finalized = true;
+}
+
+size_t FrameCapture::GetCommandCount() const noexcept
+{
+	size_t count = 0;
+	for (const FrameCaptureStream& stream : Streams)
+		count += stream.Commands.size();
+	return count;
+}
+
+template<typename T>
+static bool Capture_Write(FILE* fp, const T* data, size_t count)
+{
+	return count == 0 || fwrite(data, sizeof(T), count, fp) == count;
+}
+
+template<typename T>
+static bool Capture_Read(FILE* fp, T* data, size_t count)
+{
+	return count == 0 || fread(data, sizeof(T), count, fp) == count;
+}
+
+template<typename T>
+static bool Capture_WriteVector(FILE* fp, const std::vector<T>& v)
+{
+	const uint64_t count = v.size();
+	return Capture_Write(fp, &count, 1) && Capture_Write(fp, v.data(), v.size());
+}
+
+template<typename T>
+static bool Capture_ReadVector(FILE* fp, std::vector<T>& v)
+{
+	uint64_t count = 0;
+	if (!Capture_Read(fp, &count, 1))
+		return false;
+
+	// Guards against allocating something absurd from a truncated or corrupt file
+	if (count > (1ull << 32))
+		return false;
+
+	v.resize((size_t)count);
+	return Capture_Read(fp, v.data(), v.size());
+}
+
+struct CaptureFileHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t ViewportWidth;
+	uint32_t ViewportHeight;
+	matrix ViewMatrix;
+	matrix ProjectionMatrix;
+	float3 CameraPosition;
+	uint32_t Bindless;
+	uint32_t StreamCount;
+	uint32_t ViewportSize;
+	uint64_t ObjectTransformsSrv;
+};
+
+bool FrameCapture_Write(const FrameCapture& capture, const char* path)
+{
+	if (!ENSUREMSG(capture.IsFinalized(), "Frame capture must be finalized before it is written"))
+		return false;
+
+	FILE* fp = OpenFile(path, "wb");
+	if (!ENSUREMSG(fp, "Failed to open capture file for writing (%s)", path))
+		return false;
+
+	CaptureFileHeader header = {};
+	header.Magic = FrameCapture::FileMagic;
+	header.Version = FrameCapture::FileVersion;
+	header.ViewportWidth = capture.ViewportWidth;
+	header.ViewportHeight = capture.ViewportHeight;
+	header.ViewMatrix = capture.ViewMatrix;
+	header.ProjectionMatrix = capture.ProjectionMatrix;
+	header.CameraPosition = capture.CameraPosition;
+	header.Bindless = capture.Bindless ? 1u : 0u;
+	header.StreamCount = (uint32_t)capture.Streams.size();
+	header.ViewportSize = (uint32_t)sizeof(Viewport);
+	header.ObjectTransformsSrv = capture.ObjectTransformsSrv;
+
+	bool ok = Capture_Write(fp, &header, 1);
+	ok = ok && Capture_WriteVector(fp, capture.ObjectTransforms);
+	ok = ok && Capture_WriteVector(fp, capture.Resources);
+
+	for (const FrameCaptureStream& stream : capture.Streams)
+	{
+		ok = ok && Capture_WriteVector(fp, stream.Commands);
+		ok = ok && Capture_WriteVector(fp, stream.Payload);
+	}
+
+	fclose(fp);
+
+	if (!ENSUREMSG(ok, "Failed to write capture file (%s)", path))
+		return false;
+
+	LOGINFO("Wrote frame capture %s: %zu command lists, %zu commands, %zu resources",
+		path, capture.Streams.size(), capture.GetCommandCount(), capture.Resources.size());
+
+	return true;
+}
+
+bool FrameCapture_Read(const char* path, FrameCapture& capture)
+{
+	FILE* fp = OpenFile(path, "rb");
+	if (!ENSUREMSG(fp, "Failed to open capture file (%s)", path))
+		return false;
+
+	capture = {};
+
+	CaptureFileHeader header = {};
+	bool ok = Capture_Read(fp, &header, 1);
+
+	if (ok && (header.Magic != FrameCapture::FileMagic || header.Version != FrameCapture::FileVersion))
+	{
+		LOGERROR("%s is not a version %u frame capture", path, FrameCapture::FileVersion);
+		ok = false;
+	}
+
+	// Viewports are stored as raw structs so captures only replay against a build with the same layout
+	if (ok && header.ViewportSize != sizeof(Viewport))
+	{
+		LOGERROR("%s was captured with a different Viewport layout", path);
+		ok = false;
+	}
+
+	if (ok)
+	{
+		capture.ViewportWidth = header.ViewportWidth;
+		capture.ViewportHeight = header.ViewportHeight;
+		capture.ViewMatrix = header.ViewMatrix;
+		capture.ProjectionMatrix = header.ProjectionMatrix;
+		capture.CameraPosition = header.CameraPosition;
+		capture.Bindless = header.Bindless != 0u;
+		capture.ObjectTransformsSrv = header.ObjectTransformsSrv;
+	}
+
+	ok = ok && Capture_ReadVector(fp, capture.ObjectTransforms);
+
+	ok = ok && Capture_ReadVector(fp, capture.Resources);
+
+	for (uint32_t s = 0; ok && s < header.StreamCount; s++)
+	{
+		FrameCaptureStream& stream = capture.Streams.emplace_back();
+		ok = Capture_ReadVector(fp, stream.Commands) && Capture_ReadVector(fp, stream.Payload);
+	}
+
+	fclose(fp);
+
+	if (!ENSUREMSG(ok, "Failed to read capture file (%s)", path))
+	{
+		capture = {};
+		return false;
+	}
+
+	capture.Finalized = true;
+
+	return true;
+}
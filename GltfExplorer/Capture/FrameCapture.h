@@ -0,0 +1,164 @@
+#pragma once
+
+#include "../SceneGraph/RenderStateCache.h"
+
+#include <Render/RenderTypes.h>
+#include <SurfMath.h>
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// The first commands line up with RenderStateCall so stats from the cache and from a capture use the same names
+enum class CaptureCommandType : uint8_t
+{
+	ROOT_SIGNATURE,
+	PIPELINE_STATE,
+	ROOT_CBV,
+	ROOT_DESCRIPTOR_TABLE,
+	ROOT_VALUE,
+	VERTEX_CBVS,
+	PIXEL_CBVS,
+	VERTEX_SRVS,
+	PIXEL_SRVS,
+	INDEX_BUFFER,
+	VERTEX_BUFFERS,
+	RENDER_TARGETS,
+	VIEWPORTS,
+	DEFAULT_SCISSOR,
+	DRAW_INDEXED_INSTANCED,
+	DRAW_INSTANCED,
+	COUNT,
+};
+
+static_assert((uint8_t)CaptureCommandType::VERTEX_BUFFERS == (uint8_t)RenderStateCall::VERTEX_BUFFERS, "Capture commands must mirror RenderStateCall");
+
+const char* CaptureCommandType_GetName(CaptureCommandType type);
+
+enum class CaptureResourceType : uint8_t
+{
+	ROOT_SIGNATURE,
+	PIPELINE_STATE,
+	CONSTANT_BUFFER,
+	DYNAMIC_CONSTANT_BUFFER,
+	DYNAMIC_VERTEX_BUFFER,
+	DYNAMIC_INDEX_BUFFER,
+	VERTEX_BUFFER,
+	INDEX_BUFFER,
+	SHADER_RESOURCE_VIEW,
+	RENDER_TARGET_VIEW,
+	DEPTH_STENCIL_VIEW,
+	COUNT,
+};
+
+const char* CaptureResourceType_GetName(CaptureResourceType type);
+
+enum CaptureCommandFlags : uint8_t
+{
+	CAPTURE_CMD_DYNAMIC = 1 << 0,
+};
+
+// Arguments live in the stream payload starting at PayloadOffset, the layout is fixed per command type:
+//   ROOT_SIGNATURE, PIPELINE_STATE   handle
+//   ROOT_CBV                         handle
+//   ROOT_VALUE                       value
+//   *_CBVS, *_SRVS                   Count handles
+//   INDEX_BUFFER                     handle, format, offset
+//   VERTEX_BUFFERS                   Count handles, Count strides, Count offsets
+//   RENDER_TARGETS                   Count handles, dsv handle
+//   VIEWPORTS                        Count viewports, packed into whole payload words
+//   DRAW_INDEXED_INSTANCED           index count, instance count, start index, base vertex, start instance
+//   DRAW_INSTANCED                   vertex count, instance count, start vertex, start instance
+struct CaptureCommand
+{
+	CaptureCommandType Type = CaptureCommandType::COUNT;
+	uint8_t Flags = 0;
+	uint16_t Count = 0;
+	uint32_t Slot = 0;
+	uint32_t PayloadOffset = 0;
+};
+
+// Payload words that hold a handle. While recording they hold the raw backend handle, Finalize rewrites them as indices
+// into FrameCapture::Resources.
+struct CaptureHandleRef
+{
+	uint32_t PayloadIndex = 0;
+	CaptureResourceType Type = CaptureResourceType::COUNT;
+};
+
+// Calls recorded into one command list. Streams are only written by the thread recording that command list.
+struct FrameCaptureStream
+{
+	std::vector<CaptureCommand> Commands;
+	std::vector<uint64_t> Payload;
+	std::vector<CaptureHandleRef> Handles;
+
+	void RecordHandle(CaptureCommandType type, uint32_t slot, CaptureResourceType resourceType, uint64_t handle, uint8_t flags = 0);
+	void RecordValue(CaptureCommandType type, uint32_t slot, uint32_t value);
+	void RecordHandles(CaptureCommandType type, uint32_t startSlot, uint32_t count, CaptureResourceType resourceType, const uint64_t* handles, uint8_t flags = 0);
+	void RecordIndexBuffer(CaptureResourceType resourceType, uint64_t handle, tpr::RenderFormat format, uint32_t offset, uint8_t flags);
+	void RecordVertexBuffers(uint32_t startSlot, uint32_t count, CaptureResourceType resourceType, const uint64_t* handles, const uint32_t* strides, const uint32_t* offsets, uint8_t flags);
+	void RecordRenderTargets(const tpr::RenderTargetView_t* rtvs, uint32_t count, tpr::DepthStencilView_t dsv);
+	void RecordViewports(const tpr::Viewport* viewports, uint32_t count);
+	void RecordDefaultScissor();
+	void RecordDrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, uint32_t baseVertex, uint32_t startInstance);
+	void RecordDrawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance);
+
+private:
+
+	CaptureCommand& BeginCommand(CaptureCommandType type, uint32_t slot, uint16_t count, uint8_t flags);
+	void PushHandle(CaptureResourceType resourceType, uint64_t handle);
+};
+
+struct CaptureResource
+{
+	CaptureResourceType Type = CaptureResourceType::COUNT;
+
+	// Handle value at capture time, only kept to make captures easier to debug
+	uint64_t OriginalHandle = 0;
+};
+
+// One frame of scene state and every command list recorded for it, in submission order. Replaying a capture needs nothing
+// but the file, resources are recreated as placeholders so a replay measures submission cost rather than GPU work. The
+// object transforms are the exception, they are restored so the replayed draws place the scene where it was captured.
+struct FrameCapture
+{
+	static constexpr uint32_t FileMagic = 0x50435847; // GXCP
+	static constexpr uint32_t FileVersion = 3;
+
+	matrix ViewMatrix = {};
+	matrix ProjectionMatrix = {};
+	float3 CameraPosition = {};
+	uint32_t ViewportWidth = 0;
+	uint32_t ViewportHeight = 0;
+	bool Bindless = false;
+
+	// Scene transforms by object id and the view the draws read them through, so a replay draws the captured scene.
+	// Finalize turns the view into a resource index, ~0 when no command bound it as bindless draws reach it by descriptor.
+	std::vector<matrix> ObjectTransforms;
+	uint64_t ObjectTransformsSrv = 0;
+
+	std::vector<CaptureResource> Resources;
+
+	// A deque so streams handed out to recording threads stay put as more are added
+	std::deque<FrameCaptureStream> Streams;
+
+	// Not thread safe, add every stream before recording into any of them
+	FrameCaptureStream* AddStream();
+
+	// Rewrites raw handles as resource indices, call once after the last stream has been recorded
+	void Finalize();
+
+	bool IsFinalized() const noexcept { return Finalized; }
+
+	size_t GetCommandCount() const noexcept;
+
+private:
+
+	bool Finalized = false;
+
+	friend bool FrameCapture_Read(const char* path, FrameCapture& capture);
+};
+
+bool FrameCapture_Write(const FrameCapture& capture, const char* path);
+bool FrameCapture_Read(const char* path, FrameCapture& capture);
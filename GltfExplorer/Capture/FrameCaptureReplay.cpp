@@ -0,0 +1,500 @@
+#include "FrameCaptureReplay.h"
+
+#include "../Logging.h"
+#include "../SceneGraph/SceneTransformBuffer.h"
+
+#include <Render/Render.h>
+
+#include <chrono>
+#include <cstring>
+
+using namespace tpr;
+
+static constexpr uint32_t MaxReplayCBVs = 16u;
+static constexpr uint32_t MaxReplaySRVs = 32u;
+static constexpr uint32_t MaxReplayVertexBuffers = 16u;
+static constexpr uint32_t MaxReplayRenderTargets = 8u;
+static constexpr uint32_t MaxReplayViewports = 16u;
+
+static constexpr uint64_t InvalidResourceIndex = ~0ull;
+
+// Placeholder buffers are zero filled, this is big enough for any constant buffer and a few thousand indices
+static constexpr size_t PlaceholderBufferSize = 64u * 1024u;
+static constexpr size_t PlaceholderDynamicBufferSize = 256u;
+
+using ReplayClock = std::chrono::steady_clock;
+
+CaptureReplayStats& CaptureReplayStats::operator+=(const CaptureReplayStats& other) noexcept
+{
+	for (uint8_t i = 0; i < (uint8_t)CaptureCommandType::COUNT; i++)
+	{
+		Calls[i] += other.Calls[i];
+		CallNanoseconds[i] += other.CallNanoseconds[i];
+	}
+	RecordMilliseconds += other.RecordMilliseconds;
+	SubmitMilliseconds += other.SubmitMilliseconds;
+	Frames += other.Frames;
+	return *this;
+}
+
+static uint32_t CaptureCommand_GetPayloadWords(const CaptureCommand& cmd)
+{
+	switch (cmd.Type)
+	{
+	case CaptureCommandType::ROOT_SIGNATURE:
+	case CaptureCommandType::PIPELINE_STATE:
+	case CaptureCommandType::ROOT_CBV:
+	case CaptureCommandType::ROOT_DESCRIPTOR_TABLE:
+	case CaptureCommandType::ROOT_VALUE:
+		return 1u;
+	case CaptureCommandType::VERTEX_CBVS:
+	case CaptureCommandType::PIXEL_CBVS:
+	case CaptureCommandType::VERTEX_SRVS:
+	case CaptureCommandType::PIXEL_SRVS:
+		return cmd.Count;
+	case CaptureCommandType::INDEX_BUFFER:
+		return 3u;
+	case CaptureCommandType::VERTEX_BUFFERS:
+		return cmd.Count * 3u;
+	case CaptureCommandType::RENDER_TARGETS:
+		return cmd.Count + 1u;
+	case CaptureCommandType::VIEWPORTS:
+		return (uint32_t)((sizeof(Viewport) * cmd.Count + sizeof(uint64_t) - 1u) / sizeof(uint64_t));
+	case CaptureCommandType::DEFAULT_SCISSOR:
+		return 0u;
+	case CaptureCommandType::DRAW_INDEXED_INSTANCED:
+		return 5u;
+	case CaptureCommandType::DRAW_INSTANCED:
+		return 4u;
+	default:
+		return ~0u;
+	}
+}
+
+static uint32_t CaptureCommand_GetMaxCount(CaptureCommandType type)
+{
+	switch (type)
+	{
+	case CaptureCommandType::VERTEX_CBVS:
+	case CaptureCommandType::PIXEL_CBVS:
+		return MaxReplayCBVs;
+	case CaptureCommandType::VERTEX_SRVS:
+	case CaptureCommandType::PIXEL_SRVS:
+		return MaxReplaySRVs;
+	case CaptureCommandType::VERTEX_BUFFERS:
+		return MaxReplayVertexBuffers;
+	case CaptureCommandType::RENDER_TARGETS:
+		return MaxReplayRenderTargets;
+	case CaptureCommandType::VIEWPORTS:
+		return MaxReplayViewports;
+	default:
+		return 1u;
+	}
+}
+
+// Resource type the handle at `word` of a command has to refer to, COUNT when that word is not a handle
+static CaptureResourceType CaptureCommand_GetHandleType(const CaptureCommand& cmd, uint32_t word)
+{
+	const bool dynamic = (cmd.Flags & CAPTURE_CMD_DYNAMIC) != 0;
+
+	switch (cmd.Type)
+	{
+	case CaptureCommandType::ROOT_SIGNATURE:
+		return CaptureResourceType::ROOT_SIGNATURE;
+	case CaptureCommandType::PIPELINE_STATE:
+		return CaptureResourceType::PIPELINE_STATE;
+	case CaptureCommandType::ROOT_CBV:
+	case CaptureCommandType::VERTEX_CBVS:
+	case CaptureCommandType::PIXEL_CBVS:
+		return dynamic ? CaptureResourceType::DYNAMIC_CONSTANT_BUFFER : CaptureResourceType::CONSTANT_BUFFER;
+	case CaptureCommandType::VERTEX_SRVS:
+	case CaptureCommandType::PIXEL_SRVS:
+		return CaptureResourceType::SHADER_RESOURCE_VIEW;
+	case CaptureCommandType::INDEX_BUFFER:
+		if (word != 0u)
+			return CaptureResourceType::COUNT;
+		return dynamic ? CaptureResourceType::DYNAMIC_INDEX_BUFFER : CaptureResourceType::INDEX_BUFFER;
+	case CaptureCommandType::VERTEX_BUFFERS:
+		if (word >= cmd.Count)
+			return CaptureResourceType::COUNT;
+		return dynamic ? CaptureResourceType::DYNAMIC_VERTEX_BUFFER : CaptureResourceType::VERTEX_BUFFER;
+	case CaptureCommandType::RENDER_TARGETS:
+		return word < cmd.Count ? CaptureResourceType::RENDER_TARGET_VIEW : CaptureResourceType::DEPTH_STENCIL_VIEW;
+	default:
+		return CaptureResourceType::COUNT;
+	}
+}
+
+bool FrameCaptureReplayer::Validate() const
+{
+	const FrameCapture& capture = *Capture;
+
+	for (size_t s = 0; s < capture.Streams.size(); s++)
+	{
+		const FrameCaptureStream& stream = capture.Streams[s];
+
+		for (size_t c = 0; c < stream.Commands.size(); c++)
+		{
+			const CaptureCommand& cmd = stream.Commands[c];
+
+			const uint32_t words = CaptureCommand_GetPayloadWords(cmd);
+			if (words == ~0u || cmd.Count > CaptureCommand_GetMaxCount(cmd.Type) || (uint64_t)cmd.PayloadOffset + words > stream.Payload.size())
+			{
+				LOGERROR("Capture stream %zu command %zu (%s) is malformed", s, c, CaptureCommandType_GetName(cmd.Type));
+				return false;
+			}
+
+			for (uint32_t w = 0; w < words; w++)
+			{
+				const CaptureResourceType expected = CaptureCommand_GetHandleType(cmd, w);
+				if (expected == CaptureResourceType::COUNT)
+					continue;
+
+				const uint64_t index = stream.Payload[cmd.PayloadOffset + w];
+				if (index == InvalidResourceIndex)
+					continue;
+
+				if (index >= capture.Resources.size() || capture.Resources[index].Type != expected)
+				{
+					LOGERROR("Capture stream %zu command %zu (%s) references resource %llu which is not a %s",
+						s, c, CaptureCommandType_GetName(cmd.Type), (unsigned long long)index, CaptureResourceType_GetName(expected));
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+void FrameCaptureReplayer::CreateResources(const FrameCaptureReplayBackend& backend)
+{
+	const FrameCapture& capture = *Capture;
+
+	// Root arguments are rebuilt from the slots the capture uses. Registers follow the slot index so no two slots collide.
+	enum class SlotUse : uint8_t { NONE, CBV, VALUE, TABLE };
+	std::vector<SlotUse> slotUses;
+
+	for (const FrameCaptureStream& stream : capture.Streams)
+	{
+		for (const CaptureCommand& cmd : stream.Commands)
+		{
+			SlotUse use = SlotUse::NONE;
+			switch (cmd.Type)
+			{
+			case CaptureCommandType::ROOT_CBV: use = SlotUse::CBV; break;
+			case CaptureCommandType::ROOT_VALUE: use = SlotUse::VALUE; break;
+			case CaptureCommandType::ROOT_DESCRIPTOR_TABLE: use = SlotUse::TABLE; break;
+			default: continue;
+			}
+
+			if (cmd.Slot >= slotUses.size())
+				slotUses.resize(cmd.Slot + 1u, SlotUse::NONE);
+
+			slotUses[cmd.Slot] = use;
+		}
+	}
+
+	RootSignatureDesc rootSigDesc = {};
+	rootSigDesc.Flags = RootSignatureFlags::ALLOW_INPUT_LAYOUT;
+	rootSigDesc.Slots.resize(slotUses.size());
+	for (uint32_t slot = 0; slot < (uint32_t)slotUses.size(); slot++)
+	{
+		switch (slotUses[slot])
+		{
+		case SlotUse::CBV: rootSigDesc.Slots[slot] = RootSignatureSlot::CBVSlot(slot, 0); break;
+		case SlotUse::TABLE: rootSigDesc.Slots[slot] = RootSignatureSlot::DescriptorTableSlot(0, slot, RootSignatureDescriptorTableType::SRV); break;
+		default: rootSigDesc.Slots[slot] = RootSignatureSlot::ConstantsSlot(1u, slot); break;
+		}
+	}
+
+	rootSigDesc.GlobalSamplers.resize(1);
+	rootSigDesc.GlobalSamplers[0].AddressModeUVW(SamplerAddressMode::WRAP).FilterModeMinMagMip(SamplerFilterMode::LINEAR);
+
+	RootSignature = CreateRootSignature(rootSigDesc);
+
+	const std::vector<uint8_t> zeros(PlaceholderBufferSize, 0u);
+
+	ResourceHandles.assign(capture.Resources.size(), 0u);
+
+	for (size_t i = 0; i < capture.Resources.size(); i++)
+	{
+		switch (capture.Resources[i].Type)
+		{
+		case CaptureResourceType::ROOT_SIGNATURE:
+			ResourceHandles[i] = static_cast<uint64_t>(RootSignature.Get());
+			break;
+		case CaptureResourceType::PIPELINE_STATE:
+			Psos.push_back(backend.CreatePipelineState());
+			ResourceHandles[i] = static_cast<uint64_t>(Psos.back().Get());
+			break;
+		case CaptureResourceType::CONSTANT_BUFFER:
+			ConstantBuffers.push_back(CreateConstantBuffer(zeros.data(), PlaceholderDynamicBufferSize));
+			ResourceHandles[i] = static_cast<uint64_t>(ConstantBuffers.back().Get());
+			break;
+		case CaptureResourceType::VERTEX_BUFFER:
+			VertexBuffers.push_back(CreateVertexBuffer(zeros.data(), zeros.size()));
+			ResourceHandles[i] = static_cast<uint64_t>(VertexBuffers.back().Get());
+			break;
+		case CaptureResourceType::INDEX_BUFFER:
+			IndexBuffers.push_back(CreateIndexBuffer(zeros.data(), zeros.size()));
+			ResourceHandles[i] = static_cast<uint64_t>(IndexBuffers.back().Get());
+			break;
+		case CaptureResourceType::SHADER_RESOURCE_VIEW:
+		{
+			if (i == capture.ObjectTransformsSrv && !capture.ObjectTransforms.empty())
+			{
+				// Previous matches Current, as it does for any object that did not move that frame
+				std::vector<ObjectTransform> transforms(capture.ObjectTransforms.size());
+				for (size_t o = 0; o < transforms.size(); o++)
+				{
+					transforms[o].Current = capture.ObjectTransforms[o];
+					transforms[o].Previous = capture.ObjectTransforms[o];
+				}
+
+				ObjectTransforms = CreateStructuredBuffer(transforms.data(), transforms.size() * sizeof(ObjectTransform), sizeof(ObjectTransform));
+				Srvs.push_back(CreateStructuredBufferSRV(ObjectTransforms, 0u, (uint32_t)transforms.size(), sizeof(ObjectTransform)));
+				ResourceHandles[i] = static_cast<uint64_t>(Srvs.back().Get());
+				break;
+			}
+
+			TextureCreateDesc texDesc = {};
+			texDesc.Width = 4;
+			texDesc.Height = 4;
+			texDesc.Format = RenderFormat::R8G8B8A8_UNORM;
+			texDesc.Flags = RenderResourceFlags::SRV;
+			Textures.push_back(CreateTexture(texDesc));
+			Srvs.push_back(CreateTextureSRV(Textures.back(), RenderFormat::R8G8B8A8_UNORM, TextureDimension::TEX2D, 1u, 1u));
+			ResourceHandles[i] = static_cast<uint64_t>(Srvs.back().Get());
+			break;
+		}
+		case CaptureResourceType::DEPTH_STENCIL_VIEW:
+		{
+			TextureCreateDesc depthDesc = {};
+			depthDesc.Width = Max(capture.ViewportWidth, 1u);
+			depthDesc.Height = Max(capture.ViewportHeight, 1u);
+			depthDesc.Format = RenderFormat::D32_FLOAT;
+			depthDesc.Flags = RenderResourceFlags::DSV;
+			Textures.push_back(CreateTexture(depthDesc));
+			Dsvs.push_back(CreateTextureDSV(Textures.back(), RenderFormat::D32_FLOAT, TextureDimension::TEX2D, 1u));
+			ResourceHandles[i] = static_cast<uint64_t>(Dsvs.back().Get());
+			break;
+		}
+		case CaptureResourceType::RENDER_TARGET_VIEW:
+			Rtvs.push_back(backend.CreateRenderTargetView(Max(capture.ViewportWidth, 1u), Max(capture.ViewportHeight, 1u)));
+			ResourceHandles[i] = static_cast<uint64_t>(Rtvs.back().Get());
+			break;
+		default:
+			// Dynamic buffers are created per frame
+			break;
+		}
+	}
+}
+
+void FrameCaptureReplayer::CreateFrameResources()
+{
+	static const uint8_t zeros[PlaceholderDynamicBufferSize] = {};
+
+	for (size_t i = 0; i < Capture->Resources.size(); i++)
+	{
+		switch (Capture->Resources[i].Type)
+		{
+		case CaptureResourceType::DYNAMIC_CONSTANT_BUFFER:
+			ResourceHandles[i] = static_cast<uint64_t>(CreateDynamicConstantBuffer(zeros, sizeof(zeros)));
+			break;
+		case CaptureResourceType::DYNAMIC_VERTEX_BUFFER:
+			ResourceHandles[i] = static_cast<uint64_t>(CreateDynamicVertexBuffer(zeros, sizeof(zeros)));
+			break;
+		case CaptureResourceType::DYNAMIC_INDEX_BUFFER:
+			ResourceHandles[i] = static_cast<uint64_t>(CreateDynamicIndexBuffer(zeros, sizeof(zeros)));
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+bool FrameCaptureReplayer::Init(const FrameCapture& capture, const FrameCaptureReplayBackend& backend)
+{
+	if (!ENSUREMSG(capture.IsFinalized(), "Only finalized captures can be replayed"))
+		return false;
+
+	if (!ENSUREMSG(backend.CreatePipelineState && backend.CreateRenderTargetView, "Replay needs the backend's pipeline and render target hooks"))
+		return false;
+
+	Capture = &capture;
+
+	if (!Validate())
+	{
+		Capture = nullptr;
+		return false;
+	}
+
+	CreateResources(backend);
+
+	return true;
+}
+
+void FrameCaptureReplayer::ReplayStream(const FrameCaptureStream& stream, CommandList* cl, bool timeCalls, CaptureReplayStats& stats) const
+{
+	const uint64_t* payload = stream.Payload.data();
+
+	for (const CaptureCommand& cmd : stream.Commands)
+	{
+		const uint64_t* args = payload + cmd.PayloadOffset;
+
+		ReplayClock::time_point start;
+		if (timeCalls)
+			start = ReplayClock::now();
+
+		const bool dynamic = (cmd.Flags & CAPTURE_CMD_DYNAMIC) != 0;
+
+		switch (cmd.Type)
+		{
+		case CaptureCommandType::ROOT_SIGNATURE:
+			cl->SetRootSignature(GetHandle<RootSignature_t>(args[0]));
+			break;
+		case CaptureCommandType::PIPELINE_STATE:
+			cl->SetPipelineState(GetHandle<GraphicsPipelineState_t>(args[0]));
+			break;
+		case CaptureCommandType::ROOT_CBV:
+			if (dynamic)
+				cl->SetGraphicsRootCBV(cmd.Slot, GetHandle<DynamicBuffer_t>(args[0]));
+			else
+				cl->SetGraphicsRootCBV(cmd.Slot, GetHandle<ConstantBuffer_t>(args[0]));
+			break;
+		case CaptureCommandType::ROOT_DESCRIPTOR_TABLE:
+			cl->SetGraphicsRootDescriptorTable(cmd.Slot);
+			break;
+		case CaptureCommandType::ROOT_VALUE:
+			cl->SetGraphicsRootValue(cmd.Slot, (uint32_t)args[0]);
+			break;
+		case CaptureCommandType::VERTEX_CBVS:
+		case CaptureCommandType::PIXEL_CBVS:
+		{
+			const bool vertex = cmd.Type == CaptureCommandType::VERTEX_CBVS;
+			if (dynamic)
+			{
+				DynamicBuffer_t bufs[MaxReplayCBVs];
+				for (uint32_t i = 0; i < cmd.Count; i++)
+					bufs[i] = GetHandle<DynamicBuffer_t>(args[i]);
+
+				vertex ? cl->BindVertexCBVs(cmd.Slot, cmd.Count, bufs) : cl->BindPixelCBVs(cmd.Slot, cmd.Count, bufs);
+			}
+			else
+			{
+				ConstantBuffer_t bufs[MaxReplayCBVs];
+				for (uint32_t i = 0; i < cmd.Count; i++)
+					bufs[i] = GetHandle<ConstantBuffer_t>(args[i]);
+
+				vertex ? cl->BindVertexCBVs(cmd.Slot, cmd.Count, bufs) : cl->BindPixelCBVs(cmd.Slot, cmd.Count, bufs);
+			}
+			break;
+		}
+		case CaptureCommandType::VERTEX_SRVS:
+		case CaptureCommandType::PIXEL_SRVS:
+		{
+			ShaderResourceView_t srvs[MaxReplaySRVs];
+			for (uint32_t i = 0; i < cmd.Count; i++)
+				srvs[i] = GetHandle<ShaderResourceView_t>(args[i]);
+
+			if (cmd.Type == CaptureCommandType::VERTEX_SRVS)
+				cl->BindVertexSRVs(cmd.Slot, cmd.Count, srvs);
+			else
+				cl->BindPixelSRVs(cmd.Slot, cmd.Count, srvs);
+			break;
+		}
+		case CaptureCommandType::INDEX_BUFFER:
+			if (dynamic)
+				cl->SetIndexBuffer(GetHandle<DynamicBuffer_t>(args[0]), (RenderFormat)args[1], (uint32_t)args[2]);
+			else
+				cl->SetIndexBuffer(GetHandle<IndexBuffer_t>(args[0]), (RenderFormat)args[1], (uint32_t)args[2]);
+			break;
+		case CaptureCommandType::VERTEX_BUFFERS:
+		{
+			uint32_t strides[MaxReplayVertexBuffers];
+			uint32_t offsets[MaxReplayVertexBuffers];
+			for (uint32_t i = 0; i < cmd.Count; i++)
+			{
+				strides[i] = (uint32_t)args[cmd.Count + i];
+				offsets[i] = (uint32_t)args[cmd.Count * 2u + i];
+			}
+
+			if (dynamic)
+			{
+				DynamicBuffer_t bufs[MaxReplayVertexBuffers];
+				for (uint32_t i = 0; i < cmd.Count; i++)
+					bufs[i] = GetHandle<DynamicBuffer_t>(args[i]);
+
+				cl->SetVertexBuffers(cmd.Slot, cmd.Count, bufs, strides, offsets);
+			}
+			else
+			{
+				VertexBuffer_t bufs[MaxReplayVertexBuffers];
+				for (uint32_t i = 0; i < cmd.Count; i++)
+					bufs[i] = GetHandle<VertexBuffer_t>(args[i]);
+
+				cl->SetVertexBuffers(cmd.Slot, cmd.Count, bufs, strides, offsets);
+			}
+			break;
+		}
+		case CaptureCommandType::RENDER_TARGETS:
+		{
+			RenderTargetView_t rtvs[MaxReplayRenderTargets];
+			for (uint32_t i = 0; i < cmd.Count; i++)
+				rtvs[i] = GetHandle<RenderTargetView_t>(args[i]);
+
+			cl->SetRenderTargets(cmd.Count > 0u ? rtvs : nullptr, cmd.Count, GetHandle<DepthStencilView_t>(args[cmd.Count]));
+			break;
+		}
+		case CaptureCommandType::VIEWPORTS:
+		{
+			Viewport viewports[MaxReplayViewports];
+			memcpy((void*)viewports, args, sizeof(Viewport) * cmd.Count);
+			cl->SetViewports(viewports, cmd.Count);
+			break;
+		}
+		case CaptureCommandType::DEFAULT_SCISSOR:
+			cl->SetDefaultScissor();
+			break;
+		case CaptureCommandType::DRAW_INDEXED_INSTANCED:
+			cl->DrawIndexedInstanced((uint32_t)args[0], (uint32_t)args[1], (uint32_t)args[2], (uint32_t)args[3], (uint32_t)args[4]);
+			break;
+		case CaptureCommandType::DRAW_INSTANCED:
+			cl->DrawInstanced((uint32_t)args[0], (uint32_t)args[1], (uint32_t)args[2], (uint32_t)args[3]);
+			break;
+		default:
+			break;
+		}
+
+		stats.Calls[(uint8_t)cmd.Type]++;
+
+		if (timeCalls)
+			stats.CallNanoseconds[(uint8_t)cmd.Type] += std::chrono::duration<double, std::nano>(ReplayClock::now() - start).count();
+	}
+}
+
+void FrameCaptureReplayer::ReplayFrame(bool timeCalls, CaptureReplayStats& stats)
+{
+	if (!ENSUREMSG(Capture, "Replay has not been initialised"))
+		return;
+
+	CreateFrameResources();
+
+	CommandListSubmissionGroup clGroup(CommandListType::GRAPHICS);
+
+	const ReplayClock::time_point recordStart = ReplayClock::now();
+
+	for (const FrameCaptureStream& stream : Capture->Streams)
+	{
+		ReplayStream(stream, clGroup.CreateCommandList(), timeCalls, stats);
+	}
+
+	const ReplayClock::time_point submitStart = ReplayClock::now();
+
+	clGroup.Submit();
+
+	stats.RecordMilliseconds += std::chrono::duration<double, std::milli>(submitStart - recordStart).count();
+	stats.SubmitMilliseconds += std::chrono::duration<double, std::milli>(ReplayClock::now() - submitStart).count();
+	stats.Frames++;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "FrameCapture.h"
+
+#include <Render/RenderTypes.h>
+
+#include <cstdint>
+#include <vector>
+
+struct CaptureReplayStats
+{
+	uint64_t Calls[(uint8_t)CaptureCommandType::COUNT] = {};
+	double CallNanoseconds[(uint8_t)CaptureCommandType::COUNT] = {};
+	double RecordMilliseconds = 0.0;
+	double SubmitMilliseconds = 0.0;
+	uint32_t Frames = 0;
+
+	CaptureReplayStats& operator+=(const CaptureReplayStats& other) noexcept;
+};
+
+// Makes the placeholders a capture does not hold enough to rebuild through the tpr API, on the backend being replayed
+struct FrameCaptureReplayBackend
+{
+	// Stands in for each pipeline the capture bound. A capture records which pipeline is bound but not its shaders or state.
+	tpr::GraphicsPipelineState_t (*CreatePipelineState)() = nullptr;
+
+	// Stands in for each render target the capture bound, sized to the captured viewport
+	tpr::RenderTargetView_t (*CreateRenderTargetView)(uint32_t width, uint32_t height) = nullptr;
+};
+
+// Re-executes a capture against whichever backend is linked. Resources are placeholders created from the capture's
+// resource table: buffers hold zeros, views point at tiny textures, and pipelines and render targets come from the
+// backend hooks. The object transform view is rebuilt from the captured transforms so draws read the captured scene.
+struct FrameCaptureReplayer
+{
+	// Validates every command against the resource table before creating anything, fails on a malformed capture or
+	// when a hook is missing
+	bool Init(const FrameCapture& capture, const FrameCaptureReplayBackend& backend);
+
+	// Records every stream into its own command list, in capture order, and submits them as one group.
+	// Timing every call adds a clock read per call, leave it off to measure the whole frame.
+	void ReplayFrame(bool timeCalls, CaptureReplayStats& stats);
+
+private:
+
+	bool Validate() const;
+	void CreateResources(const FrameCaptureReplayBackend& backend);
+	void CreateFrameResources();
+	void ReplayStream(const FrameCaptureStream& stream, tpr::CommandList* cl, bool timeCalls, CaptureReplayStats& stats) const;
+
+	template<typename T>
+	T GetHandle(uint64_t index) const { return index < ResourceHandles.size() ? static_cast<T>(ResourceHandles[index]) : T::INVALID; }
+
+	const FrameCapture* Capture = nullptr;
+
+	// Backend handle for every capture resource, dynamic buffers are refilled every replayed frame
+	std::vector<uint64_t> ResourceHandles;
+
+	tpr::RootSignaturePtr RootSignature;
+	std::vector<tpr::GraphicsPipelineStatePtr> Psos;
+	std::vector<tpr::ConstantBufferPtr> ConstantBuffers;
+	std::vector<tpr::VertexBufferPtr> VertexBuffers;
+	std::vector<tpr::IndexBufferPtr> IndexBuffers;
+	tpr::StructuredBufferPtr ObjectTransforms;
+	std::vector<tpr::TexturePtr> Textures;
+	std::vector<tpr::ShaderResourceViewPtr> Srvs;
+	std::vector<tpr::RenderPtr<tpr::DepthStencilView_t>> Dsvs;
+	std::vector<tpr::RenderPtr<tpr::RenderTargetView_t>> Rtvs;
+};
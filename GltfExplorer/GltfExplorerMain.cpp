@@ -2,12 +2,27 @@
 #include <Clock.h>
 #include <SurfMath.h>
 
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
 #include "backends/imgui_impl_win32.h"
 #include "imgui.h"
 #include "imgui_impl_render.h"
 
+#include "Camera/CameraPath.h"
 #include "Camera/FlyCamera.h"
+#include "Capture/FrameCapture.h"
 #include "DebugDraw/DebugDraw.h"
+#include "Profiler/Profiler.h"
+#include "Profiler/ProfilerUI.h"
+#include "SceneGraph/FramePipeline.h"
+#include "SceneGraph/RenderSortKey.h"
+#include "SceneGraph/RenderStateCache.h"
+#include "SceneGraph/SceneRendering.h"
+#include "Textures/TextureCache.h"
+#include "Logging.h"
 #include "TextureLoader.h"
 #include "Scene.h"
 
@@ -15,16 +30,81 @@ using namespace tpr;
 
 static constexpr RenderFormat DepthFormat = RenderFormat::D32_FLOAT;
 
+static constexpr const char* CameraPathFile = "GltfExplorer_camera.path";
+static constexpr const char* LogFile = "GltfExplorer.log";
+static constexpr const char* TextureCacheDir = "TextureCache";
+static constexpr uint64_t TextureStreamingBudgetBytes = 1024ull << 20u;
+
+enum class CameraPathMode : uint8_t
+{
+	IDLE,
+	RECORDING,
+	PLAYING,
+};
+
+// Camera state sampled on the main thread, the simulation stage never touches the camera or ImGui
+struct SceneFrameInput
+{
+	matrix View = {};
+	matrix Projection = {};
+	float3 CameraPosition = {};
+	uint32_t ViewportHeight = 0;
+	bool FrustumCulling = true;
+};
+
+struct SceneDrawItem
+{
+	uint32_t TransformId = 0;
+	const SMesh* Mesh = nullptr;
+	const SMaterial* Material = nullptr;
+	GraphicsPipelineState_t Pso = GraphicsPipelineState_t::INVALID;
+};
+
+// Output of the simulation stage, the render stage records Draws in order without looking at the scene nodes
+struct SceneFrameSnapshot
+{
+	SceneFrameInput View;
+	std::vector<SceneDrawItem> Draws;
+	uint32_t VisibleNodes = 0;
+	uint32_t CulledNodes = 0;
+
+	// Most detailed mip each scene image was drawn at, FLT_MAX when nothing visible samples it
+	std::vector<float> TextureMips;
+
+	// Kept between frames so culling and sorting stop allocating once the scene has been seen
+	std::vector<SceneDrawItem> Unsorted;
+	std::vector<uint64_t> SortKeys;
+	std::vector<uint64_t> SortKeysScratch;
+	std::vector<uint32_t> SortIndices;
+	std::vector<uint32_t> SortIndicesScratch;
+};
+
 static struct
 {
 	uint32_t ScreenWidth = 0;
 	uint32_t ScreenHeight = 0;
 	FlyCamera Camera;
+	Clock FrameClock;
+
+	CameraPath RecordedPath;
+	CameraPathMode PathMode = CameraPathMode::IDLE;
+	float PathTime = 0.0f;
 
 	RenderPtr<Texture_t> DepthTexture;
 	RenderPtr<DepthStencilView_t> Dsv;
 
 	SScene Scene;
+
+	RenderStateCacheStats LastFrameStateStats;
+
+	bool CaptureNextFrame = false;
+	uint32_t CaptureCount = 0;
+
+	bool PipelinedUpdate = true;
+	bool FrustumCulling = true;
+	uint32_t LastVisibleNodes = 0;
+	uint32_t LastCulledNodes = 0;
+	float LastSimulationWaitMilliseconds = 0.0f;
 } G;
 
 struct DirectionalLight
@@ -55,12 +135,30 @@ struct SkyDome
 	TexturePtr SkyTexture;
 	ShaderResourceViewPtr Srv;
 
+	// Ambient lighting baked from the same image
+	EnvironmentLighting Environment;
+	ShaderResourceViewPtr SpecularSrv;
+	ShaderResourceViewPtr BrdfLutSrv;
+
 	GraphicsPipelineStatePtr Pso;
 
 	void Load(const char* path)
 	{
-		SkyTexture = LoadHdrTextureFromFile(path);
-		Srv = CreateTextureSRV(SkyTexture, RenderFormat::R32G32B32A32_FLOAT, TextureDimension::TEX2D, 1u, 1u);
+		// BC6H is a sixteenth of the float32 size, the mips stop the sky aliasing where it is minified
+		HdrLoadParams skyParams;
+		skyParams.Encoding = HdrEncoding::BC6H;
+		skyParams.GenerateMips = true;
+
+		TextureLoadInfo skyInfo;
+		SkyTexture = LoadHdrTextureFromFile(path, skyParams, &skyInfo);
+		Srv = CreateTextureSRV(SkyTexture, skyInfo.Format, skyInfo.Dimension, skyInfo.MipCount, skyInfo.ArraySize);
+
+		if (LoadEnvironmentLightingFromFile(path, EnvironmentLightingParams{}, Environment))
+		{
+			const TextureLoadInfo& specularInfo = Environment.SpecularInfo;
+			SpecularSrv = CreateTextureSRV(Environment.SpecularTexture, specularInfo.Format, specularInfo.Dimension, specularInfo.MipCount, specularInfo.ArraySize);
+			BrdfLutSrv = CreateTextureSRV(Environment.BrdfLutTexture, Environment.BrdfLutInfo.Format, TextureDimension::TEX2D, 1u, 1u);
+		}
 		
 		constexpr uint32_t stacks = 16;
 		constexpr uint32_t slices = 32;
@@ -163,6 +261,150 @@ struct SkyDome
 
 } GSkyDome;
 
+static void StartCameraPathRecording()
+{
+	G.RecordedPath.Clear();
+	G.PathTime = 0.0f;
+	G.RecordedPath.AddKey(CameraPathKey{ 0.0f, G.Camera.GetPosition(), G.Camera.GetPitch(), G.Camera.GetYaw() });
+	G.PathMode = CameraPathMode::RECORDING;
+}
+
+static void StartCameraPathPlayback()
+{
+	G.PathTime = 0.0f;
+	G.PathMode = CameraPathMode::PLAYING;
+
+	// Frame time stats cover exactly one run of the path
+	G.FrameClock.GetStats().Reset();
+}
+
+static void UpdateCamera(float deltaSeconds)
+{
+	if (G.PathMode == CameraPathMode::PLAYING)
+	{
+		// Fixed timestep, every run of a path shows the same views however long the frames take
+		const CameraPathKey key = G.RecordedPath.Sample(G.PathTime);
+		G.Camera.SetView(key.Position, key.Pitch, key.Yaw);
+
+		G.PathTime += CameraPath::PlaybackTimestep;
+
+		if (G.PathTime > G.RecordedPath.GetDuration() + CameraPath::PlaybackTimestep)
+		{
+			const FrameTimeSummary summary = G.FrameClock.GetStats().Summarize();
+			LOGINFO("Camera path done: %u frames, avg %.2f p50 %.2f p95 %.2f p99 %.2f max %.2f ms", summary.SampleCount,
+				summary.AvgMilliseconds, summary.P50Milliseconds, summary.P95Milliseconds, summary.P99Milliseconds, summary.MaxMilliseconds);
+
+			G.PathMode = CameraPathMode::IDLE;
+		}
+
+		return;
+	}
+
+	G.Camera.UpdateView(deltaSeconds);
+
+	if (G.PathMode == CameraPathMode::RECORDING)
+	{
+		G.PathTime += deltaSeconds;
+		G.RecordedPath.AddKey(CameraPathKey{ G.PathTime, G.Camera.GetPosition(), G.Camera.GetPitch(), G.Camera.GetYaw() });
+	}
+}
+
+// Runs on the pipeline worker. PSOs are precached before the first frame so resolving them here never creates one.
+static void SimulateScene(const SceneFrameInput& input, const GraphicsPipelineTargetDesc& targetDesc, SceneFrameSnapshot& snapshot)
+{
+	snapshot.View = input;
+	snapshot.Unsorted.clear();
+	snapshot.SortKeys.clear();
+	snapshot.VisibleNodes = 0;
+	snapshot.CulledNodes = 0;
+
+	const bool streaming = G.Scene.Streaming != nullptr;
+	const SceneStreamingView streamingView = SceneStreaming_MakeView(input.Projection, input.ViewportHeight, input.CameraPosition);
+
+	if (streaming)
+	{
+		snapshot.TextureMips.assign(G.Scene.Textures.size(), FLT_MAX);
+	}
+
+	{
+		PROFILE_ZONE("Cull");
+
+		const FrustumPlanes frustum(input.View * input.Projection);
+
+		for (const SNode& node : G.Scene.Nodes)
+		{
+			if (node.Model == SceneModel_t::INVALID)
+				continue;
+
+			AABB bounds = node.WorldBounds;
+			if (input.FrustumCulling && !bounds.Invalid() && !frustum.Intersects(bounds))
+			{
+				snapshot.CulledNodes++;
+				continue;
+			}
+
+			snapshot.VisibleNodes++;
+
+			const float depth = bounds.Invalid() ? 0.0f : LengthF3(bounds.Origin() - input.CameraPosition);
+
+			const SModel& model = G.Scene.Models[(uint32_t)node.Model];
+			for (const SMesh& mesh : model.Meshes)
+			{
+				if (mesh.Material == SceneMaterial_t::INVALID)
+					continue;
+
+				if (streaming)
+				{
+					SceneStreaming_RequestMesh(G.Scene, node, mesh, streamingView, snapshot.TextureMips.data());
+				}
+
+				const SMaterial& material = G.Scene.Materials[(uint32_t)mesh.Material];
+
+				SceneDrawItem item;
+				item.TransformId = node.TransformId;
+				item.Mesh = &mesh;
+				item.Material = &material;
+				item.Pso = GetPSOForMaterial(material, targetDesc);
+
+				const SceneRenderPass pass = material.Domain == EMaterialDomain::MD_TRANSLUCENT ? SceneRenderPass::TRANSLUCENT_PASS : SceneRenderPass::OPAQUE_PASS;
+
+				SortKeyValues values;
+				values.Pass = (uint32_t)pass;
+				values.Pso = static_cast<uint32_t>(item.Pso);
+				values.Material = static_cast<uint32_t>(mesh.Material);
+				values.VertexBuffer = static_cast<uint32_t>(mesh.VertexBuffersRaw[(uint32_t)EMeshVertexBuffers::VB_POSITION]);
+				values.Depth = depth;
+
+				snapshot.SortKeys.push_back(SortKey_Pack(DefaultPassSortKeyLayouts[(uint8_t)pass], values));
+				snapshot.Unsorted.push_back(item);
+			}
+		}
+	}
+
+	{
+		PROFILE_ZONE("Sort");
+
+		const size_t count = snapshot.Unsorted.size();
+
+		snapshot.SortIndices.resize(count);
+		snapshot.SortKeysScratch.resize(count);
+		snapshot.SortIndicesScratch.resize(count);
+
+		for (uint32_t i = 0; i < (uint32_t)count; i++)
+		{
+			snapshot.SortIndices[i] = i;
+		}
+
+		SortKey_RadixSort(snapshot.SortKeys.data(), snapshot.SortIndices.data(), snapshot.SortKeysScratch.data(), snapshot.SortIndicesScratch.data(), count);
+
+		snapshot.Draws.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			snapshot.Draws[i] = snapshot.Unsorted[snapshot.SortIndices[i]];
+		}
+	}
+}
+
 void ResizeScreen(uint32_t width, uint32_t height)
 {
 	width = Max(width, 1u);
@@ -198,14 +440,21 @@ void DrawUI()
 {
 	static bool bShowDemoWindow = false;
 	static bool bShowTextureWindow = false;
+	static bool bShowProfilerWindow = false;
 
 	if (ImGui::Begin("GltfExplorer"))
 	{
 		ImGui::Checkbox("Show Demo Window", &bShowDemoWindow);
 		ImGui::Checkbox("Show Textures", &bShowTextureWindow);
+		ImGui::Checkbox("Show Profiler", &bShowProfilerWindow);
 	}
 	ImGui::End();
 
+	if (bShowProfilerWindow)
+	{
+		ProfilerUI_Draw(&bShowProfilerWindow);
+	}
+
 	if (bShowDemoWindow)
 	{
 		ImGui::ShowDemoWindow();
@@ -230,6 +479,172 @@ void DrawUI()
 		ImGui::End();
 	}
 
+	// State cache counters from the previous frame
+	if (ImGui::CollapsingHeader("Render State"))
+	{
+		const RenderStateCacheStats& stats = G.LastFrameStateStats;
+
+		ImGui::Text("Draws: %u", stats.Draws);
+		ImGui::Text("Calls issued: %u, elided: %u", stats.TotalIssued(), stats.TotalElided());
+
+		const SceneTransformUpdateStats& transformStats = G.Scene.Transforms.GetLastUpdateStats();
+		ImGui::Text("Transform upload: %u objects, %u ranges, %llu bytes", transformStats.UploadedObjects, transformStats.UploadedRanges, (unsigned long long)transformStats.UploadedBytes);
+
+		for (uint8_t i = 0; i < (uint8_t)RenderStateCall::COUNT; i++)
+		{
+			ImGui::Text("  %s: %u / %u", RenderStateCall_GetName((RenderStateCall)i), stats.Issued[i], stats.Elided[i]);
+		}
+
+		// Written next to the executable, replay with GltfExplorerReplay
+		if (ImGui::Button("Capture Frame"))
+		{
+			G.CaptureNextFrame = true;
+		}
+	}
+
+	// Culling and sorting for the next frame run on a worker while this one records, the view lags the camera by a frame
+	if (ImGui::CollapsingHeader("Frame Pipeline"))
+	{
+		ImGui::Checkbox("Pipelined Update", &G.PipelinedUpdate);
+		ImGui::Checkbox("Frustum Culling", &G.FrustumCulling);
+
+		ImGui::Text("Nodes: %u visible, %u culled", G.LastVisibleNodes, G.LastCulledNodes);
+		ImGui::Text("Waited for simulation: %.3f ms", G.LastSimulationWaitMilliseconds);
+	}
+
+	if (G.Scene.Streaming && ImGui::CollapsingHeader("Texture Streaming"))
+	{
+		TextureStreamer& streamer = G.Scene.Streaming->Streamer;
+		const TextureStreamingStats& stats = streamer.GetStats();
+
+		TextureStreamingParams params = streamer.GetParams();
+		int budgetMB = (int)(params.BudgetBytes >> 20u);
+		if (ImGui::SliderInt("Budget (MB)", &budgetMB, 16, 4096))
+		{
+			params.BudgetBytes = (uint64_t)budgetMB << 20u;
+			streamer.SetParams(params);
+		}
+		if (ImGui::SliderFloat("Mip Bias", &params.MipBias, -2.0f, 4.0f))
+		{
+			streamer.SetParams(params);
+		}
+
+		ImGui::Text("Textures: %u streamed, %u requested, %u starved", streamer.GetTextureCount(), stats.RequestedTextures, stats.StarvedTextures);
+		ImGui::Text("Resident: %.1f MB (peak %.1f MB)", (double)stats.ResidentBytes / (1024.0 * 1024.0), (double)stats.PeakResidentBytes / (1024.0 * 1024.0));
+		ImGui::Text("Requested: %.1f MB", (double)stats.RequestedBytes / (1024.0 * 1024.0));
+		ImGui::Text("Streamed in: %.1f MB, evicted: %.1f MB", (double)stats.StreamedInBytes / (1024.0 * 1024.0), (double)stats.EvictedBytes / (1024.0 * 1024.0));
+	}
+
+	// Paths play back at a fixed 60Hz timestep, the same files drive GltfExplorerHeadless --camera-path
+	if (ImGui::CollapsingHeader("Camera Path"))
+	{
+		const bool idle = G.PathMode == CameraPathMode::IDLE;
+
+		if (G.PathMode == CameraPathMode::RECORDING)
+		{
+			if (ImGui::Button("Stop Recording"))
+				G.PathMode = CameraPathMode::IDLE;
+		}
+		else if (ImGui::Button("Record") && idle)
+		{
+			StartCameraPathRecording();
+		}
+
+		ImGui::SameLine();
+		if (G.PathMode == CameraPathMode::PLAYING)
+		{
+			if (ImGui::Button("Stop Playback"))
+				G.PathMode = CameraPathMode::IDLE;
+		}
+		else if (ImGui::Button("Play") && idle && !G.RecordedPath.Empty())
+		{
+			StartCameraPathPlayback();
+		}
+
+		ImGui::SameLine();
+		if (ImGui::Button("Save") && idle)
+		{
+			G.RecordedPath.Save(CameraPathFile);
+		}
+
+		ImGui::SameLine();
+		if (ImGui::Button("Load") && idle)
+		{
+			G.RecordedPath.Load(CameraPathFile);
+		}
+
+		ImGui::Text("%zu keys, %.2fs", G.RecordedPath.GetKeyCount(), G.RecordedPath.GetDuration());
+
+		if (!idle)
+		{
+			ImGui::Text("%s %.2fs", G.PathMode == CameraPathMode::RECORDING ? "Recording" : "Playing", G.PathTime);
+		}
+	}
+
+	if (ImGui::CollapsingHeader("Frame Time"))
+	{
+		const FrameTimeStats& frameStats = G.FrameClock.GetStats();
+		const FrameTimeSummary summary = frameStats.Summarize();
+
+		ImGui::Text("Last %u frames: min %.2f avg %.2f max %.2f ms", summary.SampleCount, summary.MinMilliseconds, summary.AvgMilliseconds, summary.MaxMilliseconds);
+		ImGui::Text("p50 %.2f p95 %.2f p99 %.2f p99.9 %.2f ms", summary.P50Milliseconds, summary.P95Milliseconds, summary.P99Milliseconds, summary.P999Milliseconds);
+
+		// Only the occupied part of the histogram, the full range spans a few seconds
+		float histogram[FrameTimeStats::HistogramBucketCount];
+		uint32_t firstBucket = FrameTimeStats::HistogramBucketCount;
+		uint32_t lastBucket = 0;
+		for (uint32_t b = 0; b < FrameTimeStats::HistogramBucketCount; b++)
+		{
+			histogram[b] = (float)frameStats.GetHistogramCount(b);
+			if (histogram[b] > 0.0f)
+			{
+				firstBucket = Min(firstBucket, b);
+				lastBucket = b;
+			}
+		}
+
+		if (firstBucket <= lastBucket)
+		{
+			char overlay[64];
+			snprintf(overlay, sizeof(overlay), "%.2f - %.2f ms", FrameTimeStats::GetHistogramBucketMinMilliseconds(firstBucket), FrameTimeStats::GetHistogramBucketMinMilliseconds(lastBucket + 1u));
+			ImGui::PlotHistogram("##FrameTimeHistogram", histogram + firstBucket, (int)(lastBucket - firstBucket + 1u), 0, overlay, 0.0f, FLT_MAX, ImVec2(0.0f, 60.0f));
+		}
+
+		ImGui::Text("Hitches: %llu", (unsigned long long)frameStats.GetHitchCount());
+		for (uint32_t h = 0; h < frameStats.GetStoredHitchCount(); h++)
+		{
+			const FrameHitch& hitch = frameStats.GetHitch(h);
+			ImGui::Text("  Frame %llu: %.2f ms (threshold %.2f), %s %.2f ms", (unsigned long long)hitch.Frame, hitch.Milliseconds, hitch.ThresholdMilliseconds,
+				hitch.Zone ? hitch.Zone : "unknown", hitch.ZoneMilliseconds);
+		}
+
+		if (ImGui::Button("Write CSV"))
+		{
+			frameStats.WriteCsv("GltfExplorer_frametimes.csv");
+		}
+
+		ImGui::SameLine();
+		if (ImGui::Button("Write JSON"))
+		{
+			frameStats.WriteJson("GltfExplorer_frametimes.json");
+		}
+	}
+
+	if (ImGui::CollapsingHeader("Log"))
+	{
+		static std::vector<std::string> lines;
+		Log_GetRecentLines(lines);
+
+		ImGui::BeginChild("##LogLines", ImVec2(0.0f, 200.0f), true, ImGuiWindowFlags_HorizontalScrollbar);
+		for (const std::string& line : lines)
+			ImGui::TextUnformatted(line.c_str(), line.c_str() + line.size());
+
+		// Follow new lines unless scrolled back
+		if (ImGui::GetScrollY() >= ImGui::GetScrollMaxY())
+			ImGui::SetScrollHereY(1.0f);
+		ImGui::EndChild();
+	}
+
 	// Sun params
 	{
 		ImGui::SliderAngle("Sun Theta", &GSun.Theta, 0.0f, 180.0f);
@@ -243,14 +658,27 @@ LRESULT WINAPI WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
 enum RootSigSlots
 {
 	RS_VIEW_BUF,
-	RS_MESH_BUF,
+	RS_OBJECT_ID,
 	RS_MAT_BUF,
 	RS_SRV_TABLE,
+	RS_OBJECT_BUF_INDEX,
+	RS_BUFFER_SRV_TABLE,
+	RS_CUBE_SRV_TABLE,
 	RS_COUNT,
 };
 
 int main()
 {
+	PROFILE_THREAD("Main");
+
+	LogInitParams logParams;
+	logParams.FilePath = LogFile;
+	logParams.RecentLineCount = 512;
+	Log_Init(logParams);
+
+	TextureCache_SetDirectory(TextureCacheDir);
+	SetTextureCompressionPreset(TextureCompressionPreset::QUALITY);
+
 	WNDCLASSEX wc = { sizeof(WNDCLASSEX), CS_CLASSDC, WndProc, 0L, 0L, GetModuleHandle(NULL), NULL, NULL, NULL, NULL, "Gltf Explorer", NULL };
 	::RegisterClassEx(&wc);
 	HWND hwnd = ::CreateWindow(wc.lpszClassName, "Gltf Explorer", WS_OVERLAPPEDWINDOW, 100, 100, 1280, 800, NULL, NULL, wc.hInstance, NULL);
@@ -265,9 +693,12 @@ int main()
 	params.RootSigDesc.Flags = RootSignatureFlags::ALLOW_INPUT_LAYOUT;
 	params.RootSigDesc.Slots.resize(RS_COUNT);
 	params.RootSigDesc.Slots[RS_VIEW_BUF] = RootSignatureSlot::CBVSlot(0, 0);
-	params.RootSigDesc.Slots[RS_MESH_BUF] = RootSignatureSlot::CBVSlot(1, 0);
+	params.RootSigDesc.Slots[RS_OBJECT_ID] = RootSignatureSlot::ConstantsSlot(1u, 1u);
 	params.RootSigDesc.Slots[RS_MAT_BUF] = RootSignatureSlot::CBVSlot(2, 0);
 	params.RootSigDesc.Slots[RS_SRV_TABLE] = RootSignatureSlot::DescriptorTableSlot(0, 0, tpr::RootSignatureDescriptorTableType::SRV);
+	params.RootSigDesc.Slots[RS_OBJECT_BUF_INDEX] = RootSignatureSlot::ConstantsSlot(1u, 3u);
+	params.RootSigDesc.Slots[RS_BUFFER_SRV_TABLE] = RootSignatureSlot::DescriptorTableSlot(0, 1, tpr::RootSignatureDescriptorTableType::SRV);
+	params.RootSigDesc.Slots[RS_CUBE_SRV_TABLE] = RootSignatureSlot::DescriptorTableSlot(0, 2, tpr::RootSignatureDescriptorTableType::SRV);
 
 	params.RootSigDesc.GlobalSamplers.resize(1);
 	params.RootSigDesc.GlobalSamplers[0].AddressModeUVW(SamplerAddressMode::WRAP).FilterModeMinMagMip(SamplerFilterMode::LINEAR);
@@ -294,7 +725,11 @@ int main()
 	ImGui_ImplWin32_Init(hwnd);
 	ImGui_ImplRender_Init(RenderView::BackBufferFormat);
 
-	G.Scene = LoadSceneFromGlb("Assets/SunTemple.glb");
+	SceneLoadParams sceneParams;
+	sceneParams.StreamTextures = true;
+	sceneParams.Streaming.BudgetBytes = TextureStreamingBudgetBytes;
+
+	G.Scene = LoadSceneFromGlb("Assets/SunTemple.glb", nullptr, sceneParams);
 
 	GSkyDome.Load("Assets/evening_sky_8k.hdr");
 
@@ -310,10 +745,29 @@ int main()
 
 	DebugDrawInit(sceneTargetDesc);
 
-	Clock clock{};
+	// Loading is not a frame
+	G.FrameClock.Reset();
 
 	G.Camera.SetView(float3{ -2, 6, -2 }, 0.0f, 45.0f);
 
+	auto SampleSceneInput = []()
+	{
+		SceneFrameInput input;
+		input.View = G.Camera.GetView();
+		input.Projection = G.Camera.GetProjection();
+		input.CameraPosition = G.Camera.GetPosition();
+		input.ViewportHeight = G.ScreenHeight;
+		input.FrustumCulling = G.FrustumCulling;
+		return input;
+	};
+
+	FramePipeline<SceneFrameSnapshot, SceneFrameInput> scenePipeline([&](const SceneFrameInput& input, SceneFrameSnapshot& snapshot)
+	{
+		SimulateScene(input, sceneTargetDesc, snapshot);
+	});
+
+	scenePipeline.KickSimulation(SampleSceneInput());
+
 	// Main loop
 	bool bQuit = false;
 	MSG msg;
@@ -327,18 +781,36 @@ int main()
 			continue;
 		}
 
-		clock.Tick();
+		PROFILE_FRAME();
+
+		// The profiler has just started a new frame so the previous one is complete and can be searched for the culprit
+		if (G.FrameClock.Tick())
+		{
+			ProfileZoneTime hottest;
+			if (Profiler_FindHottestZone(Profiler_GetFrameStart(1u), Profiler_GetFrameStart(0u), hottest))
+			{
+				G.FrameClock.GetStats().SetLastHitchZone(hottest.Name, (float)(hottest.Microseconds * 1e-3));
+			}
+		}
 
-		const float deltaSeconds = clock.GetDeltaSeconds();
+		const float deltaSeconds = G.FrameClock.GetDeltaSeconds();
 
-		G.Camera.UpdateView(deltaSeconds);
+		{
+			PROFILE_ZONE("Update");
+			UpdateCamera(deltaSeconds);
+		}
 
 		// Because we use multiple viewports it is more efficient to sync at the latest possible point
-		view->Sync();
+		{
+			PROFILE_ZONE("Sync");
+			view->Sync();
+		}
 
 		Render_BeginFrame();
 
 		{
+			PROFILE_ZONE("UI");
+
 			ImGui_ImplRender_NewFrame();
 
 			ImGui_ImplWin32_NewFrame();
@@ -354,6 +826,50 @@ int main()
 
 		Render_BeginRenderFrame();
 
+		const SceneFrameSnapshot& scene = scenePipeline.WaitForSimulation();
+
+		G.LastVisibleNodes = scene.VisibleNodes;
+		G.LastCulledNodes = scene.CulledNodes;
+		G.LastSimulationWaitMilliseconds = scenePipeline.GetLastWaitMilliseconds();
+
+		// Nothing is in flight between the wait and the kick so this is the only safe place to switch modes
+		if (scenePipeline.IsPipelined() != G.PipelinedUpdate)
+		{
+			scenePipeline.SetPipelined(G.PipelinedUpdate);
+		}
+
+		// Replaces textures and material buffers, the worker must not be reading the scene while they swap
+		SceneStreaming_Update(G.Scene, scene.TextureMips.data());
+
+		// Queues copies for transforms that changed, static scenes upload nothing here. After the kick the worker may
+		// write them again for the next frame.
+		G.Scene.Transforms.Update();
+
+		// A capture copies the transforms while the worker cannot be moving them
+		std::unique_ptr<FrameCapture> capture;
+		if (G.CaptureNextFrame)
+		{
+			G.CaptureNextFrame = false;
+
+			capture = std::make_unique<FrameCapture>();
+			capture->ViewMatrix = scene.View.View;
+			capture->ProjectionMatrix = scene.View.Projection;
+			capture->CameraPosition = scene.View.CameraPosition;
+			capture->ViewportWidth = G.ScreenWidth;
+			capture->ViewportHeight = G.ScreenHeight;
+			capture->Bindless = Render_IsBindless();
+
+			capture->ObjectTransforms.resize(G.Scene.Transforms.GetObjectCount());
+			for (uint32_t i = 0; i < G.Scene.Transforms.GetObjectCount(); i++)
+			{
+				capture->ObjectTransforms[i] = G.Scene.Transforms.GetTransform(i);
+			}
+			capture->ObjectTransformsSrv = static_cast<uint64_t>(G.Scene.Transforms.GetSrv());
+		}
+
+		// Everything the simulation writes outside its snapshot has been consumed, the next frame can start
+		scenePipeline.KickSimulation(SampleSceneInput());
+
 		CommandListSubmissionGroup clGroup(CommandListType::GRAPHICS);
 
 		CommandList* cl = clGroup.CreateCommandList();
@@ -363,10 +879,10 @@ int main()
 		cl->TransitionResource(view->GetCurrentBackBufferTexture(), ResourceTransitionState::PRESENT, ResourceTransitionState::RENDER_TARGET);
 		cl->TransitionResource(G.DepthTexture, ResourceTransitionState::COMMON, ResourceTransitionState::DEPTH_WRITE);
 
+		RenderTargetView_t backBufferRtv = view->GetCurrentBackBufferRTV();
+
 		// Bind and clear targets
 		{
-			RenderTargetView_t backBufferRtv = view->GetCurrentBackBufferRTV();
-
 			constexpr float DefaultClearCol[4] = { 0.0f, 0.0f, 0.2f, 1.0f };
 
 			cl->ClearRenderTarget(backBufferRtv, DefaultClearCol);
@@ -377,6 +893,17 @@ int main()
 
 		cl->SetRootSignature();
 
+		RenderStateCache stateCache(cl);
+
+		// Scene submission goes through the state cache so a capture sees everything but the debug draw and UI
+		if (capture)
+		{
+			stateCache.SetCapture(capture->AddStream());
+
+			// Targets were bound before the cache existed, repeat them so the capture replays on its own
+			stateCache.SetRenderTargets(&backBufferRtv, 1, G.Dsv);
+		}
+
 		struct ViewUniforms
 		{
 			matrix ViewProjectionMat;
@@ -386,78 +913,94 @@ int main()
 			float __pad1;
 			float3 SunRadiance;
 			float __pad2;
+			float IrradianceSh[9][4];
+			uint32_t SpecularSrvIndex;
+			uint32_t BrdfLutSrvIndex;
+			float SpecularMipCount;
+			float __pad3;
 		} viewUniforms;
 
-		viewUniforms.ViewProjectionMat = G.Camera.GetView() * G.Camera.GetProjection();
-		viewUniforms.CameraPos = G.Camera.GetPosition();
+		// Must match the view the draw list was culled with
+		viewUniforms.ViewProjectionMat = scene.View.View * scene.View.Projection;
+		viewUniforms.CameraPos = scene.View.CameraPosition;
 		viewUniforms.SunDirection = GSun.ToCartesian();
 		viewUniforms.SunRadiance = GSun.Radiance;
 
+		const bool hasEnvironment = GSkyDome.SpecularSrv != ShaderResourceView_t::INVALID;
+		memcpy(viewUniforms.IrradianceSh, GSkyDome.Environment.Irradiance.Coefficients, sizeof(viewUniforms.IrradianceSh));
+		viewUniforms.SpecularSrvIndex = hasEnvironment ? GetDescriptorIndex(GSkyDome.SpecularSrv) : 0u;
+		viewUniforms.BrdfLutSrvIndex = hasEnvironment ? GetDescriptorIndex(GSkyDome.BrdfLutSrv) : 0u;
+		viewUniforms.SpecularMipCount = hasEnvironment ? (float)GSkyDome.Environment.SpecularInfo.MipCount : 0.0f;
+		viewUniforms.__pad3 = 0.0f;
+
 		DynamicBuffer_t viewCB = CreateDynamicConstantBuffer(&viewUniforms, sizeof(viewUniforms));
 
 		if (Render_IsBindless())
 		{
-			cl->SetGraphicsRootCBV(RS_VIEW_BUF, viewCB);
+			stateCache.SetGraphicsRootCBV(RS_VIEW_BUF, viewCB);
+
+			stateCache.SetGraphicsRootDescriptorTable(RS_SRV_TABLE);
+			stateCache.SetGraphicsRootDescriptorTable(RS_BUFFER_SRV_TABLE);
+			stateCache.SetGraphicsRootDescriptorTable(RS_CUBE_SRV_TABLE);
 
-			cl->SetGraphicsRootDescriptorTable(RS_SRV_TABLE);
+			stateCache.SetGraphicsRootValue(RS_OBJECT_BUF_INDEX, GetDescriptorIndex(G.Scene.Transforms.GetSrv()));
 		}
 		else
 		{
-			cl->BindVertexCBVs(0, 1, &viewCB);
-			cl->BindPixelCBVs(0, 1, &viewCB);
+			stateCache.BindVertexCBVs(0, 1, &viewCB);
+			stateCache.BindPixelCBVs(0, 1, &viewCB);
+
+			const ShaderResourceView_t transformSrv = G.Scene.Transforms.GetSrv();
+			stateCache.BindVertexSRVs(0, 1, &transformSrv);
+
+			// After the four material textures
+			const ShaderResourceView_t environmentSrvs[] = { GSkyDome.SpecularSrv, GSkyDome.BrdfLutSrv };
+			stateCache.BindPixelSRVs(4, ARRAYSIZE(environmentSrvs), environmentSrvs);
 		}
 
 		// Draw scene
 		{
+			PROFILE_ZONE("Record Scene");
+
 			Viewport vp(G.ScreenWidth, G.ScreenHeight);
 
-			cl->SetViewports(&vp, 1);
-			cl->SetDefaultScissor();
+			stateCache.SetViewports(&vp, 1);
+			stateCache.SetDefaultScissor();
 
-			int count = 0;
-			for (const SNode& node : G.Scene.Nodes)
+			for (const SceneDrawItem& draw : scene.Draws)
 			{
-				if (node.Model == SceneModel_t::INVALID)
-					continue;
+				const SMesh& mesh = *draw.Mesh;
+				const SMaterial& material = *draw.Material;
 
-				DynamicBuffer_t meshBuf = CreateDynamicConstantBuffer(&node.Transform, sizeof(node.Transform));
 				if (Render_IsBindless())
 				{
-					cl->SetGraphicsRootCBV(RS_MESH_BUF, meshBuf);
+					stateCache.SetGraphicsRootValue(RS_OBJECT_ID, draw.TransformId);
 				}
 				else
 				{
-					cl->BindVertexCBVs(0, 1, &meshBuf);
+					const ConstantBuffer_t objectCB = G.Scene.Transforms.GetObjectIdBuffer(draw.TransformId);
+					stateCache.BindVertexCBVs(1, 1, &objectCB);
 				}
 
-				const SModel& model = G.Scene.Models[(uint32_t)node.Model];
-				for (const SMesh& mesh : model.Meshes)
-				{
-					if (mesh.Material == SceneMaterial_t::INVALID)
-						continue;
-
-					const SMaterial& material = G.Scene.Materials[(uint32_t)mesh.Material];
-
-					cl->SetPipelineState(GetPSOForMaterial(material, sceneTargetDesc));
+				stateCache.SetPipelineState(draw.Pso);
 
-					if (Render_IsBindless())
-					{
-						cl->SetGraphicsRootCBV(RS_MAT_BUF, material.ConstantBuffer);
-					}
-					else
-					{
-						cl->BindPixelCBVs(1, 1, &material.ConstantBuffer);
+				const ConstantBuffer_t materialCB = material.ConstantBuffer;
 
-						cl->BindPixelSRVs(0, ARRAYSIZE(material.Srvs), material.Srvs);
-					}
+				if (Render_IsBindless())
+				{
+					stateCache.SetGraphicsRootCBV(RS_MAT_BUF, materialCB);
+				}
+				else
+				{
+					stateCache.BindPixelCBVs(1, 1, &materialCB);
 
-					cl->SetIndexBuffer(mesh.IndexBuffer, mesh.IndexFormat, mesh.IndexOffset);
-					cl->SetVertexBuffers(0, ARRAYSIZE(mesh.VertexBuffersRaw), mesh.VertexBuffersRaw, mesh.BufferStrides, mesh.BufferOffsets);
+					stateCache.BindPixelSRVs(0, ARRAYSIZE(material.Srvs), material.Srvs);
+				}
 
-					cl->DrawIndexedInstanced(mesh.IndexCount, 1, 0, 0, 0);
+				stateCache.SetIndexBuffer(mesh.IndexBuffer, mesh.IndexFormat, mesh.IndexOffset);
+				stateCache.SetVertexBuffers(0, ARRAYSIZE(mesh.VertexBuffersRaw), mesh.VertexBuffersRaw, mesh.BufferStrides, mesh.BufferOffsets);
 
-					count++;
-				}
+				stateCache.DrawIndexedInstanced(mesh.IndexCount, 1, 0, 0, 0);
 			}
 		}
 
@@ -472,19 +1015,27 @@ int main()
 			}
 
 			debugCtx.Render(cl);
+
+			stateCache.Invalidate();
 		}
 
 		{
+			PROFILE_ZONE("Sky");
+
 			Viewport vp(G.ScreenWidth, G.ScreenHeight);
 			vp.maxDepth = vp.minDepth = 1.0f;
 
-			cl->SetViewports(&vp, 1);
-			cl->SetDefaultScissor();
+			stateCache.SetViewports(&vp, 1);
+			stateCache.SetDefaultScissor();
+
+			stateCache.SetPipelineState(GSkyDome.Pso);
 
-			cl->SetPipelineState(GSkyDome.Pso);
+			const VertexBuffer_t skyVertexBuffer = GSkyDome.VertexBuffer;
+			const uint32_t skyVertexStride = sizeof(float3);
+			const uint32_t skyVertexOffset = 0u;
 
-			cl->SetIndexBuffer(GSkyDome.IndexBuffer, RenderFormat::R16_UINT, 0u);
-			cl->SetVertexBuffer(0, GSkyDome.VertexBuffer, 12, 0);
+			stateCache.SetIndexBuffer(GSkyDome.IndexBuffer, RenderFormat::R16_UINT, 0u);
+			stateCache.SetVertexBuffers(0, 1, &skyVertexBuffer, &skyVertexStride, &skyVertexOffset);
 
 			if (Render_IsBindless())
 			{
@@ -498,18 +1049,38 @@ int main()
 
 				DynamicBuffer_t skyDomeCbuf = CreateDynamicConstantBuffer(&skyData, sizeof(skyData));
 
-				cl->SetGraphicsRootCBV(RS_MAT_BUF, skyDomeCbuf);
+				stateCache.SetGraphicsRootCBV(RS_MAT_BUF, skyDomeCbuf);
 			}
 			else
 			{
-				cl->BindPixelSRVs(0, 1, &GSkyDome.Srv);
+				const ShaderResourceView_t skySrv = GSkyDome.Srv;
+				stateCache.BindPixelSRVs(0, 1, &skySrv);
 			}
 
 
-			cl->DrawIndexedInstanced(GSkyDome.IndexCount, 1, 0, 0, 0);
+			stateCache.DrawIndexedInstanced(GSkyDome.IndexCount, 1, 0, 0, 0);
 		}
 
+		G.LastFrameStateStats = stateCache.GetStats();
+
+		PROFILE_COUNTER("Draws", G.LastFrameStateStats.Draws);
+		PROFILE_COUNTER("Culled Nodes", scene.CulledNodes);
+		PROFILE_COUNTER("State Calls Elided", G.LastFrameStateStats.TotalElided());
+
+		if (capture)
 		{
+			stateCache.SetCapture(nullptr);
+
+			capture->Finalize();
+
+			char capturePath[64];
+			snprintf(capturePath, sizeof(capturePath), "GltfExplorer_%u.gxcap", G.CaptureCount++);
+			FrameCapture_Write(*capture, capturePath);
+		}
+
+		{
+			PROFILE_ZONE("Record UI");
+
 			cl->SetRootSignature(ImGui_ImplRender_GetRootSignature());
 
 			ImGui_ImplRender_RenderDrawData(frameData, ImGui::GetDrawData(), cl);
@@ -520,11 +1091,18 @@ int main()
 		cl->TransitionResource(G.DepthTexture, ResourceTransitionState::DEPTH_WRITE, ResourceTransitionState::COMMON);
 		cl->TransitionResource(view->GetCurrentBackBufferTexture(), ResourceTransitionState::RENDER_TARGET, ResourceTransitionState::PRESENT);
 
-		clGroup.Submit();
+		{
+			PROFILE_ZONE("Submit");
 
-		Render_EndFrame();
+			clGroup.Submit();
 
-		view->Present(true, false);
+			Render_EndFrame();
+		}
+
+		{
+			PROFILE_ZONE("Present");
+			view->Present(true, false);
+		}
 
 		// Update and Render additional Platform Windows
 		if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
@@ -534,6 +1112,9 @@ int main()
 		}
 	}
 
+	// The worker reads the scene, let it finish before anything is torn down
+	scenePipeline.Flush();
+
 	DebugDrawShutdown();
 
 	ImGui_ImplRender_Shutdown();
@@ -544,6 +1125,8 @@ int main()
 
 	::DestroyWindow(hwnd);
 	::UnregisterClass(wc.lpszClassName, wc.hInstance);
+
+	Log_Shutdown();
 }
 
 // Win32 message handler
@@ -1,7 +1,10 @@
 #include "GltfLoader.h"
 
+#include "LoadStats.h"
 #include "Logging.h"
+#include "Profiler/Profiler.h"
 
+#include <OpenFile.h>
 #include <rapidjson/document.h>
 
 #include <memory>
@@ -13,10 +16,11 @@
 
 std::vector<uint8_t> LoadBinaryFile(const char* pFilename)
 {
+    PROFILE_ZONE("Read File");
+
     std::vector<uint8_t> ret;
 
-    FILE* fp = nullptr;
-    fopen_s(&fp, pFilename, "rb");
+    FILE* fp = OpenFile(pFilename, "rb");
 
     if (!ENSUREMSG(fp, "Failed to load file (%s)", pFilename))
     {
@@ -424,11 +428,35 @@ static bool Gltf_Parse(const rapidjson::Value& json, GltfMaterial* material)
     return true;
 }
 
+static std::optional<GltfTextureBasisuExtension> GltfTextureBasisuExtension_Parse(const rapidjson::Value& json)
+{
+    if (!json.HasMember("KHR_texture_basisu"))
+    {
+        return std::nullopt;
+    }
+
+    const rapidjson::Value& basisuJson = json["KHR_texture_basisu"];
+    if (!basisuJson.HasMember("source"))
+    {
+        return std::nullopt;
+    }
+
+    GltfTextureBasisuExtension basisu;
+
+    basisu.source = basisuJson["source"].GetInt();
+
+    return basisu;
+}
+
 static bool Gltf_Parse(const rapidjson::Value& json, GltfTexture* texture)
 {
-    CheckGltfSupport(json, "GltfTexture", "extensions");
     CheckGltfSupport(json, "GltfTexture", "extras");
 
+    if (json.HasMember("extensions"))
+    {
+        texture->basisuExtension = GltfTextureBasisuExtension_Parse(json["extensions"]);
+    }
+
     texture->name = json.HasMember("name") ? json["name"].GetString() : "";
     texture->sampler = json.HasMember("sampler") ? json["sampler"].GetInt() : -1;
     texture->source = json.HasMember("source") ? json["source"].GetInt() : -1;
@@ -600,14 +628,21 @@ static bool Gltf_Parse(const rapidjson::Value& json, Gltf* gltf)
     return succeeded;
 }
 
-bool GltfLoader_Load(const char* path, Gltf* loadedGltf)
+bool GltfLoader_Load(const char* path, Gltf* loadedGltf, LoadStats* stats)
 {
+    PROFILE_ZONE("Gltf Load");
+
     if (!loadedGltf)
         return false;
 
     *loadedGltf = {};
 
-    std::vector<uint8_t> fileBuf = LoadBinaryFile(path);
+    std::vector<uint8_t> fileBuf;
+    {
+        LoadPhaseScope phase(stats, LoadPhase::FILE_READ);
+        fileBuf = LoadBinaryFile(path);
+        phase.AddBytes(fileBuf.size());
+    }
 
     if (!ENSUREMSG(!fileBuf.empty(), "Failed to load Gltf file: %s", path))
         return false;
@@ -641,14 +676,27 @@ bool GltfLoader_Load(const char* path, Gltf* loadedGltf)
 
         // Load JSON
         {
+            PROFILE_ZONE("Gltf Parse JSON");
+
             const char* jsonStr = (const char*)chunkStart + sizeof(jsonChunk);
             rapidjson::Document json;
-            json.Parse(jsonStr, jsonChunk->length);
+            {
+                LoadPhaseScope phase(stats, LoadPhase::JSON_PARSE);
+                json.Parse(jsonStr, jsonChunk->length);
+                phase.AddBytes(jsonChunk->length);
+            }
 
             if (!ENSUREMSG(!json.HasParseError(), "Gltf: failed to parse json chunk with code %d", json.GetParseError()))
                 break;
 
-            if (!ENSUREMSG(Gltf_Parse(json, loadedGltf), "Gltf: Failed to parse"))
+            bool parsed = false;
+            {
+                LoadPhaseScope phase(stats, LoadPhase::STRUCT_FILL);
+                parsed = Gltf_Parse(json, loadedGltf);
+                phase.AddBytes(jsonChunk->length);
+            }
+
+            if (!ENSUREMSG(parsed, "Gltf: Failed to parse"))
                 break;
 
 #if GLTF_LOG_VERBOSE
@@ -667,6 +715,11 @@ bool GltfLoader_Load(const char* path, Gltf* loadedGltf)
 
         // Load Binary
         {
+            PROFILE_ZONE("Gltf Copy Binary");
+
+            // Part of filling in the Gltf, the binary chunk ends up owned by it
+            LoadPhaseScope phase(stats, LoadPhase::STRUCT_FILL);
+
             chunkStart = chunkStart + sizeof(GltfChunk) + jsonChunk->length;
             GltfChunk* binChunk = (GltfChunk*)chunkStart;
 
@@ -674,6 +727,8 @@ bool GltfLoader_Load(const char* path, Gltf* loadedGltf)
 
             loadedGltf->data = std::make_unique<uint8_t[]>(binChunk->length);
             memcpy(loadedGltf->data.get(), binData, binChunk->length);
+
+            phase.AddBytes(binChunk->length);
         }
 
         parseSuccess = true;
@@ -224,12 +224,20 @@ struct GltfMaterial
 };
 typedef std::vector<GltfMaterial> GltfMaterialArray;
 
+struct GltfTextureBasisuExtension
+{
+    // KTX2 image, the texture's own source is the fallback for loaders without a transcoder
+    int32_t source;
+};
+
 struct GltfTexture
 {
     std::string name;
     int32_t sampler;
     int32_t source;
-    // Gltf Unsupported: extensions
+
+    std::optional<GltfTextureBasisuExtension> basisuExtension;
+
     // Gltf Unsupported: extras
 };
 typedef std::vector<GltfTexture> GltfTextureArray;
@@ -322,6 +330,9 @@ struct Gltf
     std::unique_ptr<uint8_t[]> data;
 };
 
-bool GltfLoader_Load(const char* path, Gltf* loadedGltf);
+struct LoadStats;
+
+// stats is optional, receives the file read, json parse and struct fill phases
+bool GltfLoader_Load(const char* path, Gltf* loadedGltf, LoadStats* stats = nullptr);
 size_t GltfLoader_SizeOfComponent(GltfComponentType ct);
 size_t GltfLoader_ComponentCount(GltfElementType et);
\ No newline at end of file
@@ -2,12 +2,15 @@
 
 #include "GltfLoader.h"
 #include "TextureLoader.h"
+#include "TextureRegistry.h"
 #include "GltfSceneNode.h"
 
+#include "Profiler/Profiler.h"
+
 #include "SceneGraph/SceneMaterial.h"
 
 #include <Render/Render.h>
-#include <ppl.h>
+#include <ParallelFor.h>
 
 #define PARALLEL_LOAD (RENDER_THREAD_SAFE)
 
@@ -27,8 +30,7 @@ private:
     const Gltf& Src;
 
     std::vector<std::shared_ptr<SceneMaterial>> LoadedMaterials;
-    std::vector<tpr::TexturePtr> LoadedTextures;
-    std::vector<tpr::ShaderResourceViewPtr> LoadedSrvs;
+    std::vector<SharedTexturePtr> LoadedTextures;
 };
 
 GltfStaticMeshLoadContext::GltfStaticMeshLoadContext(const Gltf& src)
@@ -46,9 +48,13 @@ void GltfStaticMeshLoadContext::Process()
 
 void GltfStaticMeshLoadContext::ProcessImages()
 {
+    PROFILE_ZONE("Load Images");
+
     LoadedTextures.resize(Src.images.size());
 
     // Gltf loads images as texture + sampler combos, im assuming trilinear always to simplify it
+    std::vector<TextureLoadParams> loadParams;
+    GetTextureLoadParamsForGltf(Src, loadParams);
 
 #if PARALLEL_LOAD
     Concurrency::parallel_for((size_t)0u, Src.images.size(), [&](size_t i)
@@ -56,12 +62,16 @@ void GltfStaticMeshLoadContext::ProcessImages()
     for (uint32_t i = 0; i < Src.images.size(); i++)
 #endif
     {
-        const GltfImage& gltfImage = Src.images[i];
+        if (!loadParams[i].Skip)
+        {
+            PROFILE_ZONE("Decode Image");
 
-        const GltfBufferView& gltfBufView = Src.bufferViews[gltfImage.bufferView];
+            const GltfImage& gltfImage = Src.images[i];
 
-        LoadedTextures[i] = LoadTextureFromBinary(Src.data.get() + gltfBufView.byteOffset, gltfBufView.byteLength);
-        LoadedSrvs[i] = tpr::CreateTextureSRV(LoadedTextures[i], tpr::RenderFormat::R8G8B8A8_UNORM, tpr::TextureDimension::TEX2D, 1u, 1u);
+            const GltfBufferView& gltfBufView = Src.bufferViews[gltfImage.bufferView];
+
+            LoadedTextures[i] = TextureRegistry_Acquire(Src.data.get() + gltfBufView.byteOffset, gltfBufView.byteLength, loadParams[i]);
+        }
     }
 #if PARALLEL_LOAD
     );
@@ -70,6 +80,8 @@ void GltfStaticMeshLoadContext::ProcessImages()
 
 void GltfStaticMeshLoadContext::ProcessMaterials()
 {
+    PROFILE_ZONE("Load Materials");
+
     LoadedMaterials.resize(Src.materials.size());
 
     static const std::string kShaderPath = "Shaders/GltfMesh.hlsl";
@@ -87,9 +99,10 @@ void GltfStaticMeshLoadContext::ProcessMaterials()
         case GltfAlphaMode::BLEND: domain = SceneMaterialDomain::MD_TRANSLUCENT; break;
         }
 
-        auto GetSrvForTexInfo = [this]<typename T>(const std::optional<T>&texInfo)->tpr::ShaderResourceViewPtr
+        auto GetTextureForTexInfo = [this]<typename T>(const std::optional<T>&texInfo)->SharedTexturePtr
         {
-            return texInfo.has_value() && (LoadedTextures.size() > texInfo->index) ? LoadedSrvs[Src.textures[texInfo->index].source] : tpr::ShaderResourceViewPtr{};
+            const int32_t image = texInfo.has_value() ? GetGltfTextureImage(Src, texInfo->index) : -1;
+            return image >= 0 && (size_t)image < LoadedTextures.size() ? LoadedTextures[image] : SharedTexturePtr{};
         };
 
         auto GetUVIndexForTexInfo = [this]<typename T>(const std::optional<T>&texInfo)->uint32_t
@@ -97,10 +110,19 @@ void GltfStaticMeshLoadContext::ProcessMaterials()
             return texInfo.has_value() ? texInfo->texcoord : 0u;
         };
 
-        material->Srvs[SceneMaterial::BASE_COLOR_TEX] = GetSrvForTexInfo(gltfMaterial.pbr.baseColorTexture);
-        material->Srvs[SceneMaterial::NORMAL_TEX] = GetSrvForTexInfo(gltfMaterial.normalTexture);
-        material->Srvs[SceneMaterial::METALLIC_ROUGHNESS_TEX] = GetSrvForTexInfo(gltfMaterial.pbr.metallicRoughnessTexture);
-        material->Srvs[SceneMaterial::EMISSIVE_TEX] = GetSrvForTexInfo(gltfMaterial.emissiveTexture);
+        material->SharedTextures[SceneMaterial::BASE_COLOR_TEX] = GetTextureForTexInfo(gltfMaterial.pbr.baseColorTexture);
+        material->SharedTextures[SceneMaterial::NORMAL_TEX] = GetTextureForTexInfo(gltfMaterial.normalTexture);
+        material->SharedTextures[SceneMaterial::METALLIC_ROUGHNESS_TEX] = GetTextureForTexInfo(gltfMaterial.pbr.metallicRoughnessTexture);
+        material->SharedTextures[SceneMaterial::EMISSIVE_TEX] = GetTextureForTexInfo(gltfMaterial.emissiveTexture);
+
+        for (uint32_t tex = 0; tex < SceneMaterial::kMaterialTextureCount; tex++)
+        {
+            if (const SharedTexturePtr& texture = material->SharedTextures[tex])
+            {
+                material->Textures[tex] = texture->Texture;
+                material->Srvs[tex] = texture->Srv;
+            }
+        }
 
         material->Constants.BaseColorFactor = float4((float)gltfMaterial.pbr.baseColorFactor.x, (float)gltfMaterial.pbr.baseColorFactor.y, (float)gltfMaterial.pbr.baseColorFactor.z, (float)gltfMaterial.pbr.baseColorFactor.w);
         material->Constants.EmissiveFactor = float3((float)gltfMaterial.emissiveFactor.x, (float)gltfMaterial.emissiveFactor.y, (float)gltfMaterial.emissiveFactor.z);
@@ -124,6 +146,8 @@ void GltfStaticMeshLoadContext::ProcessMaterials()
 
 void GltfStaticMeshLoadContext::ProcessScenes()
 {
+    PROFILE_ZONE("Load Nodes");
+
     for (const GltfScene& scene : Src.scenes)
     {
         std::stack<matrix> transformStack;
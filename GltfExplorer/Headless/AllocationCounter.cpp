@@ -0,0 +1,32 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> GAllocationCount = 0;
+
+void* operator new(size_t size)
+{
+	GAllocationCount.fetch_add(1u, std::memory_order_relaxed);
+
+	if (void* p = malloc(size ? size : 1u))
+		return p;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+uint64_t AllocationCounter_GetCount()
+{
+	return GAllocationCount.load(std::memory_order_relaxed);
+}
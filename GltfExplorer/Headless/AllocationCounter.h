@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+// Replaces the global operator new of the program this is linked into and counts every call. Only the headless tools
+// link it, they use the counts to check loads and frames against allocation budgets. C allocations, such as the ones
+// stb_image makes, are not counted.
+
+// Allocations made by every thread so far
+uint64_t AllocationCounter_GetCount();
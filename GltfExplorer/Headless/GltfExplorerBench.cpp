@@ -0,0 +1,354 @@
+// Loads a glb through GltfLoader and the scene build a number of times against the null render backend and reports where
+// load time goes, phase by phase. Resource creation is free on the null backend so mesh and image phases measure the
+// loader's own work. Results go to stdout and, with --json, to a file meant to be tracked from commit to commit.
+
+#include <Render/Render.h>
+#include <RenderNull.h>
+#include <OpenFile.h>
+
+#include "AllocationCounter.h"
+
+#include "../LoadStats.h"
+#include "../Logging.h"
+#include "../Scene.h"
+#include "../TextureLoader.h"
+#include "../TextureRegistry.h"
+#include "../Textures/TextureCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace tpr;
+
+struct BenchOptions
+{
+	const char* GlbPath = nullptr;
+	const char* JsonPath = nullptr;
+	const char* Label = nullptr;
+	const char* TextureCacheDir = nullptr;
+	TextureCompressionPreset Compression = TextureCompressionPreset::NONE;
+	ImageDecodeParams Decode;
+	uint32_t Iterations = 10;
+	uint32_t WarmupIterations = 1;
+	bool Cold = false;
+};
+
+struct BenchIteration
+{
+	LoadStats Stats;
+	double WallMilliseconds = 0.0;
+	double CpuMilliseconds = 0.0;
+	uint64_t Allocations = 0;
+	size_t Nodes = 0;
+};
+
+static void PrintUsage()
+{
+	printf(
+		"GltfExplorerBench <scene.glb> [options]\n"
+		"  --iterations <n>  Loads to measure (default 10)\n"
+		"  --warmup <n>      Loads before measuring, warms the file cache and allocator (default 1)\n"
+		"  --cold            Drop the file from the OS cache before every load, where the platform allows it\n"
+		"  --json <path>     Write per phase results for every iteration\n"
+		"  --label <text>    Stored in the json, for example the commit being measured\n"
+		"  --texture-cache <dir>  Keep generated mips in <dir>, later loads read them back instead of decoding\n"
+		"  --compress <preset>    Block compress textures, none, fast or quality (default none)\n"
+		"  --decode-workers <n>   Image decode threads, 0 for one per hardware thread (default 0)\n"
+		"  --decode-budget <MB>   Decoded image memory in flight at once (default 1024)\n");
+}
+
+static bool ParseOptions(int argc, char** argv, BenchOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if ((strcmp(arg, "--iterations") == 0 || strcmp(arg, "--warmup") == 0) && value)
+		{
+			uint32_t& out = strcmp(arg, "--iterations") == 0 ? options.Iterations : options.WarmupIterations;
+			out = (uint32_t)strtoul(value, nullptr, 10);
+			i++;
+		}
+		else if (strcmp(arg, "--cold") == 0)
+		{
+			options.Cold = true;
+		}
+		else if (strcmp(arg, "--json") == 0 && value)
+		{
+			options.JsonPath = value;
+			i++;
+		}
+		else if (strcmp(arg, "--label") == 0 && value)
+		{
+			options.Label = value;
+			i++;
+		}
+		else if (strcmp(arg, "--texture-cache") == 0 && value)
+		{
+			options.TextureCacheDir = value;
+			i++;
+		}
+		else if (strcmp(arg, "--compress") == 0 && value)
+		{
+			if (strcmp(value, "none") == 0)
+				options.Compression = TextureCompressionPreset::NONE;
+			else if (strcmp(value, "fast") == 0)
+				options.Compression = TextureCompressionPreset::FAST;
+			else if (strcmp(value, "quality") == 0)
+				options.Compression = TextureCompressionPreset::QUALITY;
+			else
+			{
+				LOGERROR("Unknown compression preset %s", value);
+				return false;
+			}
+			i++;
+		}
+		else if (strcmp(arg, "--decode-workers") == 0 && value)
+		{
+			options.Decode.WorkerCount = (uint32_t)strtoul(value, nullptr, 10);
+			i++;
+		}
+		else if (strcmp(arg, "--decode-budget") == 0 && value)
+		{
+			options.Decode.MemoryBudgetBytes = (uint64_t)strtoull(value, nullptr, 10) << 20u;
+			i++;
+		}
+		else if (arg[0] != '-' && !options.GlbPath)
+		{
+			options.GlbPath = arg;
+		}
+		else
+		{
+			LOGERROR("Unknown option %s", arg);
+			return false;
+		}
+	}
+
+	if (!options.GlbPath)
+	{
+		LOGERROR("No glb given");
+		return false;
+	}
+
+	options.Iterations = std::max(options.Iterations, 1u);
+
+	return true;
+}
+
+// Only drops clean pages, which a file we only read always is
+static bool EvictFromFileCache(const char* path)
+{
+#if defined(_WIN32)
+	(void)path;
+	return false;
+#else
+	const int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	const bool ok = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+	close(fd);
+	return ok;
+#endif
+}
+
+static bool RunIteration(const BenchOptions& options, BenchIteration& iteration)
+{
+	iteration = {};
+	iteration.Stats.GetAllocationCount = AllocationCounter_GetCount;
+
+	const uint64_t allocationStart = AllocationCounter_GetCount();
+	const double cpuStart = LoadStats_GetProcessCpuMilliseconds();
+	const std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+
+	SceneLoadParams loadParams;
+	loadParams.Decode = options.Decode;
+
+	SScene scene = LoadSceneFromGlb(options.GlbPath, &iteration.Stats, loadParams);
+
+	iteration.WallMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+	iteration.CpuMilliseconds = LoadStats_GetProcessCpuMilliseconds() - cpuStart;
+	iteration.Allocations = AllocationCounter_GetCount() - allocationStart;
+	iteration.Nodes = scene.Nodes.size();
+
+	// An empty scene is a failed load, anything the loader could read has at least one model slot
+	return !scene.Models.empty();
+}
+
+static double ToMegabytesPerSecond(uint64_t bytes, double milliseconds)
+{
+	return milliseconds > 0.0 ? (double)bytes / (1024.0 * 1024.0) / (milliseconds * 1e-3) : 0.0;
+}
+
+static bool WriteJson(const char* path, const BenchOptions& options, const std::vector<BenchIteration>& iterations, const LoadStats& average,
+	uint64_t processPeakResidentBytes)
+{
+	FILE* fp = OpenFile(path, "w");
+
+	if (!ENSUREMSG(fp, "Failed to open %s for writing", path))
+		return false;
+
+	auto WritePhases = [fp](const LoadStats& stats, const char* indent)
+	{
+		for (uint32_t p = 0; p < KLoadPhaseCount; p++)
+		{
+			const LoadPhaseStats& phase = stats.Phases[p];
+			fprintf(fp, "%s\"%s\": { \"wall_ms\": %.4f, \"cpu_ms\": %.4f, \"bytes\": %llu, \"mb_per_s\": %.2f, \"allocations\": %llu }%s\n",
+				indent, LoadPhase_GetName((LoadPhase)p), phase.WallMilliseconds, phase.CpuMilliseconds, (unsigned long long)phase.Bytes,
+				ToMegabytesPerSecond(phase.Bytes, phase.WallMilliseconds), (unsigned long long)phase.Allocations, p + 1u < KLoadPhaseCount ? "," : "");
+		}
+	};
+
+	fprintf(fp, "{\n  \"scene\": ");
+	Log_WriteJsonString(fp, options.GlbPath);
+	fprintf(fp, ",\n  \"label\": ");
+	Log_WriteJsonString(fp, options.Label ? options.Label : "");
+	fprintf(fp, ",\n  \"iterations\": %zu,\n  \"warmup\": %u,\n  \"cold\": %s,\n", iterations.size(), options.WarmupIterations, options.Cold ? "true" : "false");
+
+	// High water mark of the whole process, warmup loads included, not of any one load
+	fprintf(fp, "  \"process_peak_rss_bytes\": %llu,\n", (unsigned long long)processPeakResidentBytes);
+
+	fprintf(fp, "  \"average\": {\n");
+	WritePhases(average, "    ");
+	fprintf(fp, "  },\n");
+
+	fprintf(fp, "  \"per_iteration\": [");
+	for (size_t i = 0; i < iterations.size(); i++)
+	{
+		const BenchIteration& iteration = iterations[i];
+
+		fprintf(fp, "%s\n    {\n      \"wall_ms\": %.4f,\n      \"cpu_ms\": %.4f,\n      \"allocations\": %llu,\n      \"nodes\": %zu,\n      \"phases\": {\n",
+			i ? "," : "", iteration.WallMilliseconds, iteration.CpuMilliseconds, (unsigned long long)iteration.Allocations,
+			iteration.Nodes);
+		WritePhases(iteration.Stats, "        ");
+		fprintf(fp, "      }\n    }");
+	}
+	fprintf(fp, "\n  ]\n}\n");
+
+	const bool ok = ferror(fp) == 0;
+	fclose(fp);
+
+	return ENSUREMSG(ok, "Failed to write %s", path);
+}
+
+int main(int argc, char** argv)
+{
+	BenchOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	Log_Init(LogInitParams());
+
+	TextureCache_SetDirectory(options.TextureCacheDir);
+	SetTextureCompressionPreset(options.Compression);
+
+	RenderInitParams params;
+	if (!Render_Init(params))
+	{
+		Render_ShutDown();
+		return 1;
+	}
+
+	if (options.Cold && !EvictFromFileCache(options.GlbPath))
+	{
+		LOGWARNING("Bench: cannot drop %s from the file cache on this platform, loads will be warm", options.GlbPath);
+		options.Cold = false;
+	}
+
+	std::vector<BenchIteration> iterations(options.Iterations);
+
+	bool ok = true;
+	for (uint32_t i = 0; ok && i < options.WarmupIterations + options.Iterations; i++)
+	{
+		if (options.Cold)
+		{
+			EvictFromFileCache(options.GlbPath);
+		}
+
+		BenchIteration warmup;
+		BenchIteration& iteration = i < options.WarmupIterations ? warmup : iterations[i - options.WarmupIterations];
+
+		ok = RunIteration(options, iteration);
+	}
+
+	if (!ok)
+	{
+		LOGERROR("Bench: failed to load %s", options.GlbPath);
+		Render_ShutDown();
+		return 1;
+	}
+
+	LoadStats average = {};
+	double wallMilliseconds = 0.0;
+	double cpuMilliseconds = 0.0;
+	uint64_t allocations = 0;
+
+	for (const BenchIteration& iteration : iterations)
+	{
+		for (uint32_t p = 0; p < KLoadPhaseCount; p++)
+		{
+			average.Phases[p].WallMilliseconds += iteration.Stats.Phases[p].WallMilliseconds;
+			average.Phases[p].CpuMilliseconds += iteration.Stats.Phases[p].CpuMilliseconds;
+			average.Phases[p].Bytes += iteration.Stats.Phases[p].Bytes;
+			average.Phases[p].Allocations += iteration.Stats.Phases[p].Allocations;
+		}
+
+		wallMilliseconds += iteration.WallMilliseconds;
+		cpuMilliseconds += iteration.CpuMilliseconds;
+		allocations += iteration.Allocations;
+	}
+
+	const uint64_t count = iterations.size();
+	for (LoadPhaseStats& phase : average.Phases)
+	{
+		phase.WallMilliseconds /= count;
+		phase.CpuMilliseconds /= count;
+		phase.Bytes = (phase.Bytes + count / 2u) / count;
+		phase.Allocations = (phase.Allocations + count / 2u) / count;
+	}
+
+	wallMilliseconds /= count;
+	cpuMilliseconds /= count;
+	allocations = (allocations + count / 2u) / count;
+
+	LOGINFO("Bench: %s, %zu nodes, %u iterations (%u warmup)%s", options.GlbPath, iterations.front().Nodes, options.Iterations,
+		options.WarmupIterations, options.Cold ? ", cold cache" : "");
+	LOGINFO("  %-16s %10s %10s %12s %10s %12s", "phase", "wall ms", "cpu ms", "bytes", "MB/s", "allocations");
+
+	for (uint32_t p = 0; p < KLoadPhaseCount; p++)
+	{
+		const LoadPhaseStats& phase = average.Phases[p];
+		LOGINFO("  %-16s %10.3f %10.3f %12llu %10.1f %12llu", LoadPhase_GetName((LoadPhase)p), phase.WallMilliseconds, phase.CpuMilliseconds,
+			(unsigned long long)phase.Bytes, ToMegabytesPerSecond(phase.Bytes, phase.WallMilliseconds), (unsigned long long)phase.Allocations);
+	}
+
+	LOGINFO("  %-16s %10.3f %10.3f %12s %10s %12llu", "total", wallMilliseconds, cpuMilliseconds, "", "", (unsigned long long)allocations);
+	// The OS only reports the high water mark of the process, so this covers every load rather than an average of them
+	const uint64_t processPeakResidentBytes = LoadStats_GetPeakResidentBytes();
+	LOGINFO("  process peak rss %.1f MB", (double)processPeakResidentBytes / (1024.0 * 1024.0));
+
+	// Every iteration releases its scene, so this counts images duplicated within the file
+	const TextureRegistryStats registry = TextureRegistry_GetStats();
+	LOGINFO("  textures %llu requests, %llu shared, %.1f MB decoded, %.1f MB deduplicated", (unsigned long long)registry.Requests,
+		(unsigned long long)registry.Hits, (double)registry.DecodedBytes / (1024.0 * 1024.0), (double)registry.SharedBytes / (1024.0 * 1024.0));
+
+	const bool written = !options.JsonPath || WriteJson(options.JsonPath, options, iterations, average, processPeakResidentBytes);
+
+	Render_ShutDown();
+	Log_Shutdown();
+
+	return written ? 0 : 1;
+}
@@ -0,0 +1,884 @@
+// Runs the scene graph submission path against the null render backend so gathering, sorting and recording can be
+// measured on machines without a GPU or a window. The scene is synthetic by default, every node draws a handful of batches
+// picked from a small pool of pipelines, materials and meshes so state filtering has something realistic to work with.
+// With --glb the nodes of a real scene are drawn instead, and --camera-path flies through it along a recorded path.
+
+#include <Render/Render.h>
+#include <RenderNull.h>
+#include <Clock.h>
+#include <OpenFile.h>
+
+#include "AllocationCounter.h"
+
+#include "../Camera/CameraPath.h"
+#include "../Capture/FrameCapture.h"
+#include "../Logging.h"
+#include "../Profiler/Profiler.h"
+#include "../Scene.h"
+#include "../SceneGraph/FramePipeline.h"
+#include "../SceneGraph/SceneGraph.h"
+
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace tpr;
+
+struct HeadlessOptions
+{
+	uint32_t Frames = 300;
+	uint32_t Nodes = 10000;
+	uint32_t BatchesPerNode = 2;
+	uint32_t Buckets = 4;
+	uint32_t Psos = 8;
+	uint32_t Materials = 64;
+	uint32_t Meshes = 256;
+	uint32_t MovingPercent = 5;
+	bool RecordCommands = true;
+	bool Bindless = false;
+	const char* CapturePath = nullptr;
+	const char* TracePath = nullptr;
+	const char* StatsJsonPath = nullptr;
+	const char* StatsCsvPath = nullptr;
+	bool Profile = true;
+	bool Pipeline = true;
+	bool Cull = true;
+	bool FramesSet = false;
+	const char* GlbPath = nullptr;
+	const char* CameraPathFile = nullptr;
+	const char* BenchJsonPath = nullptr;
+	uint32_t TextureBudgetMB = 0;
+};
+
+struct BenchResources
+{
+	std::vector<GraphicsPipelineStatePtr> Psos;
+	std::vector<ConstantBufferPtr> Materials;
+	std::vector<MeshBuffers> Meshes;
+	std::vector<TexturePtr> Textures;
+	std::vector<ShaderResourceViewPtr> SrvPtrs;
+	std::vector<ShaderResourceView_t> Srvs;
+	std::vector<ResourceBindings> Bindings;
+};
+
+// Render state for the meshes and materials of a loaded glb, laid out the way the scene renderer consumes it
+struct GlbResources
+{
+	std::vector<std::vector<MeshBuffers>> ModelMeshes;
+	std::vector<ResourceBindings> MaterialBindings;
+	std::vector<GraphicsPipelineState_t> MaterialPsos;
+};
+
+static struct
+{
+	HeadlessOptions Options;
+	BenchResources Resources;
+	SScene Scene;
+	GlbResources Glb;
+	SceneTransformBuffer Transforms;
+} G;
+
+// Gltf nodes and the mesh shaders use row vectors, MakeMatrixTranslation builds the column vector form
+static matrix BenchTranslation(const float3& position)
+{
+	return TransposeMatrix(MakeMatrixTranslation(position));
+}
+
+class BenchMeshNode : public ISceneNode
+{
+public:
+
+	BenchMeshNode(uint32_t index, const float3& position)
+		: Index(index)
+		, Position(position)
+	{
+		SetCanRender(true);
+		SetCanTick(true);
+
+		LocalBounds = AABB(float3(-0.5f), float3(0.5f));
+		RelativeTransform = BenchTranslation(Position);
+
+		ObjectId = G.Transforms.Allocate(GetTransformLazyUpdate());
+	}
+
+	virtual void Update(float deltaSeconds) override
+	{
+		// A fixed slice of the scene moves every frame so the transform buffer has a steady amount of work
+		if (Index % 100u >= G.Options.MovingPercent)
+			return;
+
+		Time += deltaSeconds;
+
+		RelativeTransform = BenchTranslation(Position + float3{ 0.0f, sinf(Time + (float)Index), 0.0f });
+		TransformChanged = true;
+
+		G.Transforms.SetTransform(ObjectId, GetTransformLazyUpdate());
+	}
+
+	virtual void Draw(const RenderInfo& info, Renderables& renderables) const noexcept override
+	{
+		const BenchResources& res = G.Resources;
+
+		const float zDepth = LengthF3(Position - info.Pass[(uint8_t)SceneRenderPass::OPAQUE_PASS].CameraPosition);
+
+		for (uint32_t b = 0; b < G.Options.BatchesPerNode; b++)
+		{
+			// Cheap hash so neighbouring nodes do not share all of their state
+			const uint32_t h = (Index * 2654435761u) ^ (b * 40503u);
+
+			RenderBatch batch = {};
+			batch.PSO = res.Psos[h % res.Psos.size()];
+			batch.ObjectId = ObjectId;
+			batch.MaterialCBuf = res.Materials[(h >> 8) % res.Materials.size()];
+			batch.ZDepth = zDepth;
+			batch.BufferBindings = &res.Meshes[(h >> 16) % res.Meshes.size()];
+			batch.ResourceBindings = &res.Bindings[(h >> 8) % res.Bindings.size()];
+
+			// One batch in sixteen goes through the translucent pass
+			renderables.AddBatch((h & 15u) == 0u ? SceneRenderPass::TRANSLUCENT_PASS : SceneRenderPass::OPAQUE_PASS, batch);
+		}
+	}
+
+private:
+
+	uint32_t Index = 0;
+	uint32_t ObjectId = 0;
+	float3 Position = {};
+	float Time = 0.0f;
+};
+
+// One node of a loaded glb, drawn with one batch per mesh primitive. Glb scenes are static so nothing ticks.
+class GlbMeshNode : public ISceneNode
+{
+public:
+
+	explicit GlbMeshNode(const SNode& node)
+		: Model((uint32_t)node.Model)
+	{
+		SetCanRender(true);
+
+		LocalBounds = G.Scene.Models[Model].Bounds;
+		RelativeTransform = node.Transform;
+
+		ObjectId = G.Transforms.Allocate(GetTransformLazyUpdate());
+	}
+
+	virtual void Draw(const RenderInfo& info, Renderables& renderables) const noexcept override
+	{
+		const SModel& model = G.Scene.Models[Model];
+
+		const float zDepth = LengthF3(WorldBounds.Origin() - info.Pass[(uint8_t)SceneRenderPass::OPAQUE_PASS].CameraPosition);
+
+		for (size_t m = 0; m < model.Meshes.size(); m++)
+		{
+			const SMesh& mesh = model.Meshes[m];
+			if (mesh.Material == SceneMaterial_t::INVALID)
+				continue;
+
+			const uint32_t materialIndex = (uint32_t)mesh.Material;
+			const SMaterial& material = G.Scene.Materials[materialIndex];
+
+			RenderBatch batch = {};
+			batch.PSO = G.Glb.MaterialPsos[materialIndex];
+			batch.ObjectId = ObjectId;
+			batch.MaterialCBuf = material.ConstantBuffer;
+			batch.ZDepth = zDepth;
+			batch.BufferBindings = &G.Glb.ModelMeshes[Model][m];
+			batch.ResourceBindings = &G.Glb.MaterialBindings[materialIndex];
+
+			renderables.AddBatch(material.Domain == EMaterialDomain::MD_TRANSLUCENT ? SceneRenderPass::TRANSLUCENT_PASS : SceneRenderPass::OPAQUE_PASS, batch);
+		}
+	}
+
+private:
+
+	uint32_t Model = 0;
+	uint32_t ObjectId = 0;
+};
+
+static void PrintUsage()
+{
+	printf(
+		"GltfExplorerHeadless [options]\n"
+		"  --frames <n>      Frames to run (default 300)\n"
+		"  --nodes <n>       Scene nodes (default 10000)\n"
+		"  --batches <n>     Batches per node (default 2)\n"
+		"  --buckets <n>     Gather buckets (default 4)\n"
+		"  --moving <n>      Percentage of nodes that move each frame (default 5)\n"
+		"  --no-stream       Only count commands, do not keep the recorded stream\n"
+		"  --bindless        Emulate a bindless device\n"
+		"  --capture <path>  Write the last frame to a capture file for GltfExplorerReplay\n"
+		"  --trace <path>    Write profiler zones as a Chrome trace when done\n"
+		"  --no-profile      Disable profiler zones, for measuring their overhead\n"
+		"  --no-pipeline     Simulate each frame on the main thread before recording it\n"
+		"  --no-cull         Draw every node regardless of the view frustum\n"
+		"  --stats-json <path>  Write frame time percentiles, histogram and hitches\n"
+		"  --stats-csv <path>   Write the time of every frame in the stats window\n"
+		"  --glb <path>         Draw the nodes of a glb instead of the synthetic scene\n"
+		"  --camera-path <path> Fly the camera along a recorded path at a fixed 60Hz timestep, runs the whole path\n"
+		"                       unless --frames is given\n"
+		"  --bench-json <path>  Write the time of every pipeline stage for every frame\n"
+		"  --texture-budget <MB> Stream the glb's textures within this much device memory\n");
+}
+
+static bool ParseOptions(int argc, char** argv, HeadlessOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		auto ReadUint = [&](uint32_t& out) -> bool
+		{
+			if (!value)
+			{
+				LOGERROR("Missing value for %s", arg);
+				return false;
+			}
+
+			out = (uint32_t)strtoul(value, nullptr, 10);
+			i++;
+			return true;
+		};
+
+		bool ok = true;
+		if (strcmp(arg, "--frames") == 0) { ok = ReadUint(options.Frames); options.FramesSet = true; }
+		else if (strcmp(arg, "--nodes") == 0) ok = ReadUint(options.Nodes);
+		else if (strcmp(arg, "--batches") == 0) ok = ReadUint(options.BatchesPerNode);
+		else if (strcmp(arg, "--buckets") == 0) ok = ReadUint(options.Buckets);
+		else if (strcmp(arg, "--moving") == 0) ok = ReadUint(options.MovingPercent);
+		else if (strcmp(arg, "--no-stream") == 0) options.RecordCommands = false;
+		else if (strcmp(arg, "--bindless") == 0) options.Bindless = true;
+		else if (strcmp(arg, "--capture") == 0 && value) { options.CapturePath = value; i++; }
+		else if (strcmp(arg, "--trace") == 0 && value) { options.TracePath = value; i++; }
+		else if (strcmp(arg, "--no-profile") == 0) options.Profile = false;
+		else if (strcmp(arg, "--no-pipeline") == 0) options.Pipeline = false;
+		else if (strcmp(arg, "--no-cull") == 0) options.Cull = false;
+		else if (strcmp(arg, "--stats-json") == 0 && value) { options.StatsJsonPath = value; i++; }
+		else if (strcmp(arg, "--stats-csv") == 0 && value) { options.StatsCsvPath = value; i++; }
+		else if (strcmp(arg, "--glb") == 0 && value) { options.GlbPath = value; i++; }
+		else if (strcmp(arg, "--camera-path") == 0 && value) { options.CameraPathFile = value; i++; }
+		else if (strcmp(arg, "--bench-json") == 0 && value) { options.BenchJsonPath = value; i++; }
+		else if (strcmp(arg, "--texture-budget") == 0) ok = ReadUint(options.TextureBudgetMB);
+		else
+		{
+			LOGERROR("Unknown option %s", arg);
+			ok = false;
+		}
+
+		if (!ok)
+			return false;
+	}
+
+	options.Buckets = Max(options.Buckets, 1u);
+
+	return true;
+}
+
+static void CreateBenchResources(BenchResources& res, const HeadlessOptions& options)
+{
+	GraphicsPipelineStateDesc psoDesc = {};
+
+	res.Psos.resize(options.Psos);
+	for (GraphicsPipelineStatePtr& pso : res.Psos)
+	{
+		pso = CreateGraphicsPipelineState(psoDesc, nullptr, 0);
+	}
+
+	res.Materials.resize(options.Materials);
+	res.Textures.resize(options.Materials);
+	res.SrvPtrs.resize(options.Materials);
+	res.Srvs.resize(options.Materials);
+	res.Bindings.resize(options.Materials);
+	for (uint32_t m = 0; m < options.Materials; m++)
+	{
+		const float4 materialData = float4{ 1.0f, 1.0f, 1.0f, 1.0f };
+		res.Materials[m] = CreateConstantBuffer(&materialData, sizeof(materialData));
+
+		TextureCreateDesc texDesc = {};
+		texDesc.Width = 4;
+		texDesc.Height = 4;
+		texDesc.Format = RenderFormat::R8G8B8A8_UNORM;
+		res.Textures[m] = CreateTexture(texDesc);
+		res.SrvPtrs[m] = CreateTextureSRV(res.Textures[m], RenderFormat::R8G8B8A8_UNORM, TextureDimension::TEX2D, 1, 1);
+		res.Srvs[m] = res.SrvPtrs[m];
+
+		res.Bindings[m].PixelSrvBinds = &res.Srvs[m];
+		res.Bindings[m].PixelSrvCount = 1;
+	}
+
+	res.Meshes.resize(options.Meshes);
+	for (MeshBuffers& mesh : res.Meshes)
+	{
+		for (uint8_t v = 0; v < (uint8_t)MeshVertexBuffers::COUNT; v++)
+		{
+			mesh.VertexBuffers[v] = CreateVertexBuffer(nullptr, 1024);
+			mesh.BindVertexBuffers[v] = mesh.VertexBuffers[v];
+			mesh.Strides[v] = v == (uint8_t)MeshVertexBuffers::TEXCOORD0 || v == (uint8_t)MeshVertexBuffers::TEXCOORD1 ? 8u : 12u;
+			mesh.Offsets[v] = 0;
+		}
+
+		mesh.IndexBuffer = CreateIndexBuffer(nullptr, 1536);
+		mesh.IndexFormat = RenderFormat::R16_UINT;
+		mesh.IndexCount = 768;
+	}
+}
+
+static bool CreateGlbResources(GlbResources& res, SScene& scene)
+{
+	if (scene.Models.empty() || scene.Nodes.empty())
+		return false;
+
+	res.ModelMeshes.resize(scene.Models.size());
+	for (size_t m = 0; m < scene.Models.size(); m++)
+	{
+		const SModel& model = scene.Models[m];
+
+		res.ModelMeshes[m].resize(model.Meshes.size());
+		for (size_t p = 0; p < model.Meshes.size(); p++)
+		{
+			const SMesh& mesh = model.Meshes[p];
+			MeshBuffers& buffers = res.ModelMeshes[m][p];
+
+			// The scene keeps ownership, only the raw handles are needed for binding
+			for (uint8_t v = 0; v < (uint8_t)MeshVertexBuffers::COUNT; v++)
+			{
+				buffers.BindVertexBuffers[v] = mesh.VertexBuffersRaw[v];
+				buffers.Strides[v] = mesh.BufferStrides[v];
+				buffers.Offsets[v] = mesh.BufferOffsets[v];
+			}
+
+			buffers.IndexBuffer = mesh.IndexBuffer;
+			buffers.IndexFormat = mesh.IndexFormat;
+			buffers.IndexCount = mesh.IndexCount;
+		}
+	}
+
+	const GraphicsPipelineTargetDesc targetDesc({ RenderFormat::R8G8B8A8_UNORM }, { BlendMode::None() }, RenderFormat::D32_FLOAT);
+
+	res.MaterialBindings.resize(scene.Materials.size());
+	res.MaterialPsos.resize(scene.Materials.size());
+	for (size_t m = 0; m < scene.Materials.size(); m++)
+	{
+		SMaterial& material = scene.Materials[m];
+
+		res.MaterialBindings[m].PixelSrvBinds = material.Srvs;
+		res.MaterialBindings[m].PixelSrvCount = kMaterialTextureCount;
+
+		res.MaterialPsos[m] = GetPSOForMaterial(material, targetDesc);
+	}
+
+	return true;
+}
+
+struct PhaseTimes
+{
+	// Simulation stage, on the pipeline worker unless --no-pipeline
+	double Update = 0.0;
+	double Gather = 0.0;
+	double Sort = 0.0;
+
+	// Render stage
+	double Wait = 0.0;
+	double Upload = 0.0;
+	double Render = 0.0;
+	double Submit = 0.0;
+	double Frame = 0.0;
+
+	PhaseTimes& operator+=(const PhaseTimes& other) noexcept
+	{
+		Update += other.Update;
+		Gather += other.Gather;
+		Sort += other.Sort;
+		Wait += other.Wait;
+		Upload += other.Upload;
+		Render += other.Render;
+		Submit += other.Submit;
+		Frame += other.Frame;
+		return *this;
+	}
+};
+
+struct HeadlessFrameInput
+{
+	float DeltaSeconds = 0.0f;
+	SceneView View = {};
+};
+
+// Handed from the simulation stage to the render stage, everything it points to lives in the frame's arenas
+struct HeadlessFrameSnapshot
+{
+	SceneView View = {};
+	FrameArena* Arena = nullptr;
+	const SceneDrawList* DrawList = nullptr;
+	RenderInfo Info = {};
+	uint32_t VisibleNodes = 0;
+	uint32_t CulledNodes = 0;
+	PhaseTimes Times = {};
+};
+
+struct HeadlessFrameRecord
+{
+	PhaseTimes Times = {};
+	uint32_t VisibleNodes = 0;
+	uint32_t CulledNodes = 0;
+	uint32_t Draws = 0;
+};
+
+static bool WriteBenchJson(const char* path, const HeadlessOptions& options, const std::vector<HeadlessFrameRecord>& records, const FrameTimeSummary& summary)
+{
+	FILE* fp = OpenFile(path, "w");
+
+	if (!ENSUREMSG(fp, "Failed to open benchmark results for writing (%s)", path))
+		return false;
+
+	PhaseTimes totals = {};
+	for (const HeadlessFrameRecord& record : records)
+	{
+		totals += record.Times;
+	}
+
+	const double frames = (double)Max<size_t>(records.size(), 1u);
+
+	// Paths come from the command line, keep them valid json
+	fprintf(fp, "{\n  \"scene\": ");
+	Log_WriteJsonString(fp, options.GlbPath ? options.GlbPath : "synthetic");
+	fprintf(fp, ",\n  \"camera_path\": ");
+	Log_WriteJsonString(fp, options.CameraPathFile ? options.CameraPathFile : "");
+	fprintf(fp, ",\n");
+	fprintf(fp, "  \"frames\": %zu,\n  \"pipelined\": %s,\n  \"culling\": %s,\n  \"bindless\": %s,\n",
+		records.size(), options.Pipeline ? "true" : "false", options.Cull ? "true" : "false", options.Bindless ? "true" : "false");
+
+	fprintf(fp, "  \"average_ms\": { \"update\": %.4f, \"gather\": %.4f, \"sort\": %.4f, \"wait\": %.4f, \"upload\": %.4f, \"record\": %.4f, \"submit\": %.4f, \"frame\": %.4f },\n",
+		totals.Update / frames, totals.Gather / frames, totals.Sort / frames, totals.Wait / frames, totals.Upload / frames, totals.Render / frames, totals.Submit / frames, totals.Frame / frames);
+	fprintf(fp, "  \"frame_ms\": { \"min\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"p999\": %.4f, \"max\": %.4f },\n",
+		summary.MinMilliseconds, summary.P50Milliseconds, summary.P95Milliseconds, summary.P99Milliseconds, summary.P999Milliseconds, summary.MaxMilliseconds);
+
+	fprintf(fp, "  \"per_frame\": [");
+	for (size_t f = 0; f < records.size(); f++)
+	{
+		const HeadlessFrameRecord& record = records[f];
+		const PhaseTimes& t = record.Times;
+
+		fprintf(fp, "%s\n    { \"frame\": %zu, \"update\": %.4f, \"gather\": %.4f, \"sort\": %.4f, \"wait\": %.4f, \"upload\": %.4f, \"record\": %.4f, \"submit\": %.4f, \"frame_ms\": %.4f, \"visible\": %u, \"culled\": %u, \"draws\": %u }",
+			f == 0 ? "" : ",", f, t.Update, t.Gather, t.Sort, t.Wait, t.Upload, t.Render, t.Submit, t.Frame, record.VisibleNodes, record.CulledNodes, record.Draws);
+	}
+	fprintf(fp, "\n  ]\n}\n");
+
+	const bool ok = ferror(fp) == 0;
+	fclose(fp);
+
+	if (!ENSUREMSG(ok, "Failed to write benchmark results (%s)", path))
+		return false;
+
+	LOGINFO("Wrote %zu frames of stage timings to %s", records.size(), path);
+
+	return true;
+}
+
+using HeadlessClock = std::chrono::steady_clock;
+
+static double MillisecondsSince(HeadlessClock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(HeadlessClock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+	HeadlessOptions& options = G.Options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	PROFILE_THREAD("Main");
+	Profiler_SetEnabled(options.Profile);
+
+	Log_Init(LogInitParams());
+
+	RenderNull_SetBindless(options.Bindless);
+	RenderNull_SetRecordCommands(options.RecordCommands);
+
+	RenderInitParams params;
+	if (!Render_Init(params))
+	{
+		Render_ShutDown();
+		return 1;
+	}
+
+	CreateBenchResources(G.Resources, options);
+
+	SceneGraph graph;
+	graph.SetFrustumCulling(options.Cull);
+
+	if (options.GlbPath)
+	{
+		SceneLoadParams loadParams;
+		loadParams.StreamTextures = options.TextureBudgetMB > 0u;
+		loadParams.Streaming.BudgetBytes = (uint64_t)options.TextureBudgetMB << 20u;
+
+		G.Scene = LoadSceneFromGlb(options.GlbPath, nullptr, loadParams);
+
+		if (!CreateGlbResources(G.Glb, G.Scene))
+		{
+			LOGERROR("Nothing to draw in %s", options.GlbPath);
+			G.Scene = {};
+			Render_ShutDown();
+			return 1;
+		}
+
+		for (const SNode& node : G.Scene.Nodes)
+		{
+			if (node.Model != SceneModel_t::INVALID)
+			{
+				graph.AddNode(std::make_shared<GlbMeshNode>(node));
+			}
+		}
+
+		options.Nodes = (uint32_t)G.Scene.Nodes.size();
+	}
+	else
+	{
+		// Nodes are laid out on a square grid centred under the camera, roughly half of them are behind it and get culled
+		const uint32_t gridSize = (uint32_t)ceilf(sqrtf((float)options.Nodes));
+		const float gridOffset = (float)gridSize;
+		for (uint32_t n = 0; n < options.Nodes; n++)
+		{
+			const float3 position = float3{ (float)(n % gridSize) * 2.0f - gridOffset, 0.0f, (float)(n / gridSize) * 2.0f - gridOffset };
+			graph.AddNode(std::make_shared<BenchMeshNode>(n, position));
+		}
+	}
+
+	SceneView view = {};
+	view.ViewMatrix = MakeMatrixLookAtLH(float3{ 0.0f, 10.0f, -10.0f }, float3{ 0.0f, 0.0f, 1.0f }, float3{ 0.0f, 1.0f, 0.0f });
+	view.ProjectionMatrix = MakeMatrixPerspectiveFovLH(ConvertToRadians(60.0f), 1920.0f / 1080.0f, 0.1f, 1000.0f);
+	view.CameraPosition = float3{ 0.0f, 10.0f, -10.0f };
+	view.ViewportWidth = 1920;
+	view.ViewportHeight = 1080;
+
+	CameraPath cameraPath;
+	if (options.CameraPathFile)
+	{
+		if (!cameraPath.Load(options.CameraPathFile) || cameraPath.Empty())
+		{
+			LOGERROR("No camera path to play from %s", options.CameraPathFile);
+			graph = {};
+			G.Transforms = {};
+			G.Glb = {};
+			G.Scene = {};
+			G.Resources = {};
+			Render_ShutDown();
+			return 1;
+		}
+
+		// Same projection as the fly camera so paths recorded in GltfExplorer frame the same views
+		view.ProjectionMatrix = MakeMatrixPerspectiveFovLH(ConvertToRadians(45.0f), 1920.0f / 1080.0f, 0.1f, 10000.0f);
+
+		if (!options.FramesSet)
+		{
+			options.Frames = cameraPath.GetPlaybackFrameCount();
+		}
+	}
+
+	// Fixed timestep so every run of a path renders the same views regardless of how long frames take
+	auto GetFrameInput = [&](uint32_t frame)
+	{
+		HeadlessFrameInput input;
+		input.DeltaSeconds = CameraPath::PlaybackTimestep;
+		input.View = view;
+
+		if (!cameraPath.Empty())
+		{
+			const CameraPathKey key = cameraPath.Sample((float)frame * CameraPath::PlaybackTimestep);
+			input.View.ViewMatrix = CameraPath_MakeViewMatrix(key);
+			input.View.CameraPosition = key.Position;
+		}
+
+		return input;
+	};
+
+	FrameAllocator allocator(options.Buckets);
+	SceneRenderer renderer;
+
+	PhaseTimes totals = {};
+	std::vector<HeadlessFrameRecord> records;
+	records.reserve(options.BenchJsonPath ? options.Frames : 0u);
+	RenderNullStats nullTotals = {};
+	RenderStateCacheStats stateTotals = {};
+	uint64_t culledTotal = 0;
+	uint64_t steadyStateHeapAllocations = 0;
+	size_t streamBytes = 0;
+	std::vector<float> textureMips;
+
+	// Window covers the whole run so percentiles match the averages below
+	FrameTimeStats frameStats(Max(options.Frames, 1u));
+
+	// Never touches the render API, the render stage only reads what ends up in the snapshot
+	auto Simulate = [&](const HeadlessFrameInput& input, HeadlessFrameSnapshot& snapshot)
+	{
+		snapshot.Times = {};
+		snapshot.View = input.View;
+
+		allocator.BeginFrame();
+
+		HeadlessClock::time_point phaseStart = HeadlessClock::now();
+
+		graph.Update(input.DeltaSeconds);
+
+		snapshot.Times.Update = MillisecondsSince(phaseStart);
+		phaseStart = HeadlessClock::now();
+
+		std::span<Renderables> renderables = graph.GatherRenderables(input.View, allocator);
+
+		snapshot.Times.Gather = MillisecondsSince(phaseStart);
+		phaseStart = HeadlessClock::now();
+
+		snapshot.Arena = &allocator.GetArena();
+		snapshot.DrawList = renderer.Prepare(*snapshot.Arena, renderables.data(), renderables.size());
+
+		snapshot.Times.Sort = MillisecondsSince(phaseStart);
+
+		snapshot.Info = SceneGraph::BuildRenderInfo(input.View);
+		snapshot.Info.Transforms = &G.Transforms;
+
+		snapshot.VisibleNodes = 0;
+		snapshot.CulledNodes = 0;
+		for (const Renderables& r : renderables)
+		{
+			snapshot.VisibleNodes += r.VisibleNodes;
+			snapshot.CulledNodes += r.CulledNodes;
+		}
+	};
+
+	FramePipeline<HeadlessFrameSnapshot, HeadlessFrameInput> pipeline(Simulate);
+	pipeline.SetPipelined(options.Pipeline);
+
+	pipeline.KickSimulation(GetFrameInput(0u));
+
+	// Only the last frame is captured. Built once since an empty capture's stream deque already allocates.
+	FrameCapture capture;
+
+	// Counted across every thread from one frame's end to the next, so simulating ahead and parallel recording are included
+	uint64_t allocationMark = AllocationCounter_GetCount();
+
+	for (uint32_t frame = 0; frame < options.Frames; frame++)
+	{
+		PROFILE_FRAME();
+
+		const HeadlessClock::time_point frameStart = HeadlessClock::now();
+
+		uint64_t streamingAllocations = 0;
+		uint64_t hitchAllocations = 0;
+
+		Render_BeginFrame();
+
+		Render_BeginRenderFrame();
+
+		HeadlessFrameSnapshot& snapshot = pipeline.WaitForSimulation();
+
+		PhaseTimes times = snapshot.Times;
+		times.Wait = pipeline.GetLastWaitMilliseconds();
+
+		const bool captureFrame = options.CapturePath && frame + 1 == options.Frames;
+
+		{
+			CommandListSubmissionGroup clGroup(CommandListType::GRAPHICS);
+
+			CommandList* cl = clGroup.CreateCommandList();
+
+			HeadlessClock::time_point phaseStart = HeadlessClock::now();
+
+			// Transforms the simulation wrote are queued for upload here, after this the worker may move them again
+			G.Transforms.Update();
+
+			// Before the kick, the simulation reads material buffers the streamer may replace
+			if (G.Scene.Streaming)
+			{
+				const uint64_t streamingStart = AllocationCounter_GetCount();
+
+				const SceneStreamingView streamingView = SceneStreaming_MakeView(snapshot.View.ProjectionMatrix, snapshot.View.ViewportHeight, snapshot.View.CameraPosition);
+
+				textureMips.assign(G.Scene.Textures.size(), FLT_MAX);
+				SceneStreaming_RequestNodes(G.Scene, streamingView, snapshot.View.ViewMatrix * snapshot.View.ProjectionMatrix, textureMips.data());
+				SceneStreaming_Update(G.Scene, textureMips.data());
+
+				// Nothing else runs between the wait and the kick, so these are the streamer's alone
+				streamingAllocations = AllocationCounter_GetCount() - streamingStart;
+			}
+
+			if (captureFrame)
+			{
+				capture.ViewMatrix = snapshot.View.ViewMatrix;
+				capture.ProjectionMatrix = snapshot.View.ProjectionMatrix;
+				capture.CameraPosition = snapshot.View.CameraPosition;
+				capture.ViewportWidth = snapshot.View.ViewportWidth;
+				capture.ViewportHeight = snapshot.View.ViewportHeight;
+				capture.Bindless = Render_IsBindless();
+
+				capture.ObjectTransforms.resize(G.Transforms.GetObjectCount());
+				for (uint32_t i = 0; i < G.Transforms.GetObjectCount(); i++)
+				{
+					capture.ObjectTransforms[i] = G.Transforms.GetTransform(i);
+				}
+				capture.ObjectTransformsSrv = static_cast<uint64_t>(G.Transforms.GetSrv());
+
+				renderer.CaptureNextFrame(&capture);
+			}
+
+			if (frame + 1 < options.Frames)
+			{
+				pipeline.KickSimulation(GetFrameInput(frame + 1u));
+			}
+
+			UploadBuffers(cl);
+
+			times.Upload = MillisecondsSince(phaseStart);
+			phaseStart = HeadlessClock::now();
+
+			renderer.Render(&clGroup, *snapshot.Arena, *snapshot.DrawList, snapshot.Info);
+
+			times.Render = MillisecondsSince(phaseStart);
+			phaseStart = HeadlessClock::now();
+
+			{
+				PROFILE_ZONE("Submit");
+				clGroup.Submit();
+			}
+
+			times.Submit = MillisecondsSince(phaseStart);
+		}
+
+		Render_EndFrame();
+
+		times.Frame = MillisecondsSince(frameStart);
+
+		if (frameStats.AddFrame((float)times.Frame))
+		{
+			const uint64_t hitchStart = AllocationCounter_GetCount();
+
+			ProfileZoneTime hottest;
+			if (Profiler_FindHottestZone(Profiler_GetFrameStart(0u), Profiler_Now(), hottest))
+			{
+				frameStats.SetLastHitchZone(hottest.Name, (float)(hottest.Microseconds * 1e-3));
+			}
+
+			// Attributing a hitch copies the profiler's buffers, only slow frames pay for it
+			hitchAllocations = AllocationCounter_GetCount() - hitchStart;
+		}
+
+		totals += times;
+		culledTotal += snapshot.CulledNodes;
+
+		const RenderNullStats& frameNullStats = RenderNull_GetFrameStats();
+		nullTotals += frameNullStats;
+
+		if (options.BenchJsonPath)
+		{
+			records.push_back(HeadlessFrameRecord{ times, snapshot.VisibleNodes, snapshot.CulledNodes, (uint32_t)frameNullStats.Draws });
+		}
+		stateTotals += renderer.GetLastFrameStats();
+		streamBytes = RenderNull_GetFrameCommands().size() * sizeof(NullCommand);
+
+		// Streaming in new mips, attributing hitches and recording a capture allocate by design
+		const uint64_t allocationCount = AllocationCounter_GetCount();
+		if (frame >= FrameAllocator::WarmupFrames && !captureFrame)
+		{
+			steadyStateHeapAllocations += allocationCount - allocationMark - streamingAllocations - hitchAllocations;
+		}
+		allocationMark = allocationCount;
+
+		if (captureFrame)
+		{
+			capture.Finalize();
+			FrameCapture_Write(capture, options.CapturePath);
+		}
+	}
+
+	const double frames = (double)Max(options.Frames, 1u);
+
+	LOGINFO("Headless: %u frames, %u nodes from %s, %u buckets%s%s%s",
+		options.Frames, options.Nodes, options.GlbPath ? options.GlbPath : "synthetic scene", options.Buckets, options.Bindless ? ", bindless" : "",
+		options.Pipeline ? ", pipelined" : "", cameraPath.Empty() ? "" : ", camera path");
+	LOGINFO("  Average simulation ms: update %.3f gather %.3f sort %.3f, culled %.0f nodes",
+		totals.Update / frames, totals.Gather / frames, totals.Sort / frames, culledTotal / frames);
+	LOGINFO("  Average render ms: wait %.3f upload %.3f record %.3f submit %.3f frame %.3f",
+		totals.Wait / frames, totals.Upload / frames, totals.Render / frames, totals.Submit / frames, totals.Frame / frames);
+	const FrameTimeSummary frameSummary = frameStats.Summarize();
+	LOGINFO("  Frame ms: min %.3f p50 %.3f p95 %.3f p99 %.3f p99.9 %.3f max %.3f, %llu hitches",
+		frameSummary.MinMilliseconds, frameSummary.P50Milliseconds, frameSummary.P95Milliseconds, frameSummary.P99Milliseconds,
+		frameSummary.P999Milliseconds, frameSummary.MaxMilliseconds, (unsigned long long)frameStats.GetHitchCount());
+	LOGINFO("  Per frame: draws %.0f state changes %.0f command lists %.1f upload bytes %.0f dynamic bytes %.0f",
+		nullTotals.Draws / frames, nullTotals.StateChanges / frames, nullTotals.CommandListsSubmitted / frames,
+		nullTotals.UploadBytes / frames, nullTotals.DynamicBytes / frames);
+	LOGINFO("  State cache: issued %.0f elided %.0f per frame", stateTotals.TotalIssued() / frames, stateTotals.TotalElided() / frames);
+	LOGINFO("  Allocations building frames after warmup: %llu arena blocks, %llu heap", (unsigned long long)allocator.GetSteadyStateBlockAllocations(),
+		(unsigned long long)steadyStateHeapAllocations);
+
+	if (options.RecordCommands)
+	{
+		LOGINFO("  Last frame command stream: %zu bytes", streamBytes);
+	}
+
+	if (G.Scene.Streaming)
+	{
+		const TextureStreamingStats& textureStats = G.Scene.Streaming->Streamer.GetStats();
+		constexpr double MB = 1024.0 * 1024.0;
+
+		LOGINFO("  Texture streaming: %.1f MB resident of %u MB, peak %.1f MB, last frame wanted %.1f MB for %u textures, %u starved",
+			textureStats.ResidentBytes / MB, options.TextureBudgetMB, textureStats.PeakResidentBytes / MB, textureStats.RequestedBytes / MB,
+			textureStats.RequestedTextures, textureStats.StarvedTextures);
+		LOGINFO("    streamed in %llu mips %.1f MB, evicted %llu mips %.1f MB", (unsigned long long)textureStats.StreamedInMips,
+			textureStats.StreamedInBytes / MB, (unsigned long long)textureStats.EvictedMips, textureStats.EvictedBytes / MB);
+	}
+
+	for (uint8_t c = 0; c < (uint8_t)NullCommandType::COUNT; c++)
+	{
+		if (nullTotals.Commands[c] > 0)
+		{
+			LOGINFO("    %-28s %.0f", NullCommandType_GetName((NullCommandType)c), nullTotals.Commands[c] / frames);
+		}
+	}
+
+	if (options.StatsJsonPath && !frameStats.WriteJson(options.StatsJsonPath))
+	{
+		LOGERROR("Failed to write frame stats to %s", options.StatsJsonPath);
+	}
+
+	if (options.StatsCsvPath && !frameStats.WriteCsv(options.StatsCsvPath))
+	{
+		LOGERROR("Failed to write frame times to %s", options.StatsCsvPath);
+	}
+
+	if (options.BenchJsonPath)
+	{
+		WriteBenchJson(options.BenchJsonPath, options, records, frameSummary);
+	}
+
+	if (options.TracePath)
+	{
+		Profiler_WriteChromeTrace(options.TracePath);
+	}
+
+	graph = {};
+	G.Transforms = {};
+	G.Glb = {};
+	G.Scene = {};
+	G.Resources = {};
+
+	// Once the arenas have grown frames must be built and recorded without the heap, anything else fails the run
+	const bool allocationFree = allocator.GetSteadyStateBlockAllocations() == 0u && steadyStateHeapAllocations == 0u;
+	if (!allocationFree)
+	{
+		LOGERROR("Frames allocated from the heap after %u warmup frames", FrameAllocator::WarmupFrames);
+	}
+
+	Render_ShutDown();
+	Log_Shutdown();
+
+	return allocationFree ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+// Replays a frame capture against the null backend a fixed number of times and reports where submission time goes.
+// Captures come from the explorer's Capture Frame button or from GltfExplorerHeadless --capture.
+
+#include <Render/Render.h>
+#include <RenderNull.h>
+
+#include "../Capture/FrameCapture.h"
+#include "../Capture/FrameCaptureReplay.h"
+#include "../Logging.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace tpr;
+
+struct ReplayOptions
+{
+	const char* CapturePath = nullptr;
+	uint32_t Iterations = 100;
+	uint32_t WarmupIterations = 10;
+	bool TimeCalls = false;
+};
+
+// The null backend accepts a pipeline with no shaders and hands out render target views with nothing behind them
+static GraphicsPipelineState_t CreateNullPipelineState()
+{
+	GraphicsPipelineStateDesc psoDesc = {};
+	return CreateGraphicsPipelineState(psoDesc, nullptr, 0);
+}
+
+static RenderTargetView_t CreateNullRenderTargetView(uint32_t, uint32_t)
+{
+	return RenderNull_CreateRenderTargetView();
+}
+
+static void PrintUsage()
+{
+	printf(
+		"GltfExplorerReplay <capture> [options]\n"
+		"  --iterations <n>  Frames to replay (default 100)\n"
+		"  --warmup <n>      Frames replayed before measuring (default 10)\n"
+		"  --time-calls      Time every call by type, adds a clock read per call\n");
+}
+
+static bool ParseOptions(int argc, char** argv, ReplayOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if ((strcmp(arg, "--iterations") == 0 || strcmp(arg, "--warmup") == 0) && value)
+		{
+			uint32_t& out = strcmp(arg, "--iterations") == 0 ? options.Iterations : options.WarmupIterations;
+			out = (uint32_t)strtoul(value, nullptr, 10);
+			i++;
+		}
+		else if (strcmp(arg, "--time-calls") == 0)
+		{
+			options.TimeCalls = true;
+		}
+		else if (arg[0] != '-' && !options.CapturePath)
+		{
+			options.CapturePath = arg;
+		}
+		else
+		{
+			LOGERROR("Unknown option %s", arg);
+			return false;
+		}
+	}
+
+	return options.CapturePath != nullptr;
+}
+
+int main(int argc, char** argv)
+{
+	ReplayOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	Log_Init(LogInitParams());
+
+	FrameCapture capture;
+	if (!FrameCapture_Read(options.CapturePath, capture))
+		return 1;
+
+	// The null backend supports both binding models so it follows whichever one the capture was recorded with
+	RenderNull_SetBindless(capture.Bindless);
+
+	RenderInitParams params;
+	if (!Render_Init(params))
+	{
+		Render_ShutDown();
+		return 1;
+	}
+
+	if (capture.Bindless != Render_IsBindless())
+	{
+		LOGWARNING("Capture was recorded %s bindless but this backend %s bindless, bindings will not match the capture",
+			capture.Bindless ? "with" : "without", Render_IsBindless() ? "is" : "is not");
+	}
+
+	int result = 0;
+
+	{
+		FrameCaptureReplayBackend backend;
+		backend.CreatePipelineState = CreateNullPipelineState;
+		backend.CreateRenderTargetView = CreateNullRenderTargetView;
+
+		FrameCaptureReplayer replayer;
+		if (replayer.Init(capture, backend))
+		{
+			auto RunFrame = [&](bool timeCalls, CaptureReplayStats& stats)
+			{
+				Render_BeginFrame();
+				Render_BeginRenderFrame();
+				replayer.ReplayFrame(timeCalls, stats);
+				Render_EndFrame();
+			};
+
+			CaptureReplayStats warmupStats;
+			for (uint32_t i = 0; i < options.WarmupIterations; i++)
+			{
+				RunFrame(false, warmupStats);
+			}
+
+			CaptureReplayStats stats;
+			for (uint32_t i = 0; i < options.Iterations; i++)
+			{
+				RunFrame(options.TimeCalls, stats);
+			}
+
+			const double frames = (double)Max(stats.Frames, 1u);
+
+			LOGINFO("Replayed %s %u times: %zu command lists, %zu commands, %zu resources",
+				options.CapturePath, stats.Frames, capture.Streams.size(), capture.GetCommandCount(), capture.Resources.size());
+			LOGINFO("  Average ms: record %.3f submit %.3f", stats.RecordMilliseconds / frames, stats.SubmitMilliseconds / frames);
+
+			for (uint8_t c = 0; c < (uint8_t)CaptureCommandType::COUNT; c++)
+			{
+				if (stats.Calls[c] == 0)
+					continue;
+
+				if (options.TimeCalls)
+				{
+					LOGINFO("    %-22s %8.0f calls/frame %8.1f ns/call %8.3f ms/frame", CaptureCommandType_GetName((CaptureCommandType)c),
+						stats.Calls[c] / frames, stats.CallNanoseconds[c] / stats.Calls[c], stats.CallNanoseconds[c] / frames * 1e-6);
+				}
+				else
+				{
+					LOGINFO("    %-22s %8.0f calls/frame", CaptureCommandType_GetName((CaptureCommandType)c), stats.Calls[c] / frames);
+				}
+			}
+		}
+		else
+		{
+			result = 1;
+		}
+	}
+
+	Render_ShutDown();
+	Log_Shutdown();
+
+	return result;
+}
@@ -0,0 +1,95 @@
+#include "LoadStats.h"
+
+#include <iterator>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+const char* LoadPhase_GetName(LoadPhase phase)
+{
+	static constexpr const char* Names[] =
+	{
+		"file_read",
+		"json_parse",
+		"struct_fill",
+		"image_decode",
+		"material_build",
+		"mesh_build",
+		"node_flatten",
+	};
+
+	static_assert(std::size(Names) == KLoadPhaseCount);
+
+	return (uint32_t)phase < KLoadPhaseCount ? Names[(uint32_t)phase] : "unknown";
+}
+
+LoadPhaseScope::LoadPhaseScope(LoadStats* stats, LoadPhase phase)
+	: Stats(stats)
+	, Phase(phase)
+{
+	if (!Stats)
+		return;
+
+	AllocationStart = Stats->GetAllocationCount ? Stats->GetAllocationCount() : 0u;
+	CpuStart = LoadStats_GetProcessCpuMilliseconds();
+	WallStart = std::chrono::steady_clock::now();
+}
+
+LoadPhaseScope::~LoadPhaseScope()
+{
+	if (!Stats)
+		return;
+
+	LoadPhaseStats& phase = (*Stats)[Phase];
+
+	phase.WallMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - WallStart).count();
+	phase.CpuMilliseconds += LoadStats_GetProcessCpuMilliseconds() - CpuStart;
+
+	if (Stats->GetAllocationCount)
+		phase.Allocations += Stats->GetAllocationCount() - AllocationStart;
+}
+
+double LoadStats_GetProcessCpuMilliseconds()
+{
+#if defined(_WIN32)
+	FILETIME creation, exit, kernel, user;
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+		return 0.0;
+
+	// 100ns units
+	const uint64_t kernelTicks = ((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+	const uint64_t userTicks = ((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime;
+	return (double)(kernelTicks + userTicks) * 1e-4;
+#else
+	timespec ts = {};
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec * 1e-6;
+#endif
+}
+
+uint64_t LoadStats_GetPeakResidentBytes()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters = {};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0u;
+
+	return counters.PeakWorkingSetSize;
+#else
+	rusage usage = {};
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0u;
+
+#if defined(__APPLE__)
+	return (uint64_t)usage.ru_maxrss;
+#else
+	// Linux reports kilobytes
+	return (uint64_t)usage.ru_maxrss * 1024u;
+#endif
+#endif
+}
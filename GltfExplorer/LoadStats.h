@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+enum class LoadPhase : uint32_t
+{
+	FILE_READ,
+	JSON_PARSE,
+	STRUCT_FILL,
+	IMAGE_DECODE,
+	MATERIAL_BUILD,
+	MESH_BUILD,
+	NODE_FLATTEN,
+	COUNT,
+};
+
+constexpr uint32_t KLoadPhaseCount = (uint32_t)LoadPhase::COUNT;
+
+const char* LoadPhase_GetName(LoadPhase phase);
+
+struct LoadPhaseStats
+{
+	double WallMilliseconds = 0.0;
+
+	// Whole process, phases that fan out over threads can take more CPU than wall time
+	double CpuMilliseconds = 0.0;
+
+	uint64_t Bytes = 0;
+	uint64_t Allocations = 0;
+};
+
+// Optional breakdown of a scene load, GltfLoader_Load and LoadSceneFromGlb fill it in when given one. Phases accumulate so
+// the same stats can be passed to several loads.
+struct LoadStats
+{
+	LoadPhaseStats Phases[KLoadPhaseCount] = {};
+
+	// Programs that count allocations, by replacing operator new, can point this at their count
+	uint64_t (*GetAllocationCount)() = nullptr;
+
+	LoadPhaseStats& operator[](LoadPhase phase) { return Phases[(uint32_t)phase]; }
+	const LoadPhaseStats& operator[](LoadPhase phase) const { return Phases[(uint32_t)phase]; }
+};
+
+// Times a phase for as long as it is in scope, does nothing without stats
+class LoadPhaseScope
+{
+public:
+
+	LoadPhaseScope(LoadStats* stats, LoadPhase phase);
+	~LoadPhaseScope();
+
+	LoadPhaseScope(const LoadPhaseScope&) = delete;
+	LoadPhaseScope& operator=(const LoadPhaseScope&) = delete;
+
+	void AddBytes(uint64_t bytes)
+	{
+		if (Stats)
+			(*Stats)[Phase].Bytes += bytes;
+	}
+
+private:
+
+	LoadStats* Stats = nullptr;
+	LoadPhase Phase = LoadPhase::COUNT;
+
+	std::chrono::steady_clock::time_point WallStart;
+	double CpuStart = 0.0;
+	uint64_t AllocationStart = 0;
+};
+
+// CPU time used by every thread of the process so far
+double LoadStats_GetProcessCpuMilliseconds();
+
+// High water mark of the process working set, 0 where the platform does not report it
+uint64_t LoadStats_GetPeakResidentBytes();
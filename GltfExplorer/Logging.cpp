@@ -1,87 +1,613 @@
 #include "Logging.h"
 
+#include <OpenFile.h>
+
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <stdio.h>
 #include <stdarg.h>
+#include <string.h>
+
+#if defined(_WIN32)
 #include <Windows.h>
 
-typedef void (*LogFunc) (const char* str);
+#define PlatformOutputLog(str) OutputDebugStringA(str)
+#define PlatformDebugBreak() __debugbreak()
+#else
+// Headless builds log to stderr, breaking into a debugger is left to the assert
+#define PlatformOutputLog(str) fputs(str, stderr)
+#define PlatformDebugBreak() ((void)0)
+#endif
 
-#define PlatformFormatLogMessage(fn) \
-	constexpr size_t BufferSize = 16 * 1024; \
-	char buf[BufferSize]; \
+#define PlatformFormatLogMessage(level) \
+	char buf[KLogMaxMessageLength]; \
 	va_list ap; \
 	va_start(ap, fmt); \
-	vsprintf_s(buf, fmt, ap); \
+	vsnprintf(buf, sizeof(buf), fmt, ap); \
 	va_end(ap); \
-	fn(buf); \
+	Log_WriteText(level, buf, 0u); \
 
-#define PlatformFormatLogMessageLf(fn) \
-	constexpr size_t BufferSize = 16 * 1024; \
-	char buf[BufferSize]; \
-	va_list ap; \
-	va_start(ap, fmt); \
-	vsprintf_s(buf, fmt, ap); \
-	va_end(ap); \
-	strcat_s(buf, "\n"); \
-	fn(buf); \
+static constexpr uint32_t KLogRingCapacity = 1u << 16;
+
+// Messages whose arguments take more than this are written synchronously
+static constexpr size_t KLogMaxRecordSize = KLogRingCapacity / 4u;
+
+struct LogRecordHeader
+{
+	// Whole record including the header, a multiple of 8
+	uint32_t Size;
+	uint32_t Suppressed;
+	LogLevel Level;
+
+	// Fills the end of the ring when the next record does not fit before it wraps
+	bool Padding;
+
+	uint64_t Sequence;
+	const char* Format;
+	LogFormatFunc FormatFunc;
+};
+
+static constexpr size_t KLogHeaderSize = (sizeof(LogRecordHeader) + 7u) & ~size_t(7u);
+
+// Single producer, the owning thread, single consumer, the logging thread
+struct LogThreadRing
+{
+	alignas(64) std::atomic<uint64_t> WritePosition = 0;
+	alignas(64) std::atomic<uint64_t> ReadPosition = 0;
+
+	// Owner only, end of the record being written
+	uint64_t ReservedEnd = 0;
+
+	alignas(8) uint8_t Data[KLogRingCapacity];
+};
+
+static thread_local LogThreadRing* GLogThreadRing = nullptr;
+
+struct LogRingCursor
+{
+	LogThreadRing* Ring;
+	uint64_t Read;
+	uint64_t End;
+};
+
+static struct
+{
+	std::mutex Lock;
+
+	// Rings are never freed while the program runs, threads that exit hand theirs to the next thread to log
+	std::vector<std::unique_ptr<LogThreadRing>> Rings;
+	std::vector<LogThreadRing*> FreeRings;
+
+	std::atomic<bool> Running = false;
+	std::atomic<bool> Stopping = false;
+	std::thread Thread;
+	std::thread::id ThreadId;
+	std::condition_variable Wake;
+	std::condition_variable Drained;
+
+	std::atomic<uint64_t> NextSequence = 0;
+	std::atomic<uint64_t> WrittenCount = 0;
+
+	std::atomic<uint32_t> SiteMessagesPerSecond = 100;
+
+	// Sites that have dropped messages, reported once their flood stops
+	std::atomic<LogSite*> SuppressingSites = nullptr;
+
+	// Held while draining rings, so only one thread formats at a time
+	std::mutex DrainLock;
+	std::vector<LogRingCursor> Cursors;
+
+	// Everything below is only touched with OutputLock held
+	std::mutex OutputLock;
+	LogInitParams Params;
+	FILE* File = nullptr;
+	std::deque<std::string> RecentLines;
+	std::string LastMessage;
+	LogLevel LastLevel = LogLevel::LEVEL_INFO;
+	uint32_t Repeats = 0;
+} GLog;
+
+static uint64_t Log_CurrentSecond()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void Log_OutputLine(const char* line)
+{
+	if (GLog.Params.PlatformOutput)
+		PlatformOutputLog(line);
+
+	if (GLog.Params.Stdout)
+		fputs(line, stdout);
+
+	if (GLog.File)
+		fputs(line, GLog.File);
+
+	if (GLog.Params.RecentLineCount)
+	{
+		GLog.RecentLines.emplace_back(line);
+		while (GLog.RecentLines.size() > GLog.Params.RecentLineCount)
+			GLog.RecentLines.pop_front();
+	}
+}
+
+static void Log_OutputRepeats()
+{
+	if (GLog.Repeats == 0)
+		return;
+
+	char line[64];
+	snprintf(line, sizeof(line), "(last message repeated %u times)\n", GLog.Repeats);
+	Log_OutputLine(line);
+
+	GLog.Repeats = 0;
+}
+
+// Runs of the same message collapse into the first one and a count
+static void Log_Output(LogLevel level, const char* message, uint32_t suppressed)
+{
+	std::lock_guard<std::mutex> lock(GLog.OutputLock);
+
+	// Only while the logging thread runs, it is what writes the count out once the run ends
+	if (suppressed == 0 && GLog.Running.load(std::memory_order_relaxed) && level == GLog.LastLevel && GLog.LastMessage == message)
+	{
+		GLog.Repeats++;
+		return;
+	}
+
+	Log_OutputRepeats();
+
+	GLog.LastMessage = message;
+	GLog.LastLevel = level;
+
+	char line[KLogMaxMessageLength + 64];
+	if (suppressed)
+		snprintf(line, sizeof(line), "%s (%u similar messages suppressed)\n", message, suppressed);
+	else
+		snprintf(line, sizeof(line), "%s\n", message);
+
+	Log_OutputLine(line);
+}
+
+static void Log_FlushOutput()
+{
+	std::lock_guard<std::mutex> lock(GLog.OutputLock);
+
+	Log_OutputRepeats();
+
+	// The next message starts a new run even if it matches the last one, so a count never sits behind a quiet period
+	GLog.LastMessage.clear();
+
+	if (GLog.Params.Stdout)
+		fflush(stdout);
+
+	if (GLog.File)
+		fflush(GLog.File);
+}
+
+static void Log_ReportSuppressedSites(bool all)
+{
+	const uint64_t second = Log_CurrentSecond();
+
+	for (LogSite* site = GLog.SuppressingSites.load(std::memory_order_acquire); site; site = site->Next)
+	{
+		if (site->Suppressed.load(std::memory_order_relaxed) == 0)
+			continue;
+
+		// Still flooding, it will be reported when it passes again or goes quiet
+		if (!all && site->Second.load(std::memory_order_relaxed) == second)
+			continue;
+
+		const uint32_t suppressed = site->Suppressed.exchange(0u, std::memory_order_relaxed);
+		if (suppressed == 0)
+			continue;
+
+		char message[512];
+		snprintf(message, sizeof(message), "(%u more messages like \"%s\" suppressed)", suppressed, site->Format);
+		Log_Output(LogLevel::LEVEL_INFO, message, 0u);
+	}
+}
+
+// Formats and writes every record published so far, oldest first across threads. Returns the number written.
+static size_t Log_Drain()
+{
+	std::lock_guard<std::mutex> drainLock(GLog.DrainLock);
+
+	// Kept between drains, allocating here would show up in programs that count allocations
+	std::vector<LogRingCursor>& cursors = GLog.Cursors;
+	cursors.clear();
+	{
+		std::lock_guard<std::mutex> lock(GLog.Lock);
+		for (const std::unique_ptr<LogThreadRing>& ring : GLog.Rings)
+		{
+			const uint64_t end = ring->WritePosition.load(std::memory_order_acquire);
+			const uint64_t read = ring->ReadPosition.load(std::memory_order_relaxed);
+			if (read != end)
+				cursors.push_back({ ring.get(), read, end });
+		}
+	}
+
+	// Steps over padding, returns the next record or null once the cursor reaches the end
+	auto Front = [](LogRingCursor& cursor) -> const LogRecordHeader*
+	{
+		while (cursor.Read != cursor.End)
+		{
+			const uint32_t offset = (uint32_t)(cursor.Read & (KLogRingCapacity - 1u));
+			if (KLogRingCapacity - offset < KLogHeaderSize)
+			{
+				cursor.Read += KLogRingCapacity - offset;
+				continue;
+			}
+
+			const LogRecordHeader* header = (const LogRecordHeader*)(cursor.Ring->Data + offset);
+			if (header->Padding)
+			{
+				cursor.Read += header->Size;
+				continue;
+			}
+
+			return header;
+		}
+
+		cursor.Ring->ReadPosition.store(cursor.Read, std::memory_order_release);
+		return nullptr;
+	};
+
+	size_t written = 0;
+	char message[KLogMaxMessageLength];
+
+	for (;;)
+	{
+		LogRingCursor* next = nullptr;
+		const LogRecordHeader* nextHeader = nullptr;
+
+		for (LogRingCursor& cursor : cursors)
+		{
+			const LogRecordHeader* header = Front(cursor);
+			if (header && (!nextHeader || header->Sequence < nextHeader->Sequence))
+			{
+				next = &cursor;
+				nextHeader = header;
+			}
+		}
+
+		if (!next)
+			break;
+
+		nextHeader->FormatFunc(message, sizeof(message), nextHeader->Format, (const uint8_t*)nextHeader + KLogHeaderSize);
+		Log_Output(nextHeader->Level, message, nextHeader->Suppressed);
+
+		next->Read += nextHeader->Size;
+		next->Ring->ReadPosition.store(next->Read, std::memory_order_release);
+		written++;
+	}
+
+	GLog.WrittenCount.fetch_add(written, std::memory_order_release);
+
+	return written;
+}
+
+static void Log_ThreadMain()
+{
+	auto lastReport = std::chrono::steady_clock::now();
+
+	for (;;)
+	{
+		const bool stopping = GLog.Stopping.load(std::memory_order_acquire);
+
+		const size_t written = Log_Drain();
+		GLog.Drained.notify_all();
+
+		if (written)
+			continue;
+
+		Log_FlushOutput();
 
-void LogFatal(const char* str)
+		if (stopping)
+			break;
+
+		if (std::chrono::steady_clock::now() - lastReport > std::chrono::seconds(1))
+		{
+			Log_ReportSuppressedSites(false);
+			lastReport = std::chrono::steady_clock::now();
+		}
+
+		// Producers never signal, waking on a short timer keeps logging free of syscalls on their side
+		std::unique_lock<std::mutex> lock(GLog.Lock);
+		GLog.Wake.wait_for(lock, std::chrono::milliseconds(2));
+	}
+}
+
+// Threads come and go with parallel loops, their rings go back on the free list so the count stays bounded by the number
+// of threads alive at once
+struct LogThreadRingRelease
 {
-	OutputDebugStringA(str);
+	~LogThreadRingRelease()
+	{
+		if (!GLogThreadRing)
+			return;
+
+		std::lock_guard<std::mutex> lock(GLog.Lock);
+		GLog.FreeRings.push_back(GLogThreadRing);
+		GLogThreadRing = nullptr;
+	}
+};
+
+static LogThreadRing* Log_AcquireThreadRing()
+{
+	static thread_local LogThreadRingRelease release;
+	(void)release;
+
+	std::lock_guard<std::mutex> lock(GLog.Lock);
+
+	LogThreadRing* ring = nullptr;
+	if (!GLog.FreeRings.empty())
+	{
+		ring = GLog.FreeRings.back();
+		GLog.FreeRings.pop_back();
+	}
+	else
+	{
+		GLog.Rings.push_back(std::make_unique<LogThreadRing>());
+		ring = GLog.Rings.back().get();
+	}
+
+	GLogThreadRing = ring;
+	return ring;
 }
 
-void LogError(const char* str)
+static void Log_NoteSuppressingSite(LogSite& site, const char* fmt)
 {
-	OutputDebugStringA(str);
+	bool listed = false;
+	if (!site.Listed.compare_exchange_strong(listed, true, std::memory_order_relaxed))
+		return;
+
+	site.Format = fmt;
+
+	LogSite* head = GLog.SuppressingSites.load(std::memory_order_relaxed);
+	do
+	{
+		site.Next = head;
+	} while (!GLog.SuppressingSites.compare_exchange_weak(head, &site, std::memory_order_release, std::memory_order_relaxed));
 }
 
-void LogWarning(const char* str)
+bool Log_AcceptSite(LogLevel level, LogSite& site, const char* fmt, uint32_t& suppressed)
 {
-	OutputDebugStringA(str);
+	suppressed = 0;
+
+	const uint32_t limit = GLog.SiteMessagesPerSecond.load(std::memory_order_relaxed);
+	if (limit && level < LogLevel::LEVEL_ERROR)
+	{
+		const uint64_t second = Log_CurrentSecond();
+		if (site.Second.load(std::memory_order_relaxed) != second)
+		{
+			site.Second.store(second, std::memory_order_relaxed);
+			site.Count.store(0u, std::memory_order_relaxed);
+		}
+
+		if (site.Count.fetch_add(1u, std::memory_order_relaxed) >= limit)
+		{
+			if (site.Suppressed.fetch_add(1u, std::memory_order_relaxed) == 0)
+				Log_NoteSuppressingSite(site, fmt);
+			return false;
+		}
+	}
+
+	if (site.Suppressed.load(std::memory_order_relaxed))
+		suppressed = site.Suppressed.exchange(0u, std::memory_order_relaxed);
+
+	return true;
 }
 
-void LogInfo(const char* str)
+uint8_t* Log_ReserveRecord(LogLevel level, const char* fmt, LogFormatFunc formatFunc, size_t argBytes, uint32_t suppressed)
 {
-	OutputDebugStringA(str);
+	if (!GLog.Running.load(std::memory_order_acquire) || std::this_thread::get_id() == GLog.ThreadId)
+		return nullptr;
+
+	const size_t size = (KLogHeaderSize + argBytes + 7u) & ~size_t(7u);
+	if (size > KLogMaxRecordSize)
+		return nullptr;
+
+	LogThreadRing* ring = GLogThreadRing ? GLogThreadRing : Log_AcquireThreadRing();
+
+	const uint64_t position = ring->WritePosition.load(std::memory_order_relaxed);
+	const uint32_t offset = (uint32_t)(position & (KLogRingCapacity - 1u));
+	const uint32_t padding = KLogRingCapacity - offset < size ? KLogRingCapacity - offset : 0u;
+
+	// A full ring means the logging thread is behind, wait for it rather than lose messages
+	while (KLogRingCapacity - (position - ring->ReadPosition.load(std::memory_order_acquire)) < padding + size)
+	{
+		if (!GLog.Running.load(std::memory_order_acquire))
+			return nullptr;
+
+		GLog.Wake.notify_one();
+		std::this_thread::yield();
+	}
+
+	if (padding >= KLogHeaderSize)
+	{
+		LogRecordHeader* pad = (LogRecordHeader*)(ring->Data + offset);
+		pad->Size = padding;
+		pad->Padding = true;
+	}
+
+	LogRecordHeader* header = (LogRecordHeader*)(ring->Data + ((position + padding) & (KLogRingCapacity - 1u)));
+	header->Size = (uint32_t)size;
+	header->Suppressed = suppressed;
+	header->Level = level;
+	header->Padding = false;
+	header->Sequence = GLog.NextSequence.fetch_add(1u, std::memory_order_relaxed);
+	header->Format = fmt;
+	header->FormatFunc = formatFunc;
+
+	ring->ReservedEnd = position + padding + size;
+
+	return (uint8_t*)header + KLogHeaderSize;
 }
 
-void LogDebug(const char* str)
+void Log_CommitRecord()
 {
-	OutputDebugStringA(str);
+	GLogThreadRing->WritePosition.store(GLogThreadRing->ReservedEnd, std::memory_order_release);
+}
+
+void Log_WriteText(LogLevel level, const char* text, uint32_t suppressed)
+{
+	const size_t argBytes = LogArgCodec<const char*>::Size(text);
+	if (uint8_t* cursor = Log_ReserveRecord(level, "%s", &Log_FormatArgs<const char*>, argBytes, suppressed))
+	{
+		LogArgCodec<const char*>::Write(cursor, text);
+		Log_CommitRecord();
+		return;
+	}
+
+	// Keeps order with anything this thread already queued
+	Log_Flush();
+	Log_Output(level, text, suppressed);
+}
+
+bool Log_Init(const LogInitParams& params)
+{
+	if (!ENSUREMSG(!GLog.Running.load(), "Log_Init: already initialised"))
+		return false;
+
+	{
+		std::lock_guard<std::mutex> lock(GLog.OutputLock);
+
+		GLog.Params = params;
+		GLog.Params.FilePath = nullptr;
+
+		if (params.FilePath)
+		{
+			GLog.File = OpenFile(params.FilePath, "w");
+		}
+	}
+
+	GLog.SiteMessagesPerSecond.store(params.SiteMessagesPerSecond, std::memory_order_relaxed);
+
+	if (params.FilePath && !GLog.File)
+	{
+		LOGWARNING("Log_Init: failed to open %s, logging without it", params.FilePath);
+	}
+
+	GLog.Stopping.store(false);
+	GLog.Thread = std::thread(Log_ThreadMain);
+	GLog.ThreadId = GLog.Thread.get_id();
+	GLog.Running.store(true, std::memory_order_release);
+
+	static bool registered = false;
+	if (!registered)
+	{
+		atexit(Log_Shutdown);
+		registered = true;
+	}
+
+	return true;
+}
+
+void Log_Shutdown()
+{
+	if (!GLog.Running.exchange(false))
+		return;
+
+	GLog.Stopping.store(true, std::memory_order_release);
+	GLog.Wake.notify_all();
+	GLog.Thread.join();
+	GLog.ThreadId = {};
+
+	// Anything that slipped in while the thread was stopping
+	Log_Drain();
+	Log_ReportSuppressedSites(true);
+	Log_FlushOutput();
+
+	std::lock_guard<std::mutex> lock(GLog.OutputLock);
+	if (GLog.File)
+	{
+		fclose(GLog.File);
+		GLog.File = nullptr;
+	}
+}
+
+void Log_Flush()
+{
+	if (!GLog.Running.load(std::memory_order_acquire) || std::this_thread::get_id() == GLog.ThreadId)
+		return;
+
+	const uint64_t target = GLog.NextSequence.load(std::memory_order_acquire);
+
+	std::unique_lock<std::mutex> lock(GLog.Lock);
+	GLog.Wake.notify_one();
+	GLog.Drained.wait(lock, [target]()
+	{
+		return GLog.WrittenCount.load(std::memory_order_acquire) >= target || !GLog.Running.load(std::memory_order_acquire);
+	});
+}
+
+void Log_GetRecentLines(std::vector<std::string>& lines)
+{
+	std::lock_guard<std::mutex> lock(GLog.OutputLock);
+	lines.assign(GLog.RecentLines.begin(), GLog.RecentLines.end());
+}
+
+void Log_WriteJsonString(FILE* fp, const char* str)
+{
+	fputc('"', fp);
+	for (const char* c = str; *c; c++)
+	{
+		switch (*c)
+		{
+		case '"':	fputs("\\\"", fp); break;
+		case '\\':	fputs("\\\\", fp); break;
+		case '\n':	fputs("\\n", fp); break;
+		case '\r':	fputs("\\r", fp); break;
+		case '\t':	fputs("\\t", fp); break;
+		default:
+			if ((unsigned char)*c < 0x20)
+				fprintf(fp, "\\u%04x", (unsigned)(unsigned char)*c);
+			else
+				fputc(*c, fp);
+		}
+	}
+	fputc('"', fp);
 }
 
 void _LogFatalfLF(const char* fmt, ...)
 {
-	PlatformFormatLogMessageLf(LogFatal);
+	PlatformFormatLogMessage(LogLevel::LEVEL_FATAL);
+	Log_Flush();
 }
 
 void _LogErrorfLF(const char* fmt, ...)
 {
-	PlatformFormatLogMessageLf(LogError);
+	PlatformFormatLogMessage(LogLevel::LEVEL_ERROR);
 }
 
 void _LogWarningfLF(const char* fmt, ...)
 {
-	PlatformFormatLogMessageLf(LogWarning);
+	PlatformFormatLogMessage(LogLevel::LEVEL_WARNING);
 }
 
 void _LogInfofLF(const char* fmt, ...)
 {
-	PlatformFormatLogMessageLf(LogInfo);
+	PlatformFormatLogMessage(LogLevel::LEVEL_INFO);
 }
 
 void _LogDebugfLF(const char* fmt, ...)
 {
-	PlatformFormatLogMessageLf(LogDebug);
+	PlatformFormatLogMessage(LogLevel::LEVEL_DEBUG);
 }
 
 bool _EnsureMsg(bool condition, const char * fmt, ...)
 {
 	if (condition == false)
-	{		
-		PlatformFormatLogMessageLf(LogError);
-		__debugbreak();
+	{
+		PlatformFormatLogMessage(LogLevel::LEVEL_ERROR);
+		Log_Flush();
+		PlatformDebugBreak();
 	}
 	return condition;
 }
@@ -90,8 +616,9 @@ void _AssertMsg(bool condition, const char* fmt, ...)
 {
 	if (condition == false)
 	{
-		PlatformFormatLogMessageLf(LogFatal);
-		__debugbreak();
+		PlatformFormatLogMessage(LogLevel::LEVEL_FATAL);
+		Log_Flush();
+		PlatformDebugBreak();
 		assert(0);
 	}
 }
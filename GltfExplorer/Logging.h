@@ -1,5 +1,19 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// Once Log_Init has started the logging thread a LOG macro copies its format pointer and arguments into a per thread ring
+// and returns, formatting and output happen on that thread. Before Log_Init and after Log_Shutdown messages are formatted
+// and written on the calling thread. Errors that break into the debugger flush everything queued before them first.
+
 void _LogFatalfLF(const char* fmt, ...);
 void _LogErrorfLF(const char* fmt, ...);
 void _LogWarningfLF(const char* fmt, ...);
@@ -8,6 +22,172 @@ void _LogDebugfLF(const char* fmt, ...);
 bool _EnsureMsg(bool condition, const char* fmt, ...);
 void _AssertMsg(bool condition, const char* fmt, ...);
 
+// Levels below this are compiled out, 0 keeps debug messages, 1 info, 2 warnings, 3 errors
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 0
+#endif
+
+// Windows headers define ERROR, hence the prefix
+enum class LogLevel : uint8_t
+{
+	LEVEL_DEBUG,
+	LEVEL_INFO,
+	LEVEL_WARNING,
+	LEVEL_ERROR,
+	LEVEL_FATAL,
+};
+
+struct LogInitParams
+{
+	// OutputDebugString on Windows, stderr elsewhere
+	bool PlatformOutput = true;
+	bool Stdout = false;
+
+	// Every message is appended to this file when set
+	const char* FilePath = nullptr;
+
+	// Recent lines kept in memory for Log_GetRecentLines, 0 disables
+	uint32_t RecentLineCount = 0;
+
+	// Debug, info and warning messages from one LOG statement past this many in a second are counted rather than queued.
+	// 0 disables the limit.
+	uint32_t SiteMessagesPerSecond = 100;
+};
+
+bool Log_Init(const LogInitParams& params);
+
+// Writes out everything queued and stops the logging thread, also registered with atexit by Log_Init
+void Log_Shutdown();
+
+// Blocks until every message queued before the call has been written
+void Log_Flush();
+
+void Log_GetRecentLines(std::vector<std::string>& lines);
+
+// Writes `str` quoted and escaped as a json string, for paths and names that end up in result files
+void Log_WriteJsonString(FILE* fp, const char* str);
+
+// One per LOG statement, counts how often it fires to rate limit floods
+struct LogSite
+{
+	std::atomic<uint64_t> Second = 0;
+	std::atomic<uint32_t> Count = 0;
+	std::atomic<uint32_t> Suppressed = 0;
+
+	// Sites that have suppressed messages are listed so the counts get reported after the flood stops
+	std::atomic<bool> Listed = false;
+	const char* Format = nullptr;
+	LogSite* Next = nullptr;
+};
+
+using LogFormatFunc = int (*)(char* out, size_t size, const char* fmt, const uint8_t* args);
+
+// Returns false when the site is over its rate, `suppressed` is how many of its messages were dropped since it last passed
+bool Log_AcceptSite(LogLevel level, LogSite& site, const char* fmt, uint32_t& suppressed);
+
+// Space for the arguments of one message in the calling thread's ring, null when the logging thread is not running or
+// the message is too large for a ring. Log_CommitRecord publishes it.
+uint8_t* Log_ReserveRecord(LogLevel level, const char* fmt, LogFormatFunc formatFunc, size_t argBytes, uint32_t suppressed);
+void Log_CommitRecord();
+
+// Formats nothing, writes `text` as one message at `level`
+void Log_WriteText(LogLevel level, const char* text, uint32_t suppressed);
+
+constexpr size_t KLogMaxMessageLength = 16 * 1024;
+
+// Arguments are stored by value. Strings are copied since the pointer may not outlive the call.
+template<typename T>
+struct LogArgCodec
+{
+	static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>, "Log arguments must be numbers, enums, pointers or C strings");
+
+	static size_t Size(const T&) { return sizeof(T); }
+
+	static void Write(uint8_t*& cursor, const T& value)
+	{
+		memcpy(cursor, &value, sizeof(T));
+		cursor += sizeof(T);
+	}
+
+	static T Read(const uint8_t*& cursor)
+	{
+		T value;
+		memcpy(&value, cursor, sizeof(T));
+		cursor += sizeof(T);
+		return value;
+	}
+};
+
+template<>
+struct LogArgCodec<const char*>
+{
+	static constexpr uint32_t NullString = UINT32_MAX;
+
+	static size_t Size(const char* str) { return sizeof(uint32_t) + (str ? strlen(str) + 1u : 0u); }
+
+	static void Write(uint8_t*& cursor, const char* str)
+	{
+		const uint32_t length = str ? (uint32_t)strlen(str) : NullString;
+		memcpy(cursor, &length, sizeof(length));
+		cursor += sizeof(length);
+
+		if (str)
+		{
+			memcpy(cursor, str, length + 1u);
+			cursor += length + 1u;
+		}
+	}
+
+	static const char* Read(const uint8_t*& cursor)
+	{
+		uint32_t length;
+		memcpy(&length, cursor, sizeof(length));
+		cursor += sizeof(length);
+
+		if (length == NullString)
+			return nullptr;
+
+		const char* str = (const char*)cursor;
+		cursor += length + 1u;
+		return str;
+	}
+};
+
+// Arrays decay and every string is stored as a const char*
+template<typename T>
+using LogArgType = std::conditional_t<std::is_same_v<std::decay_t<T>, char*>, const char*, std::decay_t<T>>;
+
+template<typename... Args>
+int Log_FormatArgs(char* out, size_t size, const char* fmt, const uint8_t* args)
+{
+	// Braced initialisation reads the arguments in order
+	const std::tuple<Args...> values{ LogArgCodec<Args>::Read(args)... };
+	(void)args;
+
+	return std::apply([&](const Args&... v) { return snprintf(out, size, fmt, v...); }, values);
+}
+
+template<typename... Args>
+void Log_Write(LogLevel level, LogSite& site, const char* fmt, const Args&... args)
+{
+	uint32_t suppressed = 0;
+	if (!Log_AcceptSite(level, site, fmt, suppressed))
+		return;
+
+	const size_t argBytes = (LogArgCodec<LogArgType<Args>>::Size(args) + ... + 0u);
+
+	if (uint8_t* cursor = Log_ReserveRecord(level, fmt, &Log_FormatArgs<LogArgType<Args>...>, argBytes, suppressed))
+	{
+		(LogArgCodec<LogArgType<Args>>::Write(cursor, args), ...);
+		Log_CommitRecord();
+		return;
+	}
+
+	char buf[KLogMaxMessageLength];
+	snprintf(buf, sizeof(buf), fmt, args...);
+	Log_WriteText(level, buf, suppressed);
+}
+
 //#define FAST_ENSURES
 
 #ifndef FAST_ENSURES
@@ -18,8 +198,28 @@ void _AssertMsg(bool condition, const char* fmt, ...);
 
 #define ASSERTMSG(x, ...) _AssertMsg(x, __VA_ARGS__)
 
-#define LOGERROR(...) 		_LogErrorfLF(__VA_ARGS__)
-#define LOGWARNING(...) 	_LogWarningfLF(__VA_ARGS__)
-#define LOGINFO(...) 		_LogInfofLF(__VA_ARGS__)
-#define LOGDEBUG(...) 		_LogDebugfLF(__VA_ARGS__)
+#define LOG_WRITE(level, ...) do { static LogSite _logSite; Log_Write(level, _logSite, __VA_ARGS__); } while (0)
+
+#if LOG_COMPILE_LEVEL <= 3
+#define LOGERROR(...) 		LOG_WRITE(LogLevel::LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOGERROR(...) 		((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= 2
+#define LOGWARNING(...) 	LOG_WRITE(LogLevel::LEVEL_WARNING, __VA_ARGS__)
+#else
+#define LOGWARNING(...) 	((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= 1
+#define LOGINFO(...) 		LOG_WRITE(LogLevel::LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOGINFO(...) 		((void)0)
+#endif
 
+#if LOG_COMPILE_LEVEL <= 0
+#define LOGDEBUG(...) 		LOG_WRITE(LogLevel::LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOGDEBUG(...) 		((void)0)
+#endif
@@ -0,0 +1,338 @@
+#include "Profiler.h"
+
+#include <OpenFile.h>
+
+#include "../Logging.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+std::atomic<bool> GProfilerEnabled = true;
+thread_local ProfileThreadBuffer* GProfilerThreadBuffer = nullptr;
+
+using ProfilerClock = std::chrono::steady_clock;
+
+static struct
+{
+	std::mutex Lock;
+
+	// Buffers are never freed while the program runs so snapshots can read them without holding on to threads
+	std::vector<std::unique_ptr<ProfileThreadBuffer>> Buffers;
+	std::vector<ProfileThreadBuffer*> FreeBuffers;
+
+	std::atomic<uint64_t> FrameIndex = 0;
+	uint64_t FrameStarts[ProfilerMaxFrames] = {};
+
+	// Pairs of timestamp and clock readings used to convert timestamps to time
+	uint64_t CalibrationTicks = Profiler_Now();
+	ProfilerClock::time_point CalibrationTime = ProfilerClock::now();
+	std::atomic<double> TicksPerMicrosecond = 0.0;
+} GProfiler;
+
+// Threads started by parallel loops come and go, their buffers go back on the free list so the count stays bounded by
+// the number of threads alive at once
+struct ProfileThreadRelease
+{
+	~ProfileThreadRelease()
+	{
+		if (!GProfilerThreadBuffer)
+			return;
+
+		std::lock_guard<std::mutex> lock(GProfiler.Lock);
+		GProfilerThreadBuffer->Depth = 0;
+		GProfiler.FreeBuffers.push_back(GProfilerThreadBuffer);
+		GProfilerThreadBuffer = nullptr;
+	}
+};
+
+ProfileThreadBuffer* Profiler_AcquireThreadBuffer()
+{
+	static thread_local ProfileThreadRelease release;
+	(void)release;
+
+	std::lock_guard<std::mutex> lock(GProfiler.Lock);
+
+	ProfileThreadBuffer* buffer = nullptr;
+	if (!GProfiler.FreeBuffers.empty())
+	{
+		buffer = GProfiler.FreeBuffers.back();
+		GProfiler.FreeBuffers.pop_back();
+	}
+	else
+	{
+		GProfiler.Buffers.push_back(std::make_unique<ProfileThreadBuffer>());
+		buffer = GProfiler.Buffers.back().get();
+		buffer->ThreadIndex = (uint32_t)GProfiler.Buffers.size() - 1u;
+		snprintf(buffer->Name, sizeof(buffer->Name), "Thread %u", buffer->ThreadIndex);
+	}
+
+	GProfilerThreadBuffer = buffer;
+	return buffer;
+}
+
+void Profiler_SetEnabled(bool enabled)
+{
+	GProfilerEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler_SetThreadName(const char* name)
+{
+	ProfileThreadBuffer* buffer = Profiler_GetThreadBuffer();
+
+	std::lock_guard<std::mutex> lock(GProfiler.Lock);
+	snprintf(buffer->Name, sizeof(buffer->Name), "%s", name);
+}
+
+static void Profiler_Calibrate()
+{
+	const uint64_t ticks = Profiler_Now();
+	const ProfilerClock::time_point time = ProfilerClock::now();
+
+	const double elapsedUs = std::chrono::duration<double, std::micro>(time - GProfiler.CalibrationTime).count();
+
+	// Too short an interval gives a noisy rate, the first few frames keep whatever estimate came before
+	if (elapsedUs > 10000.0)
+	{
+		GProfiler.TicksPerMicrosecond.store((double)(ticks - GProfiler.CalibrationTicks) / elapsedUs, std::memory_order_relaxed);
+	}
+}
+
+void Profiler_BeginFrame()
+{
+	const uint64_t index = GProfiler.FrameIndex.load(std::memory_order_relaxed) + 1u;
+	GProfiler.FrameStarts[index % ProfilerMaxFrames] = Profiler_Now();
+	GProfiler.FrameIndex.store(index, std::memory_order_release);
+
+	Profiler_Calibrate();
+}
+
+void Profiler_Counter(const char* name, double value)
+{
+	if (!Profiler_IsEnabled())
+		return;
+
+	ProfileThreadBuffer* buffer = Profiler_GetThreadBuffer();
+
+	ProfileEvent e;
+	e.Name = name;
+	e.Start = Profiler_Now();
+	e.Value = value;
+	e.Depth = buffer->Depth;
+	e.Type = ProfileEventType::COUNTER;
+
+	buffer->Push(e);
+}
+
+uint64_t Profiler_GetFrameIndex()
+{
+	return GProfiler.FrameIndex.load(std::memory_order_acquire);
+}
+
+uint64_t Profiler_GetFrameStart(uint32_t framesAgo)
+{
+	const uint64_t index = Profiler_GetFrameIndex();
+	if (framesAgo >= ProfilerMaxFrames || framesAgo > index)
+		return 0;
+
+	return GProfiler.FrameStarts[(index - framesAgo) % ProfilerMaxFrames];
+}
+
+double Profiler_TicksToMicroseconds(uint64_t ticks)
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	double ticksPerUs = GProfiler.TicksPerMicrosecond.load(std::memory_order_relaxed);
+	if (ticksPerUs <= 0.0)
+	{
+		// Nothing has calibrated yet, wait long enough for a usable estimate. Only happens before the first frames.
+		while (std::chrono::duration<double, std::micro>(ProfilerClock::now() - GProfiler.CalibrationTime).count() <= 10000.0) {}
+		Profiler_Calibrate();
+		ticksPerUs = GProfiler.TicksPerMicrosecond.load(std::memory_order_relaxed);
+	}
+	return (double)ticks / ticksPerUs;
+#else
+	using Period = ProfilerClock::period;
+	return (double)ticks * 1e6 * Period::num / Period::den;
+#endif
+}
+
+void Profiler_Snapshot(std::vector<ProfileThreadSnapshot>& threads, uint64_t sinceTicks)
+{
+	std::lock_guard<std::mutex> lock(GProfiler.Lock);
+
+	threads.resize(GProfiler.Buffers.size());
+
+	for (size_t t = 0; t < GProfiler.Buffers.size(); t++)
+	{
+		const ProfileThreadBuffer& buffer = *GProfiler.Buffers[t];
+		ProfileThreadSnapshot& snapshot = threads[t];
+
+		snapshot.ThreadIndex = buffer.ThreadIndex;
+		snapshot.Name = buffer.Name;
+		snapshot.Events.clear();
+
+		const uint64_t writeCount = buffer.WriteCount.load(std::memory_order_acquire);
+		const uint64_t first = writeCount > ProfileThreadBuffer::Capacity ? writeCount - ProfileThreadBuffer::Capacity : 0u;
+
+		snapshot.Events.reserve((size_t)(writeCount - first));
+
+		for (uint64_t i = first; i < writeCount; i++)
+		{
+			snapshot.Events.push_back(buffer.Events[i & (ProfileThreadBuffer::Capacity - 1u)]);
+		}
+
+		// The owner kept writing while we copied, drop whatever it may have overwritten under us
+		const uint64_t writeCountAfter = buffer.WriteCount.load(std::memory_order_acquire);
+		if (writeCountAfter - first > ProfileThreadBuffer::Capacity)
+		{
+			const uint64_t overwritten = writeCountAfter - first - ProfileThreadBuffer::Capacity;
+			snapshot.Events.erase(snapshot.Events.begin(), snapshot.Events.begin() + (ptrdiff_t)std::min<uint64_t>(overwritten, snapshot.Events.size()));
+		}
+
+		if (sinceTicks > 0)
+		{
+			std::erase_if(snapshot.Events, [sinceTicks](const ProfileEvent& e)
+			{
+				return (e.Type == ProfileEventType::ZONE ? e.End : e.Start) < sinceTicks;
+			});
+		}
+	}
+}
+
+bool Profiler_FindHottestZone(uint64_t startTicks, uint64_t endTicks, ProfileZoneTime& hottest)
+{
+	std::vector<ProfileThreadSnapshot> threads;
+	Profiler_Snapshot(threads, startTicks);
+
+	struct OpenZone
+	{
+		const ProfileEvent* Event;
+		size_t Total;
+	};
+
+	std::vector<ProfileZoneTime> totals;
+	std::vector<const ProfileEvent*> zones;
+	std::vector<OpenZone> stack;
+
+	for (const ProfileThreadSnapshot& thread : threads)
+	{
+		zones.clear();
+		for (const ProfileEvent& e : thread.Events)
+		{
+			if (e.Type == ProfileEventType::ZONE && e.Start >= startTicks && e.End <= endTicks)
+				zones.push_back(&e);
+		}
+
+		// Parents before children so the stack always holds the chain of zones enclosing the current one
+		std::sort(zones.begin(), zones.end(), [](const ProfileEvent* a, const ProfileEvent* b)
+		{
+			return a->Start != b->Start ? a->Start < b->Start : a->Depth < b->Depth;
+		});
+
+		stack.clear();
+		for (const ProfileEvent* e : zones)
+		{
+			while (!stack.empty() && stack.back().Event->End <= e->Start)
+				stack.pop_back();
+
+			const double us = Profiler_TicksToMicroseconds(e->End - e->Start);
+
+			auto it = std::find_if(totals.begin(), totals.end(), [&](const ProfileZoneTime& t) { return strcmp(t.Name, e->Name) == 0; });
+			if (it == totals.end())
+			{
+				totals.push_back(ProfileZoneTime{ e->Name, 0.0 });
+				it = totals.end() - 1;
+			}
+
+			it->Microseconds += us;
+
+			if (!stack.empty())
+				totals[stack.back().Total].Microseconds -= us;
+
+			stack.push_back(OpenZone{ e, (size_t)(it - totals.begin()) });
+		}
+	}
+
+	if (totals.empty())
+		return false;
+
+	hottest = *std::max_element(totals.begin(), totals.end(), [](const ProfileZoneTime& a, const ProfileZoneTime& b)
+	{
+		return a.Microseconds < b.Microseconds;
+	});
+
+	return true;
+}
+
+bool Profiler_WriteChromeTrace(const char* path)
+{
+	std::vector<ProfileThreadSnapshot> threads;
+	Profiler_Snapshot(threads);
+
+	FILE* fp = OpenFile(path, "w");
+
+	if (!ENSUREMSG(fp, "Failed to open trace file for writing (%s)", path))
+		return false;
+
+	uint64_t baseTicks = UINT64_MAX;
+	for (const ProfileThreadSnapshot& thread : threads)
+	{
+		for (const ProfileEvent& e : thread.Events)
+			baseTicks = std::min(baseTicks, e.Start);
+	}
+
+	size_t eventCount = 0;
+
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	bool first = true;
+	auto Separator = [&]()
+	{
+		if (!first)
+			fprintf(fp, ",\n");
+		first = false;
+	};
+
+	for (const ProfileThreadSnapshot& thread : threads)
+	{
+		Separator();
+		fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", thread.ThreadIndex);
+		Log_WriteJsonString(fp, thread.Name);
+		fprintf(fp, "}}");
+
+		for (const ProfileEvent& e : thread.Events)
+		{
+			const double ts = Profiler_TicksToMicroseconds(e.Start - baseTicks);
+
+			Separator();
+			fprintf(fp, "{\"name\":");
+			Log_WriteJsonString(fp, e.Name);
+
+			if (e.Type == ProfileEventType::ZONE)
+			{
+				const double dur = Profiler_TicksToMicroseconds(e.End - e.Start);
+				fprintf(fp, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", thread.ThreadIndex, ts, dur);
+			}
+			else
+			{
+				fprintf(fp, ",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%g}}", thread.ThreadIndex, ts, e.Value);
+			}
+
+			eventCount++;
+		}
+	}
+
+	fprintf(fp, "\n]}\n");
+
+	const bool ok = ferror(fp) == 0;
+	fclose(fp);
+
+	if (!ENSUREMSG(ok, "Failed to write trace file (%s)", path))
+		return false;
+
+	LOGINFO("Wrote %zu profiler events from %zu threads to %s", eventCount, threads.size(), path);
+
+	return true;
+}
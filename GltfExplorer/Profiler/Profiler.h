@@ -0,0 +1,181 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Scoped CPU zones and counters recorded into per thread ring buffers. Zones cost two timestamp reads and one 32 byte store,
+// nothing is shared between threads while recording. Building with PROFILER_ENABLED=0 compiles every macro out.
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+enum class ProfileEventType : uint8_t
+{
+	ZONE,
+	COUNTER,
+};
+
+struct ProfileEvent
+{
+	// Has to outlive the profiler, zones are expected to use string literals
+	const char* Name;
+	uint64_t Start;
+	union
+	{
+		uint64_t End;
+		double Value;
+	};
+	uint16_t Depth;
+	ProfileEventType Type;
+};
+
+// Owned by one thread at a time. Only the owner writes, readers copy out whatever has not been overwritten yet.
+struct ProfileThreadBuffer
+{
+	static constexpr uint32_t Capacity = 1u << 14;
+
+	ProfileEvent Events[Capacity];
+	std::atomic<uint64_t> WriteCount = 0;
+	uint16_t Depth = 0;
+	uint32_t ThreadIndex = 0;
+	char Name[32] = {};
+
+	void Push(const ProfileEvent& e) noexcept
+	{
+		const uint64_t index = WriteCount.load(std::memory_order_relaxed);
+		Events[index & (Capacity - 1u)] = e;
+		WriteCount.store(index + 1u, std::memory_order_release);
+	}
+};
+
+struct ProfileThreadSnapshot
+{
+	uint32_t ThreadIndex = 0;
+	const char* Name = nullptr;
+	std::vector<ProfileEvent> Events;
+};
+
+struct ProfileZoneTime
+{
+	const char* Name = nullptr;
+	double Microseconds = 0.0;
+};
+
+extern std::atomic<bool> GProfilerEnabled;
+extern thread_local ProfileThreadBuffer* GProfilerThreadBuffer;
+
+ProfileThreadBuffer* Profiler_AcquireThreadBuffer();
+
+// rdtsc where it is available, it is an order of magnitude cheaper than going through the OS clock
+inline uint64_t Profiler_Now() noexcept
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+inline ProfileThreadBuffer* Profiler_GetThreadBuffer() noexcept
+{
+	ProfileThreadBuffer* buffer = GProfilerThreadBuffer;
+	return buffer ? buffer : Profiler_AcquireThreadBuffer();
+}
+
+void Profiler_SetEnabled(bool enabled);
+inline bool Profiler_IsEnabled() noexcept { return GProfilerEnabled.load(std::memory_order_relaxed); }
+
+void Profiler_SetThreadName(const char* name);
+
+// Marks the start of a frame, the last MaxFrames frame starts are kept for the UI
+void Profiler_BeginFrame();
+
+void Profiler_Counter(const char* name, double value);
+
+static constexpr uint32_t ProfilerMaxFrames = 256u;
+
+uint64_t Profiler_GetFrameIndex();
+
+// framesAgo 0 is the frame in progress, 1 the last completed frame. Returns 0 for frames that are no longer kept.
+uint64_t Profiler_GetFrameStart(uint32_t framesAgo);
+
+double Profiler_TicksToMicroseconds(uint64_t ticks);
+
+// Copies every event still held by each thread buffer, optionally only those that ended after `sinceTicks`
+void Profiler_Snapshot(std::vector<ProfileThreadSnapshot>& threads, uint64_t sinceTicks = 0);
+
+// Zone with the most exclusive time among zones that started and ended between the two timestamps. Instances of the same
+// zone are summed across threads. Returns false when no zones were recorded in that interval.
+bool Profiler_FindHottestZone(uint64_t startTicks, uint64_t endTicks, ProfileZoneTime& hottest);
+
+// Writes everything still in the buffers as Chrome trace event JSON, load it in chrome://tracing or ui.perfetto.dev
+bool Profiler_WriteChromeTrace(const char* path);
+
+struct ProfileZone
+{
+	explicit ProfileZone(const char* name) noexcept
+	{
+		if (!Profiler_IsEnabled())
+			return;
+
+		Buffer = Profiler_GetThreadBuffer();
+		Name = name;
+		Depth = Buffer->Depth++;
+		Start = Profiler_Now();
+	}
+
+	~ProfileZone() noexcept
+	{
+		if (!Buffer)
+			return;
+
+		ProfileEvent e;
+		e.Name = Name;
+		e.Start = Start;
+		e.End = Profiler_Now();
+		e.Depth = Depth;
+		e.Type = ProfileEventType::ZONE;
+
+		Buffer->Depth--;
+		Buffer->Push(e);
+	}
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+	ProfileThreadBuffer* Buffer = nullptr;
+	const char* Name = nullptr;
+	uint64_t Start = 0;
+	uint16_t Depth = 0;
+};
+
+#if PROFILER_ENABLED
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(_profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__FUNCTION__)
+#define PROFILE_COUNTER(name, value) Profiler_Counter(name, (double)(value))
+#define PROFILE_FRAME() Profiler_BeginFrame()
+#define PROFILE_THREAD(name) Profiler_SetThreadName(name)
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_COUNTER(name, value) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+
+#endif
@@ -0,0 +1,203 @@
+#include "ProfilerUI.h"
+
+#include "Profiler.h"
+
+#include "imgui.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string_view>
+#include <vector>
+
+static struct
+{
+	bool Paused = false;
+	uint32_t TraceCount = 0;
+
+	std::vector<ProfileThreadSnapshot> Threads;
+	uint64_t FrameStart = 0;
+	uint64_t FrameEnd = 0;
+} GProfilerUI;
+
+struct ProfilerUICounter
+{
+	const char* Name;
+	double Value;
+	uint64_t Time;
+};
+
+static ImU32 ProfilerUI_ZoneColor(const char* name)
+{
+	// Same name, same colour from frame to frame regardless of where the string lives
+	uint32_t hash = 2166136261u;
+	for (const char* c = name; *c; c++)
+	{
+		hash = (hash ^ (uint8_t)*c) * 16777619u;
+	}
+
+	const float hue = (float)(hash & 0xffffu) / 65535.0f;
+	return (ImU32)ImColor::HSV(hue, 0.45f, 0.75f);
+}
+
+static void ProfilerUI_DrawTimeline()
+{
+	const uint64_t frameTicks = GProfilerUI.FrameEnd - GProfilerUI.FrameStart;
+	const double frameUs = Profiler_TicksToMicroseconds(frameTicks);
+
+	ImGui::Text("Frame %.3f ms", frameUs * 1e-3);
+
+	constexpr float RowHeight = 18.0f;
+
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	const float width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+	const float pixelsPerTick = width / (float)std::max<uint64_t>(frameTicks, 1u);
+	const ImVec2 mouse = ImGui::GetMousePos();
+
+	for (const ProfileThreadSnapshot& thread : GProfilerUI.Threads)
+	{
+		uint16_t maxDepth = 0;
+		bool hasZones = false;
+		for (const ProfileEvent& e : thread.Events)
+		{
+			if (e.Type != ProfileEventType::ZONE || e.Start >= GProfilerUI.FrameEnd)
+				continue;
+
+			maxDepth = std::max(maxDepth, e.Depth);
+			hasZones = true;
+		}
+
+		if (!hasZones)
+			continue;
+
+		ImGui::TextUnformatted(thread.Name);
+
+		const ImVec2 origin = ImGui::GetCursorScreenPos();
+		const float height = RowHeight * (maxDepth + 1);
+
+		ImGui::Dummy(ImVec2(width, height));
+
+		drawList->PushClipRect(origin, ImVec2(origin.x + width, origin.y + height), true);
+
+		for (const ProfileEvent& e : thread.Events)
+		{
+			if (e.Type != ProfileEventType::ZONE || e.Start >= GProfilerUI.FrameEnd)
+				continue;
+
+			const uint64_t start = std::max(e.Start, GProfilerUI.FrameStart) - GProfilerUI.FrameStart;
+			const uint64_t end = std::min(e.End, GProfilerUI.FrameEnd) - GProfilerUI.FrameStart;
+
+			const ImVec2 min(origin.x + start * pixelsPerTick, origin.y + e.Depth * RowHeight);
+			const ImVec2 max(std::max(origin.x + end * pixelsPerTick, min.x + 1.0f), min.y + RowHeight - 1.0f);
+
+			drawList->AddRectFilled(min, max, ProfilerUI_ZoneColor(e.Name));
+
+			if (max.x - min.x > ImGui::CalcTextSize(e.Name).x + 4.0f)
+			{
+				drawList->AddText(ImVec2(min.x + 2.0f, min.y + 2.0f), IM_COL32(0, 0, 0, 255), e.Name);
+			}
+
+			if (ImGui::IsItemHovered() && mouse.x >= min.x && mouse.x < max.x && mouse.y >= min.y && mouse.y < max.y)
+			{
+				ImGui::SetTooltip("%s\n%.3f ms", e.Name, Profiler_TicksToMicroseconds(e.End - e.Start) * 1e-3);
+			}
+		}
+
+		drawList->PopClipRect();
+	}
+}
+
+static void ProfilerUI_DrawCounters()
+{
+	std::vector<ProfilerUICounter> counters;
+
+	for (const ProfileThreadSnapshot& thread : GProfilerUI.Threads)
+	{
+		for (const ProfileEvent& e : thread.Events)
+		{
+			if (e.Type != ProfileEventType::COUNTER)
+				continue;
+
+			auto it = std::find_if(counters.begin(), counters.end(), [&](const ProfilerUICounter& c) { return std::string_view(c.Name) == e.Name; });
+			if (it == counters.end())
+			{
+				counters.push_back(ProfilerUICounter{ e.Name, e.Value, e.Start });
+			}
+			else if (e.Start >= it->Time)
+			{
+				it->Value = e.Value;
+				it->Time = e.Start;
+			}
+		}
+	}
+
+	if (counters.empty())
+		return;
+
+	std::sort(counters.begin(), counters.end(), [](const ProfilerUICounter& a, const ProfilerUICounter& b) { return std::string_view(a.Name) < b.Name; });
+
+	if (ImGui::BeginTable("Counters", 2, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders))
+	{
+		ImGui::TableSetupColumn("Counter");
+		ImGui::TableSetupColumn("Value");
+		ImGui::TableHeadersRow();
+
+		for (const ProfilerUICounter& counter : counters)
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(counter.Name);
+			ImGui::TableNextColumn();
+			ImGui::Text("%g", counter.Value);
+		}
+
+		ImGui::EndTable();
+	}
+}
+
+void ProfilerUI_Draw(bool* open)
+{
+	if (ImGui::Begin("Profiler", open))
+	{
+		bool enabled = Profiler_IsEnabled();
+		if (ImGui::Checkbox("Enabled", &enabled))
+		{
+			Profiler_SetEnabled(enabled);
+		}
+
+		ImGui::SameLine();
+		ImGui::Checkbox("Pause", &GProfilerUI.Paused);
+
+		ImGui::SameLine();
+		if (ImGui::Button("Export Chrome Trace"))
+		{
+			char tracePath[64];
+			snprintf(tracePath, sizeof(tracePath), "GltfExplorer_%u.trace.json", GProfilerUI.TraceCount++);
+			Profiler_WriteChromeTrace(tracePath);
+		}
+
+		// The frame in progress is still being recorded, show the one before it
+		const uint64_t frameStart = Profiler_GetFrameStart(1u);
+		const uint64_t frameEnd = Profiler_GetFrameStart(0u);
+
+		if (!GProfilerUI.Paused && frameStart != 0 && frameEnd > frameStart)
+		{
+			GProfilerUI.FrameStart = frameStart;
+			GProfilerUI.FrameEnd = frameEnd;
+			Profiler_Snapshot(GProfilerUI.Threads, frameStart);
+		}
+
+		if (GProfilerUI.FrameEnd > GProfilerUI.FrameStart)
+		{
+			ProfilerUI_DrawTimeline();
+
+			ImGui::Separator();
+
+			ProfilerUI_DrawCounters();
+		}
+		else
+		{
+			ImGui::TextUnformatted("No completed frames recorded");
+		}
+	}
+	ImGui::End();
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+// ImGui window showing the zones of the last completed frame per thread and the latest counter values
+void ProfilerUI_Draw(bool* open);
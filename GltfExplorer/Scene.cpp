@@ -2,33 +2,148 @@
 
 #include "Logging.h"
 #include "GltfLoader.h"
+#include "LoadStats.h"
+#include "Profiler/Profiler.h"
 #include "TextureLoader.h"
+#include "TextureRegistry.h"
 
 #include <Render/RenderDefines.h>
 
-#include <ppl.h>
+#include <ParallelFor.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
 #include <stack>
+#include <unordered_map>
 
-#define PARALLEL_LOAD (RENDER_THREAD_SAFE)
+// Element reads from an accessor, honouring the buffer view stride. Normalised integers come back as 0-1.
+struct SAccessorReader
+{
+    const uint8_t* Data = nullptr;
+    size_t Stride = 0;
+    GltfComponentType ComponentType = GltfComponentType::FLOAT;
+    bool Normalized = false;
+
+    SAccessorReader(const Gltf& gltf, const GltfAccessor& accessor)
+    {
+        const GltfBufferView& bufView = gltf.bufferViews[accessor.bufferView];
+        const size_t elementSize = GltfLoader_SizeOfComponent(accessor.componentType) * GltfLoader_ComponentCount(accessor.type);
+
+        Data = gltf.data.get() + bufView.byteOffset + accessor.byteOffset;
+        Stride = bufView.byteStride > 0 ? (size_t)bufView.byteStride : elementSize;
+        ComponentType = accessor.componentType;
+        Normalized = accessor.normalized;
+    }
+
+    float Read(size_t element, uint32_t component) const
+    {
+        const uint8_t* p = Data + element * Stride;
+
+        switch (ComponentType)
+        {
+        case GltfComponentType::UNSIGNED_BYTE: return Normalized ? p[component] / 255.0f : (float)p[component];
+        case GltfComponentType::UNSIGNED_SHORT: { uint16_t v; memcpy(&v, p + component * 2u, 2u); return Normalized ? v / 65535.0f : (float)v; }
+        case GltfComponentType::UNSIGNED_INT: { uint32_t v; memcpy(&v, p + component * 4u, 4u); return (float)v; }
+        case GltfComponentType::FLOAT: { float v; memcpy(&v, p + component * 4u, 4u); return v; }
+        default: return 0.0f;
+        }
+    }
+
+    uint32_t ReadIndex(size_t element) const
+    {
+        const uint8_t* p = Data + element * Stride;
+
+        switch (ComponentType)
+        {
+        case GltfComponentType::UNSIGNED_BYTE: return p[0];
+        case GltfComponentType::UNSIGNED_SHORT: { uint16_t v; memcpy(&v, p, 2u); return v; }
+        case GltfComponentType::UNSIGNED_INT: { uint32_t v; memcpy(&v, p, 4u); return v; }
+        default: return 0u;
+        }
+    }
+};
+
+// Root of UV area over surface area, summed over every triangle so seams and degenerate triangles average out
+static float ComputeUvDensity(const Gltf& gltf, const GltfMeshPrimitive& prim, int32_t positionAccessor, int32_t uvAccessor)
+{
+    const GltfAccessor& positions = gltf.accessors[positionAccessor];
+    const GltfAccessor& uvs = gltf.accessors[uvAccessor];
+
+    if (positions.componentType != GltfComponentType::FLOAT || uvs.count != positions.count)
+        return 0.0f;
+
+    const SAccessorReader positionReader(gltf, positions);
+    const SAccessorReader uvReader(gltf, uvs);
+
+    // Unindexed primitives read the positions in order, the index reader is never used
+    const bool indexed = prim.indices >= 0;
+    const size_t vertexCount = indexed ? (size_t)gltf.accessors[prim.indices].count : (size_t)positions.count;
+    const SAccessorReader indexReader = indexed ? SAccessorReader(gltf, gltf.accessors[prim.indices]) : positionReader;
+
+    double surfaceArea = 0.0;
+    double uvArea = 0.0;
+
+    for (size_t v = 0; v + 2u < vertexCount; v += 3u)
+    {
+        float3 p[3];
+        float2 uv[3];
+
+        for (uint32_t c = 0; c < 3u; c++)
+        {
+            const uint32_t vertex = indexed ? indexReader.ReadIndex(v + c) : (uint32_t)(v + c);
+            if (vertex >= (uint32_t)positions.count)
+                return 0.0f;
+
+            p[c] = float3{ positionReader.Read(vertex, 0u), positionReader.Read(vertex, 1u), positionReader.Read(vertex, 2u) };
+            uv[c] = float2{ uvReader.Read(vertex, 0u), uvReader.Read(vertex, 1u) };
+        }
+
+        surfaceArea += LengthF3(CrossF3(p[1] - p[0], p[2] - p[0]));
+
+        const float2 e0 = uv[1] - uv[0];
+        const float2 e1 = uv[2] - uv[0];
+        uvArea += fabsf(e0.x * e1.y - e0.y * e1.x);
+    }
+
+    return surfaceArea > 0.0 ? (float)sqrt(uvArea / surfaceArea) : 0.0f;
+}
 
 struct SGltfProcessor
 {
     Gltf& GltfModel;
+    LoadStats* Stats;
+    const SceneLoadParams& Params;
     SScene LoadedScene;
 
-    SGltfProcessor(Gltf& _model) : GltfModel(_model) {}
+    // Appended after the glTF materials when a primitive has none
+    SceneMaterial_t DefaultMaterial = SceneMaterial_t::INVALID;
+
+    SGltfProcessor(Gltf& _model, LoadStats* _stats, const SceneLoadParams& _params) : GltfModel(_model), Stats(_stats), Params(_params) {}
 
     SScene Process()
     {
         LoadedScene = {};
 
+        // Index 0 is the INVALID handle, gltf materials and meshes start at 1
         LoadedScene.Materials.resize(1);
         LoadedScene.Models.resize(1);
 
         ProcessImages();
+
+        if (Params.Cancel && Params.Cancel->IsCancelled())
+        {
+            LOGINFO("Scene: Load cancelled");
+            return {};
+        }
+
         ProcessMaterials();
         ProcessMeshes();                   
 
+        PROFILE_ZONE("Load Nodes");
+
+        LoadPhaseScope phase(Stats, LoadPhase::NODE_FLATTEN);
+
         for (const GltfScene& scene : GltfModel.scenes)
         {
             std::stack<matrix> transformStack;
@@ -40,7 +155,9 @@ struct SGltfProcessor
             }
         }
 
-        return LoadedScene;
+        phase.AddBytes(LoadedScene.Nodes.size() * sizeof(SNode));
+
+        return std::move(LoadedScene);
     }
 
 private:
@@ -49,7 +166,22 @@ private:
     tpr::ShaderResourceViewPtr& GetSrvForTexInfo(const std::optional<T>& texInfo)
     {
         static tpr::ShaderResourceViewPtr nullSrv = {};
-        return texInfo.has_value() && (LoadedScene.Textures.size() > texInfo->index) ? LoadedScene.Textures[GltfModel.textures[texInfo->index].source].Srv : nullSrv;
+        const int32_t image = texInfo.has_value() ? GetGltfTextureImage(GltfModel, texInfo->index) : -1;
+        return image >= 0 && (size_t)image < LoadedScene.Textures.size() ? LoadedScene.Textures[image].Srv : nullSrv;
+    }
+
+    template<typename T>
+    uint32_t GetImageForTexInfo(const std::optional<T>& texInfo)
+    {
+        const int32_t image = texInfo.has_value() ? GetGltfTextureImage(GltfModel, texInfo->index) : -1;
+        return image >= 0 && (size_t)image < LoadedScene.Textures.size() ? (uint32_t)image : ~0u;
+    }
+
+    template<typename T>
+    float4 GetUvTransformForTexInfo(const std::optional<T>& texInfo)
+    {
+        const uint32_t image = GetImageForTexInfo(texInfo);
+        return image != ~0u ? LoadedScene.Textures[image].UvTransform : float4(1.0f, 1.0f, 0.0f, 0.0f);
     }
 
     template<typename T>
@@ -60,36 +192,333 @@ private:
 
     void ProcessImages()
     {
-        LoadedScene.Textures.resize(GltfModel.images.size());
+        PROFILE_ZONE("Load Images");
+
+        LoadPhaseScope phase(Stats, LoadPhase::IMAGE_DECODE);
+
+        const uint32_t imageCount = (uint32_t)GltfModel.images.size();
+
+        LoadedScene.Textures.resize(imageCount);
 
         // Gltf loads images as texture + sampler combos, im assuming trilinear always to simplify it
+        std::vector<TextureLoadParams> loadParams;
+        GetTextureLoadParamsForGltf(GltfModel, loadParams);
+
+        // Streamed images keep their levels on the CPU, only the streamer knows which of them to upload. Each scene
+        // decides residency on its own so they are not shared through the registry.
+        std::vector<uint8_t> streamed(imageCount, 0u);
+
+        if (Params.StreamTextures)
+        {
+            LoadedScene.Streaming = std::make_unique<SceneTextureStreaming>();
+            LoadedScene.Streaming->Streamer.SetParams(Params.Streaming);
+            LoadedScene.Streaming->StreamedTextures.assign(imageCount, ~0u);
+
+            for (uint32_t i = 0; i < imageCount; i++)
+            {
+                streamed[i] = loadParams[i].GenerateMips;
+            }
+        }
+
+        std::vector<TextureHash128> hashes(imageCount);
+
+        Concurrency::parallel_for(0u, imageCount, [&](uint32_t i)
+        {
+            if (!loadParams[i].Skip && !streamed[i])
+            {
+                const GltfBufferView& gltfBufView = GltfModel.bufferViews[GltfModel.images[i].bufferView];
+                hashes[i] = TextureRegistry_Hash(GltfModel.data.get() + gltfBufView.byteOffset, gltfBufView.byteLength);
+            }
+        });
+
+        const std::vector<int32_t> priorities = GetImagePriorities();
+
+        // Images already resident, here or from another loaded file, skip decoding and repeats within the file decode once
+        std::vector<uint32_t> repeatOf(imageCount, ~0u);
+        std::unordered_map<uint64_t, uint32_t> firstImages;
+
+        ImageDecodeService decoder(Params.Decode);
+
+        for (uint32_t i = 0; i < imageCount; i++)
+        {
+            if (loadParams[i].Skip)
+                continue;
+
+            const GltfBufferView& gltfBufView = GltfModel.bufferViews[GltfModel.images[i].bufferView];
+            const uint8_t* pImageData = GltfModel.data.get() + gltfBufView.byteOffset;
+
+            phase.AddBytes(gltfBufView.byteLength);
+
+            if (!streamed[i])
+            {
+                const uint64_t settings = GetTextureLoadSettingsKey(loadParams[i]);
+                const auto first = firstImages.try_emplace(hashes[i].Low ^ (settings * 0x9E3779B97F4A7C15ull), i);
+
+                const uint32_t firstImage = first.first->second;
+                if (!first.second && hashes[firstImage].High == hashes[i].High && GetTextureLoadSettingsKey(loadParams[firstImage]) == settings)
+                {
+                    repeatOf[i] = firstImage;
+                    continue;
+                }
 
-#if PARALLEL_LOAD
-        Concurrency::parallel_for((size_t)0u, GltfModel.images.size(), [&](size_t i)
-#else
-        for (uint32_t i = 0; i < GltfModel.images.size(); i++)
-#endif
+                STexture& texture = LoadedScene.Textures[i];
+                texture.Shared = TextureRegistry_Find(hashes[i], gltfBufView.byteLength, loadParams[i]);
+                if (texture.Shared)
+                {
+                    texture.Texture = texture.Shared->Texture;
+                    texture.Srv = texture.Shared->Srv;
+                    continue;
+                }
+            }
+
+            ImageDecodeRequest request;
+            request.pData = pImageData;
+            request.Size = gltfBufView.byteLength;
+            request.Params = loadParams[i];
+            request.Priority = priorities[i];
+            request.Id = i;
+            request.Cancel = Params.Cancel;
+
+            decoder.Submit(request);
+        }
+
+        // Small images wait for the atlas, the rest upload in the order decodes finish. Each result's memory goes back to
+        // the budget once it is on the device.
+        std::vector<uint32_t> packImages;
+        std::vector<TextureMipChain> packChains;
+
+        ImageDecodeResult result;
+        while (decoder.WaitForResult(result))
         {
-            const GltfImage& gltfImage = GltfModel.images[i];
-            
-            const GltfBufferView& gltfBufView = GltfModel.bufferViews[gltfImage.bufferView];
+            if (result.Decoded && TextureAtlas_CanPack(result.Mips, Params.Atlas))
+            {
+                packImages.push_back(result.Id);
+                packChains.push_back(std::move(result.Mips));
+            }
+            else if (result.Decoded)
+            {
+                UploadImage(result.Id, std::move(result.Mips), streamed[result.Id], hashes[result.Id], loadParams[result.Id]);
+            }
 
-            LoadedScene.Textures[i].Texture = LoadTextureFromBinary(GltfModel.data.get() + gltfBufView.byteOffset, gltfBufView.byteLength);
-            LoadedScene.Textures[i].Srv = tpr::CreateTextureSRV(LoadedScene.Textures[i].Texture, tpr::RenderFormat::R8G8B8A8_UNORM, tpr::TextureDimension::TEX2D, 1u, 1u);
+            decoder.Release(result);
         }
-#if PARALLEL_LOAD
-            );
-#endif
+
+        if (!packImages.empty())
+        {
+            PackImages(packImages, packChains, streamed, hashes, loadParams);
+        }
+
+        // Found through the registry now the first of them is in it, which also counts them as shared. Atlased images
+        // are not registered, repeats of those take the same placement.
+        for (uint32_t i = 0; i < imageCount; i++)
+        {
+            if (repeatOf[i] == ~0u)
+                continue;
+
+            const STexture& first = LoadedScene.Textures[repeatOf[i]];
+            STexture& texture = LoadedScene.Textures[i];
+
+            if (first.Shared)
+            {
+                const GltfBufferView& gltfBufView = GltfModel.bufferViews[GltfModel.images[i].bufferView];
+
+                texture.Shared = TextureRegistry_Find(hashes[i], gltfBufView.byteLength, loadParams[i]);
+                if (texture.Shared)
+                {
+                    texture.Texture = texture.Shared->Texture;
+                    texture.Srv = texture.Shared->Srv;
+                }
+            }
+            else
+            {
+                texture.Texture = first.Texture;
+                texture.Srv = first.Srv;
+                texture.UvTransform = first.UvTransform;
+            }
+        }
+
+        const ImageDecodeStats decodeStats = decoder.GetStats();
+        if (decodeStats.Decoded + decodeStats.Failed > 0u)
+        {
+            LOGINFO("Scene: Decoded %u images (%u failed) on %u workers, %.1f MB peak in flight, slowest image %u took %.1f ms",
+                decodeStats.Decoded, decodeStats.Failed, decodeStats.WorkerCount, (double)decodeStats.PeakInFlightBytes / (1024.0 * 1024.0),
+                decodeStats.SlowestDecodeId, decodeStats.SlowestDecodeMilliseconds);
+        }
+    }
+
+    void UploadImage(uint32_t image, TextureMipChain&& chain, bool streamed, const TextureHash128& hash, const TextureLoadParams& loadParams)
+    {
+        if (streamed)
+        {
+            AddStreamedTexture(image, std::move(chain));
+            return;
+        }
+
+        const GltfBufferView& gltfBufView = GltfModel.bufferViews[GltfModel.images[image].bufferView];
+
+        TextureLoadInfo loadInfo;
+        tpr::TexturePtr loaded = CreateTextureFromMips(chain, &loadInfo);
+
+        STexture& texture = LoadedScene.Textures[image];
+        texture.Shared = TextureRegistry_Insert(hash, gltfBufView.byteLength, loadParams, std::move(loaded), loadInfo);
+        if (texture.Shared)
+        {
+            texture.Texture = texture.Shared->Texture;
+            texture.Srv = texture.Shared->Srv;
+        }
+    }
+
+    // Atlas pages belong to the scene, they are neither streamed, their levels are all tail, nor shared through the
+    // registry
+    void PackImages(const std::vector<uint32_t>& images, std::vector<TextureMipChain>& chains, const std::vector<uint8_t>& streamed,
+        const std::vector<TextureHash128>& hashes, const std::vector<TextureLoadParams>& loadParams)
+    {
+        std::vector<const TextureMipChain*> textures(chains.size());
+        for (size_t i = 0; i < chains.size(); i++)
+        {
+            textures[i] = &chains[i];
+        }
+
+        std::vector<TextureMipChain> pages;
+        std::vector<TextureAtlasPlacement> placements;
+        TextureAtlas_Build(textures, Params.Atlas, pages, placements);
+
+        std::vector<tpr::TexturePtr> pageTextures(pages.size());
+        std::vector<tpr::ShaderResourceViewPtr> pageSrvs(pages.size());
+
+        for (size_t p = 0; p < pages.size(); p++)
+        {
+            TextureLoadInfo loadInfo;
+            pageTextures[p] = CreateTextureFromMips(pages[p], &loadInfo);
+            pageSrvs[p] = tpr::CreateTextureSRV(pageTextures[p], loadInfo.Format, loadInfo.Dimension, loadInfo.MipCount, loadInfo.ArraySize);
+        }
+
+        uint32_t packed = 0u;
+
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            const uint32_t image = images[i];
+            const TextureAtlasPlacement& placement = placements[i];
+
+            if (placement.Page == ~0u)
+            {
+                UploadImage(image, std::move(chains[i]), streamed[image], hashes[image], loadParams[image]);
+                continue;
+            }
+
+            STexture& texture = LoadedScene.Textures[image];
+            texture.Texture = pageTextures[placement.Page];
+            texture.Srv = pageSrvs[placement.Page];
+            texture.UvTransform = placement.UvTransform;
+
+            packed++;
+        }
+
+        if (packed > 0u)
+        {
+            LOGINFO("Scene: Packed %u small images into %zu atlas pages", packed, pages.size());
+        }
+    }
+
+    // How many mesh instances sample each image through their materials, the images most of the scene shows decode first
+    std::vector<int32_t> GetImagePriorities()
+    {
+        std::vector<int32_t> priorities(GltfModel.images.size(), 0);
+
+        std::vector<int32_t> materialUses(GltfModel.materials.size(), 0);
+        for (const GltfNode& node : GltfModel.nodes)
+        {
+            if (node.mesh < 0)
+                continue;
+
+            for (const GltfMeshPrimitive& primitive : GltfModel.meshes[node.mesh].primitives)
+            {
+                if (primitive.material >= 0 && (size_t)primitive.material < materialUses.size())
+                {
+                    materialUses[primitive.material]++;
+                }
+            }
+        }
+
+        for (size_t m = 0; m < GltfModel.materials.size(); m++)
+        {
+            const GltfMaterial& material = GltfModel.materials[m];
+
+            const uint32_t images[] = {
+                GetImageForTexInfo(material.pbr.baseColorTexture),
+                GetImageForTexInfo(material.normalTexture),
+                GetImageForTexInfo(material.pbr.metallicRoughnessTexture),
+                GetImageForTexInfo(material.emissiveTexture),
+            };
+
+            for (const uint32_t image : images)
+            {
+                if (image != ~0u)
+                {
+                    priorities[image] += materialUses[m];
+                }
+            }
+        }
+
+        return priorities;
+    }
+
+    void AddStreamedTexture(uint32_t image, TextureMipChain&& chain)
+    {
+        SceneTextureStreaming& streaming = *LoadedScene.Streaming;
+
+        const uint32_t streamedTexture = streaming.Streamer.AddTexture(chain.Width, chain.Height, chain.MipCount, chain.Format);
+        const uint32_t firstMip = streaming.Streamer.GetResidentMip(streamedTexture);
+
+        STexture& texture = LoadedScene.Textures[image];
+
+        TextureLoadInfo loadInfo;
+        texture.Texture = CreateTextureFromMips(chain, &loadInfo, firstMip);
+        texture.Srv = tpr::CreateTextureSRV(texture.Texture, loadInfo.Format, loadInfo.Dimension, loadInfo.MipCount, loadInfo.ArraySize);
+
+        streaming.StreamedTextures[image] = streamedTexture;
+        streaming.Images.push_back(image);
+        streaming.Resolutions.push_back(sqrtf((float)chain.Width * (float)chain.Height));
+
+        // Textures small enough to be all tail never change, their levels are not needed again
+        streaming.Sources.emplace_back(streaming.Streamer.GetTailMip(streamedTexture) > 0u ? std::move(chain) : TextureMipChain{});
     }
 
     void ProcessMaterials()
     {
-        LoadedScene.Materials.resize(GltfModel.materials.size());
+        PROFILE_ZONE("Load Materials");
+
+        LoadPhaseScope phase(Stats, LoadPhase::MATERIAL_BUILD);
+        phase.AddBytes(GltfModel.materials.size() * sizeof(SMaterialConstants));
+
+        const uint32_t gltfMaterialCount = (uint32_t)GltfModel.materials.size();
 
-        for (uint32_t i = 0; i < GltfModel.materials.size(); i++)
+        // Primitives without a material use the glTF default, opaque and untextured with every factor at 1
+        const bool needsDefault = std::any_of(GltfModel.meshes.begin(), GltfModel.meshes.end(), [](const GltfMesh& mesh)
         {
-            const GltfMaterial& gltfMaterial = GltfModel.materials[i];
-            SMaterial& material = LoadedScene.Materials[i];
+            return std::any_of(mesh.primitives.begin(), mesh.primitives.end(), [](const GltfMeshPrimitive& prim) { return prim.material < 0; });
+        });
+
+        GltfMaterial defaultMaterial = {};
+        defaultMaterial.pbr.baseColorFactor = GltfVec4(1.0, 1.0, 1.0, 1.0);
+        defaultMaterial.pbr.metallicFactor = 1.0f;
+        defaultMaterial.pbr.roughnessFactor = 1.0f;
+        defaultMaterial.alphaMode = GltfAlphaMode::OPAQUE;
+        defaultMaterial.alphaCutoff = 0.5f;
+        defaultMaterial.emissiveFactor = GltfVec3(0.0, 0.0, 0.0);
+
+        const uint32_t materialCount = gltfMaterialCount + (needsDefault ? 1u : 0u);
+        LoadedScene.Materials.resize(materialCount + 1u);
+
+        if (needsDefault)
+        {
+            DefaultMaterial = (SceneMaterial_t)materialCount;
+        }
+
+        for (uint32_t i = 0; i < materialCount; i++)
+        {
+            const GltfMaterial& gltfMaterial = i < gltfMaterialCount ? GltfModel.materials[i] : defaultMaterial;
+            SMaterial& material = LoadedScene.Materials[i + 1u];
 
             switch (gltfMaterial.alphaMode)
             {
@@ -105,16 +534,23 @@ private:
             material.Srvs[(uint32_t)EMaterialTextures::MT_METALLIC_ROUGHNESS] = GetSrvForTexInfo(gltfMaterial.pbr.metallicRoughnessTexture);
             material.Srvs[(uint32_t)EMaterialTextures::MT_EMISSIVE] = GetSrvForTexInfo(gltfMaterial.emissiveTexture);
 
+            material.TextureImages[(uint32_t)EMaterialTextures::MT_BASE_COLOR] = GetImageForTexInfo(gltfMaterial.pbr.baseColorTexture);
+            material.TextureImages[(uint32_t)EMaterialTextures::MT_NORMAL] = GetImageForTexInfo(gltfMaterial.normalTexture);
+            material.TextureImages[(uint32_t)EMaterialTextures::MT_METALLIC_ROUGHNESS] = GetImageForTexInfo(gltfMaterial.pbr.metallicRoughnessTexture);
+            material.TextureImages[(uint32_t)EMaterialTextures::MT_EMISSIVE] = GetImageForTexInfo(gltfMaterial.emissiveTexture);
+
             material.Constants.BaseColorFactor = float4((float)gltfMaterial.pbr.baseColorFactor.x, (float)gltfMaterial.pbr.baseColorFactor.y, (float)gltfMaterial.pbr.baseColorFactor.z, (float)gltfMaterial.pbr.baseColorFactor.w);
             material.Constants.EmissiveFactor = float3((float)gltfMaterial.emissiveFactor.x, (float)gltfMaterial.emissiveFactor.y, (float)gltfMaterial.emissiveFactor.z);
             material.Constants.MaskAlphaCutoff = gltfMaterial.alphaCutoff;
             material.Constants.MetallicFactor = gltfMaterial.pbr.metallicFactor;
             material.Constants.RoughnessFactor = gltfMaterial.pbr.roughnessFactor;
 
-            material.Constants.BaseColorTextureIndex = tpr::GetDescriptorIndex(material.Srvs[(uint32_t)EMaterialTextures::MT_BASE_COLOR]);
-            material.Constants.NormalTextureIndex = tpr::GetDescriptorIndex(material.Srvs[(uint32_t)EMaterialTextures::MT_NORMAL]);
-            material.Constants.MetallicRoughnessTextureIndex = tpr::GetDescriptorIndex(material.Srvs[(uint32_t)EMaterialTextures::MT_METALLIC_ROUGHNESS]);
-            material.Constants.EmissiveTextureIndex = tpr::GetDescriptorIndex(material.Srvs[(uint32_t)EMaterialTextures::MT_EMISSIVE]);
+            SetMaterialTextureIndices(material);
+
+            material.Constants.BaseColorUVTransform = GetUvTransformForTexInfo(gltfMaterial.pbr.baseColorTexture);
+            material.Constants.NormalUVTransform = GetUvTransformForTexInfo(gltfMaterial.normalTexture);
+            material.Constants.MetallicRoughnessUVTransform = GetUvTransformForTexInfo(gltfMaterial.pbr.metallicRoughnessTexture);
+            material.Constants.EmissiveUVTransform = GetUvTransformForTexInfo(gltfMaterial.emissiveTexture);
 
             material.Constants.BaseColorUVIndex = GetUVIndexForTexInfo(gltfMaterial.pbr.baseColorTexture);
             material.Constants.NormalUVIndex = GetUVIndexForTexInfo(gltfMaterial.normalTexture);
@@ -127,13 +563,17 @@ private:
 
     void ProcessMeshes()
     {
-        LoadedScene.Models.resize(GltfModel.meshes.size());
+        PROFILE_ZONE("Load Meshes");
+
+        LoadPhaseScope phase(Stats, LoadPhase::MESH_BUILD);
+
+        LoadedScene.Models.resize(GltfModel.meshes.size() + 1u);
 
         for (uint32_t modelIt = 0; modelIt < GltfModel.meshes.size(); modelIt++)
         {
             const GltfMesh& gltfMesh = GltfModel.meshes[modelIt];
 
-            SModel& model = LoadedScene.Models[modelIt];
+            SModel& model = LoadedScene.Models[modelIt + 1u];
 
             model.Meshes.resize(gltfMesh.primitives.size());
 
@@ -143,7 +583,11 @@ private:
 
                 SMesh& mesh = model.Meshes[meshIt];
 
-                mesh.Material = (SceneMaterial_t)gltfPrim.material;
+                // Only support triangles for simplicity, anything else keeps an invalid material and is never drawn
+                if (gltfPrim.mode != GltfMeshMode::TRIANGLES)
+                    continue;
+
+                mesh.Material = gltfPrim.material >= 0 ? (SceneMaterial_t)(gltfPrim.material + 1) : DefaultMaterial;
 
                 // Load index buffer
                 {
@@ -151,11 +595,11 @@ private:
                     const GltfBufferView& gltfBufView = GltfModel.bufferViews[gltfAccessor.bufferView];
 
                     const size_t offset = gltfAccessor.byteOffset + gltfBufView.byteOffset;
+                    const size_t size = gltfAccessor.count * GltfLoader_SizeOfComponent(gltfAccessor.componentType) * GltfLoader_ComponentCount(gltfAccessor.type);
+
+                    mesh.IndexBuffer = tpr::CreateIndexBuffer(GltfModel.data.get() + offset, size);
 
-                    mesh.IndexBuffer = tpr::CreateIndexBuffer(
-                        GltfModel.data.get() + offset,
-                        gltfAccessor.count * GltfLoader_SizeOfComponent(gltfAccessor.componentType) * GltfLoader_ComponentCount(gltfAccessor.type)
-                    );
+                    phase.AddBytes(size);
 
                     mesh.IndexCount = gltfAccessor.count;
                     mesh.IndexOffset = 0;
@@ -164,6 +608,9 @@ private:
 
                 // Load vertex buffers
                 {
+                    int32_t positionAccessor = -1;
+                    int32_t uvAccessors[2] = { -1, -1 };
+
                     for (const GltfMeshAttribute& gltfAttr : gltfPrim.attributes)
                     {
                         EMeshVertexBuffers targetBuffer = EMeshVertexBuffers::VB_COUNT;
@@ -178,9 +625,20 @@ private:
                             continue;
                         }
 
+                        if (targetBuffer == EMeshVertexBuffers::VB_POSITION) positionAccessor = (int32_t)gltfAttr.index;
+                        else if (targetBuffer == EMeshVertexBuffers::VB_TEXCOORD0) uvAccessors[0] = (int32_t)gltfAttr.index;
+                        else if (targetBuffer == EMeshVertexBuffers::VB_TEXCOORD1) uvAccessors[1] = (int32_t)gltfAttr.index;
+
                         const GltfAccessor& gltfAccessor = GltfModel.accessors[gltfAttr.index];
                         const GltfBufferView& gltfBufView = GltfModel.bufferViews[gltfAccessor.bufferView];
 
+                        // Gltf requires min and max on POSITION accessors
+                        if (targetBuffer == EMeshVertexBuffers::VB_POSITION)
+                        {
+                            model.Bounds.Grow(float3{ (float)gltfAccessor.min[0], (float)gltfAccessor.min[1], (float)gltfAccessor.min[2] });
+                            model.Bounds.Grow(float3{ (float)gltfAccessor.max[0], (float)gltfAccessor.max[1], (float)gltfAccessor.max[2] });
+                        }
+
                         const size_t stride = GltfLoader_SizeOfComponent(gltfAccessor.componentType) * GltfLoader_ComponentCount(gltfAccessor.type);
 
                         mesh.VertexBuffers[(uint32_t)targetBuffer] = tpr::CreateVertexBuffer(
@@ -188,10 +646,20 @@ private:
                             gltfAccessor.count * stride
                         );
 
+                        phase.AddBytes(gltfAccessor.count * stride);
+
                         mesh.VertexBuffersRaw[(uint32_t)targetBuffer] = mesh.VertexBuffers[(uint32_t)targetBuffer].Get();
-                        mesh.BufferStrides[(uint32_t)targetBuffer] = static_cast<UINT>(stride);
+                        mesh.BufferStrides[(uint32_t)targetBuffer] = static_cast<uint32_t>(stride);
                         mesh.BufferOffsets[(uint32_t)targetBuffer] = 0;
                     }
+
+                    for (uint32_t set = 0; set < 2u; set++)
+                    {
+                        if (positionAccessor >= 0 && uvAccessors[set] >= 0)
+                        {
+                            mesh.UvDensity[set] = ComputeUvDensity(GltfModel, gltfPrim, positionAccessor, uvAccessors[set]);
+                        }
+                    }
                 }
             }
         }
@@ -215,22 +683,21 @@ private:
 
         matrixStack.push(matrixStack.top() * transform);
 
+        // One node per mesh, the model already draws every primitive
         if (gltfNode.mesh >= 0)
         {
-            const GltfMesh& gltfMesh = GltfModel.meshes[gltfNode.mesh];
+            LoadedScene.Nodes.push_back({});
+            SNode& node = LoadedScene.Nodes.back();
 
-            for (const GltfMeshPrimitive& gltfPrim : gltfMesh.primitives)
-            {
-                // Only support triangles for simplicity
-                if (gltfPrim.mode != GltfMeshMode::TRIANGLES)
-                    continue;
+            node.Transform = matrixStack.top();
+            node.TransformId = LoadedScene.Transforms.Allocate(node.Transform);
 
-                LoadedScene.Nodes.push_back({});
-                SNode& node = LoadedScene.Nodes.back();
+            node.Model = (SceneModel_t)(gltfNode.mesh + 1);
 
-                node.Transform = matrixStack.top();
-
-                node.Model = (SceneModel_t)gltfNode.mesh;
+            node.WorldBounds = LoadedScene.Models[(uint32_t)node.Model].Bounds;
+            if (!node.WorldBounds.Invalid())
+            {
+                node.WorldBounds.Transform(node.Transform);
             }
         }
 
@@ -244,17 +711,27 @@ private:
 
 };
 
-SScene LoadSceneFromGlb(const char* glbPath)
+SScene LoadSceneFromGlb(const char* glbPath, LoadStats* stats, const SceneLoadParams& params)
 {
+    PROFILE_ZONE("Load Scene");
+
     Gltf gltfModel;
-    if (!GltfLoader_Load(glbPath, &gltfModel))
+    if (!GltfLoader_Load(glbPath, &gltfModel, stats))
         return {};
 
-    SGltfProcessor processor(gltfModel);
+    SGltfProcessor processor(gltfModel, stats, params);
 
     return processor.Process();
 }
 
+void SetMaterialTextureIndices(SMaterial& material)
+{
+    material.Constants.BaseColorTextureIndex = tpr::GetDescriptorIndex(material.Srvs[(uint32_t)EMaterialTextures::MT_BASE_COLOR]);
+    material.Constants.NormalTextureIndex = tpr::GetDescriptorIndex(material.Srvs[(uint32_t)EMaterialTextures::MT_NORMAL]);
+    material.Constants.MetallicRoughnessTextureIndex = tpr::GetDescriptorIndex(material.Srvs[(uint32_t)EMaterialTextures::MT_METALLIC_ROUGHNESS]);
+    material.Constants.EmissiveTextureIndex = tpr::GetDescriptorIndex(material.Srvs[(uint32_t)EMaterialTextures::MT_EMISSIVE]);
+}
+
 tpr::GraphicsPipelineState_t GetPSOForMaterial(const SMaterial& material, const tpr::GraphicsPipelineTargetDesc& targetDesc)
 {
     static tpr::GraphicsPipelineStatePtr Permutations[(uint32_t)EMaterialDomain::MD_COUNT][2] = {};
@@ -297,7 +774,7 @@ tpr::GraphicsPipelineState_t GetPSOForMaterial(const SMaterial& material, const
         { "TEXCOORD",   1, tpr::RenderFormat::R32G32_FLOAT,         4, 0,   tpr::InputClassification::PER_VERTEX,   0 },
     };
 
-    perm = tpr::CreateGraphicsPipelineState(psoDesc, meshLayout, ARRAYSIZE(meshLayout));
+    perm = tpr::CreateGraphicsPipelineState(psoDesc, meshLayout, std::size(meshLayout));
 
     if (!perm)
     {
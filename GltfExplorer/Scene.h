@@ -1,11 +1,17 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 #include <Render/Render.h>
 #include <SurfMath.h>
 
+#include "SceneGraph/SceneTransformBuffer.h"
+#include "SceneStreaming.h"
+#include "Textures/ImageDecodeService.h"
+#include "Textures/TextureAtlas.h"
+
 enum class EMeshVertexBuffers : uint32_t
 {
     VB_POSITION,
@@ -42,11 +48,18 @@ struct SMesh
     uint32_t IndexOffset = 0u;
 
     SceneMaterial_t Material = SceneMaterial_t::INVALID;
+
+    // UV units per model space unit for TEXCOORD_0 and TEXCOORD_1, the root of UV area over surface area across every
+    // triangle. Zero when the set is missing. Texture streaming turns it into the mip a view needs.
+    float UvDensity[2] = {};
 };
 
 struct SModel
 {
     std::vector<SMesh> Meshes;
+
+    // Model space, from the POSITION accessor bounds of every mesh
+    AABB Bounds = {};
 };
 
 struct SMaterialConstants
@@ -69,6 +82,12 @@ struct SMaterialConstants
     float MetallicFactor;
     float RoughnessFactor;
     float __pad[2];
+
+    // Textures packed into an atlas sample Offset + frac(uv) * Scale, xy is the scale and zw the offset
+    float4 BaseColorUVTransform = float4(1.0f, 1.0f, 0.0f, 0.0f);
+    float4 NormalUVTransform = float4(1.0f, 1.0f, 0.0f, 0.0f);
+    float4 MetallicRoughnessUVTransform = float4(1.0f, 1.0f, 0.0f, 0.0f);
+    float4 EmissiveUVTransform = float4(1.0f, 1.0f, 0.0f, 0.0f);
 };
 
 enum class EMaterialTextures : uint32_t
@@ -89,20 +108,33 @@ struct SMaterial
 
     tpr::ShaderResourceView_t Srvs[kMaterialTextureCount] = {};
 
+    // Scene image behind each SRV, ~0u for unused slots
+    uint32_t TextureImages[kMaterialTextureCount] = { ~0u, ~0u, ~0u, ~0u };
+
     SMaterialConstants Constants = {};
     tpr::ConstantBufferPtr ConstantBuffer = tpr::ConstantBuffer_t::INVALID;
 };
 
+struct SharedTexture;
+
 struct STexture
 {
     tpr::TexturePtr Texture = tpr::Texture_t::INVALID;
     tpr::ShaderResourceViewPtr Srv = tpr::ShaderResourceView_t::INVALID;
+
+    // Keeps the texture registered while the scene uses it, so later loads of the same image share it
+    std::shared_ptr<const SharedTexture> Shared;
+
+    // Where the image sits in Texture when it was packed into an atlas page, identity otherwise
+    float4 UvTransform = float4(1.0f, 1.0f, 0.0f, 0.0f);
 };
 
 struct SNode
 {
     matrix Transform = {};
+    AABB WorldBounds = {};
     SceneModel_t Model = SceneModel_t::INVALID;
+    uint32_t TransformId = 0;
 };
 
 struct SScene
@@ -111,8 +143,35 @@ struct SScene
     std::vector<SModel> Models;
     std::vector<SMaterial> Materials;
     std::vector<STexture> Textures;
+
+    SceneTransformBuffer Transforms;
+
+    // Only set when the scene was loaded with StreamTextures
+    std::unique_ptr<SceneTextureStreaming> Streaming;
 };
 
-SScene LoadSceneFromGlb(const char* glbPath);
+struct SceneLoadParams
+{
+    // Images with mips start with only their tail resident, SceneStreaming_Update brings in what views need
+    bool StreamTextures = false;
+    TextureStreamingParams Streaming;
+
+    // Images decode on the service's workers and upload on the loading thread as they finish
+    ImageDecodeParams Decode;
+
+    // Small images share atlas pages, fewer textures and descriptors for scenes full of solid colours and decals
+    TextureAtlasParams Atlas;
+
+    // Cancelling stops the load after the images already decoding, LoadSceneFromGlb then returns an empty scene
+    ImageDecodeCancelToken Cancel;
+};
+
+struct LoadStats;
+
+// stats is optional, see LoadStats.h for the phases it breaks the load into
+SScene LoadSceneFromGlb(const char* glbPath, LoadStats* stats = nullptr, const SceneLoadParams& params = {});
+
+// Points the material's constants at its SRVs, bindless shaders read textures through these
+void SetMaterialTextureIndices(SMaterial& material);
 
 tpr::GraphicsPipelineState_t GetPSOForMaterial(const SMaterial& material, const tpr::GraphicsPipelineTargetDesc& targetDesc);
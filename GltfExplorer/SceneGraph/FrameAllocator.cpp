@@ -0,0 +1,125 @@
+#include "FrameAllocator.h"
+
+#include "../Logging.h"
+
+#include <cassert>
+
+static constexpr size_t BlockAlignment = 64u;
+
+static inline size_t AlignUpSize(size_t value, size_t alignment)
+{
+	return (value + alignment - 1u) & ~(alignment - 1u);
+}
+
+FrameArena::FrameArena(size_t blockSize)
+	: BlockSize(blockSize)
+{
+	AddBlock(BlockSize);
+
+	// The first block is part of setup rather than any frame
+	Stats.BlockAllocations = 0;
+}
+
+FrameArena::~FrameArena()
+{
+	FreeBlocks();
+}
+
+void FrameArena::AddBlock(size_t minSize)
+{
+	Block block;
+	block.Size = AlignUpSize(minSize > BlockSize ? minSize : BlockSize, BlockAlignment);
+	block.Memory = static_cast<uint8_t*>(::operator new(block.Size, std::align_val_t(BlockAlignment)));
+
+	Blocks.push_back(block);
+
+	Stats.BytesReserved += block.Size;
+	Stats.BlockAllocations++;
+}
+
+void FrameArena::FreeBlocks()
+{
+	for (const Block& block : Blocks)
+	{
+		::operator delete(block.Memory, std::align_val_t(BlockAlignment));
+	}
+
+	Blocks.clear();
+	Stats.BytesReserved = 0;
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	assert(alignment != 0 && (alignment & (alignment - 1u)) == 0);
+	assert(alignment <= BlockAlignment);
+
+	size_t offset = AlignUpSize(Offset, alignment);
+
+	if (offset + size > Blocks[CurrentBlock].Size)
+	{
+		AddBlock(size);
+
+		CurrentBlock = (uint32_t)Blocks.size() - 1u;
+		offset = 0;
+	}
+
+	Offset = offset + size;
+	Stats.BytesUsed += size;
+
+	return Blocks[CurrentBlock].Memory + offset;
+}
+
+void FrameArena::Reset()
+{
+	if (CurrentBlock > 0)
+	{
+		const size_t required = Stats.BytesReserved;
+
+		FreeBlocks();
+		AddBlock(required);
+	}
+
+	CurrentBlock = 0;
+	Offset = 0;
+	Stats.BytesUsed = 0;
+	Stats.BlockAllocations = 0;
+}
+
+FrameAllocator::FrameAllocator(uint32_t bucketCount, size_t blockSize)
+	: BucketCount(bucketCount > 0u ? bucketCount : 1u)
+{
+	Arenas.reserve((size_t)FramesInFlight * BucketCount);
+
+	for (uint32_t i = 0; i < FramesInFlight * BucketCount; i++)
+	{
+		Arenas.push_back(std::make_unique<FrameArena>(blockSize));
+	}
+
+	// BeginFrame advances before resetting so the first frame lands on index 0
+	FrameIndex = FramesInFlight - 1u;
+}
+
+void FrameAllocator::BeginFrame()
+{
+	uint32_t blockAllocations = 0;
+	for (uint32_t b = 0; b < BucketCount; b++)
+	{
+		blockAllocations += GetArena(b).GetStats().BlockAllocations;
+	}
+
+	LastFrameBlockAllocations = blockAllocations;
+
+	if (FrameCount > WarmupFrames && blockAllocations > 0)
+	{
+		SteadyStateBlockAllocations += blockAllocations;
+		LOGWARNING("Frame allocator grew by %u blocks after warmup", blockAllocations);
+	}
+
+	FrameIndex = (FrameIndex + 1u) % FramesInFlight;
+	FrameCount++;
+
+	for (uint32_t b = 0; b < BucketCount; b++)
+	{
+		GetArena(b).Reset();
+	}
+}
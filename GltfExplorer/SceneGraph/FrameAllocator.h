@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+struct FrameArenaStats
+{
+	size_t BytesUsed = 0;
+	size_t BytesReserved = 0;
+	uint32_t BlockAllocations = 0;
+};
+
+// Linear allocator for data that lives for a single frame. Allocations bump an offset and are released all at once by Reset,
+// nothing placed in the arena is destroyed so only trivially destructible types are allowed.
+// Not thread safe, each thread records into its own arena.
+class FrameArena
+{
+public:
+
+	static constexpr size_t DefaultBlockSize = 256u * 1024u;
+
+	explicit FrameArena(size_t blockSize = DefaultBlockSize);
+	~FrameArena();
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	void* Allocate(size_t size, size_t alignment);
+
+	template<typename T>
+	T* Allocate(size_t count = 1)
+	{
+		static_assert(std::is_trivially_destructible_v<T>, "Frame arena memory is never destructed");
+		return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	template<typename T>
+	T* New(const T& value)
+	{
+		T* ptr = Allocate<T>();
+		new (ptr) T(value);
+		return ptr;
+	}
+
+	// Frees everything allocated since the last reset. If the frame spilled into extra blocks they are merged into one
+	// block big enough for the whole frame, so a frame of the same size next time is served without touching the heap.
+	void Reset();
+
+	const FrameArenaStats& GetStats() const noexcept { return Stats; }
+
+private:
+
+	struct Block
+	{
+		uint8_t* Memory = nullptr;
+		size_t Size = 0;
+	};
+
+	void AddBlock(size_t minSize);
+	void FreeBlocks();
+
+	std::vector<Block> Blocks;
+	uint32_t CurrentBlock = 0;
+	size_t Offset = 0;
+	size_t BlockSize = DefaultBlockSize;
+
+	FrameArenaStats Stats = {};
+};
+
+// Chunked list whose storage comes from a frame arena. Lists built on different threads are joined by relinking chunks
+// so merging never copies elements.
+template<typename T>
+struct FrameList
+{
+	static_assert(std::is_trivially_destructible_v<T>, "Frame arena memory is never destructed");
+
+	static constexpr uint32_t ChunkCapacity = 256u;
+
+	struct Chunk
+	{
+		Chunk* Next;
+		uint32_t Count;
+		T Items[ChunkCapacity];
+	};
+
+	void PushBack(FrameArena& arena, const T& value)
+	{
+		if (!Tail || Tail->Count == ChunkCapacity)
+		{
+			Chunk* chunk = arena.Allocate<Chunk>();
+			chunk->Next = nullptr;
+			chunk->Count = 0;
+
+			if (Tail)
+				Tail->Next = chunk;
+			else
+				Head = chunk;
+
+			Tail = chunk;
+		}
+
+		Tail->Items[Tail->Count++] = value;
+		Count++;
+	}
+
+	// Takes ownership of the chunks in other, leaving it empty
+	void Splice(FrameList& other) noexcept
+	{
+		if (!other.Head)
+			return;
+
+		if (Tail)
+			Tail->Next = other.Head;
+		else
+			Head = other.Head;
+
+		Tail = other.Tail;
+		Count += other.Count;
+
+		other = {};
+	}
+
+	template<typename Func>
+	void ForEach(Func&& func) const
+	{
+		for (const Chunk* chunk = Head; chunk; chunk = chunk->Next)
+		{
+			for (uint32_t i = 0; i < chunk->Count; i++)
+			{
+				func(chunk->Items[i]);
+			}
+		}
+	}
+
+	size_t Size() const noexcept { return Count; }
+	bool Empty() const noexcept { return Count == 0; }
+
+	Chunk* Head = nullptr;
+	Chunk* Tail = nullptr;
+	size_t Count = 0;
+};
+
+// Arenas for every frame in flight, each frame has one arena per bucket so worker threads never share an arena.
+// A frame's arenas are only reset once that frame index comes round again, so data handed to the renderer stays valid
+// while later frames are being built.
+class FrameAllocator
+{
+public:
+
+	static constexpr uint32_t FramesInFlight = 3u;
+
+	// Frames before this are allowed to grow the arenas, after that any heap allocation is reported
+	static constexpr uint32_t WarmupFrames = 8u;
+
+	explicit FrameAllocator(uint32_t bucketCount = 1u, size_t blockSize = FrameArena::DefaultBlockSize);
+
+	void BeginFrame();
+
+	FrameArena& GetArena(uint32_t bucket = 0u) noexcept { return *Arenas[FrameIndex * BucketCount + bucket]; }
+	uint32_t GetBucketCount() const noexcept { return BucketCount; }
+
+	// Heap allocations made by the previous frame's arenas, zero in steady state
+	uint32_t GetLastFrameBlockAllocations() const noexcept { return LastFrameBlockAllocations; }
+	uint64_t GetSteadyStateBlockAllocations() const noexcept { return SteadyStateBlockAllocations; }
+
+private:
+
+	std::vector<std::unique_ptr<FrameArena>> Arenas;
+	uint32_t BucketCount = 1u;
+	uint32_t FrameIndex = 0u;
+	uint64_t FrameCount = 0u;
+
+	uint32_t LastFrameBlockAllocations = 0u;
+	uint64_t SteadyStateBlockAllocations = 0u;
+};
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "../Profiler/Profiler.h"
+
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Two stage frame pipeline. The simulation stage (scene update, culling, sorting) of frame N+1 runs on a worker thread
+// while the calling thread records and submits frame N. Each stage owns one of two snapshots, they swap at
+// WaitForSimulation so neither stage ever sees the other's snapshot while it is being written.
+//
+// The calling thread drives it with two sync points a frame:
+//   WaitForSimulation - the next snapshot is complete and now belongs to the render stage.
+//   KickSimulation    - the render stage has consumed everything the simulation writes outside its snapshot (for example
+//                       transforms waiting to be uploaded), the worker may start on the next frame.
+// KickSimulation has to be called once before the first WaitForSimulation.
+template<typename SnapshotT, typename InputT>
+class FramePipeline
+{
+public:
+
+	using SimulateFunc = std::function<void(const InputT& input, SnapshotT& snapshot)>;
+
+	explicit FramePipeline(SimulateFunc simulate)
+		: Simulate(std::move(simulate))
+	{
+		Worker = std::thread([this]() { WorkerLoop(); });
+	}
+
+	~FramePipeline()
+	{
+		{
+			std::lock_guard<std::mutex> lock(Lock);
+			Quit = true;
+		}
+		Signal.notify_all();
+		Worker.join();
+	}
+
+	FramePipeline(const FramePipeline&) = delete;
+	FramePipeline& operator=(const FramePipeline&) = delete;
+
+	// Without pipelining the simulation runs inline in KickSimulation, useful for comparing the two
+	void SetPipelined(bool pipelined)
+	{
+		Flush();
+		Pipelined = pipelined;
+	}
+
+	bool IsPipelined() const noexcept { return Pipelined; }
+
+	void KickSimulation(const InputT& input)
+	{
+		assert(!Pending);
+
+		SimSlot = RenderSlot ^ 1u;
+		Input = input;
+		Pending = true;
+
+		if (!Pipelined)
+		{
+			Simulate(Input, Snapshots[SimSlot]);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(Lock);
+			Working = true;
+		}
+		Signal.notify_all();
+	}
+
+	SnapshotT& WaitForSimulation()
+	{
+		assert(Pending);
+
+		if (Pipelined)
+		{
+			PROFILE_ZONE("Wait Simulation");
+
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			std::unique_lock<std::mutex> lock(Lock);
+			Signal.wait(lock, [this]() { return !Working; });
+
+			LastWaitMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		else
+		{
+			LastWaitMilliseconds = 0.0f;
+		}
+
+		Pending = false;
+		RenderSlot = SimSlot;
+
+		return Snapshots[RenderSlot];
+	}
+
+	// Waits for any simulation in flight, call before changing anything the simulation reads
+	void Flush()
+	{
+		if (Pending)
+		{
+			WaitForSimulation();
+		}
+	}
+
+	// How long the render stage blocked in the last WaitForSimulation, non zero means the simulation is the bottleneck
+	float GetLastWaitMilliseconds() const noexcept { return LastWaitMilliseconds; }
+
+private:
+
+	void WorkerLoop()
+	{
+		PROFILE_THREAD("Simulation");
+
+		std::unique_lock<std::mutex> lock(Lock);
+
+		for (;;)
+		{
+			Signal.wait(lock, [this]() { return Working || Quit; });
+
+			if (Quit)
+				return;
+
+			lock.unlock();
+
+			{
+				PROFILE_ZONE("Simulate");
+				Simulate(Input, Snapshots[SimSlot]);
+			}
+
+			lock.lock();
+			Working = false;
+			Signal.notify_all();
+		}
+	}
+
+	SimulateFunc Simulate;
+
+	SnapshotT Snapshots[2] = {};
+	InputT Input = {};
+
+	// Only touched by the calling thread, the worker reads SimSlot and Input after being signalled
+	uint32_t RenderSlot = 1u;
+	uint32_t SimSlot = 0u;
+	bool Pending = false;
+	bool Pipelined = true;
+	float LastWaitMilliseconds = 0.0f;
+
+	std::thread Worker;
+	std::mutex Lock;
+	std::condition_variable Signal;
+	bool Working = false;
+	bool Quit = false;
+};
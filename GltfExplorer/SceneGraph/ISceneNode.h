@@ -16,6 +16,9 @@ public:
 
 	const matrix& GetTransformLazyUpdate() noexcept;
 
+	// As of the last GetTransformLazyUpdate, invalid when the node never set LocalBounds
+	const AABB& GetWorldBounds() const noexcept { return WorldBounds; }
+
 	void SetParent(ISceneNode* parent);
 
 protected:
@@ -0,0 +1,160 @@
+#include "RenderSortKey.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+static constexpr uint32_t RadixBits = 8u;
+static constexpr uint32_t RadixBuckets = 1u << RadixBits;
+static constexpr uint32_t RadixPasses = 64u / RadixBits;
+
+uint32_t SortKey_QuantizeDepth(float depth, float depthMin, float depthMax, uint8_t bits, SortKeyDepthOrder order) noexcept
+{
+	if (bits == 0)
+		return 0;
+
+	const uint32_t mask = bits >= 32 ? ~0u : (1u << bits) - 1u;
+
+	// Doubles keep every step of a 32 bit field distinct, the comparisons also catch NaN
+	const double range = (double)depthMax - (double)depthMin;
+	double t = range > 0.0 ? ((double)depth - (double)depthMin) / range : 0.0;
+	if (!(t > 0.0))
+		t = 0.0;
+	if (!(t < 1.0))
+		t = 1.0;
+
+	uint32_t quantized = (uint32_t)(t * (double)mask + 0.5);
+
+	if (order == SortKeyDepthOrder::BACK_TO_FRONT)
+		quantized = ~quantized & mask;
+
+	return quantized;
+}
+
+void SortKeyRemap::Reset(uint64_t* handles, uint32_t* indices, uint32_t slotCount) noexcept
+{
+	assert(slotCount > 0u && (slotCount & (slotCount - 1u)) == 0u);
+
+	Handles = handles;
+	Indices = indices;
+	Mask = slotCount - 1u;
+	Count = 0;
+
+	for (uint32_t i = 0; i < slotCount; i++)
+		Indices[i] = ~0u;
+}
+
+uint32_t SortKeyRemap::Map(uint64_t handle) noexcept
+{
+	uint32_t slot = (uint32_t)((handle * 0x9E3779B97F4A7C15ull) >> 32u) & Mask;
+
+	while (Indices[slot] != ~0u)
+	{
+		if (Handles[slot] == handle)
+			return Indices[slot];
+
+		slot = (slot + 1u) & Mask;
+	}
+
+	assert(Count < Mask);
+
+	Handles[slot] = handle;
+	Indices[slot] = Count;
+	return Count++;
+}
+
+uint64_t SortKey_Pack(const SortKeyLayout& layout, const SortKeyValues& values) noexcept
+{
+	assert(layout.TotalBits() <= 64u);
+
+	uint64_t key = 0;
+	uint32_t shift = 64u;
+
+	for (uint32_t i = 0; i < layout.FieldCount; i++)
+	{
+		const SortKeyFieldDesc& desc = layout.Fields[i];
+
+		if (desc.Bits == 0)
+			continue;
+
+		uint32_t value = 0;
+		switch (desc.Field)
+		{
+		case SortKeyField::PASS: value = values.Pass; break;
+		case SortKeyField::PSO: value = values.Pso; break;
+		case SortKeyField::MATERIAL: value = values.Material; break;
+		case SortKeyField::VERTEX_BUFFER: value = values.VertexBuffer; break;
+		case SortKeyField::DEPTH: value = SortKey_QuantizeDepth(values.Depth, values.DepthMin, values.DepthMax, desc.Bits, layout.DepthOrder); break;
+		default: break;
+		}
+
+		// Masking would wrap a large value into the middle of the field and break the order, the top bucket keeps it last
+		const uint64_t mask = desc.Bits >= 32 ? 0xffffffffull : (1ull << desc.Bits) - 1ull;
+
+		shift -= desc.Bits;
+		key |= std::min((uint64_t)value, mask) << shift;
+	}
+
+	return key;
+}
+
+void SortKey_RadixSort(uint64_t* keys, uint32_t* indices, uint64_t* scratchKeys, uint32_t* scratchIndices, size_t count) noexcept
+{
+	if (count <= 1)
+		return;
+
+	// Build every histogram in a single read of the keys
+	uint32_t histograms[RadixPasses][RadixBuckets] = {};
+
+	for (size_t i = 0; i < count; i++)
+	{
+		uint64_t key = keys[i];
+		for (uint32_t pass = 0; pass < RadixPasses; pass++)
+		{
+			histograms[pass][key & (RadixBuckets - 1u)]++;
+			key >>= RadixBits;
+		}
+	}
+
+	uint64_t* srcKeys = keys;
+	uint32_t* srcIndices = indices;
+	uint64_t* dstKeys = scratchKeys;
+	uint32_t* dstIndices = scratchIndices;
+
+	for (uint32_t pass = 0; pass < RadixPasses; pass++)
+	{
+		uint32_t* histogram = histograms[pass];
+
+		const uint32_t shift = pass * RadixBits;
+
+		// All keys share this digit so the pass would be an identity permutation
+		if (histogram[(srcKeys[0] >> shift) & (RadixBuckets - 1u)] == count)
+			continue;
+
+		uint32_t offset = 0;
+		for (uint32_t bucket = 0; bucket < RadixBuckets; bucket++)
+		{
+			const uint32_t bucketCount = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const uint64_t key = srcKeys[i];
+			const uint32_t dst = histogram[(key >> shift) & (RadixBuckets - 1u)]++;
+			dstKeys[dst] = key;
+			dstIndices[dst] = srcIndices[i];
+		}
+
+		std::swap(srcKeys, dstKeys);
+		std::swap(srcIndices, dstIndices);
+	}
+
+	if (srcKeys != keys)
+	{
+		memcpy(keys, srcKeys, count * sizeof(uint64_t));
+		memcpy(indices, srcIndices, count * sizeof(uint32_t));
+	}
+}
\ No newline at end of file
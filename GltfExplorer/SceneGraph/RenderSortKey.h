@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Fields that can be packed into a batch sort key. Layouts list fields from the most to the least significant bits.
+enum class SortKeyField : uint8_t
+{
+	PASS,
+	PSO,
+	MATERIAL,
+	VERTEX_BUFFER,
+	DEPTH,
+	COUNT,
+};
+
+enum class SortKeyDepthOrder : uint8_t
+{
+	FRONT_TO_BACK,
+	BACK_TO_FRONT,
+};
+
+struct SortKeyFieldDesc
+{
+	SortKeyField Field = SortKeyField::COUNT;
+	uint8_t Bits = 0;
+};
+
+struct SortKeyLayout
+{
+	static constexpr uint32_t MaxFields = (uint32_t)SortKeyField::COUNT;
+
+	SortKeyFieldDesc Fields[MaxFields] = {};
+	uint8_t FieldCount = 0;
+	SortKeyDepthOrder DepthOrder = SortKeyDepthOrder::FRONT_TO_BACK;
+
+	constexpr SortKeyLayout& Add(SortKeyField field, uint8_t bits) noexcept
+	{
+		Fields[FieldCount++] = { field, bits };
+		return *this;
+	}
+
+	constexpr SortKeyLayout& Depth(SortKeyDepthOrder order, uint8_t bits) noexcept
+	{
+		DepthOrder = order;
+		return Add(SortKeyField::DEPTH, bits);
+	}
+
+	constexpr uint32_t TotalBits() const noexcept
+	{
+		uint32_t bits = 0;
+		for (uint32_t i = 0; i < FieldCount; i++)
+			bits += Fields[i].Bits;
+		return bits;
+	}
+};
+
+// Values wider than their field are clamped to its largest value, remap handles with SortKeyRemap so they stay in range
+struct SortKeyValues
+{
+	uint32_t Pass = 0;
+	uint32_t Pso = 0;
+	uint32_t Material = 0;
+	uint32_t VertexBuffer = 0;
+	float Depth = 0.0f;
+
+	// View depths of the nearest and farthest batch sorted together, the depth field spans this range
+	float DepthMin = 0.0f;
+	float DepthMax = 0.0f;
+};
+
+uint64_t SortKey_Pack(const SortKeyLayout& layout, const SortKeyValues& values) noexcept;
+
+// Quantizes view depth linearly between depthMin and depthMax to an unsigned `bits` wide value, so the whole field
+// resolves the depths actually sorted. Depths outside the range and NaN clamp to its ends.
+uint32_t SortKey_QuantizeDepth(float depth, float depthMin, float depthMax, uint8_t bits, SortKeyDepthOrder order) noexcept;
+
+// Maps render handles to dense indices in order of first use, so sparse or generation tagged handles still fit a key
+// field of a few bits. Storage comes from the caller, `slotCount` must be a power of two larger than the number of
+// distinct handles mapped between resets.
+struct SortKeyRemap
+{
+	void Reset(uint64_t* handles, uint32_t* indices, uint32_t slotCount) noexcept;
+
+	uint32_t Map(uint64_t handle) noexcept;
+
+	uint32_t GetCount() const noexcept { return Count; }
+
+private:
+
+	uint64_t* Handles = nullptr;
+	uint32_t* Indices = nullptr;
+	uint32_t Mask = 0;
+	uint32_t Count = 0;
+};
+
+// LSD radix sort of keys with a parallel index array, 8 bits per pass. Passes where every key shares the same digit are skipped.
+// The scratch arrays must hold `count` elements. Sorted results are always written back to `keys` and `indices`.
+void SortKey_RadixSort(uint64_t* keys, uint32_t* indices, uint64_t* scratchKeys, uint32_t* scratchIndices, size_t count) noexcept;
\ No newline at end of file
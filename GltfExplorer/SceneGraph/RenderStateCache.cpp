@@ -0,0 +1,445 @@
+#include "RenderStateCache.h"
+
+#include "../Capture/FrameCapture.h"
+
+#include <Render/Render.h>
+
+using namespace tpr;
+
+static const char* RenderStateCallNames[(uint8_t)RenderStateCall::COUNT] =
+{
+	"RootSignature",
+	"PipelineState",
+	"RootCBV",
+	"RootDescriptorTable",
+	"RootValue",
+	"VertexCBVs",
+	"PixelCBVs",
+	"VertexSRVs",
+	"PixelSRVs",
+	"IndexBuffer",
+	"VertexBuffers",
+};
+
+const char* RenderStateCall_GetName(RenderStateCall call)
+{
+	return call < RenderStateCall::COUNT ? RenderStateCallNames[(uint8_t)call] : "Unknown";
+}
+
+uint32_t RenderStateCacheStats::TotalIssued() const noexcept
+{
+	uint32_t total = 0;
+	for (uint32_t count : Issued)
+		total += count;
+	return total;
+}
+
+uint32_t RenderStateCacheStats::TotalElided() const noexcept
+{
+	uint32_t total = 0;
+	for (uint32_t count : Elided)
+		total += count;
+	return total;
+}
+
+RenderStateCacheStats& RenderStateCacheStats::operator+=(const RenderStateCacheStats& other) noexcept
+{
+	for (uint8_t i = 0; i < (uint8_t)RenderStateCall::COUNT; i++)
+	{
+		Issued[i] += other.Issued[i];
+		Elided[i] += other.Elided[i];
+	}
+	Draws += other.Draws;
+	return *this;
+}
+
+RenderStateCache::RenderStateCache(CommandList* cl)
+	: Cl(cl)
+{
+}
+
+void RenderStateCache::Reset(tpr::CommandList* cl)
+{
+	Cl = cl;
+	Invalidate();
+}
+
+void RenderStateCache::Invalidate()
+{
+	RootSignature = {};
+	PipelineState = {};
+
+	for (Binding& b : RootSlots) b = {};
+	for (Binding& b : VertexCBVs) b = {};
+	for (Binding& b : PixelCBVs) b = {};
+	for (Binding& b : VertexSRVs) b = {};
+	for (Binding& b : PixelSRVs) b = {};
+	for (VertexBufferBinding& b : VertexBuffers) b = {};
+
+	IndexBuffer = {};
+	IndexFormat = {};
+	IndexOffset = 0;
+}
+
+bool RenderStateCache::UpdateRootSlot(uint32_t slot, const Binding& binding, RenderStateCall call)
+{
+	if (slot < MaxRootSlots && RootSlots[slot] == binding)
+	{
+		Stats.Elided[(uint8_t)call]++;
+		return false;
+	}
+
+	if (slot < MaxRootSlots)
+		RootSlots[slot] = binding;
+
+	Stats.Issued[(uint8_t)call]++;
+	return true;
+}
+
+bool RenderStateCache::UpdateBindings(Binding* bound, uint32_t maxSlots, uint32_t startSlot, size_t count, BindingType type, const uint64_t* handles, RenderStateCall call)
+{
+	bool dirty = startSlot + count > maxSlots;
+
+	for (size_t i = 0; !dirty && i < count; i++)
+	{
+		dirty = !(bound[startSlot + i] == Binding{ type, handles[i] });
+	}
+
+	if (!dirty)
+	{
+		Stats.Elided[(uint8_t)call]++;
+		return false;
+	}
+
+	for (size_t i = 0; i < count && startSlot + i < maxSlots; i++)
+	{
+		bound[startSlot + i] = { type, handles[i] };
+	}
+
+	Stats.Issued[(uint8_t)call]++;
+	return true;
+}
+
+template<typename T>
+bool RenderStateCache::UpdateCBVs(Binding* bound, uint32_t startSlot, uint32_t count, BindingType type, const T* bufs, RenderStateCall call)
+{
+	uint64_t handles[MaxCBVSlots];
+
+	if (count > MaxCBVSlots)
+	{
+		// Too wide to track, forget everything in range and pass it through
+		for (uint32_t i = startSlot; i < MaxCBVSlots; i++)
+			bound[i] = {};
+
+		Stats.Issued[(uint8_t)call]++;
+		return true;
+	}
+
+	for (uint32_t i = 0; i < count; i++)
+		handles[i] = static_cast<uint64_t>(bufs[i]);
+
+	return UpdateBindings(bound, MaxCBVSlots, startSlot, count, type, handles, call);
+}
+
+bool RenderStateCache::UpdateIndexBuffer(const Binding& binding, RenderFormat format, uint32_t offset)
+{
+	if (IndexBuffer == binding && IndexFormat == format && IndexOffset == offset)
+	{
+		Stats.Elided[(uint8_t)RenderStateCall::INDEX_BUFFER]++;
+		return false;
+	}
+
+	IndexBuffer = binding;
+	IndexFormat = format;
+	IndexOffset = offset;
+
+	Stats.Issued[(uint8_t)RenderStateCall::INDEX_BUFFER]++;
+	return true;
+}
+
+bool RenderStateCache::UpdateVertexBuffers(uint32_t startSlot, uint32_t count, BindingType type, const uint64_t* handles, const uint32_t* strides, const uint32_t* offsets)
+{
+	bool dirty = startSlot + count > MaxVertexBuffers;
+
+	for (uint32_t i = 0; !dirty && i < count; i++)
+	{
+		const VertexBufferBinding binding = { { type, handles[i] }, strides[i], offsets[i] };
+		dirty = !(VertexBuffers[startSlot + i] == binding);
+	}
+
+	if (!dirty)
+	{
+		Stats.Elided[(uint8_t)RenderStateCall::VERTEX_BUFFERS]++;
+		return false;
+	}
+
+	for (uint32_t i = 0; i < count && startSlot + i < MaxVertexBuffers; i++)
+	{
+		VertexBuffers[startSlot + i] = { { type, handles[i] }, strides[i], offsets[i] };
+	}
+
+	Stats.Issued[(uint8_t)RenderStateCall::VERTEX_BUFFERS]++;
+	return true;
+}
+
+void RenderStateCache::SetRootSignature(RootSignature_t rootSignature)
+{
+	const Binding binding = { BindingType::STATIC, static_cast<uint64_t>(rootSignature) };
+
+	if (RootSignature == binding)
+	{
+		Stats.Elided[(uint8_t)RenderStateCall::ROOT_SIGNATURE]++;
+		return;
+	}
+
+	// Changing root signature invalidates all root arguments
+	RootSignature = binding;
+	for (Binding& b : RootSlots) b = {};
+
+	Stats.Issued[(uint8_t)RenderStateCall::ROOT_SIGNATURE]++;
+	Cl->SetRootSignature(rootSignature);
+
+	if (Capture)
+		Capture->RecordHandle(CaptureCommandType::ROOT_SIGNATURE, 0u, CaptureResourceType::ROOT_SIGNATURE, binding.Handle);
+}
+
+void RenderStateCache::SetPipelineState(GraphicsPipelineState_t pso)
+{
+	const Binding binding = { BindingType::STATIC, static_cast<uint64_t>(pso) };
+
+	if (PipelineState == binding)
+	{
+		Stats.Elided[(uint8_t)RenderStateCall::PIPELINE_STATE]++;
+		return;
+	}
+
+	PipelineState = binding;
+
+	Stats.Issued[(uint8_t)RenderStateCall::PIPELINE_STATE]++;
+	Cl->SetPipelineState(pso);
+
+	if (Capture)
+		Capture->RecordHandle(CaptureCommandType::PIPELINE_STATE, 0u, CaptureResourceType::PIPELINE_STATE, binding.Handle);
+}
+
+void RenderStateCache::SetGraphicsRootCBV(uint32_t slot, DynamicBuffer_t buf)
+{
+	if (UpdateRootSlot(slot, { BindingType::DYNAMIC, static_cast<uint64_t>(buf) }, RenderStateCall::ROOT_CBV))
+	{
+		Cl->SetGraphicsRootCBV(slot, buf);
+
+		if (Capture)
+			Capture->RecordHandle(CaptureCommandType::ROOT_CBV, slot, CaptureResourceType::DYNAMIC_CONSTANT_BUFFER, static_cast<uint64_t>(buf), CAPTURE_CMD_DYNAMIC);
+	}
+}
+
+void RenderStateCache::SetGraphicsRootCBV(uint32_t slot, ConstantBuffer_t buf)
+{
+	if (UpdateRootSlot(slot, { BindingType::STATIC, static_cast<uint64_t>(buf) }, RenderStateCall::ROOT_CBV))
+	{
+		Cl->SetGraphicsRootCBV(slot, buf);
+
+		if (Capture)
+			Capture->RecordHandle(CaptureCommandType::ROOT_CBV, slot, CaptureResourceType::CONSTANT_BUFFER, static_cast<uint64_t>(buf));
+	}
+}
+
+void RenderStateCache::SetGraphicsRootDescriptorTable(uint32_t slot)
+{
+	if (UpdateRootSlot(slot, { BindingType::DESCRIPTOR_TABLE, 0u }, RenderStateCall::ROOT_DESCRIPTOR_TABLE))
+	{
+		Cl->SetGraphicsRootDescriptorTable(slot);
+
+		if (Capture)
+			Capture->RecordValue(CaptureCommandType::ROOT_DESCRIPTOR_TABLE, slot, 0u);
+	}
+}
+
+void RenderStateCache::SetGraphicsRootValue(uint32_t slot, uint32_t value)
+{
+	if (UpdateRootSlot(slot, { BindingType::VALUE, value }, RenderStateCall::ROOT_VALUE))
+	{
+		Cl->SetGraphicsRootValue(slot, value);
+
+		if (Capture)
+			Capture->RecordValue(CaptureCommandType::ROOT_VALUE, slot, value);
+	}
+}
+
+template<typename T>
+static void RenderStateCache_CaptureCBVs(FrameCaptureStream* capture, CaptureCommandType type, uint32_t startSlot, uint32_t count, const T* bufs, bool dynamic)
+{
+	if (!capture)
+		return;
+
+	uint64_t handles[RenderStateCache::MaxCBVSlots];
+	count = Min(count, RenderStateCache::MaxCBVSlots);
+
+	for (uint32_t i = 0; i < count; i++)
+		handles[i] = static_cast<uint64_t>(bufs[i]);
+
+	if (dynamic)
+		capture->RecordHandles(type, startSlot, count, CaptureResourceType::DYNAMIC_CONSTANT_BUFFER, handles, CAPTURE_CMD_DYNAMIC);
+	else
+		capture->RecordHandles(type, startSlot, count, CaptureResourceType::CONSTANT_BUFFER, handles);
+}
+
+void RenderStateCache::BindVertexCBVs(uint32_t startSlot, uint32_t count, const DynamicBuffer_t* bufs)
+{
+	if (UpdateCBVs(VertexCBVs, startSlot, count, BindingType::DYNAMIC, bufs, RenderStateCall::VERTEX_CBVS))
+	{
+		Cl->BindVertexCBVs(startSlot, count, bufs);
+		RenderStateCache_CaptureCBVs(Capture, CaptureCommandType::VERTEX_CBVS, startSlot, count, bufs, true);
+	}
+}
+
+void RenderStateCache::BindVertexCBVs(uint32_t startSlot, uint32_t count, const ConstantBuffer_t* bufs)
+{
+	if (UpdateCBVs(VertexCBVs, startSlot, count, BindingType::STATIC, bufs, RenderStateCall::VERTEX_CBVS))
+	{
+		Cl->BindVertexCBVs(startSlot, count, bufs);
+		RenderStateCache_CaptureCBVs(Capture, CaptureCommandType::VERTEX_CBVS, startSlot, count, bufs, false);
+	}
+}
+
+void RenderStateCache::BindPixelCBVs(uint32_t startSlot, uint32_t count, const DynamicBuffer_t* bufs)
+{
+	if (UpdateCBVs(PixelCBVs, startSlot, count, BindingType::DYNAMIC, bufs, RenderStateCall::PIXEL_CBVS))
+	{
+		Cl->BindPixelCBVs(startSlot, count, bufs);
+		RenderStateCache_CaptureCBVs(Capture, CaptureCommandType::PIXEL_CBVS, startSlot, count, bufs, true);
+	}
+}
+
+void RenderStateCache::BindPixelCBVs(uint32_t startSlot, uint32_t count, const ConstantBuffer_t* bufs)
+{
+	if (UpdateCBVs(PixelCBVs, startSlot, count, BindingType::STATIC, bufs, RenderStateCall::PIXEL_CBVS))
+	{
+		Cl->BindPixelCBVs(startSlot, count, bufs);
+		RenderStateCache_CaptureCBVs(Capture, CaptureCommandType::PIXEL_CBVS, startSlot, count, bufs, false);
+	}
+}
+
+void RenderStateCache::BindVertexSRVs(uint32_t startSlot, size_t count, const ShaderResourceView_t* srvs)
+{
+	uint64_t handles[MaxSRVSlots] = {};
+	for (size_t i = 0; i < count && i < MaxSRVSlots; i++)
+		handles[i] = static_cast<uint64_t>(srvs[i]);
+
+	if (UpdateBindings(VertexSRVs, MaxSRVSlots, startSlot, count, BindingType::STATIC, handles, RenderStateCall::VERTEX_SRVS))
+	{
+		Cl->BindVertexSRVs(startSlot, count, srvs);
+
+		if (Capture)
+			Capture->RecordHandles(CaptureCommandType::VERTEX_SRVS, startSlot, (uint32_t)Min(count, (size_t)MaxSRVSlots), CaptureResourceType::SHADER_RESOURCE_VIEW, handles);
+	}
+}
+
+void RenderStateCache::BindPixelSRVs(uint32_t startSlot, size_t count, const ShaderResourceView_t* srvs)
+{
+	uint64_t handles[MaxSRVSlots] = {};
+	for (size_t i = 0; i < count && i < MaxSRVSlots; i++)
+		handles[i] = static_cast<uint64_t>(srvs[i]);
+
+	if (UpdateBindings(PixelSRVs, MaxSRVSlots, startSlot, count, BindingType::STATIC, handles, RenderStateCall::PIXEL_SRVS))
+	{
+		Cl->BindPixelSRVs(startSlot, count, srvs);
+
+		if (Capture)
+			Capture->RecordHandles(CaptureCommandType::PIXEL_SRVS, startSlot, (uint32_t)Min(count, (size_t)MaxSRVSlots), CaptureResourceType::SHADER_RESOURCE_VIEW, handles);
+	}
+}
+
+void RenderStateCache::SetIndexBuffer(IndexBuffer_t buf, RenderFormat format, uint32_t offset)
+{
+	if (UpdateIndexBuffer({ BindingType::STATIC, static_cast<uint64_t>(buf) }, format, offset))
+	{
+		Cl->SetIndexBuffer(buf, format, offset);
+
+		if (Capture)
+			Capture->RecordIndexBuffer(CaptureResourceType::INDEX_BUFFER, static_cast<uint64_t>(buf), format, offset, 0u);
+	}
+}
+
+void RenderStateCache::SetIndexBuffer(DynamicBuffer_t buf, RenderFormat format, uint32_t offset)
+{
+	if (UpdateIndexBuffer({ BindingType::DYNAMIC, static_cast<uint64_t>(buf) }, format, offset))
+	{
+		Cl->SetIndexBuffer(buf, format, offset);
+
+		if (Capture)
+			Capture->RecordIndexBuffer(CaptureResourceType::DYNAMIC_INDEX_BUFFER, static_cast<uint64_t>(buf), format, offset, CAPTURE_CMD_DYNAMIC);
+	}
+}
+
+void RenderStateCache::SetVertexBuffers(uint32_t startSlot, uint32_t count, const VertexBuffer_t* bufs, const uint32_t* strides, const uint32_t* offsets)
+{
+	uint64_t handles[MaxVertexBuffers] = {};
+	for (uint32_t i = 0; i < count && i < MaxVertexBuffers; i++)
+		handles[i] = static_cast<uint64_t>(bufs[i]);
+
+	if (UpdateVertexBuffers(startSlot, count, BindingType::STATIC, handles, strides, offsets))
+	{
+		Cl->SetVertexBuffers(startSlot, count, bufs, strides, offsets);
+
+		if (Capture)
+			Capture->RecordVertexBuffers(startSlot, Min(count, MaxVertexBuffers), CaptureResourceType::VERTEX_BUFFER, handles, strides, offsets, 0u);
+	}
+}
+
+void RenderStateCache::SetVertexBuffers(uint32_t startSlot, uint32_t count, const DynamicBuffer_t* bufs, const uint32_t* strides, const uint32_t* offsets)
+{
+	uint64_t handles[MaxVertexBuffers] = {};
+	for (uint32_t i = 0; i < count && i < MaxVertexBuffers; i++)
+		handles[i] = static_cast<uint64_t>(bufs[i]);
+
+	if (UpdateVertexBuffers(startSlot, count, BindingType::DYNAMIC, handles, strides, offsets))
+	{
+		Cl->SetVertexBuffers(startSlot, count, bufs, strides, offsets);
+
+		if (Capture)
+			Capture->RecordVertexBuffers(startSlot, Min(count, MaxVertexBuffers), CaptureResourceType::DYNAMIC_VERTEX_BUFFER, handles, strides, offsets, CAPTURE_CMD_DYNAMIC);
+	}
+}
+
+void RenderStateCache::SetRenderTargets(const RenderTargetView_t* rtvs, uint32_t count, DepthStencilView_t dsv)
+{
+	Cl->SetRenderTargets(rtvs, count, dsv);
+
+	if (Capture)
+		Capture->RecordRenderTargets(rtvs, count, dsv);
+}
+
+void RenderStateCache::SetViewports(const Viewport* viewports, uint32_t count)
+{
+	Cl->SetViewports(viewports, count);
+
+	if (Capture)
+		Capture->RecordViewports(viewports, count);
+}
+
+void RenderStateCache::SetDefaultScissor()
+{
+	Cl->SetDefaultScissor();
+
+	if (Capture)
+		Capture->RecordDefaultScissor();
+}
+
+void RenderStateCache::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, uint32_t baseVertex, uint32_t startInstance)
+{
+	Stats.Draws++;
+	Cl->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+
+	if (Capture)
+		Capture->RecordDrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+void RenderStateCache::DrawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance)
+{
+	Stats.Draws++;
+	Cl->DrawInstanced(vertexCount, instanceCount, startVertex, startInstance);
+
+	if (Capture)
+		Capture->RecordDrawInstanced(vertexCount, instanceCount, startVertex, startInstance);
+}
\ No newline at end of file
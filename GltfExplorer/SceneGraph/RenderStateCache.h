@@ -0,0 +1,142 @@
+#pragma once
+
+#include <Render/RenderTypes.h>
+
+#include <cstdint>
+
+enum class RenderStateCall : uint8_t
+{
+	ROOT_SIGNATURE,
+	PIPELINE_STATE,
+	ROOT_CBV,
+	ROOT_DESCRIPTOR_TABLE,
+	ROOT_VALUE,
+	VERTEX_CBVS,
+	PIXEL_CBVS,
+	VERTEX_SRVS,
+	PIXEL_SRVS,
+	INDEX_BUFFER,
+	VERTEX_BUFFERS,
+	COUNT,
+};
+
+const char* RenderStateCall_GetName(RenderStateCall call);
+
+struct FrameCaptureStream;
+
+struct RenderStateCacheStats
+{
+	uint32_t Issued[(uint8_t)RenderStateCall::COUNT] = {};
+	uint32_t Elided[(uint8_t)RenderStateCall::COUNT] = {};
+	uint32_t Draws = 0;
+
+	uint32_t TotalIssued() const noexcept;
+	uint32_t TotalElided() const noexcept;
+
+	RenderStateCacheStats& operator+=(const RenderStateCacheStats& other) noexcept;
+};
+
+// Sits in front of a tpr::CommandList and drops calls that would rebind the state that is already bound.
+// Any code that records into the command list directly must call Invalidate afterwards.
+// With a capture stream set every call that reaches the command list is also appended to the stream.
+struct RenderStateCache
+{
+	static constexpr uint32_t MaxRootSlots = 16;
+	static constexpr uint32_t MaxCBVSlots = 16;
+	static constexpr uint32_t MaxSRVSlots = 32;
+	static constexpr uint32_t MaxVertexBuffers = 16;
+
+	explicit RenderStateCache(tpr::CommandList* cl = nullptr);
+
+	void Reset(tpr::CommandList* cl);
+	void Invalidate();
+
+	tpr::CommandList* GetCommandList() const noexcept { return Cl; }
+	const RenderStateCacheStats& GetStats() const noexcept { return Stats; }
+	void ResetStats() noexcept { Stats = {}; }
+
+	void SetCapture(FrameCaptureStream* capture) noexcept { Capture = capture; }
+
+	void SetRootSignature(tpr::RootSignature_t rootSignature);
+	void SetPipelineState(tpr::GraphicsPipelineState_t pso);
+
+	void SetGraphicsRootCBV(uint32_t slot, tpr::DynamicBuffer_t buf);
+	void SetGraphicsRootCBV(uint32_t slot, tpr::ConstantBuffer_t buf);
+	void SetGraphicsRootDescriptorTable(uint32_t slot);
+	void SetGraphicsRootValue(uint32_t slot, uint32_t value);
+
+	void BindVertexCBVs(uint32_t startSlot, uint32_t count, const tpr::DynamicBuffer_t* bufs);
+	void BindVertexCBVs(uint32_t startSlot, uint32_t count, const tpr::ConstantBuffer_t* bufs);
+	void BindPixelCBVs(uint32_t startSlot, uint32_t count, const tpr::DynamicBuffer_t* bufs);
+	void BindPixelCBVs(uint32_t startSlot, uint32_t count, const tpr::ConstantBuffer_t* bufs);
+
+	void BindVertexSRVs(uint32_t startSlot, size_t count, const tpr::ShaderResourceView_t* srvs);
+	void BindPixelSRVs(uint32_t startSlot, size_t count, const tpr::ShaderResourceView_t* srvs);
+
+	void SetIndexBuffer(tpr::IndexBuffer_t buf, tpr::RenderFormat format, uint32_t offset);
+	void SetIndexBuffer(tpr::DynamicBuffer_t buf, tpr::RenderFormat format, uint32_t offset);
+
+	void SetVertexBuffers(uint32_t startSlot, uint32_t count, const tpr::VertexBuffer_t* bufs, const uint32_t* strides, const uint32_t* offsets);
+	void SetVertexBuffers(uint32_t startSlot, uint32_t count, const tpr::DynamicBuffer_t* bufs, const uint32_t* strides, const uint32_t* offsets);
+
+	// Not filtered, these go through the cache so captures see them in order with the state they apply to
+	void SetRenderTargets(const tpr::RenderTargetView_t* rtvs, uint32_t count, tpr::DepthStencilView_t dsv);
+	void SetViewports(const tpr::Viewport* viewports, uint32_t count);
+	void SetDefaultScissor();
+
+	void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, uint32_t baseVertex, uint32_t startInstance);
+	void DrawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance);
+
+private:
+
+	enum class BindingType : uint8_t
+	{
+		NONE,
+		STATIC,
+		DYNAMIC,
+		DESCRIPTOR_TABLE,
+		VALUE,
+	};
+
+	struct Binding
+	{
+		BindingType Type = BindingType::NONE;
+		uint64_t Handle = 0;
+
+		bool operator==(const Binding& other) const noexcept { return Type == other.Type && Handle == other.Handle; }
+	};
+
+	struct VertexBufferBinding
+	{
+		Binding Buffer = {};
+		uint32_t Stride = 0;
+		uint32_t Offset = 0;
+
+		bool operator==(const VertexBufferBinding& other) const noexcept { return Buffer == other.Buffer && Stride == other.Stride && Offset == other.Offset; }
+	};
+
+	bool UpdateRootSlot(uint32_t slot, const Binding& binding, RenderStateCall call);
+	bool UpdateBindings(Binding* bound, uint32_t maxSlots, uint32_t startSlot, size_t count, BindingType type, const uint64_t* handles, RenderStateCall call);
+	bool UpdateIndexBuffer(const Binding& binding, tpr::RenderFormat format, uint32_t offset);
+	bool UpdateVertexBuffers(uint32_t startSlot, uint32_t count, BindingType type, const uint64_t* handles, const uint32_t* strides, const uint32_t* offsets);
+
+	template<typename T>
+	bool UpdateCBVs(Binding* bound, uint32_t startSlot, uint32_t count, BindingType type, const T* bufs, RenderStateCall call);
+
+	tpr::CommandList* Cl = nullptr;
+	FrameCaptureStream* Capture = nullptr;
+
+	Binding RootSignature = {};
+	Binding PipelineState = {};
+	Binding RootSlots[MaxRootSlots] = {};
+	Binding VertexCBVs[MaxCBVSlots] = {};
+	Binding PixelCBVs[MaxCBVSlots] = {};
+	Binding VertexSRVs[MaxSRVSlots] = {};
+	Binding PixelSRVs[MaxSRVSlots] = {};
+	Binding IndexBuffer = {};
+	tpr::RenderFormat IndexFormat = {};
+	uint32_t IndexOffset = 0;
+	VertexBufferBinding VertexBuffers[MaxVertexBuffers] = {};
+
+	RenderStateCacheStats Stats = {};
+};
\ No newline at end of file
@@ -1,6 +1,13 @@
 #include "SceneGraph.h"
 
+#include "../Profiler/Profiler.h"
+
+#include <Render/RenderDefines.h>
+
 #include <algorithm>
+#include <ParallelFor.h>
+
+#define PARALLEL_GATHER (RENDER_THREAD_SAFE)
 
 void SceneGraph::AddNode(const SceneNodePtr& node)
 {
@@ -19,6 +26,8 @@ void SceneGraph::RemoveNode(const ISceneNode* node)
 
 void SceneGraph::Update(float deltaSeconds)
 {
+    PROFILE_ZONE("Scene Update");
+
     for (const SceneNodePtr& node : Nodes)
     {
         if (node->CanTick())
@@ -28,11 +37,8 @@ void SceneGraph::Update(float deltaSeconds)
     }
 }
 
-std::vector<Renderables> SceneGraph::GatherRenderables(const SceneView& view) const
+RenderInfo SceneGraph::BuildRenderInfo(const SceneView& view)
 {
-    std::vector<Renderables> renderables;
-    renderables.resize(1);
-
     const matrix camViewProjection = view.ViewMatrix * view.ProjectionMatrix;
 
     RenderInfo info;
@@ -57,13 +63,78 @@ std::vector<Renderables> SceneGraph::GatherRenderables(const SceneView& view) co
     info.Pass[(uint8_t)SceneRenderPass::SKYBOX_PASS].Viewport = tpr::Viewport(view.ViewportWidth, view.ViewportHeight);
     info.Pass[(uint8_t)SceneRenderPass::SKYBOX_PASS].Viewport.minDepth = 1.0f;
 
-    for (const SceneNodePtr& node : Nodes)
+    return info;
+}
+
+std::span<Renderables> SceneGraph::GatherRenderables(const SceneView& view, FrameAllocator& allocator) const
+{
+    PROFILE_ZONE("Gather");
+
+    const uint32_t bucketCount = allocator.GetBucketCount();
+
+    // Each bucket records into its own arena so gathering threads never share an allocator
+    Renderables* renderables = allocator.GetArena().Allocate<Renderables>(bucketCount);
+    for (uint32_t b = 0; b < bucketCount; b++)
     {
-        if (node->CanRender())
+        new (&renderables[b]) Renderables(&allocator.GetArena(b));
+    }
+
+    const RenderInfo info = BuildRenderInfo(view);
+
+    const FrustumPlanes frustum(view.ViewMatrix * view.ProjectionMatrix);
+
+    const size_t nodesPerBucket = (Nodes.size() + bucketCount - 1u) / bucketCount;
+
+#if PARALLEL_GATHER
+    Concurrency::parallel_for(0u, bucketCount, [&](uint32_t b)
+#else
+    for (uint32_t b = 0; b < bucketCount; b++)
+#endif
+    {
+        PROFILE_ZONE("Gather Bucket");
+
+        const size_t begin = Min(b * nodesPerBucket, Nodes.size());
+        const size_t end = Min(begin + nodesPerBucket, Nodes.size());
+
+        // Visible nodes are collected first so culling and drawing show up separately in captures and profiles
+        const ISceneNode** visible = renderables[b].GetArena().Allocate<const ISceneNode*>(end - begin);
+        uint32_t visibleCount = 0;
+
+        {
+            PROFILE_ZONE("Cull");
+
+            for (size_t n = begin; n < end; n++)
+            {
+                const ISceneNode* node = Nodes[n].get();
+
+                if (!node->CanRender())
+                    continue;
+
+                AABB bounds = node->GetWorldBounds();
+                if (FrustumCulling && !bounds.Invalid() && !frustum.Intersects(bounds))
+                {
+                    renderables[b].CulledNodes++;
+                    continue;
+                }
+
+                visible[visibleCount++] = node;
+            }
+        }
+
+        renderables[b].VisibleNodes += visibleCount;
+
         {
-            node->Draw(info, renderables[0]);
+            PROFILE_ZONE("Draw Nodes");
+
+            for (uint32_t n = 0; n < visibleCount; n++)
+            {
+                visible[n]->Draw(info, renderables[b]);
+            }
         }
     }
+#if PARALLEL_GATHER
+    );
+#endif
 
-    return renderables;
+    return std::span<Renderables>(renderables, bucketCount);
 }
@@ -3,6 +3,7 @@
 #include "ISceneNode.h"
 
 #include <SurfMath.h>
+#include <span>
 
 //struct SceneDirectionalLight
 //{
@@ -25,7 +26,9 @@
 struct SceneGlobals
 {
 	/*SceneDirectionalLight DirectionalLight = {};*/
-} GScene;
+};
+
+inline SceneGlobals GScene;
 
 struct SceneView
 {
@@ -44,9 +47,17 @@ struct SceneGraph
 
 	void Update(float deltaSeconds);
 
-	std::vector<Renderables> GatherRenderables(const SceneView& view) const;
+	static RenderInfo BuildRenderInfo(const SceneView& view);
+
+	// Returns one Renderables per allocator bucket, all of it lives in the current frame's arenas.
+	// Nodes with valid world bounds outside the view frustum are skipped unless culling is disabled.
+	std::span<Renderables> GatherRenderables(const SceneView& view, FrameAllocator& allocator) const;
+
+	void SetFrustumCulling(bool enabled) noexcept { FrustumCulling = enabled; }
 
 private:
 
 	std::vector<SceneNodePtr> Nodes;
+
+	bool FrustumCulling = true;
 };
\ No newline at end of file
@@ -3,8 +3,11 @@
 #include <Render/RenderTypes.h>
 #include <SurfMath.h>
 #include <map>
+#include <memory>
 #include <shared_mutex>
 
+struct SharedTexture;
+
 enum class SceneMaterialDomain
 {
 	MD_OPAQUE,
@@ -53,6 +56,12 @@ struct SceneMaterialConstants
 	float MetallicFactor;
 	float RoughnessFactor;
 	float __pad[2];
+
+	// Matches SMaterialConstants, these materials are never atlased so every transform stays identity
+	float4 BaseColorUVTransform = float4(1.0f, 1.0f, 0.0f, 0.0f);
+	float4 NormalUVTransform = float4(1.0f, 1.0f, 0.0f, 0.0f);
+	float4 MetallicRoughnessUVTransform = float4(1.0f, 1.0f, 0.0f, 0.0f);
+	float4 EmissiveUVTransform = float4(1.0f, 1.0f, 0.0f, 0.0f);
 };
 
 struct SceneMaterial : std::enable_shared_from_this<SceneMaterial>
@@ -72,6 +81,9 @@ struct SceneMaterial : std::enable_shared_from_this<SceneMaterial>
 	tpr::TexturePtr Textures[kMaterialTextureCount] = {};
 	tpr::ShaderResourceViewPtr Srvs[kMaterialTextureCount] = {};
 
+	// Registry references keeping the textures above shared with other materials and files
+	std::shared_ptr<const SharedTexture> SharedTextures[kMaterialTextureCount] = {};
+
 	SceneMaterialConstants Constants = {};
 	tpr::ConstantBufferPtr ConstantBuffer = {};
 };
@@ -1,7 +1,17 @@
 #include "SceneRendering.h"
+#include "RenderStateCache.h"
+#include "../Capture/FrameCapture.h"
+#include "../Profiler/Profiler.h"
 
 #include <Render/Render.h>
+#include <Render/RenderDefines.h>
 #include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <ParallelFor.h>
+#include <thread>
+
+#define PARALLEL_RECORD (RENDER_THREAD_SAFE)
 
 using namespace tpr;
 
@@ -14,15 +24,38 @@ tpr::RenderFormat SceneRenderSettings::ShadowDepthFormat = RenderFormat::D32_FLO
 enum SceneRenderingRootSigSlots
 {
 	RS_VIEW_BUF,
-	RS_BATCH_BUF,
+	RS_OBJECT_ID,
 	RS_MAT_BUF,
 	RS_SRV_TABLE,
+	RS_OBJECT_BUF_INDEX,
+	RS_BUFFER_SRV_TABLE,
+	RS_CUBE_SRV_TABLE,
 	RS_COUNT
 };
 
 void Renderables::AddBatch(SceneRenderPass pass, const RenderBatch& batch)
 {
-	PassBatches[(uint8_t)pass].push_back(batch);
+	assert(Arena);
+
+	PassBatches[(uint8_t)pass].PushBack(*Arena, batch);
+}
+
+void Renderables::Append(Renderables& other) noexcept
+{
+	for (uint8_t p = 0; p < (uint8_t)SceneRenderPass::COUNT; p++)
+	{
+		PassBatches[p].Splice(other.PassBatches[p]);
+	}
+
+	VisibleNodes += other.VisibleNodes;
+	CulledNodes += other.CulledNodes;
+	other.VisibleNodes = 0;
+	other.CulledNodes = 0;
+}
+
+size_t Renderables::GetBatchCount(SceneRenderPass pass) const noexcept
+{
+	return PassBatches[(uint8_t)pass].Size();
 }
 
 SceneRenderer::SceneRenderer()
@@ -31,45 +64,275 @@ SceneRenderer::SceneRenderer()
 	rootSigDesc.Flags = RootSignatureFlags::ALLOW_INPUT_LAYOUT;
 	rootSigDesc.Slots.resize(RS_COUNT);
 	rootSigDesc.Slots[RS_VIEW_BUF] = RootSignatureSlot::CBVSlot(0, 0);
-	rootSigDesc.Slots[RS_BATCH_BUF] = RootSignatureSlot::CBVSlot(1, 0);
+	rootSigDesc.Slots[RS_OBJECT_ID] = RootSignatureSlot::ConstantsSlot(1u, 1u);
 	rootSigDesc.Slots[RS_MAT_BUF] = RootSignatureSlot::CBVSlot(2, 0);
 	rootSigDesc.Slots[RS_SRV_TABLE] = RootSignatureSlot::DescriptorTableSlot(0, 0, RootSignatureDescriptorTableType::SRV);
+	rootSigDesc.Slots[RS_OBJECT_BUF_INDEX] = RootSignatureSlot::ConstantsSlot(1u, 3u);
+	rootSigDesc.Slots[RS_BUFFER_SRV_TABLE] = RootSignatureSlot::DescriptorTableSlot(0, 1, RootSignatureDescriptorTableType::SRV);
+	rootSigDesc.Slots[RS_CUBE_SRV_TABLE] = RootSignatureSlot::DescriptorTableSlot(0, 2, RootSignatureDescriptorTableType::SRV);
 
 	rootSigDesc.GlobalSamplers.resize(1);
 	rootSigDesc.GlobalSamplers[0].AddressModeUVW(SamplerAddressMode::WRAP).FilterModeMinMagMip(SamplerFilterMode::LINEAR);
 
 	RootSignature = CreateRootSignature(rootSigDesc);
+
+	for (uint8_t p = 0; p < (uint8_t)SceneRenderPass::COUNT; p++)
+	{
+		PassSortKeyLayouts[p] = DefaultPassSortKeyLayouts[p];
+	}
 }
 
-void SceneRenderer::Render(CommandList* cl, Renderables* renderables, size_t numRenderables, const RenderInfo& info)
+void SceneRenderer::SetPassSortKeyLayout(SceneRenderPass pass, const SortKeyLayout& layout)
 {
-	std::vector<RenderBatch> CombinedBatches[(uint8_t)SceneRenderPass::COUNT];
+	assert(layout.TotalBits() <= 64u);
+
+	PassSortKeyLayouts[(uint8_t)pass] = layout;
+}
 
-	for (size_t i = 0; i < numRenderables; i++)
+void SceneRenderer::SortBatches(SceneRenderPass pass, PassBatchList& list, FrameArena& arena) const
+{
+	const uint32_t count = list.Count;
+
+	list.Order = arena.Allocate<uint32_t>(count);
+
+	uint64_t* sortKeys = arena.Allocate<uint64_t>(count);
+	uint64_t* sortKeysScratch = arena.Allocate<uint64_t>(count);
+	uint32_t* sortIndicesScratch = arena.Allocate<uint32_t>(count);
+
+	const SortKeyLayout& layout = PassSortKeyLayouts[(uint8_t)pass];
+
+	// Handles are remapped to dense indices so they fit their fields however the backend numbers them
+	uint32_t slotCount = 1u;
+	while (slotCount <= count)
+		slotCount <<= 1u;
+
+	SortKeyRemap psos, materials, vertexBuffers;
+	psos.Reset(arena.Allocate<uint64_t>(slotCount), arena.Allocate<uint32_t>(slotCount), slotCount);
+	materials.Reset(arena.Allocate<uint64_t>(slotCount), arena.Allocate<uint32_t>(slotCount), slotCount);
+	vertexBuffers.Reset(arena.Allocate<uint64_t>(slotCount), arena.Allocate<uint32_t>(slotCount), slotCount);
+
+	float depthMin = FLT_MAX;
+	float depthMax = 0.0f;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		depthMin = std::min(depthMin, list.Batches[i]->ZDepth);
+		depthMax = std::max(depthMax, list.Batches[i]->ZDepth);
+	}
+
+	for (uint32_t i = 0; i < count; i++)
 	{
-		for (uint8_t p = 0; p < (uint8_t)SceneRenderPass::COUNT; p++)
+		const RenderBatch& batch = *list.Batches[i];
+
+		SortKeyValues values;
+		values.Pass = (uint32_t)pass;
+		values.Pso = psos.Map(static_cast<uint64_t>(batch.PSO));
+		values.Material = materials.Map(static_cast<uint64_t>(batch.MaterialCBuf));
+		values.VertexBuffer = vertexBuffers.Map(batch.BufferBindings ? static_cast<uint64_t>(batch.BufferBindings->BindVertexBuffers[(uint8_t)MeshVertexBuffers::POSITION]) : 0u);
+		values.Depth = batch.ZDepth;
+		values.DepthMin = depthMin;
+		values.DepthMax = depthMax;
+
+		sortKeys[i] = SortKey_Pack(layout, values);
+		list.Order[i] = i;
+	}
+
+	SortKey_RadixSort(sortKeys, list.Order, sortKeysScratch, sortIndicesScratch, count);
+}
+
+void SceneRenderer::SetMinBatchesPerRecordRange(uint32_t minBatches)
+{
+	MinBatchesPerRecordRange = minBatches > 0u ? minBatches : 1u;
+}
+
+void SceneRenderer::BuildRecordRanges(CommandListSubmissionGroup* clGroup, FrameArena& arena)
+{
+	uint32_t passRangeCounts[(uint8_t)SceneRenderPass::COUNT] = {};
+	uint32_t totalRangeCount = 0;
+
+	for (uint8_t p = 0; p < (uint8_t)SceneRenderPass::COUNT; p++)
+	{
+		const uint32_t batchCount = DrawList->Passes[p].Count;
+		if (batchCount == 0)
+			continue;
+
+		const uint32_t rangeCount = (batchCount + MinBatchesPerRecordRange - 1u) / MinBatchesPerRecordRange;
+		passRangeCounts[p] = Clamp(rangeCount, 1u, MaxRecordRangesPerPass);
+
+		totalRangeCount += passRangeCounts[p];
+	}
+
+	RecordRanges = arena.Allocate<RecordRange>(totalRangeCount);
+	RecordRangeCount = 0;
+
+	for (uint8_t p = 0; p < (uint8_t)SceneRenderPass::COUNT; p++)
+	{
+		const uint32_t batchCount = DrawList->Passes[p].Count;
+		const uint32_t rangeCount = passRangeCounts[p];
+		if (rangeCount == 0)
+			continue;
+
+		// Spread the remainder over the first ranges so no range is more than one batch larger than another
+		const uint32_t baseSize = batchCount / rangeCount;
+		const uint32_t remainder = batchCount % rangeCount;
+
+		uint32_t begin = 0;
+		for (uint32_t r = 0; r < rangeCount; r++)
 		{
-			CombinedBatches[p].append_range(renderables[i].PassBatches[p]);
+			const uint32_t end = begin + baseSize + (r < remainder ? 1u : 0u);
+
+			RecordRanges[RecordRangeCount++] = { (SceneRenderPass)p, begin, end, clGroup->CreateCommandList() };
+
+			begin = end;
 		}
 	}
+}
 
-	for (uint8_t p = 0; p < (uint8_t)SceneRenderPass::COUNT; p++)
+void SceneRenderer::RecordRangeBatches(const RecordRange& range, const PassInfo& pass, const SceneTransformBuffer& transforms, DynamicBuffer_t viewBuf, RenderStateCache& cache) const
+{
+	const RenderBatch* const* batches = DrawList->Passes[(uint8_t)range.Pass].Batches;
+	const uint32_t* order = DrawList->Passes[(uint8_t)range.Pass].Order;
+
+	cache.SetRootSignature(RootSignature);
+
+	if (pass.Rtv != RenderTargetView_t::INVALID)
 	{
-		if (PassSortingMethod[p] == RenderPassSorting::NONE)
+		cache.SetRenderTargets(&pass.Rtv, 1, pass.Dsv);
+	}
+	else
+	{
+		cache.SetRenderTargets(nullptr, 0, pass.Dsv);
+	}
+
+	cache.SetViewports(&pass.Viewport, 1);
+	cache.SetDefaultScissor();
+
+	auto SubmitBatchesBindless = [&]()
+	{
+		cache.SetGraphicsRootCBV(RS_VIEW_BUF, viewBuf);
+		cache.SetGraphicsRootDescriptorTable(RS_SRV_TABLE);
+		cache.SetGraphicsRootDescriptorTable(RS_BUFFER_SRV_TABLE);
+		cache.SetGraphicsRootDescriptorTable(RS_CUBE_SRV_TABLE);
+
+		cache.SetGraphicsRootValue(RS_OBJECT_BUF_INDEX, GetDescriptorIndex(transforms.GetSrv()));
+
+		for (uint32_t i = range.Begin; i < range.End; i++)
 		{
-			continue;
+			const RenderBatch& batch = *batches[order[i]];
+
+			cache.SetPipelineState(batch.PSO);
+
+			cache.SetGraphicsRootValue(RS_OBJECT_ID, batch.ObjectId);
+
+			if (batch.MaterialCBuf != ConstantBuffer_t::INVALID)
+				cache.SetGraphicsRootCBV(RS_MAT_BUF, batch.MaterialCBuf);
+
+			const MeshBuffers& mesh = *batch.BufferBindings;
+			cache.SetIndexBuffer(mesh.IndexBuffer, mesh.IndexFormat, 0u);
+			cache.SetVertexBuffers(0, (uint32_t)MeshVertexBuffers::COUNT, mesh.BindVertexBuffers, mesh.Strides, mesh.Offsets);
+
+			cache.DrawIndexedInstanced(mesh.IndexCount, 1, 0, 0, 0);
 		}
-		else if (PassSortingMethod[p] == RenderPassSorting::BACK_TO_FRONT)
+	};
+
+	auto SubmitBatches = [&]()
+	{
+		cache.BindVertexCBVs(RS_VIEW_BUF, 1, &viewBuf);
+		cache.BindPixelCBVs(RS_VIEW_BUF, 1, &viewBuf);
+
+		const ShaderResourceView_t transformSrv = transforms.GetSrv();
+		cache.BindVertexSRVs(KObjectTransformSrvSlot, 1, &transformSrv);
+
+		for (uint32_t i = range.Begin; i < range.End; i++)
+		{
+			const RenderBatch& batch = *batches[order[i]];
+
+			cache.SetPipelineState(batch.PSO);
+
+			// Slots match the shader registers, b0 stays bound to the view buffer
+			const ConstantBuffer_t objectCBuf = transforms.GetObjectIdBuffer(batch.ObjectId);
+			cache.BindVertexCBVs(RS_OBJECT_ID, 1, &objectCBuf);
+
+			cache.BindVertexCBVs(RS_MAT_BUF, 1, &batch.MaterialCBuf);
+			cache.BindPixelCBVs(RS_MAT_BUF, 1, &batch.MaterialCBuf);
+
+			if (batch.ResourceBindings)
+			{
+				if (batch.ResourceBindings->VertexSrvCount != 0)
+				{
+					cache.BindVertexSRVs(KFirstBatchVertexSrvSlot, batch.ResourceBindings->VertexSrvCount, batch.ResourceBindings->VertexSrvBinds);
+				}
+
+				if (batch.ResourceBindings->PixelSrvCount != 0)
+				{
+					cache.BindPixelSRVs(0, batch.ResourceBindings->PixelSrvCount, batch.ResourceBindings->PixelSrvBinds);
+				}
+			}
+
+			const MeshBuffers& mesh = *batch.BufferBindings;
+			cache.SetIndexBuffer(mesh.IndexBuffer, mesh.IndexFormat, 0u);
+			cache.SetVertexBuffers(0, (uint32_t)MeshVertexBuffers::COUNT, mesh.BindVertexBuffers, mesh.Strides, mesh.Offsets);
+
+			cache.DrawIndexedInstanced(mesh.IndexCount, 1, 0, 0, 0);
+		}
+	};
+
+	if (Render_IsBindless())
+	{
+		SubmitBatchesBindless();
+	}
+	else
+	{
+		SubmitBatches();
+	}
+}
+
+const SceneDrawList* SceneRenderer::Prepare(FrameArena& arena, const Renderables* renderables, size_t numRenderables) const
+{
+	SceneDrawList* drawList = arena.Allocate<SceneDrawList>(1);
+	new (drawList) SceneDrawList();
+
+	// Batches stay where they were gathered, the combined list only holds pointers to them
+	for (uint8_t p = 0; p < (uint8_t)SceneRenderPass::COUNT; p++)
+	{
+		PROFILE_ZONE("Sort");
+
+		PassBatchList& list = drawList->Passes[p];
+
+		size_t count = 0;
+		for (size_t i = 0; i < numRenderables; i++)
 		{
-			std::sort(CombinedBatches[p].begin(), CombinedBatches[p].end(), [](const RenderBatch& a, const RenderBatch& b) { return a.ZDepth > b.ZDepth; });
+			count += renderables[i].PassBatches[p].Size();
 		}
-		else if (PassSortingMethod[p] == RenderPassSorting::FRONT_TO_BACK)
+
+		list.Batches = arena.Allocate<const RenderBatch*>(count);
+		list.Count = 0;
+
+		for (size_t i = 0; i < numRenderables; i++)
 		{
-			std::sort(CombinedBatches[p].begin(), CombinedBatches[p].end(), [](const RenderBatch& a, const RenderBatch& b) { return a.ZDepth < b.ZDepth; });
+			renderables[i].PassBatches[p].ForEach([&](const RenderBatch& batch)
+			{
+				list.Batches[list.Count++] = &batch;
+			});
 		}
+
+		SortBatches((SceneRenderPass)p, list, arena);
 	}
 
-	cl->SetRootSignature(RootSignature);
+	return drawList;
+}
+
+void SceneRenderer::Render(CommandListSubmissionGroup* clGroup, FrameArena& arena, const Renderables* renderables, size_t numRenderables, const RenderInfo& info)
+{
+	Render(clGroup, arena, *Prepare(arena, renderables, numRenderables), info);
+}
+
+void SceneRenderer::Render(CommandListSubmissionGroup* clGroup, FrameArena& arena, const SceneDrawList& drawList, const RenderInfo& info)
+{
+	PROFILE_ZONE("Render Scene");
+
+	assert(info.Transforms);
+
+	DrawList = &drawList;
 
 	struct ViewUniforms
 	{
@@ -80,87 +343,83 @@ void SceneRenderer::Render(CommandList* cl, Renderables* renderables, size_t num
 		float __pad1;
 		float3 SunRadiance;
 		float __pad2;
-	} viewUniforms;
+
+		// No environment here, SpecularMipCount of 0 falls back to the constant ambient
+		float IrradianceSh[9][4];
+		uint32_t SpecularSrvIndex;
+		uint32_t BrdfLutSrvIndex;
+		float SpecularMipCount;
+		float __pad3;
+	} viewUniforms = {};
 	
 	//viewUniforms.SunDirection = DirectionalLight.Direction;
 	//viewUniforms.SunRadiance = DirectionalLight.Radiance;
 
+	// Everything the recording threads need is allocated here so they never touch the dynamic buffer allocator
+	DynamicBuffer_t viewBufs[(uint8_t)SceneRenderPass::COUNT];
+
 	for (uint8_t p = 0; p < (uint8_t)SceneRenderPass::COUNT; p++)
 	{
 		viewUniforms.CameraPos = info.Pass[p].CameraPosition;
 		viewUniforms.ViewProjectionMat = info.Pass[p].Transform;
 
-		DynamicBuffer_t viewBuf = CreateDynamicConstantBuffer(&viewUniforms, sizeof(viewUniforms));
-
-		cl->SetViewports(&info.Pass[p].Viewport, 1);
-		cl->SetDefaultScissor();
-
-		auto SubmitBatchesBindless = [&](const std::vector<RenderBatch>& batches)
-		{
-			cl->SetGraphicsRootCBV(RS_VIEW_BUF, viewBuf);
-			cl->SetGraphicsRootDescriptorTable(RS_SRV_TABLE);
-
-			for (const RenderBatch& batch : CombinedBatches[p])
-			{
-				cl->SetPipelineState(batch.PSO);
-
-				if (batch.BatchCBuf != DynamicBuffer_t::INVALID)
-					cl->SetGraphicsRootCBV(RS_BATCH_BUF, batch.BatchCBuf);
+		viewBufs[p] = CreateDynamicConstantBuffer(&viewUniforms, sizeof(viewUniforms));
+	}
 
-				if (batch.MaterialCBuf != ConstantBuffer_t::INVALID)
-					cl->SetGraphicsRootCBV(RS_MAT_BUF, batch.MaterialCBuf);
+#if PARALLEL_RECORD
+	MaxRecordRangesPerPass = Max(std::thread::hardware_concurrency(), 1u);
+#else
+	MaxRecordRangesPerPass = 1u;
+#endif
 
-				const MeshBuffers& mesh = *batch.BufferBindings;
-				cl->SetIndexBuffer(mesh.IndexBuffer, mesh.IndexFormat, 0u);
-				cl->SetVertexBuffers(0, (uint32_t)MeshVertexBuffers::COUNT, mesh.BindVertexBuffers, mesh.Strides, mesh.Offsets);
+	{
+		PROFILE_ZONE("Build Ranges");
+		BuildRecordRanges(clGroup, arena);
+	}
 
-				cl->DrawIndexedInstanced(mesh.IndexCount, 1, 0, 0, 0);
-			}
-		};
+	RenderStateCacheStats* recordRangeStats = arena.Allocate<RenderStateCacheStats>(RecordRangeCount);
 
-		auto SubmitBatches = [&](const std::vector<RenderBatch>& batches)
+	// Streams are added up front in range order, which is also the order the command lists are submitted in
+	FrameCaptureStream** captureStreams = nullptr;
+	if (PendingCapture)
+	{
+		captureStreams = arena.Allocate<FrameCaptureStream*>(RecordRangeCount);
+		for (uint32_t i = 0; i < RecordRangeCount; i++)
 		{
-			cl->BindVertexCBVs(0, 1, &viewBuf);
-			cl->BindPixelCBVs(0, 1, &viewBuf);
-
-			for (const RenderBatch& batch : CombinedBatches[p])
-			{
-				cl->SetPipelineState(batch.PSO);
+			captureStreams[i] = PendingCapture->AddStream();
+		}
+	}
 
-				cl->BindVertexCBVs(0, 1, &batch.BatchCBuf);
-				cl->BindPixelCBVs(0, 1, &batch.BatchCBuf);
+#if PARALLEL_RECORD
+	Concurrency::parallel_for((size_t)0u, (size_t)RecordRangeCount, [&](size_t i)
+#else
+	for (size_t i = 0; i < RecordRangeCount; i++)
+#endif
+	{
+		PROFILE_ZONE("Record Range");
 
-				cl->BindVertexCBVs(0, 1, &batch.MaterialCBuf);
-				cl->BindPixelCBVs(0, 1, &batch.MaterialCBuf);
+		const RecordRange& range = RecordRanges[i];
 
-				if (batch.ResourceBindings)
-				{
-					if (batch.ResourceBindings->VertexSrvCount != 0)
-					{
-						cl->BindVertexSRVs(0, batch.ResourceBindings->VertexSrvCount, batch.ResourceBindings->VertexSrvBinds);
-					}
-
-					if (batch.ResourceBindings->PixelSrvCount != 0)
-					{
-						cl->BindVertexSRVs(0, batch.ResourceBindings->PixelSrvCount, batch.ResourceBindings->PixelSrvBinds);
-					}
-				}
+		RenderStateCache cache(range.Cl);
+		cache.SetCapture(captureStreams ? captureStreams[i] : nullptr);
 
-				const MeshBuffers& mesh = *batch.BufferBindings;
-				cl->SetIndexBuffer(mesh.IndexBuffer, mesh.IndexFormat, 0u);
-				cl->SetVertexBuffers(0, (uint32_t)MeshVertexBuffers::COUNT, mesh.BindVertexBuffers, mesh.Strides, mesh.Offsets);
+		RecordRangeBatches(range, info.Pass[(uint8_t)range.Pass], *info.Transforms, viewBufs[(uint8_t)range.Pass], cache);
 
-				cl->DrawIndexedInstanced(mesh.IndexCount, 1, 0, 0, 0);
-			}
-		};
+		recordRangeStats[i] = cache.GetStats();
+	}
+#if PARALLEL_RECORD
+	);
+#endif
 
-		if (Render_IsBindless())
-		{
-			SubmitBatchesBindless(CombinedBatches[p]);
-		}
-		else
-		{
-			SubmitBatches(CombinedBatches[p]);
-		}
+	LastFrameStats = {};
+	for (uint32_t i = 0; i < RecordRangeCount; i++)
+	{
+		LastFrameStats += recordRangeStats[i];
 	}
-}
\ No newline at end of file
+
+	PROFILE_COUNTER("Draws", LastFrameStats.Draws);
+	PROFILE_COUNTER("State Calls Elided", LastFrameStats.TotalElided());
+
+	PendingCapture = nullptr;
+	DrawList = nullptr;
+}
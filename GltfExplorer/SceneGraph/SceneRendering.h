@@ -6,6 +6,13 @@
 #include <Render/Buffers.h>
 #include <vector>
 
+#include "FrameAllocator.h"
+#include "RenderSortKey.h"
+#include "RenderStateCache.h"
+#include "SceneTransformBuffer.h"
+
+struct FrameCapture;
+
 enum class MeshVertexBuffers : uint8_t
 {
 	POSITION,
@@ -25,18 +32,35 @@ enum class SceneRenderPass : uint8_t
 	COUNT
 };
 
-enum class RenderPassSorting : uint8_t
-{
-	NONE,
-	BACK_TO_FRONT,
-	FRONT_TO_BACK,
-	COUNT,
-};
-
-static const RenderPassSorting PassSortingMethod[(uint8_t)SceneRenderPass::COUNT] = {
-	RenderPassSorting::NONE,			// SHADOW_PASS
-	RenderPassSorting::FRONT_TO_BACK,	// OPAQUE_PASS
-	RenderPassSorting::BACK_TO_FRONT,	// TRANSLUCENT_PASS
+// Passes occupy the top bits of every key so combined batch lists keep pass order. Opaque passes group by state and then
+// sort front to back within a state, translucent passes must be strictly back to front so depth takes precedence.
+static constexpr uint8_t SortKeyPassBits = 2;
+
+static const SortKeyLayout DefaultPassSortKeyLayouts[(uint8_t)SceneRenderPass::COUNT] = {
+	// SHADOW_PASS
+	SortKeyLayout()
+		.Add(SortKeyField::PASS, SortKeyPassBits)
+		.Add(SortKeyField::PSO, 14)
+		.Add(SortKeyField::MATERIAL, 16)
+		.Add(SortKeyField::VERTEX_BUFFER, 20),
+	// OPAQUE_PASS
+	SortKeyLayout()
+		.Add(SortKeyField::PASS, SortKeyPassBits)
+		.Add(SortKeyField::PSO, 12)
+		.Add(SortKeyField::MATERIAL, 16)
+		.Add(SortKeyField::VERTEX_BUFFER, 14)
+		.Depth(SortKeyDepthOrder::FRONT_TO_BACK, 20),
+	// TRANSLUCENT_PASS
+	SortKeyLayout()
+		.Add(SortKeyField::PASS, SortKeyPassBits)
+		.Depth(SortKeyDepthOrder::BACK_TO_FRONT, 24)
+		.Add(SortKeyField::PSO, 12)
+		.Add(SortKeyField::MATERIAL, 14)
+		.Add(SortKeyField::VERTEX_BUFFER, 12),
+	// SKYBOX_PASS
+	SortKeyLayout()
+		.Add(SortKeyField::PASS, SortKeyPassBits)
+		.Add(SortKeyField::PSO, 14),
 };
 
 extern struct SceneRenderSettings
@@ -52,11 +76,18 @@ struct PassInfo
 	matrix Transform;
 	float3 CameraPosition;
 	tpr::Viewport Viewport;
+
+	// Every command list recording this pass binds these, the caller is expected to have cleared and transitioned them
+	tpr::RenderTargetView_t Rtv = tpr::RenderTargetView_t::INVALID;
+	tpr::DepthStencilView_t Dsv = tpr::DepthStencilView_t::INVALID;
 };
 
 struct RenderInfo
 {
 	PassInfo Pass[(uint8_t)SceneRenderPass::COUNT];
+
+	// Batches index into this by ObjectId, it must have been updated this frame before recording
+	const SceneTransformBuffer* Transforms = nullptr;
 };
 
 //struct SceneDirectionalLight
@@ -78,6 +109,10 @@ struct MeshBuffers
 	uint32_t IndexCount;
 };
 
+// Without bindless the object transforms take vertex slot t0, vertex SRVs here bind from t1
+constexpr uint32_t KObjectTransformSrvSlot = 0u;
+constexpr uint32_t KFirstBatchVertexSrvSlot = KObjectTransformSrvSlot + 1u;
+
 struct ResourceBindings
 {
 	tpr::ShaderResourceView_t* VertexSrvBinds = nullptr;
@@ -89,30 +124,105 @@ struct ResourceBindings
 struct RenderBatch
 {
 	tpr::GraphicsPipelineState_t PSO;
-	tpr::DynamicBuffer_t BatchCBuf;
+	uint32_t ObjectId;
 	tpr::ConstantBuffer_t MaterialCBuf;
 	float ZDepth;
 
 	const MeshBuffers* BufferBindings;
-	const ResourceBindings* ResourceBindings;
+	// Qualified because the member shares the type's name
+	const ::ResourceBindings* ResourceBindings;
 };
 
+// Batches gathered by one thread for one frame. Storage comes from the frame arena so the gathering thread must own it.
 struct Renderables
 {
+	explicit Renderables(FrameArena* arena = nullptr) : Arena(arena) {}
+
 	void AddBatch(SceneRenderPass pass, const RenderBatch& batch);
 
+	// Moves the batches of other onto the end of this without copying them
+	void Append(Renderables& other) noexcept;
+
+	size_t GetBatchCount(SceneRenderPass pass) const noexcept;
+
+	FrameArena& GetArena() const noexcept { return *Arena; }
+
+	// Nodes this thread tested against the view frustum while gathering
+	uint32_t VisibleNodes = 0;
+	uint32_t CulledNodes = 0;
+
 private:
-	std::vector<RenderBatch> PassBatches[(uint8_t)SceneRenderPass::COUNT];
+	FrameArena* Arena = nullptr;
+	FrameList<RenderBatch> PassBatches[(uint8_t)SceneRenderPass::COUNT];
 
 	friend struct SceneRenderer;
 };
 
+struct PassBatchList
+{
+	const RenderBatch** Batches = nullptr;
+	uint32_t* Order = nullptr;
+	uint32_t Count = 0;
+};
+
+// Gathered batches of every pass combined and sorted, everything points into the arena it was prepared in
+struct SceneDrawList
+{
+	PassBatchList Passes[(uint8_t)SceneRenderPass::COUNT];
+};
+
 struct SceneRenderer
 {
 	explicit SceneRenderer();
 
-	void Render(tpr::CommandList* cl, Renderables* renderables, size_t numRenderables, const RenderInfo& info);
+	// Combines and sorts gathered batches. Only reads the sort layouts so it can run on another thread while the previous
+	// frame is recorded, the renderables and arena just have to belong to a different frame.
+	const SceneDrawList* Prepare(FrameArena& arena, const Renderables* renderables, size_t numRenderables) const;
+
+	// Passes are split into contiguous ranges of sorted batches that are recorded in parallel, one command list per range.
+	// Command lists are created from the group in pass and range order so submission order does not depend on threading.
+	// Scratch data comes from the arena, which has to outlive the submission of clGroup
+	void Render(tpr::CommandListSubmissionGroup* clGroup, FrameArena& arena, const SceneDrawList& drawList, const RenderInfo& info);
+
+	// Prepare and Render in one go
+	void Render(tpr::CommandListSubmissionGroup* clGroup, FrameArena& arena, const Renderables* renderables, size_t numRenderables, const RenderInfo& info);
+
+	void SetPassSortKeyLayout(SceneRenderPass pass, const SortKeyLayout& layout);
+
+	// Passes with fewer batches than this are recorded into a single command list
+	void SetMinBatchesPerRecordRange(uint32_t minBatches);
+
+	// The next Render appends one stream per command list it records to capture, the caller finalizes it after that
+	void CaptureNextFrame(FrameCapture* capture) noexcept { PendingCapture = capture; }
+
+	const RenderStateCacheStats& GetLastFrameStats() const noexcept { return LastFrameStats; }
 private:
 
+	struct RecordRange
+	{
+		SceneRenderPass Pass;
+		uint32_t Begin;
+		uint32_t End;
+		tpr::CommandList* Cl;
+	};
+
+	void SortBatches(SceneRenderPass pass, PassBatchList& list, FrameArena& arena) const;
+	void BuildRecordRanges(tpr::CommandListSubmissionGroup* clGroup, FrameArena& arena);
+	void RecordRangeBatches(const RecordRange& range, const PassInfo& pass, const SceneTransformBuffer& transforms, tpr::DynamicBuffer_t viewBuf, RenderStateCache& cache) const;
+
 	tpr::RootSignaturePtr RootSignature;
+
+	SortKeyLayout PassSortKeyLayouts[(uint8_t)SceneRenderPass::COUNT];
+
+	// Point into the frame arena passed to Render and are only valid during that call
+	const SceneDrawList* DrawList = nullptr;
+	RecordRange* RecordRanges = nullptr;
+	uint32_t RecordRangeCount = 0;
+
+	uint32_t MinBatchesPerRecordRange = 2048u;
+	uint32_t MaxRecordRangesPerPass = 1u;
+
+	RenderStateCacheStats LastFrameStats = {};
+
+	FrameCapture* PendingCapture = nullptr;
 };
\ No newline at end of file
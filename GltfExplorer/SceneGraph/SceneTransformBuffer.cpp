@@ -0,0 +1,182 @@
+#include "SceneTransformBuffer.h"
+
+#include "../Profiler/Profiler.h"
+
+#include <Render/Buffers.h>
+#include <Render/Render.h>
+#include <bit>
+#include <cassert>
+
+using namespace tpr;
+
+static constexpr uint32_t MinCapacity = 64u;
+
+static inline bool TestBit(const std::vector<uint64_t>& bits, uint32_t index)
+{
+	return (bits[index >> 6u] >> (index & 63u)) & 1ull;
+}
+
+static inline void SetBit(std::vector<uint64_t>& bits, uint32_t index)
+{
+	bits[index >> 6u] |= 1ull << (index & 63u);
+}
+
+static inline void ClearBit(std::vector<uint64_t>& bits, uint32_t index)
+{
+	bits[index >> 6u] &= ~(1ull << (index & 63u));
+}
+
+uint32_t SceneTransformBuffer::Allocate(const matrix& transform)
+{
+	const uint32_t objectId = (uint32_t)Transforms.size();
+
+	Transforms.push_back({ transform, transform });
+
+	const size_t wordCount = (Transforms.size() + 63u) / 64u;
+	DirtyBits.resize(wordCount);
+	MovedBits.resize(wordCount);
+
+	MarkDirty(objectId);
+
+	return objectId;
+}
+
+void SceneTransformBuffer::SetTransform(uint32_t objectId, const matrix& transform)
+{
+	assert(objectId < Transforms.size());
+
+	ObjectTransform& entry = Transforms[objectId];
+
+	// Only the first move in a frame snapshots the transform the GPU last rendered with
+	if (!TestBit(MovedBits, objectId))
+	{
+		entry.Previous = entry.Current;
+
+		SetBit(MovedBits, objectId);
+		MovedThisUpdate.push_back(objectId);
+	}
+
+	entry.Current = transform;
+
+	MarkDirty(objectId);
+}
+
+void SceneTransformBuffer::MarkDirty(uint32_t objectId)
+{
+	SetBit(DirtyBits, objectId);
+}
+
+void SceneTransformBuffer::Reallocate(uint32_t capacity)
+{
+	Capacity = capacity;
+
+	Buffer = CreateStructuredBuffer(nullptr, (size_t)Capacity * sizeof(ObjectTransform), sizeof(ObjectTransform));
+	Srv = CreateStructuredBufferSRV(Buffer, 0u, Capacity, sizeof(ObjectTransform));
+
+	// The new buffer starts empty so every live entry has to go up again
+	for (uint32_t i = 0; i < (uint32_t)Transforms.size(); i++)
+	{
+		MarkDirty(i);
+	}
+}
+
+void SceneTransformBuffer::Update()
+{
+	PROFILE_ZONE("Transforms");
+
+	LastUpdateStats = {};
+
+	// Objects that moved last frame but not this one still carry a stale Previous
+	for (const uint32_t objectId : MovedLastUpdate)
+	{
+		if (TestBit(MovedBits, objectId))
+			continue;
+
+		Transforms[objectId].Previous = Transforms[objectId].Current;
+		MarkDirty(objectId);
+	}
+
+	for (const uint32_t objectId : MovedThisUpdate)
+	{
+		ClearBit(MovedBits, objectId);
+	}
+
+	std::swap(MovedLastUpdate, MovedThisUpdate);
+	MovedThisUpdate.clear();
+
+	const uint32_t objectCount = (uint32_t)Transforms.size();
+
+	if (objectCount > Capacity)
+	{
+		Reallocate(Max(std::bit_ceil(objectCount), MinCapacity));
+	}
+
+	if (!Render_IsBindless())
+	{
+		for (uint32_t i = (uint32_t)ObjectIdBuffers.size(); i < objectCount; i++)
+		{
+			const uint32_t idData[4] = { i, 0u, 0u, 0u };
+			ObjectIdBuffers.push_back(CreateConstantBuffer(idData, sizeof(idData)));
+		}
+	}
+
+	UploadDirtyRanges();
+
+	PROFILE_COUNTER("Transform Upload Bytes", LastUpdateStats.UploadedBytes);
+}
+
+void SceneTransformBuffer::UploadDirtyRanges()
+{
+	const uint32_t objectCount = (uint32_t)Transforms.size();
+
+	uint32_t rangeBegin = 0;
+	uint32_t rangeEnd = 0;
+	bool rangeOpen = false;
+
+	auto FlushRange = [&]()
+	{
+		const uint32_t count = rangeEnd - rangeBegin;
+		const size_t bytes = (size_t)count * sizeof(ObjectTransform);
+
+		UpdateStructuredBuffer(Buffer, &Transforms[rangeBegin], bytes, (size_t)rangeBegin * sizeof(ObjectTransform));
+
+		LastUpdateStats.UploadedObjects += count;
+		LastUpdateStats.UploadedRanges++;
+		LastUpdateStats.UploadedBytes += bytes;
+	};
+
+	for (uint32_t word = 0; word < (uint32_t)DirtyBits.size(); word++)
+	{
+		uint64_t bits = DirtyBits[word];
+		DirtyBits[word] = 0;
+
+		while (bits != 0)
+		{
+			const uint32_t index = word * 64u + (uint32_t)std::countr_zero(bits);
+			bits &= bits - 1ull;
+
+			if (index >= objectCount)
+				break;
+
+			if (rangeOpen && index - rangeEnd < MergeGap)
+			{
+				rangeEnd = index + 1u;
+				continue;
+			}
+
+			if (rangeOpen)
+			{
+				FlushRange();
+			}
+
+			rangeBegin = index;
+			rangeEnd = index + 1u;
+			rangeOpen = true;
+		}
+	}
+
+	if (rangeOpen)
+	{
+		FlushRange();
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Render/RenderTypes.h>
+#include <SurfMath.h>
+
+#include <cstdint>
+#include <vector>
+
+// GPU layout of a single entry, matches ObjectTransform in Shaders/ObjectData.h
+struct ObjectTransform
+{
+	matrix Current;
+	matrix Previous;
+};
+
+struct SceneTransformUpdateStats
+{
+	uint32_t UploadedObjects = 0;
+	uint32_t UploadedRanges = 0;
+	uint64_t UploadedBytes = 0;
+};
+
+// Scene wide structured buffer of object transforms that lives on the GPU between frames. Draws index into it by object id
+// so nothing is allocated per draw, and Update only uploads the entries that changed since the last call.
+// An object that moves keeps its old transform as Previous for the frame it moved, the frame after that Previous catches up.
+struct SceneTransformBuffer
+{
+	// Groups of dirty entries separated by fewer clean entries than this are uploaded as one range
+	static constexpr uint32_t MergeGap = 8u;
+
+	uint32_t Allocate(const matrix& transform);
+
+	void SetTransform(uint32_t objectId, const matrix& transform);
+	const matrix& GetTransform(uint32_t objectId) const { return Transforms[objectId].Current; }
+
+	uint32_t GetObjectCount() const noexcept { return (uint32_t)Transforms.size(); }
+
+	// Call once per frame before UploadBuffers so the queued copies land ahead of any draw
+	void Update();
+
+	tpr::ShaderResourceView_t GetSrv() const noexcept { return Srv; }
+
+	// Non bindless rendering can not use root constants so each object owns a constant buffer holding its id
+	tpr::ConstantBuffer_t GetObjectIdBuffer(uint32_t objectId) const { return ObjectIdBuffers[objectId]; }
+
+	const SceneTransformUpdateStats& GetLastUpdateStats() const noexcept { return LastUpdateStats; }
+
+private:
+
+	void MarkDirty(uint32_t objectId);
+	void Reallocate(uint32_t capacity);
+	void UploadDirtyRanges();
+
+	std::vector<ObjectTransform> Transforms;
+
+	// One bit per object
+	std::vector<uint64_t> DirtyBits;
+	std::vector<uint64_t> MovedBits;
+
+	std::vector<uint32_t> MovedThisUpdate;
+	std::vector<uint32_t> MovedLastUpdate;
+
+	tpr::StructuredBufferPtr Buffer;
+	tpr::ShaderResourceViewPtr Srv;
+	uint32_t Capacity = 0;
+
+	std::vector<tpr::ConstantBufferPtr> ObjectIdBuffers;
+
+	SceneTransformUpdateStats LastUpdateStats = {};
+};
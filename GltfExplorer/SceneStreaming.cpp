@@ -0,0 +1,184 @@
+#include "SceneStreaming.h"
+
+#include "Profiler/Profiler.h"
+#include "Scene.h"
+#include "TextureLoader.h"
+
+#include <Render/Render.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+SceneStreamingView SceneStreaming_MakeView(const matrix& projection, uint32_t viewportHeight, const float3& cameraPosition)
+{
+    SceneStreamingView view;
+    view.CameraPosition = cameraPosition;
+
+    // The Y scale of a perspective projection is 1 / tan(fovY / 2), half the viewport spans that at unit distance
+    view.ProjectionScale = projection.r[1].y * 0.5f * (float)viewportHeight;
+
+    return view;
+}
+
+static float GetNodeScale(const matrix& transform)
+{
+    // Geometric mean of the basis lengths, how a surface area scales under mild non uniform scale
+    const float x = LengthF3(float3{ transform.r[0].x, transform.r[0].y, transform.r[0].z });
+    const float y = LengthF3(float3{ transform.r[1].x, transform.r[1].y, transform.r[1].z });
+    const float z = LengthF3(float3{ transform.r[2].x, transform.r[2].y, transform.r[2].z });
+
+    return cbrtf(x * y * z);
+}
+
+static float GetDistanceToBounds(const AABB& bounds, const float3& position)
+{
+    AABB copy = bounds;
+    if (copy.Invalid())
+    {
+        return 0.0f;
+    }
+
+    const float3 closest = MaxF3(bounds.mins, MinF3(position, bounds.maxs));
+    return LengthF3(position - closest);
+}
+
+void SceneStreaming_RequestMesh(const SScene& scene, const SNode& node, const SMesh& mesh, const SceneStreamingView& view, float* mips)
+{
+    if (!scene.Streaming || mesh.Material == SceneMaterial_t::INVALID)
+    {
+        return;
+    }
+
+    const SceneTextureStreaming& streaming = *scene.Streaming;
+    const SMaterial& material = scene.Materials[(uint32_t)mesh.Material];
+
+    const uint32_t uvIndices[kMaterialTextureCount] = {
+        material.Constants.BaseColorUVIndex,
+        material.Constants.NormalUVIndex,
+        material.Constants.MetallicRoughnessUVIndex,
+        material.Constants.EmissiveUVIndex,
+    };
+
+    // Texels per pixel is density * resolution * distance / (scale * projection), only the resolution varies per texture
+    const float scale = GetNodeScale(node.Transform);
+    const float distance = GetDistanceToBounds(node.WorldBounds, view.CameraPosition);
+    const float viewFactor = distance / std::max(scale * view.ProjectionScale, FLT_MIN);
+
+    for (uint32_t t = 0; t < kMaterialTextureCount; t++)
+    {
+        const uint32_t image = material.TextureImages[t];
+        if (image >= streaming.StreamedTextures.size() || streaming.StreamedTextures[image] == ~0u)
+            continue;
+
+        const float density = mesh.UvDensity[std::min(uvIndices[t], 1u)];
+        if (density <= 0.0f)
+            continue;
+
+        const float texelsPerPixel = density * streaming.Resolutions[streaming.StreamedTextures[image]] * viewFactor;
+        mips[image] = std::min(mips[image], log2f(std::max(texelsPerPixel, FLT_MIN)));
+    }
+}
+
+void SceneStreaming_RequestNodes(const SScene& scene, const SceneStreamingView& view, const matrix& viewProjection, float* mips)
+{
+    if (!scene.Streaming)
+    {
+        return;
+    }
+
+    PROFILE_ZONE("Texture Streaming Requests");
+
+    const FrustumPlanes frustum(viewProjection);
+
+    for (const SNode& node : scene.Nodes)
+    {
+        if (node.Model == SceneModel_t::INVALID)
+            continue;
+
+        AABB bounds = node.WorldBounds;
+        if (!bounds.Invalid() && !frustum.Intersects(bounds))
+            continue;
+
+        for (const SMesh& mesh : scene.Models[(uint32_t)node.Model].Meshes)
+        {
+            SceneStreaming_RequestMesh(scene, node, mesh, view, mips);
+        }
+    }
+}
+
+void SceneStreaming_Update(SScene& scene, const float* mips)
+{
+    if (!scene.Streaming)
+    {
+        return;
+    }
+
+    PROFILE_ZONE("Texture Streaming");
+
+    SceneTextureStreaming& streaming = *scene.Streaming;
+
+    streaming.RetiredIndex = (streaming.RetiredIndex + 1u) % (uint32_t)streaming.Retired.size();
+
+    SceneStreamingRetired& retired = streaming.Retired[streaming.RetiredIndex];
+    retired.Clear();
+
+    for (size_t image = 0; image < streaming.StreamedTextures.size(); image++)
+    {
+        if (streaming.StreamedTextures[image] != ~0u && mips[image] < FLT_MAX)
+        {
+            streaming.Streamer.Request(streaming.StreamedTextures[image], mips[image]);
+        }
+    }
+
+    streaming.Changes.clear();
+    streaming.Streamer.Update(streaming.Changes);
+
+    if (streaming.Changes.empty())
+    {
+        return;
+    }
+
+    streaming.DirtyMaterials.assign(scene.Materials.size(), 0u);
+
+    for (const TextureResidencyChange& change : streaming.Changes)
+    {
+        const uint32_t image = streaming.Images[change.Texture];
+        STexture& texture = scene.Textures[image];
+
+        retired.Textures.push_back(std::move(texture.Texture));
+        retired.Srvs.push_back(std::move(texture.Srv));
+
+        TextureLoadInfo info;
+        texture.Texture = CreateTextureFromMips(streaming.Sources[change.Texture], &info, change.FirstMip);
+        texture.Srv = tpr::CreateTextureSRV(texture.Texture, info.Format, info.Dimension, info.MipCount, info.ArraySize);
+
+        for (size_t m = 0; m < scene.Materials.size(); m++)
+        {
+            SMaterial& material = scene.Materials[m];
+
+            for (uint32_t t = 0; t < kMaterialTextureCount; t++)
+            {
+                if (material.TextureImages[t] == image)
+                {
+                    material.Srvs[t] = texture.Srv;
+                    streaming.DirtyMaterials[m] = 1u;
+                }
+            }
+        }
+    }
+
+    // Bindless shaders find textures through the material constants, those have no update path so are recreated
+    for (size_t m = 0; m < scene.Materials.size(); m++)
+    {
+        if (streaming.DirtyMaterials[m])
+        {
+            SMaterial& material = scene.Materials[m];
+
+            SetMaterialTextureIndices(material);
+
+            retired.Buffers.push_back(std::move(material.ConstantBuffer));
+            material.ConstantBuffer = tpr::CreateConstantBuffer(&material.Constants, sizeof(material.Constants));
+        }
+    }
+}
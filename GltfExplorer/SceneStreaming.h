@@ -0,0 +1,78 @@
+#pragma once
+
+#include "SceneGraph/FrameAllocator.h"
+#include "Textures/TextureMips.h"
+#include "Textures/TextureStreaming.h"
+
+#include <Render/RenderTypes.h>
+#include <SurfMath.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+struct SScene;
+struct SNode;
+struct SMesh;
+
+// Resources replaced by one update
+struct SceneStreamingRetired
+{
+    std::vector<tpr::TexturePtr> Textures;
+    std::vector<tpr::ShaderResourceViewPtr> Srvs;
+    std::vector<tpr::ConstantBufferPtr> Buffers;
+
+    void Clear()
+    {
+        Textures.clear();
+        Srvs.clear();
+        Buffers.clear();
+    }
+};
+
+// Device residency of a scene's images when it is loaded with streaming. Images keep every level in system memory and
+// only the levels the streamer picks are uploaded. A change recreates the texture from its new top level and repoints
+// the materials sampling it.
+struct SceneTextureStreaming
+{
+    TextureStreamer Streamer;
+
+    // Indexed by streamer texture, sources are empty for textures that are always fully resident
+    std::vector<TextureMipChain> Sources;
+    std::vector<uint32_t> Images;
+
+    // Root of the texel count of level 0, indexed by streamer texture
+    std::vector<float> Resolutions;
+
+    // Streamer texture of each scene image, ~0u when it is not streamed
+    std::vector<uint32_t> StreamedTextures;
+
+    // Replaced resources are held until their slot comes round again, by then every frame recorded with them has
+    // finished on the GPU
+    std::array<SceneStreamingRetired, FrameAllocator::FramesInFlight> Retired;
+    uint32_t RetiredIndex = 0u;
+
+    std::vector<TextureResidencyChange> Changes;
+    std::vector<uint8_t> DirtyMaterials;
+};
+
+struct SceneStreamingView
+{
+    float3 CameraPosition = {};
+
+    // Pixels one unit covers at a distance of one unit
+    float ProjectionScale = 1.0f;
+};
+
+SceneStreamingView SceneStreaming_MakeView(const matrix& projection, uint32_t viewportHeight, const float3& cameraPosition);
+
+// Lowers `mips`, one per scene image and FLT_MAX when nothing wants it, to the most detailed level the mesh's textures
+// need at the node's distance. Texels per pixel come from the mesh's UV density, the node's scale and the projection.
+void SceneStreaming_RequestMesh(const SScene& scene, const SNode& node, const SMesh& mesh, const SceneStreamingView& view, float* mips);
+
+// Requests for every node inside the frustum, for callers without a draw list of their own
+void SceneStreaming_RequestNodes(const SScene& scene, const SceneStreamingView& view, const matrix& viewProjection, float* mips);
+
+// Feeds the requests to the streamer and applies its changes. Call once a frame from the thread that records draws,
+// while nothing else reads the scene's textures or material buffers.
+void SceneStreaming_Update(SScene& scene, const float* mips);
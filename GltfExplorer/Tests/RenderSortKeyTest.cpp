@@ -0,0 +1,229 @@
+// Checks batch sort keys: SortKey_RadixSort must order keys and their indices exactly as a stable std::sort does, depth
+// must quantize monotonically over the whole field, values too wide for their field must stay in order, and remapped
+// handles must come out dense. Seeded so every run sees the same keys, the exit code is non zero when a check fails.
+
+#include "../SceneGraph/RenderSortKey.h"
+
+#include "../Logging.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <tuple>
+#include <vector>
+
+static uint32_t GFailures = 0u;
+
+#define TEST_CHECK(x) do { if (!(x)) { LOGERROR("%s(%d) : check failed, %s", __FILE__, __LINE__, #x); GFailures++; } } while (0)
+
+// Sorts a copy both ways and compares keys and indices, equal keys must keep their original order
+static bool RadixMatchesReference(const std::vector<uint64_t>& input)
+{
+	const size_t count = input.size();
+
+	std::vector<uint64_t> keys = input;
+	std::vector<uint32_t> indices(count);
+	std::vector<uint64_t> scratchKeys(count);
+	std::vector<uint32_t> scratchIndices(count);
+
+	for (uint32_t i = 0; i < (uint32_t)count; i++)
+		indices[i] = i;
+
+	SortKey_RadixSort(keys.data(), indices.data(), scratchKeys.data(), scratchIndices.data(), count);
+
+	std::vector<uint32_t> reference(count);
+	for (uint32_t i = 0; i < (uint32_t)count; i++)
+		reference[i] = i;
+
+	std::stable_sort(reference.begin(), reference.end(), [&](uint32_t a, uint32_t b) { return input[a] < input[b]; });
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (indices[i] != reference[i] || keys[i] != input[reference[i]])
+			return false;
+	}
+
+	return true;
+}
+
+static void TestRadixSort()
+{
+	std::mt19937_64 rng(1);
+
+	TEST_CHECK(RadixMatchesReference({}));
+	TEST_CHECK(RadixMatchesReference({ 42u }));
+
+	for (const size_t count : { 2u, 3u, 255u, 256u, 257u, 4096u, 100000u })
+	{
+		std::vector<uint64_t> keys(count);
+
+		// Full width keys
+		for (uint64_t& key : keys)
+			key = rng();
+		TEST_CHECK(RadixMatchesReference(keys));
+
+		// Every key equal, each pass is skipped
+		std::fill(keys.begin(), keys.end(), 0x0123456789abcdefull);
+		TEST_CHECK(RadixMatchesReference(keys));
+
+		// Keys that only differ in the top and bottom byte, with plenty of duplicates
+		for (uint64_t& key : keys)
+			key = (rng() & 0xff00000000000000ull) | 0x00ffff0000ffff00ull | (rng() & 0x3u);
+		TEST_CHECK(RadixMatchesReference(keys));
+
+		// Already sorted and reversed
+		for (size_t i = 0; i < count; i++)
+			keys[i] = i << 20u;
+		TEST_CHECK(RadixMatchesReference(keys));
+		std::reverse(keys.begin(), keys.end());
+		TEST_CHECK(RadixMatchesReference(keys));
+	}
+}
+
+// Keys packed from every field of a layout sort by the fields in layout order
+static void TestPackedKeys()
+{
+	const SortKeyLayout layout = SortKeyLayout()
+		.Add(SortKeyField::PASS, 2)
+		.Add(SortKeyField::PSO, 6)
+		.Add(SortKeyField::MATERIAL, 8)
+		.Depth(SortKeyDepthOrder::FRONT_TO_BACK, 20)
+		.Add(SortKeyField::VERTEX_BUFFER, 12);
+
+	std::mt19937 rng(2);
+
+	std::vector<SortKeyValues> values(20000);
+	std::vector<uint64_t> keys(values.size());
+
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		SortKeyValues& v = values[i];
+		v.Pass = rng() % 4u;
+		v.Pso = rng() % 64u;
+		v.Material = rng() % 256u;
+		v.VertexBuffer = rng() % 4096u;
+		v.Depth = (float)(rng() % 1000u) * 0.25f;
+		v.DepthMin = 0.0f;
+		v.DepthMax = 250.0f;
+		keys[i] = SortKey_Pack(layout, v);
+	}
+
+	TEST_CHECK(RadixMatchesReference(keys));
+
+	std::vector<uint32_t> order(values.size());
+	for (uint32_t i = 0; i < (uint32_t)order.size(); i++)
+		order[i] = i;
+
+	std::vector<uint64_t> scratchKeys(keys.size());
+	std::vector<uint32_t> scratchIndices(keys.size());
+	SortKey_RadixSort(keys.data(), order.data(), scratchKeys.data(), scratchIndices.data(), keys.size());
+
+	auto FieldOrder = [](const SortKeyValues& v)
+	{
+		return std::make_tuple(v.Pass, v.Pso, v.Material, v.Depth, v.VertexBuffer);
+	};
+
+	bool ordered = true;
+	for (size_t i = 1; i < order.size(); i++)
+		ordered &= !(FieldOrder(values[order[i]]) < FieldOrder(values[order[i - 1]]));
+
+	TEST_CHECK(ordered);
+}
+
+static void TestDepth()
+{
+	for (const uint8_t bits : { (uint8_t)1, (uint8_t)8, (uint8_t)20, (uint8_t)24, (uint8_t)32 })
+	{
+		const uint32_t mask = bits >= 32 ? ~0u : (1u << bits) - 1u;
+
+		// The nearest and farthest depths reach both ends of the field
+		TEST_CHECK(SortKey_QuantizeDepth(0.5f, 0.5f, 900.0f, bits, SortKeyDepthOrder::FRONT_TO_BACK) == 0u);
+		TEST_CHECK(SortKey_QuantizeDepth(900.0f, 0.5f, 900.0f, bits, SortKeyDepthOrder::FRONT_TO_BACK) == mask);
+		TEST_CHECK(SortKey_QuantizeDepth(0.5f, 0.5f, 900.0f, bits, SortKeyDepthOrder::BACK_TO_FRONT) == mask);
+		TEST_CHECK(SortKey_QuantizeDepth(900.0f, 0.5f, 900.0f, bits, SortKeyDepthOrder::BACK_TO_FRONT) == 0u);
+
+		// Outside the range, NaN and an empty range clamp
+		TEST_CHECK(SortKey_QuantizeDepth(-5.0f, 0.5f, 900.0f, bits, SortKeyDepthOrder::FRONT_TO_BACK) == 0u);
+		TEST_CHECK(SortKey_QuantizeDepth(1e30f, 0.5f, 900.0f, bits, SortKeyDepthOrder::FRONT_TO_BACK) == mask);
+		TEST_CHECK(SortKey_QuantizeDepth(NAN, 0.5f, 900.0f, bits, SortKeyDepthOrder::FRONT_TO_BACK) == 0u);
+		TEST_CHECK(SortKey_QuantizeDepth(3.0f, 3.0f, 3.0f, bits, SortKeyDepthOrder::FRONT_TO_BACK) == 0u);
+
+		uint32_t last = 0u;
+		bool monotonic = true;
+		for (uint32_t i = 0; i <= 10000u; i++)
+		{
+			const uint32_t quantized = SortKey_QuantizeDepth(0.5f + (float)i * 0.08995f, 0.5f, 900.0f, bits, SortKeyDepthOrder::FRONT_TO_BACK);
+			monotonic &= quantized >= last;
+			last = quantized;
+		}
+		TEST_CHECK(monotonic);
+	}
+
+	// A 20 bit field tells apart depths a thousandth of the range apart
+	TEST_CHECK(SortKey_QuantizeDepth(450.0f, 0.0f, 1000.0f, 20, SortKeyDepthOrder::FRONT_TO_BACK)
+		< SortKey_QuantizeDepth(451.0f, 0.0f, 1000.0f, 20, SortKeyDepthOrder::FRONT_TO_BACK));
+}
+
+static void TestFieldRanges()
+{
+	const SortKeyLayout layout = SortKeyLayout()
+		.Add(SortKeyField::PASS, 2)
+		.Add(SortKeyField::PSO, 4)
+		.Add(SortKeyField::MATERIAL, 4);
+
+	SortKeyValues small;
+	small.Pass = 1u;
+	small.Pso = 14u;
+	small.Material = 3u;
+
+	// Too wide for its field, lands in the top bucket rather than wrapping below smaller values or into the pass bits
+	SortKeyValues wide = small;
+	wide.Pso = 0x10005u;
+
+	const uint64_t smallKey = SortKey_Pack(layout, small);
+	const uint64_t wideKey = SortKey_Pack(layout, wide);
+
+	TEST_CHECK(wideKey > smallKey);
+	TEST_CHECK(wideKey >> 62u == 1u);
+	TEST_CHECK(((wideKey >> 58u) & 0xfu) == 0xfu);
+	TEST_CHECK(((wideKey >> 54u) & 0xfu) == 3u);
+
+	// Sparse 64 bit handles come out dense in order of first use
+	std::vector<uint64_t> handles(64);
+	std::vector<uint32_t> indices(64);
+
+	SortKeyRemap remap;
+	remap.Reset(handles.data(), indices.data(), 64u);
+
+	const uint64_t sparse[] = { 0xdead000000000001ull, 7u, 0xdead000000000001ull, 0u, 1ull << 40u, 7u, 0u };
+	const uint32_t dense[] = { 0u, 1u, 0u, 2u, 3u, 1u, 2u };
+
+	bool matches = true;
+	for (size_t i = 0; i < std::size(sparse); i++)
+		matches &= remap.Map(sparse[i]) == dense[i];
+
+	TEST_CHECK(matches);
+	TEST_CHECK(remap.GetCount() == 4u);
+
+	remap.Reset(handles.data(), indices.data(), 64u);
+	TEST_CHECK(remap.Map(1ull << 40u) == 0u);
+}
+
+int main()
+{
+	TestRadixSort();
+	TestPackedKeys();
+	TestDepth();
+	TestFieldRanges();
+
+	if (GFailures)
+	{
+		LOGERROR("RenderSortKeyTest : %u checks failed", GFailures);
+		return 1;
+	}
+
+	LOGINFO("RenderSortKeyTest : passed");
+	return 0;
+}
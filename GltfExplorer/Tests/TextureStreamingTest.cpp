@@ -0,0 +1,181 @@
+// Runs the TextureStreamer policy against fixed request patterns and checks what it decides: the budget is never
+// exceeded, the largest shortfall streams in first, and a texture that cannot fit is starved rather than taking detail
+// another texture still asks for, until that detail stops being wanted. Nothing here touches the render API, the exit
+// code is non zero when a check fails.
+
+#include "../Textures/TextureMips.h"
+#include "../Textures/TextureStreaming.h"
+
+#include "../Logging.h"
+
+#include <cstdint>
+#include <vector>
+
+static uint32_t GFailures = 0u;
+
+#define TEST_CHECK(x) do { if (!(x)) { LOGERROR("%s(%d) : check failed, %s", __FILE__, __LINE__, #x); GFailures++; } } while (0)
+
+static constexpr uint32_t KSize = 256u;
+static constexpr uint32_t KMipCount = 9u;
+static constexpr tpr::RenderFormat KFormat = tpr::RenderFormat::R8G8B8A8_UNORM;
+
+static uint64_t MipBytes(uint32_t mip)
+{
+	return TextureMips_GetLevelSize(KFormat, KSize >> mip, KSize >> mip);
+}
+
+static uint64_t TailBytes(uint32_t tailMip)
+{
+	uint64_t bytes = 0u;
+	for (uint32_t mip = tailMip; mip < KMipCount; mip++)
+		bytes += MipBytes(mip);
+	return bytes;
+}
+
+static void AddTextures(TextureStreamer& streamer, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++)
+		streamer.AddTexture(KSize, KSize, KMipCount, KFormat);
+}
+
+// Every texture wants all of its detail and only part of it fits
+static void TestBudget()
+{
+	constexpr uint32_t textureCount = 8u;
+
+	TextureStreamingParams params;
+	params.BudgetBytes = textureCount * TailBytes(2u) + 3u * MipBytes(1u) + MipBytes(0u);
+	params.MaxStreamInBytesPerUpdate = MipBytes(0u);
+
+	TextureStreamer streamer;
+	streamer.SetParams(params);
+	AddTextures(streamer, textureCount);
+
+	TEST_CHECK(streamer.GetTailMip(0) == 2u);
+
+	std::vector<TextureResidencyChange> changes;
+
+	for (uint32_t update = 0; update < 32u; update++)
+	{
+		for (uint32_t i = 0; i < textureCount; i++)
+			streamer.Request(i, 0.0f);
+
+		changes.clear();
+		streamer.Update(changes);
+
+		uint64_t resident = 0u;
+		for (uint32_t i = 0; i < textureCount; i++)
+			resident += TailBytes(streamer.GetResidentMip(i));
+
+		TEST_CHECK(resident == streamer.GetStats().ResidentBytes);
+		TEST_CHECK(streamer.GetStats().ResidentBytes <= params.BudgetBytes);
+	}
+
+	const TextureStreamingStats& stats = streamer.GetStats();
+	TEST_CHECK(stats.PeakResidentBytes <= params.BudgetBytes);
+	TEST_CHECK(stats.RequestedBytes == textureCount * TailBytes(0u));
+	TEST_CHECK(stats.RequestedTextures == textureCount);
+	TEST_CHECK(stats.StarvedTextures > 0u);
+	TEST_CHECK(stats.EvictedMips == 0u);
+}
+
+// With room for one level per update the texture furthest from what it asked for goes first, one level at a time
+static void TestPriority()
+{
+	TextureStreamingParams params;
+	params.MaxStreamInBytesPerUpdate = 1u;
+
+	TextureStreamer streamer;
+	streamer.SetParams(params);
+	AddTextures(streamer, 3u);
+
+	std::vector<TextureResidencyChange> changes;
+
+	streamer.Request(0, 0.0f);
+	streamer.Request(1, 1.0f);
+	streamer.Update(changes);
+
+	TEST_CHECK(changes.size() == 1u);
+	TEST_CHECK(changes.size() == 1u && changes[0].Texture == 0u && changes[0].FirstMip == 1u);
+
+	for (uint32_t update = 0; update < 2u; update++)
+	{
+		streamer.Request(0, 0.0f);
+		streamer.Request(1, 1.0f);
+		streamer.Update(changes);
+	}
+
+	TEST_CHECK(changes.size() == 3u);
+	TEST_CHECK(streamer.GetResidentMip(0) == 0u);
+	TEST_CHECK(streamer.GetResidentMip(1) == 1u);
+	TEST_CHECK(streamer.GetResidentMip(2) == 2u);
+	TEST_CHECK(streamer.GetStats().StreamedInMips == 3u);
+
+	// Requests only count for the update that follows them
+	changes.clear();
+	streamer.Request(0, 0.0f);
+	streamer.Request(1, 1.0f);
+	streamer.Update(changes);
+	TEST_CHECK(changes.empty());
+}
+
+// Two textures want the one level that fits. The loser is starved for as long as the winner keeps asking, then takes
+// the winner's level once it stops.
+static void TestStarvation()
+{
+	TextureStreamingParams params;
+	params.BudgetBytes = 2u * TailBytes(2u) + MipBytes(1u);
+
+	TextureStreamer streamer;
+	streamer.SetParams(params);
+	AddTextures(streamer, 2u);
+
+	std::vector<TextureResidencyChange> changes;
+
+	for (uint32_t update = 0; update < 4u; update++)
+	{
+		changes.clear();
+		streamer.Request(0, 1.0f);
+		streamer.Request(1, 1.0f);
+		streamer.Update(changes);
+
+		TEST_CHECK(changes.size() == (update == 0u ? 1u : 0u));
+		TEST_CHECK(streamer.GetStats().StarvedTextures == 1u);
+		TEST_CHECK(streamer.GetStats().ResidentBytes <= params.BudgetBytes);
+	}
+
+	const uint32_t winner = streamer.GetResidentMip(0) == 1u ? 0u : 1u;
+	const uint32_t loser = 1u - winner;
+
+	TEST_CHECK(streamer.GetResidentMip(winner) == 1u);
+	TEST_CHECK(streamer.GetResidentMip(loser) == 2u);
+	TEST_CHECK(streamer.GetStats().EvictedMips == 0u);
+
+	changes.clear();
+	streamer.Request(loser, 1.0f);
+	streamer.Update(changes);
+
+	TEST_CHECK(changes.size() == 2u);
+	TEST_CHECK(streamer.GetStats().StarvedTextures == 0u);
+	TEST_CHECK(streamer.GetResidentMip(winner) == 2u);
+	TEST_CHECK(streamer.GetResidentMip(loser) == 1u);
+	TEST_CHECK(streamer.GetStats().EvictedMips == 1u);
+	TEST_CHECK(streamer.GetStats().ResidentBytes <= params.BudgetBytes);
+	TEST_CHECK(streamer.GetStats().PeakResidentBytes <= params.BudgetBytes);
+}
+
+int main()
+{
+	TestBudget();
+	TestPriority();
+	TestStarvation();
+
+	if (GFailures)
+	{
+		LOGERROR("TextureStreamingTest : %u checks failed", GFailures);
+		return 1;
+	}
+
+	LOGINFO("TextureStreamingTest : passed");
+	return 0;
+}
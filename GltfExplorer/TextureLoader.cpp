@@ -1,10 +1,19 @@
 #include "TextureLoader.h"
 
+#include "GltfLoader.h"
 #include "Logging.h"
+#include "Profiler/Profiler.h"
+#include "Textures/TextureCache.h"
+#include "Textures/TextureKtx2.h"
+#include "Textures/TextureMips.h"
 
+#include <OpenFile.h>
 #include <Render/Textures.h>
+#include <algorithm>
 #include <thread>
+#include <vector>
 #include <stdio.h>
+#include <string.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
@@ -13,10 +22,7 @@ struct FileHandle
 {
     explicit FileHandle(const char* pFileName)
     {
-        if (!(fopen_s(&pFile, pFileName, "rb") == 0))
-        {
-            pFile = nullptr;
-        }
+        pFile = OpenFile(pFileName, "rb");
     }
 
     size_t GetSize() const
@@ -43,12 +49,15 @@ struct FileHandle
 
     void ReadIntoMem(void* pMem, size_t memSize)
     {
-        fread_s(pMem, memSize, sizeof(unsigned char), memSize, pFile);
+        fread(pMem, sizeof(unsigned char), memSize, pFile);
     }
 
     ~FileHandle()
     {
-        fclose(pFile);
+        if (pFile)
+        {
+            fclose(pFile);
+        }
     }
 
     FILE* pFile = nullptr;
@@ -91,58 +100,564 @@ tpr::TexturePtr LoadTextureFromFile(const char* const pFileName)
     return {};
 }
 
-tpr::TexturePtr LoadHdrTextureFromFile(const char* const pFileName)
+tpr::TexturePtr LoadHdrTextureFromFile(const char* const pFileName, const HdrLoadParams& params, TextureLoadInfo* pInfo)
 {
     size_t size;
     std::unique_ptr<uint8_t[]> pBinary = LoadBinaryFile(pFileName, size);
 
     if (pBinary)
     {
-        return LoadHdrTextureFromBinary(pBinary.get(), size);
+        return LoadHdrTextureFromBinary(pBinary.get(), size, params, pInfo);
     }
 
     return {};
 }
 
-tpr::TexturePtr LoadTextureFromBinary(const void* pData, size_t size)
+static struct
 {
-    int x, y, comp;
-    stbi_uc* loadedTex = stbi_load_from_memory((stbi_uc*)pData, (int)size, &x, &y, &comp, 4);
+    TextureCompressionPreset Compression = TextureCompressionPreset::NONE;
+} G;
 
-    if (loadedTex == nullptr)
+tpr::TexturePtr CreateTextureFromMips(const TextureMipChain& chain, TextureLoadInfo* pInfo, uint32_t firstMip)
+{
+    firstMip = std::min(firstMip, chain.MipCount - 1u);
+
+    tpr::TextureCreateDesc texDesc = {};
+    texDesc.Width = chain.GetMipWidth(firstMip);
+    texDesc.Height = chain.GetMipHeight(firstMip);
+    texDesc.MipCount = chain.MipCount - firstMip;
+    texDesc.ArraySize = chain.ArraySize;
+    texDesc.Format = chain.Format;
+    texDesc.Flags = tpr::RenderResourceFlags::SRV;
+    texDesc.Dimension = chain.ArraySize == 6u ? tpr::TextureDimension::TEXCUBE : tpr::TextureDimension::TEX2D;
+
+    // One entry per subresource, slice major like the chain
+    std::vector<tpr::MipData> mips;
+    mips.reserve((size_t)texDesc.MipCount * chain.ArraySize);
+    for (uint32_t slice = 0; slice < chain.ArraySize; slice++)
+    {
+        for (uint32_t mip = firstMip; mip < chain.MipCount; mip++)
+        {
+            mips.emplace_back(chain.GetMip(mip, slice), texDesc.Format, chain.GetMipWidth(mip), chain.GetMipHeight(mip));
+        }
+    }
+
+    texDesc.Data = mips.data();
+
+    if (pInfo)
+    {
+        pInfo->MipCount = texDesc.MipCount;
+        pInfo->ArraySize = chain.ArraySize;
+        pInfo->Format = chain.Format;
+        pInfo->Dimension = texDesc.Dimension;
+    }
+
+    return tpr::CreateTexture(texDesc);
+}
+
+// Source channels the shader reads as R and G for data images. Gltf keeps roughness in G and metallic in B, they move to
+// R and G so a two channel format can hold them. Grey images repeat their only channel.
+static void GetDataChannels(TextureUsage usage, int sourceChannels, uint32_t channels[2])
+{
+    if (sourceChannels < 3)
+    {
+        channels[0] = 0u;
+        channels[1] = 0u;
+    }
+    else if (usage == TextureUsage::METALLIC_ROUGHNESS)
+    {
+        channels[0] = 1u;
+        channels[1] = 2u;
+    }
+    else
+    {
+        channels[0] = 0u;
+        channels[1] = 1u;
+    }
+}
+
+// Two channel data images straight from the decoder's native layout, no expansion to RGBA on the way
+template<typename T>
+static void ExtractDataChannels(const T* pSource, int sourceChannels, size_t texelCount, TextureUsage usage, T* pDest)
+{
+    uint32_t channels[2];
+    GetDataChannels(usage, sourceChannels, channels);
+
+    for (size_t i = 0; i < texelCount; i++)
+    {
+        const T* pTexel = pSource + i * sourceChannels;
+        pDest[i * 2u] = pTexel[channels[0]];
+        pDest[i * 2u + 1u] = pTexel[channels[1]];
+    }
+}
+
+// 16 bit data images keep their precision. Mips are filtered as floats and stored back as R16G16.
+static void LoadDataChannels16(const stbi_us* pSource, int sourceChannels, uint32_t width, uint32_t height, TextureUsage usage, bool generateMips, TextureMipChain& chain)
+{
+    const size_t texelCount = (size_t)width * height;
+
+    if (!generateMips)
+    {
+        chain.Allocate(width, height, 1u, tpr::RenderFormat::R16G16_UNORM);
+        ExtractDataChannels(pSource, sourceChannels, texelCount, usage, (uint16_t*)chain.GetMip(0));
+        return;
+    }
+
+    uint32_t channels[2];
+    GetDataChannels(usage, sourceChannels, channels);
+
+    TextureMipChain levels;
+    levels.Allocate(width, height, TextureMips_GetFullMipCount(width, height), tpr::RenderFormat::R32G32B32A32_FLOAT);
+
+    float* pLevel0 = (float*)levels.GetMip(0);
+    for (size_t i = 0; i < texelCount; i++)
+    {
+        const stbi_us* pTexel = pSource + i * sourceChannels;
+        pLevel0[i * 4u] = pTexel[channels[0]] * (1.0f / 65535.0f);
+        pLevel0[i * 4u + 1u] = pTexel[channels[1]] * (1.0f / 65535.0f);
+        pLevel0[i * 4u + 2u] = 0.0f;
+        pLevel0[i * 4u + 3u] = 1.0f;
+    }
+
+    TextureMips_GenerateFloatLevels(levels);
+
+    chain.Allocate(width, height, levels.MipCount, tpr::RenderFormat::R16G16_UNORM);
+    for (uint32_t mip = 0; mip < levels.MipCount; mip++)
+    {
+        const float* pSrc = (const float*)levels.GetMip(mip);
+        uint16_t* pDst = (uint16_t*)chain.GetMip(mip);
+
+        const size_t mipTexels = (size_t)levels.GetMipWidth(mip) * levels.GetMipHeight(mip);
+        for (size_t i = 0; i < mipTexels; i++)
+        {
+            pDst[i * 2u] = (uint16_t)(std::clamp(pSrc[i * 4u], 0.0f, 1.0f) * 65535.0f + 0.5f);
+            pDst[i * 2u + 1u] = (uint16_t)(std::clamp(pSrc[i * 4u + 1u], 0.0f, 1.0f) * 65535.0f + 0.5f);
+        }
+    }
+}
+
+// Drops B and A from an uncompressed data image once its mips are built
+static void PackDataChannels(TextureMipChain& chain)
+{
+    TextureMipChain packed;
+    packed.Allocate(chain.Width, chain.Height, chain.MipCount, tpr::RenderFormat::R8G8_UNORM);
+
+    for (uint32_t mip = 0; mip < chain.MipCount; mip++)
+    {
+        const size_t texelCount = (size_t)chain.GetMipWidth(mip) * chain.GetMipHeight(mip);
+        // Metallic roughness was already moved to R and G, every usage keeps the first two channels here
+        ExtractDataChannels(chain.GetMip(mip), 4, texelCount, TextureUsage::NORMAL, packed.GetMip(mip));
+    }
+
+    chain = std::move(packed);
+}
+
+static bool HasAlpha(const uint8_t* pPixels, size_t texelCount)
+{
+    for (size_t i = 0; i < texelCount; i++)
+    {
+        if (pPixels[i * 4u + 3u] != 255u)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t GetTextureLoadSettingsKey(const TextureLoadParams& params)
+{
+    uint32_t cutoffBits;
+    memcpy(&cutoffBits, &params.AlphaCutoff, sizeof(cutoffBits));
+
+    return ((uint64_t)cutoffBits << 32u) | ((uint64_t)params.Usage << 16u) | ((uint64_t)params.Compression << 8u) |
+        (params.GenerateMips ? 2u : 0u) | (params.Srgb ? 1u : 0u);
+}
+
+uint64_t GetTextureDecodeBytesEstimate(const void* pData, size_t size, const TextureLoadParams& params)
+{
+    uint32_t width = 0u;
+    uint32_t height = 0u;
+    bool is16Bit = false;
+
+    if (Ktx2_IsKtx2(pData, size))
+    {
+        if (!Ktx2_GetSize(pData, size, width, height))
+        {
+            return size;
+        }
+    }
+    else
+    {
+        int x, y, comp;
+        if (!stbi_info_from_memory((const stbi_uc*)pData, (int)size, &x, &y, &comp))
+        {
+            return size;
+        }
+
+        width = (uint32_t)x;
+        height = (uint32_t)y;
+        is16Bit = stbi_is_16_bit_from_memory((const stbi_uc*)pData, (int)size) != 0;
+    }
+
+    // stb's buffer and the RGBA8 level 0 copied out of it, then mip generation and compression build a second chain
+    // beside the first
+    const uint64_t texels = (uint64_t)width * height;
+    uint64_t bytes = texels * (is16Bit ? 8u : 4u) + texels * 4u;
+
+    if (params.GenerateMips)
+    {
+        bytes += texels * 4u * 4u / 3u;
+    }
+    else if (params.Compression != TextureCompressionPreset::NONE)
+    {
+        bytes += texels * 4u;
+    }
+
+    return bytes;
+}
+
+bool LoadTextureMipsFromBinary(const void* pData, size_t size, const TextureLoadParams& params, TextureMipChain& chain)
+{
+    const bool processed = params.GenerateMips || params.Compression != TextureCompressionPreset::NONE || params.Usage != TextureUsage::COLOR;
+
+    // The settings that change the stored levels are part of the key
+    uint64_t cacheKey = 0;
+    if (processed && TextureCache_IsEnabled())
+    {
+        cacheKey = TextureCache_Hash(pData, size, GetTextureLoadSettingsKey(params));
+
+        if (TextureCache_Load(cacheKey, chain))
+        {
+            return true;
+        }
+    }
+
+    const bool isKtx2 = Ktx2_IsKtx2(pData, size);
+    const bool dataImage = params.Usage != TextureUsage::COLOR;
+
+    if (isKtx2)
+    {
+        if (!Ktx2_Load(pData, size, params.Usage, params.Compression, chain))
+        {
+            return false;
+        }
+    }
+    else if (dataImage && params.Compression == TextureCompressionPreset::NONE && stbi_is_16_bit_from_memory((stbi_uc*)pData, (int)size))
+    {
+        // Block compression would drop the extra bits anyway, only uncompressed data images keep them
+        int x, y, comp;
+        stbi_us* loadedTex = stbi_load_16_from_memory((stbi_uc*)pData, (int)size, &x, &y, &comp, 0);
+
+        if (loadedTex == nullptr)
+        {
+            LOGERROR("LoadTextureFromBinary : Failed to load texture");
+            return false;
+        }
+
+        LoadDataChannels16(loadedTex, comp, (uint32_t)x, (uint32_t)y, params.Usage, params.GenerateMips, chain);
+
+        stbi_image_free(loadedTex);
+    }
+    else if (dataImage && params.Compression == TextureCompressionPreset::NONE && !params.GenerateMips)
+    {
+        int x, y, comp;
+        stbi_uc* loadedTex = stbi_load_from_memory((stbi_uc*)pData, (int)size, &x, &y, &comp, 0);
+
+        if (loadedTex == nullptr)
+        {
+            LOGERROR("LoadTextureFromBinary : Failed to load texture");
+            return false;
+        }
+
+        chain.Allocate((uint32_t)x, (uint32_t)y, 1u, tpr::RenderFormat::R8G8_UNORM);
+        ExtractDataChannels(loadedTex, comp, (size_t)x * y, params.Usage, chain.GetMip(0));
+
+        stbi_image_free(loadedTex);
+    }
+    else
+    {
+        int x, y, comp;
+        stbi_uc* loadedTex = stbi_load_from_memory((stbi_uc*)pData, (int)size, &x, &y, &comp, 4);
+
+        if (loadedTex == nullptr)
+        {
+            LOGERROR("LoadTextureFromBinary : Failed to load texture");
+            return false;
+        }
+
+        chain.Allocate((uint32_t)x, (uint32_t)y, 1u);
+        memcpy(chain.GetMip(0), loadedTex, chain.GetMipSize(0));
+
+        stbi_image_free(loadedTex);
+
+        if (!processed)
+        {
+            return true;
+        }
+    }
+
+    // Containers may already hold block compressed levels, those are used as they are
+    if (chain.Format == tpr::RenderFormat::R8G8B8A8_UNORM)
+    {
+        // Same move as GetDataChannels, done in place while the image is still RGBA8 for the mip filter and encoders
+        if (params.Usage == TextureUsage::METALLIC_ROUGHNESS)
+        {
+            for (size_t i = 0; i < chain.Pixels.size(); i += 4u)
+            {
+                uint8_t* pTexel = chain.Pixels.data() + i;
+                pTexel[0] = pTexel[1];
+                pTexel[1] = pTexel[2];
+                pTexel[2] = 0u;
+                pTexel[3] = 255u;
+            }
+        }
+
+        if (params.GenerateMips && chain.MipCount == 1u)
+        {
+            TextureMipParams mipParams;
+            mipParams.Srgb = params.Srgb;
+            mipParams.AlphaCutoff = params.AlphaCutoff;
+
+            TextureMipChain mips;
+            TextureMips_Generate(chain.GetMip(0), chain.Width, chain.Height, mipParams, mips);
+            chain = std::move(mips);
+        }
+
+        if (params.Compression != TextureCompressionPreset::NONE)
+        {
+            const bool hasAlpha = HasAlpha(chain.GetMip(0), (size_t)chain.Width * chain.Height);
+            const tpr::RenderFormat format = TextureCompress_ChooseFormat(params.Usage, params.Compression, hasAlpha);
+
+            if (TextureCompress_CanCompress(chain.Width, chain.Height))
+            {
+                TextureMipChain compressed;
+                TextureCompress_Encode(chain, format, params.Compression, compressed);
+                chain = std::move(compressed);
+            }
+            else
+            {
+                LOGDEBUG("LoadTextureFromBinary : %ux%u is not 4x4 aligned, left uncompressed", chain.Width, chain.Height);
+            }
+        }
+
+        // The shader only reads R and G of data images
+        if (dataImage && chain.Format == tpr::RenderFormat::R8G8B8A8_UNORM)
+        {
+            PackDataChannels(chain);
+        }
+    }
+    else if (isKtx2 && params.Usage == TextureUsage::METALLIC_ROUGHNESS)
+    {
+        // Compressed metallic roughness keeps gltf's G/B layout, which the shader does not read
+        LOGERROR("LoadTextureFromBinary : metallic roughness images must be RGBA8 or Basis, not pre-compressed");
+        return false;
+    }
+
+    if (processed && TextureCache_IsEnabled())
+    {
+        TextureCache_Store(cacheKey, chain);
+    }
+
+    return true;
+}
+
+tpr::TexturePtr LoadTextureFromBinary(const void* pData, size_t size, const TextureLoadParams& params, TextureLoadInfo* pInfo)
+{
+    if (pInfo)
+    {
+        *pInfo = {};
+    }
+
+    TextureMipChain chain;
+    if (!LoadTextureMipsFromBinary(pData, size, params, chain))
     {
-        LOGERROR("LoadTextureFromBinary : Failed to load texture");
         return tpr::Texture_t::INVALID;
     }
 
-    tpr::TextureCreateDesc texDesc = {};
-    texDesc.Width = x;
-    texDesc.Height = y;
-    texDesc.Format = tpr::RenderFormat::R8G8B8A8_UNORM;
-    texDesc.Flags = tpr::RenderResourceFlags::SRV;
-    
-    tpr::MipData mip0(loadedTex, texDesc.Format, texDesc.Width, texDesc.Height);
+    return CreateTextureFromMips(chain, pInfo);
+}
 
-    texDesc.Data = &mip0;
+void SetTextureCompressionPreset(TextureCompressionPreset preset)
+{
+    G.Compression = preset;
+}
 
-    tpr::TexturePtr tex = tpr::CreateTexture(texDesc);
+void GetTextureLoadParamsForGltf(const Gltf& gltf, std::vector<TextureLoadParams>& params)
+{
+    params.assign(gltf.images.size(), {});
 
-    stbi_image_free(loadedTex);
+    for (TextureLoadParams& imageParams : params)
+    {
+        imageParams.GenerateMips = true;
+        imageParams.Compression = G.Compression;
+    }
 
-    return tex;
+    // Images sampled by more than one kind of slot keep the first usage seen
+    std::vector<bool> usageSet(gltf.images.size(), false);
+
+    auto GetImageParams = [&]<typename T>(const std::optional<T>& texInfo, TextureUsage usage) -> TextureLoadParams*
+    {
+        if (!texInfo.has_value() || texInfo->index >= gltf.textures.size())
+        {
+            return nullptr;
+        }
+
+        const int32_t source = GetGltfTextureImage(gltf, texInfo->index);
+        if (source < 0 || (size_t)source >= params.size())
+        {
+            return nullptr;
+        }
+
+        if (!usageSet[source])
+        {
+            params[source].Usage = usage;
+            usageSet[source] = true;
+        }
+        else if (params[source].Usage != usage)
+        {
+            LOGWARNING("GetTextureLoadParamsForGltf : image %d is sampled as both %u and %u, using %u", source, (uint32_t)params[source].Usage, (uint32_t)usage, (uint32_t)params[source].Usage);
+            return nullptr;
+        }
+
+        return &params[source];
+    };
+
+    // Base color and emissive are colour, normals and metallic roughness are data and stay linear
+    for (const GltfMaterial& material : gltf.materials)
+    {
+        if (TextureLoadParams* baseColor = GetImageParams(material.pbr.baseColorTexture, TextureUsage::COLOR))
+        {
+            baseColor->Srgb = true;
+
+            if (material.alphaMode == GltfAlphaMode::MASK)
+            {
+                baseColor->AlphaCutoff = std::max(baseColor->AlphaCutoff, material.alphaCutoff);
+            }
+        }
+
+        if (TextureLoadParams* emissive = GetImageParams(material.emissiveTexture, TextureUsage::COLOR))
+        {
+            emissive->Srgb = true;
+        }
+
+        GetImageParams(material.normalTexture, TextureUsage::NORMAL);
+        GetImageParams(material.pbr.metallicRoughnessTexture, TextureUsage::METALLIC_ROUGHNESS);
+    }
+
+    // Fallback images are skipped unless some texture samples them directly
+    for (uint32_t i = 0; i < gltf.textures.size(); i++)
+    {
+        const GltfTexture& texture = gltf.textures[i];
+        if (texture.source >= 0 && (size_t)texture.source < params.size() && GetGltfTextureImage(gltf, i) != texture.source)
+        {
+            params[texture.source].Skip = true;
+        }
+    }
+
+    for (uint32_t i = 0; i < gltf.textures.size(); i++)
+    {
+        const int32_t image = GetGltfTextureImage(gltf, i);
+        if (image >= 0 && (size_t)image < params.size())
+        {
+            params[image].Skip = false;
+        }
+    }
+}
+
+int32_t GetGltfTextureImage(const Gltf& gltf, uint32_t textureIndex)
+{
+    if (textureIndex >= gltf.textures.size())
+    {
+        return -1;
+    }
+
+    const GltfTexture& texture = gltf.textures[textureIndex];
+
+    if (texture.basisuExtension.has_value() && (Ktx2_CanTranscodeBasis() || texture.source < 0))
+    {
+        return texture.basisuExtension->source;
+    }
+
+    return texture.source;
 }
 
-tpr::TexturePtr LoadHdrTextureFromBinary(const void* const pData, size_t size)
+tpr::TexturePtr LoadHdrTextureFromBinary(const void* const pData, size_t size, const HdrLoadParams& params, TextureLoadInfo* pInfo)
 {
+    if (pInfo)
+    {
+        *pInfo = {};
+        pInfo->Format = tpr::RenderFormat::R32G32B32A32_FLOAT;
+    }
+
+    const bool processed = params.Encoding != HdrEncoding::FLOAT32 || params.GenerateMips || params.CubemapSize > 0u;
+
+    uint64_t cacheKey = 0;
+    if (processed && TextureCache_IsEnabled())
+    {
+        // Top bit keeps HDR keys apart from the LDR settings
+        const uint64_t settings = (1ull << 63u) | ((uint64_t)params.CubemapSize << 16u) | ((uint64_t)params.Encoding << 8u) |
+            (params.GenerateMips ? 2u : 0u);
+
+        cacheKey = TextureCache_Hash(pData, size, settings);
+
+        TextureMipChain cached;
+        if (TextureCache_Load(cacheKey, cached))
+        {
+            return CreateTextureFromMips(cached, pInfo);
+        }
+    }
+
     int x, y, comp;
     float* loadedTex = stbi_loadf_from_memory((stbi_uc*)pData, (int)size, &x, &y, &comp, 4);
 
     if (loadedTex == nullptr)
     {
-        LOGERROR("LoadTextureFromBinary : Failed to load texture");
+        LOGERROR("LoadHdrTextureFromBinary : Failed to load texture");
         return tpr::Texture_t::INVALID;
     }
 
+    if (processed)
+    {
+        TextureMipChain chain;
+
+        if (params.CubemapSize > 0u)
+        {
+            const uint32_t mipCount = params.GenerateMips ? TextureMips_GetFullMipCount(params.CubemapSize, params.CubemapSize) : 1u;
+            TextureHdr_EquirectToCube(loadedTex, (uint32_t)x, (uint32_t)y, params.CubemapSize, mipCount, chain);
+        }
+        else
+        {
+            const uint32_t mipCount = params.GenerateMips ? TextureMips_GetFullMipCount((uint32_t)x, (uint32_t)y) : 1u;
+            chain.Allocate((uint32_t)x, (uint32_t)y, mipCount, tpr::RenderFormat::R32G32B32A32_FLOAT);
+            memcpy(chain.GetMip(0), loadedTex, chain.GetMipSize(0));
+        }
+
+        stbi_image_free(loadedTex);
+
+        TextureMips_GenerateFloatLevels(chain);
+
+        HdrEncoding encoding = params.Encoding;
+        if (encoding == HdrEncoding::BC6H && !TextureCompress_CanCompress(chain.Width, chain.Height))
+        {
+            LOGDEBUG("LoadHdrTextureFromBinary : %ux%u is not 4x4 aligned, stored as FP16 instead of BC6H", chain.Width, chain.Height);
+            encoding = HdrEncoding::FLOAT16;
+        }
+
+        if (encoding != HdrEncoding::FLOAT32)
+        {
+            TextureMipChain encoded;
+            TextureHdr_Encode(chain, encoding, encoded);
+            chain = std::move(encoded);
+        }
+
+        if (TextureCache_IsEnabled())
+        {
+            TextureCache_Store(cacheKey, chain);
+        }
+
+        return CreateTextureFromMips(chain, pInfo);
+    }
+
     tpr::TextureCreateDesc texDesc = {};
     texDesc.Width = x;
     texDesc.Height = y;
@@ -159,3 +674,133 @@ tpr::TexturePtr LoadHdrTextureFromBinary(const void* const pData, size_t size)
 
     return tex;
 }
+
+bool LoadEnvironmentLightingFromFile(const char* const pFileName, const EnvironmentLightingParams& params, EnvironmentLighting& out)
+{
+    size_t size;
+    std::unique_ptr<uint8_t[]> pBinary = LoadBinaryFile(pFileName, size);
+
+    if (pBinary)
+    {
+        return LoadEnvironmentLightingFromBinary(pBinary.get(), size, params, out);
+    }
+
+    return false;
+}
+
+static bool BakeEnvironmentLighting(const void* const pData, size_t size, const EnvironmentLightingParams& params, uint32_t specularMipCount,
+    TextureMipChain& irradiance, TextureMipChain& specular)
+{
+    int x, y, comp;
+    float* loadedTex = stbi_loadf_from_memory((stbi_uc*)pData, (int)size, &x, &y, &comp, 4);
+
+    if (loadedTex == nullptr)
+    {
+        LOGERROR("LoadEnvironmentLightingFromBinary : Failed to load texture");
+        return false;
+    }
+
+    // Neither bake needs more detail than 4 cube faces across, filtering the source down first keeps the cubemap
+    // from aliasing and the projection cheap
+    uint32_t levels = 1u;
+    while (((uint32_t)x >> (levels - 1u)) > params.SpecularSize * 4u && ((uint32_t)y >> levels) > 0u)
+    {
+        levels++;
+    }
+
+    TextureMipChain equirect;
+    equirect.Allocate((uint32_t)x, (uint32_t)y, levels, tpr::RenderFormat::R32G32B32A32_FLOAT);
+    memcpy(equirect.GetMip(0), loadedTex, equirect.GetMipSize(0));
+
+    stbi_image_free(loadedTex);
+
+    TextureMips_GenerateFloatLevels(equirect);
+
+    const uint32_t level = equirect.MipCount - 1u;
+    const float* pixels = (const float*)equirect.GetMip(level);
+    const uint32_t width = equirect.GetMipWidth(level);
+    const uint32_t height = equirect.GetMipHeight(level);
+
+    IblIrradianceSh sh;
+    TextureIbl_ProjectIrradiance(pixels, width, height, sh);
+
+    // Nine RGBA32F texels, so the coefficients share the cache with everything else
+    irradiance.Allocate(9u, 1u, 1u, tpr::RenderFormat::R32G32B32A32_FLOAT);
+    memcpy(irradiance.GetMip(0), sh.Coefficients, sizeof(sh.Coefficients));
+
+    TextureMipChain cube;
+    TextureHdr_EquirectToCube(pixels, width, height, params.SpecularSize, TextureMips_GetFullMipCount(params.SpecularSize, params.SpecularSize), cube);
+    TextureMips_GenerateFloatLevels(cube);
+
+    TextureMipChain prefiltered;
+    TextureIbl_PrefilterSpecular(cube, params.SpecularSize, specularMipCount, params.SpecularSampleCount, prefiltered);
+
+    TextureHdr_Encode(prefiltered, HdrEncoding::FLOAT16, specular);
+
+    return true;
+}
+
+bool LoadEnvironmentLightingFromBinary(const void* const pData, size_t size, const EnvironmentLightingParams& params, EnvironmentLighting& out)
+{
+    PROFILE_ZONE("Load Environment Lighting");
+
+    if (params.SpecularSize == 0u || params.BrdfLutSize == 0u)
+    {
+        LOGERROR("LoadEnvironmentLightingFromBinary : specular and BRDF LUT sizes must be above zero");
+        return false;
+    }
+
+    const uint32_t specularMipCount = std::clamp(params.SpecularMipCount, 1u, TextureMips_GetFullMipCount(params.SpecularSize, params.SpecularSize));
+
+    // Bits 60 to 62 keep these apart from each other and from the image keys
+    const uint64_t irradianceSettings = 1ull << 61u;
+    const uint64_t specularSettings = (1ull << 62u) | ((uint64_t)params.SpecularSampleCount << 32u) | ((uint64_t)specularMipCount << 24u) | params.SpecularSize;
+    const uint64_t brdfLutSettings = (1ull << 60u) | ((uint64_t)params.BrdfLutSampleCount << 16u) | params.BrdfLutSize;
+
+    TextureMipChain irradiance;
+    TextureMipChain specular;
+
+    bool cached = false;
+    uint64_t irradianceKey = 0;
+    uint64_t specularKey = 0;
+    if (TextureCache_IsEnabled())
+    {
+        irradianceKey = TextureCache_Hash(pData, size, irradianceSettings);
+        specularKey = TextureCache_Hash(pData, size, specularSettings);
+
+        cached = TextureCache_Load(irradianceKey, irradiance) && TextureCache_Load(specularKey, specular);
+    }
+
+    if (!cached)
+    {
+        if (!BakeEnvironmentLighting(pData, size, params, specularMipCount, irradiance, specular))
+        {
+            return false;
+        }
+
+        if (TextureCache_IsEnabled())
+        {
+            TextureCache_Store(irradianceKey, irradiance);
+            TextureCache_Store(specularKey, specular);
+        }
+    }
+
+    memcpy(out.Irradiance.Coefficients, irradiance.GetMip(0), sizeof(out.Irradiance.Coefficients));
+
+    out.SpecularTexture = CreateTextureFromMips(specular, &out.SpecularInfo);
+
+    // The LUT only depends on its own settings, it is shared by every sky
+    static const char KBrdfLutName[] = "BrdfLut";
+    const uint64_t brdfLutKey = TextureCache_Hash(KBrdfLutName, sizeof(KBrdfLutName), brdfLutSettings);
+
+    TextureMipChain brdfLut;
+    if (!TextureCache_Load(brdfLutKey, brdfLut))
+    {
+        TextureIbl_BuildBrdfLut(params.BrdfLutSize, params.BrdfLutSampleCount, brdfLut);
+        TextureCache_Store(brdfLutKey, brdfLut);
+    }
+
+    out.BrdfLutTexture = CreateTextureFromMips(brdfLut, &out.BrdfLutInfo);
+
+    return true;
+}
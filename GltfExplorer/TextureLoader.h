@@ -2,9 +2,110 @@
 
 #include <Render/RenderTypes.h>
 
+#include "Textures/TextureCompress.h"
+#include "Textures/TextureHdr.h"
+#include "Textures/TextureIbl.h"
+
+#include <vector>
+
+struct Gltf;
+struct TextureMipChain;
+
 tpr::TexturePtr LoadTextureFromFile(const char* const pFileName);
-tpr::TexturePtr LoadHdrTextureFromFile(const char* const pFileName);
 
-tpr::TexturePtr LoadTextureFromBinary(const void* const pData, size_t size);
-tpr::TexturePtr LoadHdrTextureFromBinary(const void* const pData, size_t size);
+struct TextureLoadParams
+{
+    // Uncompressed normal and metallic roughness images keep only the two channels the shader reads, as R8G8 or as
+    // R16G16 when the source is a 16 bit PNG
+    TextureUsage Usage = TextureUsage::COLOR;
+
+    // Colour data, mips are filtered in linear space
+    bool Srgb = false;
+
+    // Builds every level down to 1x1, taken from the texture cache when one is set
+    bool GenerateMips = false;
+
+    // Alpha test threshold of the material using the image, mips keep its coverage. 0 when not alpha tested.
+    float AlphaCutoff = 0.0f;
+
+    // Block compresses the texture in a format picked from the usage
+    TextureCompressionPreset Compression = TextureCompressionPreset::NONE;
+
+    // Only the fallback of a KTX2 image that is loaded in its place, nothing samples it
+    bool Skip = false;
+};
+
+// What the texture ended up as, for creating its SRV
+struct TextureLoadInfo
+{
+    uint32_t MipCount = 1u;
+    uint32_t ArraySize = 1u;
+    tpr::RenderFormat Format = tpr::RenderFormat::R8G8B8A8_UNORM;
+    tpr::TextureDimension Dimension = tpr::TextureDimension::TEX2D;
+};
+
+tpr::TexturePtr LoadTextureFromBinary(const void* const pData, size_t size, const TextureLoadParams& params = {}, TextureLoadInfo* pInfo = nullptr);
+
+// Decodes and processes the image the way LoadTextureFromBinary does, leaving the levels on the CPU
+bool LoadTextureMipsFromBinary(const void* const pData, size_t size, const TextureLoadParams& params, TextureMipChain& chain);
+
+// Uploads the levels from firstMip down, which becomes the texture's top level. Streaming creates textures holding only
+// the smaller mips of a chain this way.
+tpr::TexturePtr CreateTextureFromMips(const TextureMipChain& chain, TextureLoadInfo* pInfo = nullptr, uint32_t firstMip = 0u);
+
+// Upper bound of the CPU memory decoding the image with LoadTextureMipsFromBinary holds at once, read from its header.
+// The encoded size when the header cannot be read, the decode will fail anyway.
+uint64_t GetTextureDecodeBytesEstimate(const void* const pData, size_t size, const TextureLoadParams& params);
+
+// Packs the parameters that change what LoadTextureFromBinary produces, Skip is ignored
+uint64_t GetTextureLoadSettingsKey(const TextureLoadParams& params);
+
+// Preset GetTextureLoadParamsForGltf gives gltf images, NONE by default
+void SetTextureCompressionPreset(TextureCompressionPreset preset);
+
+// Load settings for every image in `gltf`, from how the materials sample it
+void GetTextureLoadParamsForGltf(const Gltf& gltf, std::vector<TextureLoadParams>& params);
+
+// Image a gltf texture samples, its KHR_texture_basisu source when KTX2 can be read. -1 when it has none.
+int32_t GetGltfTextureImage(const Gltf& gltf, uint32_t textureIndex);
+
+struct HdrLoadParams
+{
+    HdrEncoding Encoding = HdrEncoding::FLOAT32;
+
+    // Builds every level down to 1x1, for skies sampled at a lower resolution than the source
+    bool GenerateMips = false;
+
+    // Above zero, resamples the equirectangular image into a cubemap with faces of this size
+    uint32_t CubemapSize = 0u;
+};
+
+tpr::TexturePtr LoadHdrTextureFromFile(const char* const pFileName, const HdrLoadParams& params = {}, TextureLoadInfo* pInfo = nullptr);
+tpr::TexturePtr LoadHdrTextureFromBinary(const void* const pData, size_t size, const HdrLoadParams& params = {}, TextureLoadInfo* pInfo = nullptr);
+
+struct EnvironmentLightingParams
+{
+    // Face size of the prefiltered specular cubemap, each mip down holds a rougher reflection
+    uint32_t SpecularSize = 128u;
+    uint32_t SpecularMipCount = 6u;
+    uint32_t SpecularSampleCount = 64u;
+
+    uint32_t BrdfLutSize = 64u;
+    uint32_t BrdfLutSampleCount = 256u;
+};
+
+struct EnvironmentLighting
+{
+    IblIrradianceSh Irradiance;
+
+    tpr::TexturePtr SpecularTexture;
+    TextureLoadInfo SpecularInfo;
+
+    tpr::TexturePtr BrdfLutTexture;
+    TextureLoadInfo BrdfLutInfo;
+};
 
+// Bakes image based lighting from an equirectangular HDR image. Results go through the texture cache keyed by the
+// image's hash, so a sky is only baked the first time it is seen.
+bool LoadEnvironmentLightingFromFile(const char* const pFileName, const EnvironmentLightingParams& params, EnvironmentLighting& out);
+bool LoadEnvironmentLightingFromBinary(const void* const pData, size_t size, const EnvironmentLightingParams& params, EnvironmentLighting& out);
@@ -0,0 +1,330 @@
+#include "TextureRegistry.h"
+
+#include "Profiler/Profiler.h"
+
+#include <Render/Render.h>
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <unordered_map>
+#include <string.h>
+
+struct TextureRegistryKey
+{
+    TextureHash128 Hash;
+    uint64_t Settings = 0;
+
+    bool operator==(const TextureRegistryKey& other) const
+    {
+        return Hash.Low == other.Hash.Low && Hash.High == other.Hash.High && Settings == other.Settings;
+    }
+};
+
+struct TextureRegistryKeyHasher
+{
+    size_t operator()(const TextureRegistryKey& key) const
+    {
+        // Already well mixed, folding in the settings is enough to spread images loaded several ways
+        return (size_t)(key.Hash.Low ^ (key.Settings * 0x9E3779B97F4A7C15ull));
+    }
+};
+
+struct TextureRegistryEntry
+{
+    std::weak_ptr<const SharedTexture> Texture;
+    bool Loading = false;
+};
+
+// Held by every texture's deleter as well as the global, textures released during static destruction still find it
+struct TextureRegistryState
+{
+    std::mutex Lock;
+    std::condition_variable Loaded;
+    std::unordered_map<TextureRegistryKey, TextureRegistryEntry, TextureRegistryKeyHasher> Entries;
+    TextureRegistryStats Stats;
+};
+
+static struct
+{
+    std::shared_ptr<TextureRegistryState> State = std::make_shared<TextureRegistryState>();
+} G;
+
+static inline uint64_t Rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t FMix64(uint64_t k)
+{
+    k ^= k >> 33u;
+    k *= 0xFF51AFD7ED558CCDull;
+    k ^= k >> 33u;
+    k *= 0xC4CEB9FE1A85EC53ull;
+    k ^= k >> 33u;
+    return k;
+}
+
+// MurmurHash3 x64 128, two 64 bit lanes per 16 byte block. Hashing runs over every image of a file so it needs to keep
+// up with memory bandwidth, collisions only need to be unlikely rather than adversarially hard.
+TextureHash128 TextureRegistry_Hash(const void* pData, size_t size)
+{
+    constexpr uint64_t C1 = 0x87C37B91114253D5ull;
+    constexpr uint64_t C2 = 0x4CF5AD432745937Full;
+
+    const uint8_t* bytes = (const uint8_t*)pData;
+    const size_t blockCount = size / 16u;
+
+    uint64_t h1 = 0;
+    uint64_t h2 = 0;
+
+    for (size_t i = 0; i < blockCount; i++)
+    {
+        uint64_t k1, k2;
+        memcpy(&k1, bytes + i * 16u, sizeof(k1));
+        memcpy(&k2, bytes + i * 16u + 8u, sizeof(k2));
+
+        k1 *= C1; k1 = Rotl64(k1, 31); k1 *= C2; h1 ^= k1;
+        h1 = Rotl64(h1, 27); h1 += h2; h1 = h1 * 5u + 0x52DCE729u;
+
+        k2 *= C2; k2 = Rotl64(k2, 33); k2 *= C1; h2 ^= k2;
+        h2 = Rotl64(h2, 31); h2 += h1; h2 = h2 * 5u + 0x38495AB5u;
+    }
+
+    const uint8_t* tail = bytes + blockCount * 16u;
+    const size_t tailSize = size & 15u;
+
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    memcpy(&k1, tail, std::min<size_t>(tailSize, 8u));
+    if (tailSize > 8u)
+    {
+        memcpy(&k2, tail + 8u, tailSize - 8u);
+    }
+
+    k2 *= C2; k2 = Rotl64(k2, 33); k2 *= C1; h2 ^= k2;
+    k1 *= C1; k1 = Rotl64(k1, 31); k1 *= C2; h1 ^= k1;
+
+    h1 ^= (uint64_t)size;
+    h2 ^= (uint64_t)size;
+
+    h1 += h2;
+    h2 += h1;
+
+    h1 = FMix64(h1);
+    h2 = FMix64(h2);
+
+    h1 += h2;
+    h2 += h1;
+
+    return { h1, h2 };
+}
+
+// Removes the entry with the last reference, unless the key has been loaded again in the meantime
+static SharedTexturePtr MakeSharedTexture(const std::shared_ptr<TextureRegistryState>& state, const TextureRegistryKey& key, std::unique_ptr<SharedTexture> loaded)
+{
+    return SharedTexturePtr(loaded.release(), [state, key](const SharedTexture* pTexture)
+    {
+        {
+            std::lock_guard<std::mutex> lock(state->Lock);
+
+            auto it = state->Entries.find(key);
+            if (it != state->Entries.end() && !it->second.Loading && it->second.Texture.expired())
+            {
+                state->Entries.erase(it);
+            }
+
+            state->Stats.LiveTextures--;
+        }
+
+        delete pTexture;
+    });
+}
+
+SharedTexturePtr TextureRegistry_Acquire(const void* pData, size_t size, const TextureLoadParams& params)
+{
+    PROFILE_ZONE("Texture Registry Acquire");
+
+    const TextureRegistryKey key = { TextureRegistry_Hash(pData, size), GetTextureLoadSettingsKey(params) };
+
+    std::shared_ptr<TextureRegistryState> state = G.State;
+
+    {
+        std::unique_lock<std::mutex> lock(state->Lock);
+
+        state->Stats.Requests++;
+
+        while (true)
+        {
+            auto it = state->Entries.find(key);
+            if (it == state->Entries.end())
+            {
+                break;
+            }
+
+            if (it->second.Loading)
+            {
+                state->Loaded.wait(lock);
+                continue;
+            }
+
+            if (SharedTexturePtr existing = it->second.Texture.lock())
+            {
+                state->Stats.Hits++;
+                state->Stats.SharedBytes += size;
+                return existing;
+            }
+
+            // Released, but its deleter has not removed it yet
+            break;
+        }
+
+        TextureRegistryEntry& entry = state->Entries[key];
+        entry.Texture.reset();
+        entry.Loading = true;
+
+        state->Stats.DecodedBytes += size;
+    }
+
+    SharedTexturePtr texture;
+
+    // A throwing load is finished like a failed one and rethrown after, waiters would otherwise sleep on the entry forever
+    std::exception_ptr exception;
+    try
+    {
+        std::unique_ptr<SharedTexture> loaded = std::make_unique<SharedTexture>();
+        loaded->Texture = LoadTextureFromBinary(pData, size, params, &loaded->Info);
+
+        if (loaded->Texture != tpr::Texture_t::INVALID)
+        {
+            loaded->Srv = tpr::CreateTextureSRV(loaded->Texture, loaded->Info.Format, loaded->Info.Dimension, loaded->Info.MipCount, loaded->Info.ArraySize);
+
+            texture = MakeSharedTexture(state, key, std::move(loaded));
+        }
+    }
+    catch (...)
+    {
+        exception = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state->Lock);
+
+        auto it = state->Entries.find(key);
+        if (texture)
+        {
+            it->second.Texture = texture;
+            it->second.Loading = false;
+            state->Stats.LiveTextures++;
+        }
+        else
+        {
+            // Failed loads are not remembered, the next request tries again
+            state->Entries.erase(it);
+        }
+    }
+
+    state->Loaded.notify_all();
+
+    if (exception)
+    {
+        std::rethrow_exception(exception);
+    }
+
+    return texture;
+}
+
+SharedTexturePtr TextureRegistry_Find(const TextureHash128& hash, size_t size, const TextureLoadParams& params)
+{
+    const TextureRegistryKey key = { hash, GetTextureLoadSettingsKey(params) };
+
+    std::lock_guard<std::mutex> lock(G.State->Lock);
+
+    G.State->Stats.Requests++;
+
+    auto it = G.State->Entries.find(key);
+    if (it == G.State->Entries.end() || it->second.Loading)
+    {
+        return nullptr;
+    }
+
+    SharedTexturePtr existing = it->second.Texture.lock();
+    if (existing)
+    {
+        G.State->Stats.Hits++;
+        G.State->Stats.SharedBytes += size;
+    }
+
+    return existing;
+}
+
+SharedTexturePtr TextureRegistry_Insert(const TextureHash128& hash, size_t size, const TextureLoadParams& params, tpr::TexturePtr texture, const TextureLoadInfo& info)
+{
+    if (texture == tpr::Texture_t::INVALID)
+    {
+        return nullptr;
+    }
+
+    const TextureRegistryKey key = { hash, GetTextureLoadSettingsKey(params) };
+
+    std::shared_ptr<TextureRegistryState> state = G.State;
+
+    {
+        std::lock_guard<std::mutex> lock(state->Lock);
+
+        state->Stats.DecodedBytes += size;
+
+        // Another load got there first, ours is dropped so every user shares the one texture
+        auto it = state->Entries.find(key);
+        if (it != state->Entries.end() && !it->second.Loading)
+        {
+            if (SharedTexturePtr existing = it->second.Texture.lock())
+            {
+                return existing;
+            }
+        }
+    }
+
+    std::unique_ptr<SharedTexture> loaded = std::make_unique<SharedTexture>();
+    loaded->Texture = std::move(texture);
+    loaded->Info = info;
+    loaded->Srv = tpr::CreateTextureSRV(loaded->Texture, info.Format, info.Dimension, info.MipCount, info.ArraySize);
+
+    SharedTexturePtr shared = MakeSharedTexture(state, key, std::move(loaded));
+    SharedTexturePtr existing;
+
+    {
+        std::lock_guard<std::mutex> lock(state->Lock);
+
+        state->Stats.LiveTextures++;
+
+        // An Acquire still loading the key owns its entry, this texture then goes unshared
+        TextureRegistryEntry& entry = state->Entries[key];
+        if (!entry.Loading)
+        {
+            existing = entry.Texture.lock();
+            if (!existing)
+            {
+                entry.Texture = shared;
+            }
+        }
+    }
+
+    // Ours is released outside the lock, its deleter takes it
+    return existing ? existing : shared;
+}
+
+TextureRegistryStats TextureRegistry_GetStats()
+{
+    std::lock_guard<std::mutex> lock(G.State->Lock);
+    return G.State->Stats;
+}
+
+void TextureRegistry_ResetStats()
+{
+    std::lock_guard<std::mutex> lock(G.State->Lock);
+
+    const uint32_t liveTextures = G.State->Stats.LiveTextures;
+    G.State->Stats = {};
+    G.State->Stats.LiveTextures = liveTextures;
+}
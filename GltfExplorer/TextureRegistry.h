@@ -0,0 +1,55 @@
+#pragma once
+
+#include "TextureLoader.h"
+
+#include <Render/RenderTypes.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Textures shared by content. Images are keyed by a 128 bit hash of their encoded bytes and the load settings, so the
+// same image embedded by several materials, or by several files of one kit, is decoded and uploaded once. Entries are
+// released with the last reference to them.
+
+struct SharedTexture
+{
+    tpr::TexturePtr Texture = tpr::Texture_t::INVALID;
+    tpr::ShaderResourceViewPtr Srv = tpr::ShaderResourceView_t::INVALID;
+    TextureLoadInfo Info;
+};
+
+using SharedTexturePtr = std::shared_ptr<const SharedTexture>;
+
+struct TextureRegistryStats
+{
+    uint64_t Requests = 0;
+    uint64_t Hits = 0;
+
+    // Encoded bytes that were decoded, and those that were served by an existing texture instead
+    uint64_t DecodedBytes = 0;
+    uint64_t SharedBytes = 0;
+
+    uint32_t LiveTextures = 0;
+};
+
+struct TextureHash128
+{
+    uint64_t Low = 0;
+    uint64_t High = 0;
+};
+
+TextureHash128 TextureRegistry_Hash(const void* pData, size_t size);
+
+// Returns the texture for these bytes and settings, loading it with LoadTextureFromBinary when nothing holds it. Threads
+// asking for an image that is still loading wait for it rather than decoding it again. Null when the load fails.
+SharedTexturePtr TextureRegistry_Acquire(const void* pData, size_t size, const TextureLoadParams& params);
+
+// For callers that decode on a queue of their own. Find never waits on a load in progress and returns null when the
+// image is not resident, Insert then shares a texture decoded from the same bytes and settings. When another load
+// registered the image in the meantime Insert returns that one and `texture` is released.
+SharedTexturePtr TextureRegistry_Find(const TextureHash128& hash, size_t size, const TextureLoadParams& params);
+SharedTexturePtr TextureRegistry_Insert(const TextureHash128& hash, size_t size, const TextureLoadParams& params, tpr::TexturePtr texture, const TextureLoadInfo& info);
+
+TextureRegistryStats TextureRegistry_GetStats();
+void TextureRegistry_ResetStats();
@@ -0,0 +1,208 @@
+#include "ImageDecodeService.h"
+
+#include "../Profiler/Profiler.h"
+
+#include <algorithm>
+
+static double GetMilliseconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+ImageDecodeService::ImageDecodeService(const ImageDecodeParams& params)
+	: Params(params)
+{
+	uint32_t workerCount = Params.WorkerCount;
+	if (workerCount == 0u)
+	{
+		const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1u ? hardwareThreads - 1u : 1u;
+	}
+
+	Stats.WorkerCount = workerCount;
+
+	Workers.reserve(workerCount);
+	for (uint32_t i = 0; i < workerCount; i++)
+	{
+		Workers.emplace_back([this]() { WorkerLoop(); });
+	}
+}
+
+ImageDecodeService::~ImageDecodeService()
+{
+	{
+		std::lock_guard<std::mutex> lock(Lock);
+		Stopping = true;
+	}
+
+	JobReady.notify_all();
+
+	for (std::thread& worker : Workers)
+	{
+		worker.join();
+	}
+}
+
+void ImageDecodeService::Submit(const ImageDecodeRequest& request)
+{
+	Job job;
+	job.Request = request;
+	job.EstimatedBytes = GetTextureDecodeBytesEstimate(request.pData, request.Size, request.Params);
+	job.SubmitTime = std::chrono::steady_clock::now();
+
+	{
+		std::lock_guard<std::mutex> lock(Lock);
+
+		job.Sequence = NextSequence++;
+
+		Queue.push_back(std::move(job));
+		std::push_heap(Queue.begin(), Queue.end(), JobOrder{});
+
+		Outstanding++;
+	}
+
+	JobReady.notify_one();
+}
+
+bool ImageDecodeService::CanStartNextJob() const
+{
+	if (Queue.empty())
+		return false;
+
+	// Cancelled jobs cost nothing, and with nothing in flight even an image over the budget has to go
+	const Job& next = Queue.front();
+	if (InFlightBytes == 0u || (next.Request.Cancel && next.Request.Cancel->IsCancelled()))
+		return true;
+
+	return InFlightBytes + next.EstimatedBytes <= Params.MemoryBudgetBytes;
+}
+
+void ImageDecodeService::WorkerLoop()
+{
+	std::unique_lock<std::mutex> lock(Lock);
+
+	while (true)
+	{
+		JobReady.wait(lock, [this]() { return Stopping || CanStartNextJob(); });
+
+		if (Stopping)
+			return;
+
+		std::pop_heap(Queue.begin(), Queue.end(), JobOrder{});
+		Job job = std::move(Queue.back());
+		Queue.pop_back();
+
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		ImageDecodeResult result;
+		result.Id = job.Request.Id;
+		result.QueuedMilliseconds = GetMilliseconds(job.SubmitTime, start);
+
+		const ImageDecodeCancelToken& cancel = job.Request.Cancel;
+
+		if (!cancel || !cancel->IsCancelled())
+		{
+			InFlightBytes += job.EstimatedBytes;
+			Stats.PeakInFlightBytes = std::max(Stats.PeakInFlightBytes, InFlightBytes);
+
+			// Another queued job may still fit beside this one
+			JobReady.notify_one();
+
+			lock.unlock();
+
+			{
+				PROFILE_ZONE("Decode Image");
+				result.Decoded = LoadTextureMipsFromBinary(job.Request.pData, job.Request.Size, job.Request.Params, result.Mips);
+			}
+
+			const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+			result.DecodeMilliseconds = GetMilliseconds(start, end);
+
+			lock.lock();
+
+			// The estimate is swapped for what the result actually holds until it is released
+			InFlightBytes -= job.EstimatedBytes;
+
+			if (cancel && cancel->IsCancelled())
+			{
+				result.Mips = {};
+			}
+			else if (result.Decoded)
+			{
+				result.Bytes = result.Mips.Pixels.size();
+				InFlightBytes += result.Bytes;
+				Stats.PeakInFlightBytes = std::max(Stats.PeakInFlightBytes, InFlightBytes);
+			}
+		}
+
+		result.Cancelled = cancel && cancel->IsCancelled();
+
+		if (result.Cancelled)
+		{
+			result.Decoded = false;
+			Stats.Cancelled++;
+		}
+		else if (result.Decoded)
+		{
+			Stats.Decoded++;
+			Stats.DecodedBytes += result.Bytes;
+		}
+		else
+		{
+			Stats.Failed++;
+		}
+
+		Stats.QueuedMilliseconds += result.QueuedMilliseconds;
+		Stats.DecodeMilliseconds += result.DecodeMilliseconds;
+
+		if (result.DecodeMilliseconds > Stats.SlowestDecodeMilliseconds)
+		{
+			Stats.SlowestDecodeMilliseconds = result.DecodeMilliseconds;
+			Stats.SlowestDecodeId = result.Id;
+		}
+
+		Results.push_back(std::move(result));
+
+		ResultReady.notify_one();
+
+		// Whatever this job held has been given back
+		JobReady.notify_one();
+	}
+}
+
+bool ImageDecodeService::WaitForResult(ImageDecodeResult& result)
+{
+	std::unique_lock<std::mutex> lock(Lock);
+
+	ResultReady.wait(lock, [this]() { return !Results.empty() || Outstanding == 0u; });
+
+	if (Results.empty())
+		return false;
+
+	result = std::move(Results.front());
+	Results.pop_front();
+
+	Outstanding--;
+
+	return true;
+}
+
+void ImageDecodeService::Release(ImageDecodeResult& result)
+{
+	{
+		std::lock_guard<std::mutex> lock(Lock);
+
+		InFlightBytes -= result.Bytes;
+		result.Bytes = 0u;
+	}
+
+	result.Mips = {};
+
+	JobReady.notify_all();
+}
+
+ImageDecodeStats ImageDecodeService::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(Lock);
+	return Stats;
+}
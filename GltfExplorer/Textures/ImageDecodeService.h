@@ -0,0 +1,162 @@
+#pragma once
+
+#include "TextureMips.h"
+
+#include "../TextureLoader.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Decodes images on a fixed pool of workers, leaving the upload to the thread that submitted them. Decoded bytes in
+// flight are held under a budget from the moment a decode starts until its result is released, so a scene full of large
+// images never has more than the budget decoded at once. Requests run highest priority first and results come back in
+// the order they finish.
+
+struct ImageDecodeParams
+{
+	// 0 uses one worker per hardware thread, less the submitting thread
+	uint32_t WorkerCount = 0u;
+
+	// Estimated bytes decoding and decoded images may hold at once. A single image over the budget still runs, alone.
+	uint64_t MemoryBudgetBytes = 1024ull << 20u;
+};
+
+// Shared by a load and whatever may abandon it. Queued images are dropped without decoding, ones already decoding are
+// discarded when they finish.
+class ImageDecodeCancellation
+{
+public:
+
+	void Cancel() noexcept { Cancelled.store(true, std::memory_order_relaxed); }
+	bool IsCancelled() const noexcept { return Cancelled.load(std::memory_order_relaxed); }
+
+private:
+
+	std::atomic<bool> Cancelled = false;
+};
+
+using ImageDecodeCancelToken = std::shared_ptr<ImageDecodeCancellation>;
+
+struct ImageDecodeRequest
+{
+	// Must stay valid until the request's result is returned
+	const void* pData = nullptr;
+	size_t Size = 0u;
+	TextureLoadParams Params;
+
+	// Higher decodes first, requests of equal priority run in submission order
+	int32_t Priority = 0;
+
+	// The caller's own index, handed back with the result
+	uint32_t Id = 0u;
+
+	ImageDecodeCancelToken Cancel;
+};
+
+struct ImageDecodeResult
+{
+	uint32_t Id = 0u;
+	TextureMipChain Mips;
+	bool Decoded = false;
+	bool Cancelled = false;
+
+	// Charged against the budget until the result is released
+	uint64_t Bytes = 0u;
+
+	// Time spent queued, waiting for a worker or for the budget, and decoding
+	double QueuedMilliseconds = 0.0;
+	double DecodeMilliseconds = 0.0;
+};
+
+struct ImageDecodeStats
+{
+	uint32_t WorkerCount = 0u;
+
+	uint32_t Decoded = 0u;
+	uint32_t Failed = 0u;
+	uint32_t Cancelled = 0u;
+
+	uint64_t DecodedBytes = 0u;
+	uint64_t PeakInFlightBytes = 0u;
+
+	double QueuedMilliseconds = 0.0;
+	double DecodeMilliseconds = 0.0;
+
+	// Slowest single decode, its request Id
+	double SlowestDecodeMilliseconds = 0.0;
+	uint32_t SlowestDecodeId = ~0u;
+};
+
+class ImageDecodeService
+{
+public:
+
+	explicit ImageDecodeService(const ImageDecodeParams& params = {});
+
+	// Queued requests are dropped, decodes in progress are waited for
+	~ImageDecodeService();
+
+	ImageDecodeService(const ImageDecodeService&) = delete;
+	ImageDecodeService& operator=(const ImageDecodeService&) = delete;
+
+	void Submit(const ImageDecodeRequest& request);
+
+	// Blocks until the next decode finishes, false once every submitted request has been returned. Every returned result
+	// must be released before its bytes are available to the requests still queued.
+	bool WaitForResult(ImageDecodeResult& result);
+
+	// Gives the result's bytes back to the budget and frees its mips, call once they have been uploaded
+	void Release(ImageDecodeResult& result);
+
+	ImageDecodeStats GetStats() const;
+
+private:
+
+	struct Job
+	{
+		ImageDecodeRequest Request;
+		uint64_t EstimatedBytes = 0u;
+		uint64_t Sequence = 0u;
+		std::chrono::steady_clock::time_point SubmitTime;
+	};
+
+	struct JobOrder
+	{
+		bool operator()(const Job& a, const Job& b) const
+		{
+			return a.Request.Priority != b.Request.Priority ? a.Request.Priority < b.Request.Priority : a.Sequence > b.Sequence;
+		}
+	};
+
+	bool CanStartNextJob() const;
+	void WorkerLoop();
+
+	ImageDecodeParams Params;
+
+	mutable std::mutex Lock;
+	std::condition_variable JobReady;
+	std::condition_variable ResultReady;
+
+	// Max heap of queued jobs, see JobOrder
+	std::vector<Job> Queue;
+	std::deque<ImageDecodeResult> Results;
+
+	uint64_t InFlightBytes = 0u;
+	uint64_t NextSequence = 0u;
+
+	// Submitted but not yet handed back by WaitForResult
+	uint32_t Outstanding = 0u;
+
+	bool Stopping = false;
+
+	ImageDecodeStats Stats;
+
+	std::vector<std::thread> Workers;
+};
@@ -0,0 +1,156 @@
+#include "TextureAtlas.h"
+
+#include "../Profiler/Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+
+struct TextureAtlasGroup
+{
+	tpr::RenderFormat Format = tpr::RenderFormat::R8G8B8A8_UNORM;
+	uint32_t CellSize = 0u;
+	bool HasMips = false;
+	std::vector<uint32_t> Textures;
+};
+
+static bool IsPowerOfTwo(uint32_t value)
+{
+	return value != 0u && (value & (value - 1u)) == 0u;
+}
+
+bool TextureAtlas_CanPack(const TextureMipChain& chain, const TextureAtlasParams& params)
+{
+	if (params.MaxTextureSize == 0u || chain.ArraySize != 1u || chain.MipCount == 0u)
+		return false;
+
+	// Block compressed levels smaller than a block cannot be placed texel by texel
+	if (TextureMips_GetLevelSize(chain.Format, 1u, 1u) == TextureMips_GetLevelSize(chain.Format, 4u, 4u))
+		return false;
+
+	if (!IsPowerOfTwo(chain.Width) || !IsPowerOfTwo(chain.Height))
+		return false;
+
+	const uint32_t size = std::max(chain.Width, chain.Height);
+	if (size > params.MaxTextureSize || size * 2u > params.PageSize)
+		return false;
+
+	return chain.MipCount == 1u || chain.MipCount == TextureMips_GetFullMipCount(chain.Width, chain.Height);
+}
+
+// Tiles one level of the source over its cell, starting a quarter of the cell in so the texture the UVs map to has a
+// wrapped border of at least that much on every side
+static void FillCell(TextureMipChain& page, uint32_t level, const TextureMipChain& source, uint32_t cellX, uint32_t cellY, uint32_t cellSize)
+{
+	const uint32_t sourceLevel = std::min(level, source.MipCount - 1u);
+	const uint32_t sourceWidth = source.GetMipWidth(sourceLevel);
+	const uint32_t sourceHeight = source.GetMipHeight(sourceLevel);
+
+	const size_t texelSize = TextureMips_GetLevelSize(page.Format, 1u, 1u);
+	const uint32_t pageWidth = page.GetMipWidth(level);
+	const uint32_t start = cellSize / 4u;
+
+	const uint8_t* pSource = source.GetMip(sourceLevel);
+	uint8_t* pDest = page.GetMip(level);
+
+	for (uint32_t y = 0; y < cellSize; y++)
+	{
+		const uint32_t sy = (y + sourceHeight - start % sourceHeight) % sourceHeight;
+
+		for (uint32_t x = 0; x < cellSize; x++)
+		{
+			const uint32_t sx = (x + sourceWidth - start % sourceWidth) % sourceWidth;
+
+			memcpy(pDest + ((size_t)(cellY + y) * pageWidth + cellX + x) * texelSize, pSource + ((size_t)sy * sourceWidth + sx) * texelSize, texelSize);
+		}
+	}
+}
+
+void TextureAtlas_Build(const std::vector<const TextureMipChain*>& textures, const TextureAtlasParams& params, std::vector<TextureMipChain>& pages,
+	std::vector<TextureAtlasPlacement>& placements)
+{
+	PROFILE_ZONE("Texture Atlas Build");
+
+	placements.assign(textures.size(), TextureAtlasPlacement{});
+
+	// Textures share a page when their cells and levels match, so every level of a page lines up with every cell
+	std::vector<TextureAtlasGroup> groups;
+
+	for (uint32_t i = 0; i < (uint32_t)textures.size(); i++)
+	{
+		const TextureMipChain& texture = *textures[i];
+		if (!TextureAtlas_CanPack(texture, params))
+			continue;
+
+		const uint32_t cellSize = std::max(texture.Width, texture.Height) * 2u;
+		const bool hasMips = texture.MipCount > 1u;
+
+		auto group = std::find_if(groups.begin(), groups.end(), [&](const TextureAtlasGroup& g)
+		{
+			return g.Format == texture.Format && g.CellSize == cellSize && g.HasMips == hasMips;
+		});
+
+		if (group == groups.end())
+		{
+			group = groups.insert(groups.end(), TextureAtlasGroup{ texture.Format, cellSize, hasMips, {} });
+		}
+
+		group->Textures.push_back(i);
+	}
+
+	for (const TextureAtlasGroup& group : groups)
+	{
+		const uint32_t cellsPerRow = params.PageSize / group.CellSize;
+		const uint32_t cellsPerPage = cellsPerRow * cellsPerRow;
+
+		uint32_t levelCount = 1u;
+		if (group.HasMips)
+		{
+			while ((group.CellSize >> levelCount) > 0u)
+				levelCount++;
+		}
+
+		for (size_t first = 0; first < group.Textures.size(); first += cellsPerPage)
+		{
+			const uint32_t count = (uint32_t)std::min<size_t>(cellsPerPage, group.Textures.size() - first);
+
+			// A page holding one texture saves nothing and costs four times its memory
+			if (count < 2u)
+				continue;
+
+			const uint32_t columns = std::min(count, cellsPerRow);
+			const uint32_t rows = (count + columns - 1u) / columns;
+
+			const uint32_t pageIndex = (uint32_t)pages.size();
+			TextureMipChain& page = pages.emplace_back();
+			page.Allocate(columns * group.CellSize, rows * group.CellSize, levelCount, group.Format);
+
+			// Cells left over in the last row
+			memset(page.Pixels.data(), 0, page.Pixels.size());
+
+			for (uint32_t c = 0; c < count; c++)
+			{
+				const uint32_t textureIndex = group.Textures[first + c];
+				const TextureMipChain& texture = *textures[textureIndex];
+
+				const uint32_t cellX = (c % columns) * group.CellSize;
+				const uint32_t cellY = (c / columns) * group.CellSize;
+
+				for (uint32_t level = 0; level < levelCount; level++)
+				{
+					FillCell(page, level, texture, cellX >> level, cellY >> level, group.CellSize >> level);
+				}
+
+				const float pageWidth = (float)page.Width;
+				const float pageHeight = (float)page.Height;
+
+				TextureAtlasPlacement& placement = placements[textureIndex];
+				placement.Page = pageIndex;
+				placement.UvTransform = float4(
+					(float)texture.Width / pageWidth,
+					(float)texture.Height / pageHeight,
+					(float)(cellX + group.CellSize / 4u) / pageWidth,
+					(float)(cellY + group.CellSize / 4u) / pageHeight);
+			}
+		}
+	}
+}
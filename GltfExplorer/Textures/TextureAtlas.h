@@ -0,0 +1,39 @@
+#pragma once
+
+#include "TextureMips.h"
+
+#include <SurfMath.h>
+
+#include <cstdint>
+#include <vector>
+
+// Packs small textures into shared atlas pages so a scene full of tiny images needs a handful of textures and
+// descriptors rather than one each. Every texture sits in a square cell twice its size, surrounded by wrapped copies of
+// itself, and cells of one page are all the same size. Each level of the page then keeps a border around every texture
+// down to the 1x1 level of its cell, so mips and repeating UVs never blend in a neighbour.
+
+struct TextureAtlasParams
+{
+	// Textures no larger than this on either side are packed, 0 packs nothing
+	uint32_t MaxTextureSize = 64u;
+
+	// Largest side of a page
+	uint32_t PageSize = 1024u;
+};
+
+// Where a texture was packed. Shaders sample Offset + frac(uv) * Scale, stored as xy scale and zw offset, with the UV
+// gradients multiplied by Scale.
+struct TextureAtlasPlacement
+{
+	// ~0u when the texture was left on its own
+	uint32_t Page = ~0u;
+	float4 UvTransform = float4(1.0f, 1.0f, 0.0f, 0.0f);
+};
+
+// Uncompressed, power of two sides within the size limit, and either one level or a full chain
+bool TextureAtlas_CanPack(const TextureMipChain& chain, const TextureAtlasParams& params);
+
+// Lays out every packable texture and builds the pages with their levels. Textures that would have a page to themselves
+// are not packed, their placement keeps Page at ~0u.
+void TextureAtlas_Build(const std::vector<const TextureMipChain*>& textures, const TextureAtlasParams& params, std::vector<TextureMipChain>& pages,
+	std::vector<TextureAtlasPlacement>& placements);
@@ -0,0 +1,186 @@
+#include "TextureCache.h"
+
+#include "TextureMips.h"
+
+#include <OpenFile.h>
+
+#include "../Logging.h"
+#include "../Profiler/Profiler.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+
+static constexpr uint32_t KTextureCacheMagic = 0x5350494Du; // "MIPS"
+
+// Bump when the mip filter or block encoders change so stale chains are not picked up
+static constexpr uint32_t KTextureCacheVersion = 4u;
+
+struct TextureCacheHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t MipCount;
+	uint32_t ArraySize;
+	uint32_t Format;
+	uint32_t Reserved;
+	uint64_t Key;
+};
+
+static struct
+{
+	std::mutex Mutex;
+	std::string Directory;
+	bool Enabled = false;
+	bool DirectoryCreated = false;
+} G;
+
+static std::string GetCachePath(uint64_t key)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.mips", (unsigned long long)key);
+
+	std::lock_guard<std::mutex> lock(G.Mutex);
+	return (std::filesystem::path(G.Directory) / name).string();
+}
+
+void TextureCache_SetDirectory(const char* pDirectory)
+{
+	std::lock_guard<std::mutex> lock(G.Mutex);
+
+	G.Enabled = pDirectory && pDirectory[0];
+	G.Directory = G.Enabled ? pDirectory : "";
+	G.DirectoryCreated = false;
+}
+
+bool TextureCache_IsEnabled()
+{
+	std::lock_guard<std::mutex> lock(G.Mutex);
+	return G.Enabled;
+}
+
+static inline uint64_t Mix64(uint64_t k)
+{
+	k ^= k >> 33u;
+	k *= 0xFF51AFD7ED558CCDull;
+	k ^= k >> 33u;
+	k *= 0xC4CEB9FE1A85EC53ull;
+	k ^= k >> 33u;
+	return k;
+}
+
+uint64_t TextureCache_Hash(const void* pData, size_t size, uint64_t seed)
+{
+	constexpr uint64_t Prime = 0x9E3779B97F4A7C15ull;
+
+	const uint8_t* bytes = (const uint8_t*)pData;
+	uint64_t h = seed ^ (size * Prime);
+
+	size_t i = 0;
+	for (; i + 8u <= size; i += 8u)
+	{
+		uint64_t word;
+		memcpy(&word, bytes + i, sizeof(word));
+		h = (h ^ Mix64(word)) * Prime;
+	}
+
+	uint64_t tail = 0;
+	memcpy(&tail, bytes + i, size - i);
+	h = (h ^ Mix64(tail)) * Prime;
+
+	return Mix64(h);
+}
+
+bool TextureCache_Load(uint64_t key, TextureMipChain& chain)
+{
+	if (!TextureCache_IsEnabled())
+		return false;
+
+	PROFILE_ZONE("Texture Cache Load");
+
+	const std::string path = GetCachePath(key);
+
+	FILE* fp = OpenFile(path.c_str(), "rb");
+	if (!fp)
+		return false;
+
+	TextureCacheHeader header = {};
+	bool ok = fread(&header, sizeof(header), 1, fp) == 1;
+
+	ok = ok && header.Magic == KTextureCacheMagic && header.Version == KTextureCacheVersion && header.Key == key;
+	ok = ok && header.Width && header.Height && header.ArraySize;
+	ok = ok && header.MipCount && header.MipCount <= TextureMips_GetFullMipCount(header.Width, header.Height);
+
+	if (ok)
+	{
+		chain.Allocate(header.Width, header.Height, header.MipCount, (tpr::RenderFormat)header.Format, header.ArraySize);
+		ok = fread(chain.Pixels.data(), 1, chain.Pixels.size(), fp) == chain.Pixels.size();
+	}
+
+	fclose(fp);
+
+	if (!ok)
+		LOGWARNING("TextureCache: ignoring unreadable entry %s", path.c_str());
+
+	return ok;
+}
+
+void TextureCache_Store(uint64_t key, const TextureMipChain& chain)
+{
+	if (!TextureCache_IsEnabled())
+		return;
+
+	PROFILE_ZONE("Texture Cache Store");
+
+	{
+		std::lock_guard<std::mutex> lock(G.Mutex);
+		if (!G.DirectoryCreated)
+		{
+			std::error_code error;
+			std::filesystem::create_directories(G.Directory, error);
+			if (error)
+			{
+				LOGERROR("TextureCache: cannot create %s, disabling the cache", G.Directory.c_str());
+				G.Enabled = false;
+				return;
+			}
+			G.DirectoryCreated = true;
+		}
+	}
+
+	const std::string path = GetCachePath(key);
+
+	// Written under a name unique to this thread then renamed so a concurrent load never sees half a file
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), ".%zx.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+	const std::string tempPath = path + suffix;
+
+	FILE* fp = OpenFile(tempPath.c_str(), "wb");
+	if (!fp)
+	{
+		LOGWARNING("TextureCache: cannot write %s", tempPath.c_str());
+		return;
+	}
+
+	const TextureCacheHeader header = { KTextureCacheMagic, KTextureCacheVersion, chain.Width, chain.Height, chain.MipCount, chain.ArraySize,
+		(uint32_t)chain.Format, 0u, key };
+
+	bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+	ok = ok && fwrite(chain.Pixels.data(), 1, chain.Pixels.size(), fp) == chain.Pixels.size();
+	ok = fclose(fp) == 0 && ok;
+
+	std::error_code error;
+	if (ok)
+		std::filesystem::rename(tempPath, path, error);
+
+	if (!ok || error)
+	{
+		LOGWARNING("TextureCache: failed to write %s", path.c_str());
+		std::filesystem::remove(tempPath, error);
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+struct TextureMipChain;
+
+// Generated mip chains are kept on disk keyed by a hash of the encoded image and the settings that produced them, so
+// a second load of the same scene skips decoding, filtering and block compression. Disabled until a directory is set.
+
+// Null disables the cache, the directory is created on the first store
+void TextureCache_SetDirectory(const char* pDirectory);
+bool TextureCache_IsEnabled();
+
+uint64_t TextureCache_Hash(const void* pData, size_t size, uint64_t seed);
+
+bool TextureCache_Load(uint64_t key, TextureMipChain& chain);
+void TextureCache_Store(uint64_t key, const TextureMipChain& chain);
@@ -0,0 +1,697 @@
+#include "TextureCompress.h"
+
+#include "TextureHdr.h"
+#include "TextureMips.h"
+
+#include "../Profiler/Profiler.h"
+
+#include <ParallelFor.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+// Rows of blocks in one task, a 4K level has 1024 of them
+static constexpr uint32_t KBlockRowsPerTask = 8u;
+
+// Texels of one block as floats, the encoders work on whole blocks at a time
+struct BlockTexels
+{
+	float Texel[16][4];
+};
+
+// BC6H interpolates the bit patterns of half floats, scaled by 64/31 to the 16 bit range its endpoints unquantize to
+static constexpr float KBc6hScale = 64.0f / 31.0f;
+static constexpr float KBc6hMax = 65535.0f;
+
+static void FetchBlock(const uint8_t* level, bool floatSource, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, BlockTexels& block)
+{
+	// Partial blocks at the edges of small levels repeat the last row and column
+	for (uint32_t y = 0; y < 4u; y++)
+	{
+		const uint32_t srcY = std::min(blockY * 4u + y, height - 1u);
+		for (uint32_t x = 0; x < 4u; x++)
+		{
+			const uint32_t srcX = std::min(blockX * 4u + x, width - 1u);
+			const size_t texelIndex = ((size_t)srcY * width + srcX) * 4u;
+
+			if (floatSource)
+			{
+				const float* texel = (const float*)level + texelIndex;
+				for (uint32_t c = 0; c < 3u; c++)
+					block.Texel[y * 4u + x][c] = (float)TextureHdr_FloatToHalf(std::max(texel[c], 0.0f)) * KBc6hScale;
+				block.Texel[y * 4u + x][3] = 0.0f;
+			}
+			else
+			{
+				const uint8_t* texel = level + texelIndex;
+				for (uint32_t c = 0; c < 4u; c++)
+					block.Texel[y * 4u + x][c] = (float)texel[c];
+			}
+		}
+	}
+}
+
+// Direction of greatest variance through the mean of `channels` components, by power iteration on the covariance
+static void GetPrincipalAxis(const BlockTexels& block, uint32_t channels, float mean[4], float axis[4])
+{
+	for (uint32_t c = 0; c < 4u; c++)
+	{
+		mean[c] = 0.0f;
+		axis[c] = 0.0f;
+	}
+
+	for (uint32_t i = 0; i < 16u; i++)
+		for (uint32_t c = 0; c < channels; c++)
+			mean[c] += block.Texel[i][c] * (1.0f / 16.0f);
+
+	float covariance[4][4] = {};
+	for (uint32_t i = 0; i < 16u; i++)
+	{
+		float d[4];
+		for (uint32_t c = 0; c < channels; c++)
+			d[c] = block.Texel[i][c] - mean[c];
+
+		for (uint32_t a = 0; a < channels; a++)
+			for (uint32_t b = 0; b < channels; b++)
+				covariance[a][b] += d[a] * d[b];
+	}
+
+	// Start from the diagonal, it is rarely orthogonal to the answer for colour data
+	for (uint32_t c = 0; c < channels; c++)
+		axis[c] = 1.0f;
+
+	for (uint32_t iteration = 0; iteration < 8u; iteration++)
+	{
+		float next[4] = {};
+		for (uint32_t a = 0; a < channels; a++)
+			for (uint32_t b = 0; b < channels; b++)
+				next[a] += covariance[a][b] * axis[b];
+
+		float length = 0.0f;
+		for (uint32_t c = 0; c < channels; c++)
+			length = std::max(length, fabsf(next[c]));
+
+		if (length < 1e-6f)
+			break;
+
+		for (uint32_t c = 0; c < channels; c++)
+			axis[c] = next[c] / length;
+	}
+}
+
+// Endpoints at the extremes of the texels projected on the principal axis
+static void GetAxisEndpoints(const BlockTexels& block, uint32_t channels, float maxValue, float e0[4], float e1[4])
+{
+	float mean[4];
+	float axis[4];
+	GetPrincipalAxis(block, channels, mean, axis);
+
+	float minT = FLT_MAX;
+	float maxT = -FLT_MAX;
+	for (uint32_t i = 0; i < 16u; i++)
+	{
+		float t = 0.0f;
+		for (uint32_t c = 0; c < channels; c++)
+			t += (block.Texel[i][c] - mean[c]) * axis[c];
+
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+
+	float axisLengthSq = 0.0f;
+	for (uint32_t c = 0; c < channels; c++)
+		axisLengthSq += axis[c] * axis[c];
+
+	const float scale = axisLengthSq > 0.0f ? 1.0f / axisLengthSq : 0.0f;
+
+	for (uint32_t c = 0; c < channels; c++)
+	{
+		e0[c] = std::clamp(mean[c] + axis[c] * minT * scale, 0.0f, maxValue);
+		e1[c] = std::clamp(mean[c] + axis[c] * maxT * scale, 0.0f, maxValue);
+	}
+}
+
+// Picks the nearest of `count` palette entries for every texel, returns the total squared error
+static float SelectIndices(const BlockTexels& block, uint32_t channels, const float palette[][4], uint32_t count, uint8_t indices[16])
+{
+	float total = 0.0f;
+	for (uint32_t i = 0; i < 16u; i++)
+	{
+		float best = FLT_MAX;
+		for (uint32_t p = 0; p < count; p++)
+		{
+			float error = 0.0f;
+			for (uint32_t c = 0; c < channels; c++)
+			{
+				const float d = block.Texel[i][c] - palette[p][c];
+				error += d * d;
+			}
+
+			if (error < best)
+			{
+				best = error;
+				indices[i] = (uint8_t)p;
+			}
+		}
+		total += best;
+	}
+	return total;
+}
+
+// Best endpoints for fixed interpolation weights, solving the 2x2 normal equations per channel. False when every
+// texel has the same weight and the system is singular.
+static bool RefineEndpoints(const BlockTexels& block, uint32_t channels, uint32_t firstChannel, float maxValue, const float weights[16], float e0[4], float e1[4])
+{
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float ax[4] = {}, bx[4] = {};
+
+	for (uint32_t i = 0; i < 16u; i++)
+	{
+		const float b = weights[i];
+		const float a = 1.0f - b;
+
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+
+		for (uint32_t c = 0; c < channels; c++)
+		{
+			ax[c] += a * block.Texel[i][firstChannel + c];
+			bx[c] += b * block.Texel[i][firstChannel + c];
+		}
+	}
+
+	const float determinant = aa * bb - ab * ab;
+	if (fabsf(determinant) < 1e-6f)
+		return false;
+
+	const float inverse = 1.0f / determinant;
+	for (uint32_t c = 0; c < channels; c++)
+	{
+		e0[c] = std::clamp((ax[c] * bb - bx[c] * ab) * inverse, 0.0f, maxValue);
+		e1[c] = std::clamp((bx[c] * aa - ax[c] * ab) * inverse, 0.0f, maxValue);
+	}
+	return true;
+}
+
+// BC1: two 565 endpoints and 2 bit indices. Always written in 4 colour mode, which BC3 requires of its colour block.
+
+static uint16_t PackRgb565(const float c[4])
+{
+	const uint32_t r = (uint32_t)(c[0] * (31.0f / 255.0f) + 0.5f);
+	const uint32_t g = (uint32_t)(c[1] * (63.0f / 255.0f) + 0.5f);
+	const uint32_t b = (uint32_t)(c[2] * (31.0f / 255.0f) + 0.5f);
+	return (uint16_t)((r << 11u) | (g << 5u) | b);
+}
+
+static void UnpackRgb565(uint16_t packed, float c[4])
+{
+	const uint32_t r = (packed >> 11u) & 31u;
+	const uint32_t g = (packed >> 5u) & 63u;
+	const uint32_t b = packed & 31u;
+	c[0] = (float)((r << 3u) | (r >> 2u));
+	c[1] = (float)((g << 2u) | (g >> 4u));
+	c[2] = (float)((b << 3u) | (b >> 2u));
+	c[3] = 255.0f;
+}
+
+struct Bc1Candidate
+{
+	uint16_t Color0;
+	uint16_t Color1;
+	uint8_t Indices[16];
+	float Error;
+};
+
+static Bc1Candidate EvaluateBc1(const BlockTexels& block, const float e0[4], const float e1[4])
+{
+	Bc1Candidate candidate;
+	candidate.Color0 = PackRgb565(e0);
+	candidate.Color1 = PackRgb565(e1);
+
+	// Equal endpoints decode in 3 colour mode, where only index 0 is safe
+	if (candidate.Color0 == candidate.Color1)
+	{
+		float palette[1][4];
+		UnpackRgb565(candidate.Color0, palette[0]);
+		candidate.Error = SelectIndices(block, 3u, palette, 1u, candidate.Indices);
+		return candidate;
+	}
+
+	if (candidate.Color0 < candidate.Color1)
+		std::swap(candidate.Color0, candidate.Color1);
+
+	float palette[4][4];
+	UnpackRgb565(candidate.Color0, palette[0]);
+	UnpackRgb565(candidate.Color1, palette[1]);
+	for (uint32_t c = 0; c < 3u; c++)
+	{
+		palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) * (1.0f / 3.0f);
+		palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) * (1.0f / 3.0f);
+	}
+
+	candidate.Error = SelectIndices(block, 3u, palette, 4u, candidate.Indices);
+	return candidate;
+}
+
+static void EncodeBc1(const BlockTexels& block, bool refine, uint8_t* out)
+{
+	float e0[4], e1[4];
+	GetAxisEndpoints(block, 3u, 255.0f, e0, e1);
+
+	Bc1Candidate best = EvaluateBc1(block, e1, e0);
+
+	if (refine)
+	{
+		static constexpr float Bc1Weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+		for (uint32_t iteration = 0; iteration < 2u && best.Color0 != best.Color1; iteration++)
+		{
+			float weights[16];
+			for (uint32_t i = 0; i < 16u; i++)
+				weights[i] = Bc1Weights[best.Indices[i]];
+
+			if (!RefineEndpoints(block, 3u, 0u, 255.0f, weights, e0, e1))
+				break;
+
+			const Bc1Candidate candidate = EvaluateBc1(block, e0, e1);
+			if (candidate.Error >= best.Error)
+				break;
+			best = candidate;
+		}
+	}
+
+	uint32_t indices = 0;
+	for (uint32_t i = 0; i < 16u; i++)
+		indices |= (uint32_t)best.Indices[i] << (i * 2u);
+
+	memcpy(out, &best.Color0, 2u);
+	memcpy(out + 2, &best.Color1, 2u);
+	memcpy(out + 4, &indices, 4u);
+}
+
+// BC4: one channel, two 8 bit endpoints and 3 bit indices across 8 values
+
+struct Bc4Candidate
+{
+	uint8_t Value0;
+	uint8_t Value1;
+	uint8_t Indices[16];
+	float Error;
+};
+
+static Bc4Candidate EvaluateBc4(const BlockTexels& block, uint32_t channel, float v0, float v1)
+{
+	Bc4Candidate candidate;
+	candidate.Value0 = (uint8_t)(std::max(v0, v1) + 0.5f);
+	candidate.Value1 = (uint8_t)(std::min(v0, v1) + 0.5f);
+
+	// Only the 8 value mode is used, it needs the first endpoint strictly greater
+	if (candidate.Value0 == candidate.Value1)
+	{
+		if (candidate.Value0 == 255u)
+			candidate.Value1--;
+		else
+			candidate.Value0++;
+	}
+
+	float palette[8];
+	palette[0] = candidate.Value0;
+	palette[1] = candidate.Value1;
+	for (uint32_t i = 2; i < 8u; i++)
+		palette[i] = ((8u - i) * palette[0] + (i - 1u) * palette[1]) * (1.0f / 7.0f);
+
+	candidate.Error = 0.0f;
+	for (uint32_t i = 0; i < 16u; i++)
+	{
+		const float value = block.Texel[i][channel];
+
+		float best = FLT_MAX;
+		for (uint32_t p = 0; p < 8u; p++)
+		{
+			const float error = (value - palette[p]) * (value - palette[p]);
+			if (error < best)
+			{
+				best = error;
+				candidate.Indices[i] = (uint8_t)p;
+			}
+		}
+		candidate.Error += best;
+	}
+
+	return candidate;
+}
+
+static void EncodeBc4(const BlockTexels& block, uint32_t channel, bool refine, uint8_t* out)
+{
+	float minValue = 255.0f;
+	float maxValue = 0.0f;
+	for (uint32_t i = 0; i < 16u; i++)
+	{
+		minValue = std::min(minValue, block.Texel[i][channel]);
+		maxValue = std::max(maxValue, block.Texel[i][channel]);
+	}
+
+	Bc4Candidate best = EvaluateBc4(block, channel, maxValue, minValue);
+
+	if (refine && best.Error > 0.0f)
+	{
+		// Weight of endpoint 1 for each index, 8 value mode
+		static constexpr float Bc4Weights[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+
+		float weights[16];
+		for (uint32_t i = 0; i < 16u; i++)
+			weights[i] = Bc4Weights[best.Indices[i]];
+
+		float e0[4], e1[4];
+		if (RefineEndpoints(block, 1u, channel, 255.0f, weights, e0, e1))
+		{
+			const Bc4Candidate candidate = EvaluateBc4(block, channel, e0[0], e1[0]);
+			if (candidate.Error < best.Error)
+				best = candidate;
+		}
+	}
+
+	uint64_t indices = 0;
+	for (uint32_t i = 0; i < 16u; i++)
+		indices |= (uint64_t)best.Indices[i] << (i * 3u);
+
+	out[0] = best.Value0;
+	out[1] = best.Value1;
+	memcpy(out + 2, &indices, 6u);
+}
+
+// BC7 mode 6: one subset, RGBA endpoints of 7 bits plus a p-bit each, 4 bit indices
+
+static constexpr uint32_t Bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct Bc7Mode6Candidate
+{
+	uint8_t Endpoint[2][4];
+	uint8_t PBit[2];
+	uint8_t Indices[16];
+	float Error;
+};
+
+// The p-bit is shared by every channel of an endpoint, so pick the one that quantizes the whole endpoint best
+static void QuantizeBc7Endpoint(const float endpoint[4], uint8_t quantized[4], uint8_t& pBit)
+{
+	float bestError = FLT_MAX;
+	for (uint32_t p = 0; p < 2u; p++)
+	{
+		uint8_t q[4];
+		float error = 0.0f;
+		for (uint32_t c = 0; c < 4u; c++)
+		{
+			q[c] = (uint8_t)std::clamp((int32_t)floorf((endpoint[c] - (float)p) * 0.5f + 0.5f), 0, 127);
+			const float d = endpoint[c] - (float)((q[c] << 1u) | p);
+			error += d * d;
+		}
+
+		if (error < bestError)
+		{
+			bestError = error;
+			memcpy(quantized, q, 4u);
+			pBit = (uint8_t)p;
+		}
+	}
+}
+
+static Bc7Mode6Candidate EvaluateBc7Mode6(const BlockTexels& block, const float e0[4], const float e1[4])
+{
+	Bc7Mode6Candidate candidate;
+	QuantizeBc7Endpoint(e0, candidate.Endpoint[0], candidate.PBit[0]);
+	QuantizeBc7Endpoint(e1, candidate.Endpoint[1], candidate.PBit[1]);
+
+	uint32_t unpacked[2][4];
+	for (uint32_t e = 0; e < 2u; e++)
+		for (uint32_t c = 0; c < 4u; c++)
+			unpacked[e][c] = ((uint32_t)candidate.Endpoint[e][c] << 1u) | candidate.PBit[e];
+
+	float palette[16][4];
+	for (uint32_t i = 0; i < 16u; i++)
+		for (uint32_t c = 0; c < 4u; c++)
+			palette[i][c] = (float)(((64u - Bc7Weights4[i]) * unpacked[0][c] + Bc7Weights4[i] * unpacked[1][c] + 32u) >> 6u);
+
+	candidate.Error = SelectIndices(block, 4u, palette, 16u, candidate.Indices);
+	return candidate;
+}
+
+static void EncodeBc7Mode6(const BlockTexels& block, bool refine, uint8_t* out)
+{
+	float e0[4], e1[4];
+	GetAxisEndpoints(block, 4u, 255.0f, e0, e1);
+
+	Bc7Mode6Candidate best = EvaluateBc7Mode6(block, e0, e1);
+
+	if (refine)
+	{
+		for (uint32_t iteration = 0; iteration < 2u && best.Error > 0.0f; iteration++)
+		{
+			float weights[16];
+			for (uint32_t i = 0; i < 16u; i++)
+				weights[i] = Bc7Weights4[best.Indices[i]] * (1.0f / 64.0f);
+
+			if (!RefineEndpoints(block, 4u, 0u, 255.0f, weights, e0, e1))
+				break;
+
+			const Bc7Mode6Candidate candidate = EvaluateBc7Mode6(block, e0, e1);
+			if (candidate.Error >= best.Error)
+				break;
+			best = candidate;
+		}
+	}
+
+	// The first index is stored without its top bit, swapping the endpoints makes it implicitly 0
+	if (best.Indices[0] & 8u)
+	{
+		std::swap(best.Endpoint[0], best.Endpoint[1]);
+		std::swap(best.PBit[0], best.PBit[1]);
+		for (uint8_t& index : best.Indices)
+			index = (uint8_t)(15u - index);
+	}
+
+	uint64_t bits[2] = {};
+	uint32_t position = 0;
+	auto Write = [&](uint32_t value, uint32_t count)
+	{
+		for (uint32_t b = 0; b < count; b++, position++)
+			bits[position >> 6u] |= (uint64_t)((value >> b) & 1u) << (position & 63u);
+	};
+
+	Write(1u << 6u, 7u);
+	for (uint32_t c = 0; c < 4u; c++)
+	{
+		Write(best.Endpoint[0][c], 7u);
+		Write(best.Endpoint[1][c], 7u);
+	}
+	Write(best.PBit[0], 1u);
+	Write(best.PBit[1], 1u);
+
+	Write(best.Indices[0], 3u);
+	for (uint32_t i = 1; i < 16u; i++)
+		Write(best.Indices[i], 4u);
+
+	memcpy(out, bits, 16u);
+}
+
+// BC6H mode 11: one region, unsigned RGB endpoints of 10 bits stored directly, 4 bit indices
+
+struct Bc6hMode11Candidate
+{
+	uint16_t Endpoint[2][3];
+	uint8_t Indices[16];
+	float Error;
+};
+
+static uint32_t UnquantizeBc6h(uint32_t value)
+{
+	if (value == 0u)
+		return 0u;
+	if (value == 1023u)
+		return 0xFFFFu;
+	return ((value << 16u) + 0x8000u) >> 10u;
+}
+
+static uint16_t QuantizeBc6h(float value)
+{
+	return (uint16_t)std::clamp((int32_t)floorf((value - 32.0f) * (1.0f / 64.0f) + 0.5f), 0, 1023);
+}
+
+static Bc6hMode11Candidate EvaluateBc6hMode11(const BlockTexels& block, const float e0[4], const float e1[4])
+{
+	Bc6hMode11Candidate candidate;
+
+	uint32_t unpacked[2][3];
+	for (uint32_t c = 0; c < 3u; c++)
+	{
+		candidate.Endpoint[0][c] = QuantizeBc6h(e0[c]);
+		candidate.Endpoint[1][c] = QuantizeBc6h(e1[c]);
+		unpacked[0][c] = UnquantizeBc6h(candidate.Endpoint[0][c]);
+		unpacked[1][c] = UnquantizeBc6h(candidate.Endpoint[1][c]);
+	}
+
+	// Same weights as BC7, the palette stays in the scaled space the block was fetched in
+	float palette[16][4];
+	for (uint32_t i = 0; i < 16u; i++)
+		for (uint32_t c = 0; c < 3u; c++)
+			palette[i][c] = (float)(((64u - Bc7Weights4[i]) * unpacked[0][c] + Bc7Weights4[i] * unpacked[1][c] + 32u) >> 6u);
+
+	candidate.Error = SelectIndices(block, 3u, palette, 16u, candidate.Indices);
+	return candidate;
+}
+
+static void EncodeBc6hMode11(const BlockTexels& block, bool refine, uint8_t* out)
+{
+	float e0[4], e1[4];
+	GetAxisEndpoints(block, 3u, KBc6hMax, e0, e1);
+
+	Bc6hMode11Candidate best = EvaluateBc6hMode11(block, e0, e1);
+
+	if (refine)
+	{
+		for (uint32_t iteration = 0; iteration < 2u && best.Error > 0.0f; iteration++)
+		{
+			float weights[16];
+			for (uint32_t i = 0; i < 16u; i++)
+				weights[i] = Bc7Weights4[best.Indices[i]] * (1.0f / 64.0f);
+
+			if (!RefineEndpoints(block, 3u, 0u, KBc6hMax, weights, e0, e1))
+				break;
+
+			const Bc6hMode11Candidate candidate = EvaluateBc6hMode11(block, e0, e1);
+			if (candidate.Error >= best.Error)
+				break;
+			best = candidate;
+		}
+	}
+
+	// Anchor index loses its top bit like BC7
+	if (best.Indices[0] & 8u)
+	{
+		std::swap(best.Endpoint[0], best.Endpoint[1]);
+		for (uint8_t& index : best.Indices)
+			index = (uint8_t)(15u - index);
+	}
+
+	uint64_t bits[2] = {};
+	uint32_t position = 0;
+	auto Write = [&](uint32_t value, uint32_t count)
+	{
+		for (uint32_t b = 0; b < count; b++, position++)
+			bits[position >> 6u] |= (uint64_t)((value >> b) & 1u) << (position & 63u);
+	};
+
+	Write(0x03u, 5u);
+	for (uint32_t e = 0; e < 2u; e++)
+		for (uint32_t c = 0; c < 3u; c++)
+			Write(best.Endpoint[e][c], 10u);
+
+	Write(best.Indices[0], 3u);
+	for (uint32_t i = 1; i < 16u; i++)
+		Write(best.Indices[i], 4u);
+
+	memcpy(out, bits, 16u);
+}
+
+static void EncodeBlock(const BlockTexels& block, tpr::RenderFormat format, bool refine, uint8_t* out)
+{
+	switch (format)
+	{
+	case tpr::RenderFormat::BC1_UNORM:
+		EncodeBc1(block, refine, out);
+		break;
+	case tpr::RenderFormat::BC3_UNORM:
+		EncodeBc4(block, 3u, refine, out);
+		EncodeBc1(block, refine, out + 8);
+		break;
+	case tpr::RenderFormat::BC4_UNORM:
+		EncodeBc4(block, 0u, refine, out);
+		break;
+	case tpr::RenderFormat::BC5_UNORM:
+		EncodeBc4(block, 0u, refine, out);
+		EncodeBc4(block, 1u, refine, out + 8);
+		break;
+	case tpr::RenderFormat::BC7_UNORM:
+		EncodeBc7Mode6(block, refine, out);
+		break;
+	case tpr::RenderFormat::BC6H_UF16:
+		EncodeBc6hMode11(block, refine, out);
+		break;
+	default:
+		break;
+	}
+}
+
+tpr::RenderFormat TextureCompress_ChooseFormat(TextureUsage usage, TextureCompressionPreset preset, bool hasAlpha)
+{
+	if (preset == TextureCompressionPreset::NONE)
+		return tpr::RenderFormat::R8G8B8A8_UNORM;
+
+	switch (usage)
+	{
+	case TextureUsage::NORMAL:
+	case TextureUsage::METALLIC_ROUGHNESS:
+		return tpr::RenderFormat::BC5_UNORM;
+	case TextureUsage::COLOR:
+	default:
+		if (preset == TextureCompressionPreset::QUALITY)
+			return tpr::RenderFormat::BC7_UNORM;
+		return hasAlpha ? tpr::RenderFormat::BC3_UNORM : tpr::RenderFormat::BC1_UNORM;
+	}
+}
+
+bool TextureCompress_CanCompress(uint32_t width, uint32_t height)
+{
+	return width && height && (width % 4u) == 0u && (height % 4u) == 0u;
+}
+
+void TextureCompress_Encode(const TextureMipChain& source, tpr::RenderFormat format, TextureCompressionPreset preset, TextureMipChain& out)
+{
+	PROFILE_ZONE("Compress Texture");
+
+	out.Allocate(source.Width, source.Height, source.MipCount, format, source.ArraySize);
+
+	const size_t blockBytes = TextureMips_GetLevelSize(format, 4u, 4u);
+	const bool refine = preset == TextureCompressionPreset::QUALITY;
+	const bool floatSource = source.Format == tpr::RenderFormat::R32G32B32A32_FLOAT;
+
+	// One task list across every level of every slice so the small levels ride along with the large ones
+	const uint32_t levelCount = source.MipCount * source.ArraySize;
+	std::vector<uint32_t> firstTask(levelCount + 1u);
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		const uint32_t blockRows = (source.GetMipHeight(level % source.MipCount) + 3u) / 4u;
+		firstTask[level + 1u] = firstTask[level] + (blockRows + KBlockRowsPerTask - 1u) / KBlockRowsPerTask;
+	}
+
+	Concurrency::parallel_for(0u, firstTask.back(), [&](uint32_t task)
+	{
+		const uint32_t level = (uint32_t)(std::upper_bound(firstTask.begin(), firstTask.end(), task) - firstTask.begin()) - 1u;
+		const uint32_t mip = level % source.MipCount;
+		const uint32_t slice = level / source.MipCount;
+
+		const uint32_t width = source.GetMipWidth(mip);
+		const uint32_t height = source.GetMipHeight(mip);
+		const uint32_t blocksX = (width + 3u) / 4u;
+		const uint32_t blocksY = (height + 3u) / 4u;
+
+		const uint32_t rowStart = (task - firstTask[level]) * KBlockRowsPerTask;
+		const uint32_t rowEnd = std::min(rowStart + KBlockRowsPerTask, blocksY);
+
+		const uint8_t* src = source.GetMip(mip, slice);
+		uint8_t* dst = out.GetMip(mip, slice) + (size_t)rowStart * blocksX * blockBytes;
+
+		BlockTexels block;
+		for (uint32_t blockY = rowStart; blockY < rowEnd; blockY++)
+		{
+			for (uint32_t blockX = 0; blockX < blocksX; blockX++, dst += blockBytes)
+			{
+				FetchBlock(src, floatSource, width, height, blockX, blockY, block);
+				EncodeBlock(block, format, refine, dst);
+			}
+		}
+	});
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <Render/RenderTypes.h>
+
+#include <cstdint>
+
+struct TextureMipChain;
+
+enum class TextureCompressionPreset : uint8_t
+{
+	NONE,
+
+	// BC1/BC3 for colour, endpoints straight from the principal axis
+	FAST,
+
+	// BC7 for colour, endpoints refined by least squares
+	QUALITY,
+};
+
+// How the material samples an image, decides which channels a compressed format has to keep
+enum class TextureUsage : uint8_t
+{
+	COLOR,
+
+	// Tangent space XY, the shader rebuilds Z
+	NORMAL,
+
+	// Roughness in R and metallic in G, swizzled from gltf's G and B at load
+	METALLIC_ROUGHNESS,
+};
+
+tpr::RenderFormat TextureCompress_ChooseFormat(TextureUsage usage, TextureCompressionPreset preset, bool hasAlpha);
+
+// Block compressed levels must start 4x4 aligned, smaller levels are padded out to a block
+bool TextureCompress_CanCompress(uint32_t width, uint32_t height);
+
+// Encodes every level and slice of `source` as `format`, block rows are spread over the worker threads. BC6H_UF16 takes
+// an R32G32B32A32_FLOAT source, every other format RGBA8.
+void TextureCompress_Encode(const TextureMipChain& source, tpr::RenderFormat format, TextureCompressionPreset preset, TextureMipChain& out);
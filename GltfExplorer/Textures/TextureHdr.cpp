@@ -0,0 +1,218 @@
+#include "TextureHdr.h"
+
+#include "TextureMips.h"
+
+#include "../Profiler/Profiler.h"
+
+#include <ParallelFor.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Cube face rows in one resample task
+static constexpr uint32_t KCubeRowsPerTask = 16u;
+
+uint16_t TextureHdr_FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	const uint32_t sign = (bits >> 16u) & 0x8000u;
+	bits &= 0x7FFFFFFFu;
+
+	// NaN has no meaningful radiance
+	if (bits > 0x7F800000u)
+		return 0u;
+
+	// 65504 and up, including infinity
+	if (bits >= 0x477FE000u)
+		return (uint16_t)(sign | 0x7BFFu);
+
+	uint32_t half;
+	uint32_t remainder;
+	uint32_t halfway;
+
+	if (bits < 0x38800000u)
+	{
+		// Below the smallest normal half, shifted into a denormal
+		if (bits < 0x33000000u)
+			return (uint16_t)sign;
+
+		const uint32_t mantissa = (bits & 0x7FFFFFu) | 0x800000u;
+		const uint32_t shift = 126u - (bits >> 23u);
+
+		half = mantissa >> shift;
+		remainder = mantissa & ((1u << shift) - 1u);
+		halfway = 1u << (shift - 1u);
+	}
+	else
+	{
+		half = (bits - 0x38000000u) >> 13u;
+		remainder = bits & 0x1FFFu;
+		halfway = 0x1000u;
+	}
+
+	if (remainder > halfway || (remainder == halfway && (half & 1u)))
+		half++;
+
+	return (uint16_t)(sign | half);
+}
+
+uint32_t TextureHdr_PackRgb9e5(const float rgb[3])
+{
+	// Largest value with a 9 bit mantissa and the top exponent, (511 / 512) * 2^16
+	static constexpr float KMaxValue = 65408.0f;
+
+	float clamped[3];
+	for (uint32_t c = 0; c < 3u; c++)
+		clamped[c] = std::clamp(std::isnan(rgb[c]) ? 0.0f : rgb[c], 0.0f, KMaxValue);
+
+	const float maxComponent = std::max(std::max(clamped[0], clamped[1]), clamped[2]);
+	if (maxComponent <= 0.0f)
+		return 0u;
+
+	int32_t exponent = std::max(-16, (int32_t)floorf(log2f(maxComponent))) + 16;
+	float scale = exp2f((float)(exponent - 24));
+
+	// Rounding the largest component can carry into the next exponent
+	if ((uint32_t)floorf(maxComponent / scale + 0.5f) == 512u)
+	{
+		scale *= 2.0f;
+		exponent++;
+	}
+
+	uint32_t packed = (uint32_t)exponent << 27u;
+	for (uint32_t c = 0; c < 3u; c++)
+		packed |= std::min((uint32_t)floorf(clamped[c] / scale + 0.5f), 511u) << (c * 9u);
+
+	return packed;
+}
+
+static void SampleEquirect(const float* pixels, uint32_t width, uint32_t height, float dx, float dy, float dz, float out[4])
+{
+	// Same mapping as the sky dome shader
+	const float u = atan2f(dz, dx) * 0.1591f + 0.5f;
+	const float v = asinf(std::clamp(-dy, -1.0f, 1.0f)) * 0.3183f + 0.5f;
+
+	const float fx = u * width - 0.5f;
+	const float fy = std::clamp(v * height - 0.5f, 0.0f, (float)(height - 1u));
+
+	const float x0f = floorf(fx);
+	const float y0f = floorf(fy);
+	const float tx = fx - x0f;
+	const float ty = fy - y0f;
+
+	// Wraps around the seam horizontally, clamps at the poles
+	const uint32_t x0 = (uint32_t)(((int32_t)x0f % (int32_t)width + (int32_t)width) % (int32_t)width);
+	const uint32_t x1 = (x0 + 1u) % width;
+	const uint32_t y0 = (uint32_t)y0f;
+	const uint32_t y1 = std::min(y0 + 1u, height - 1u);
+
+	const float* p00 = pixels + ((size_t)y0 * width + x0) * 4u;
+	const float* p10 = pixels + ((size_t)y0 * width + x1) * 4u;
+	const float* p01 = pixels + ((size_t)y1 * width + x0) * 4u;
+	const float* p11 = pixels + ((size_t)y1 * width + x1) * 4u;
+
+	for (uint32_t c = 0; c < 4u; c++)
+	{
+		const float top = p00[c] + (p10[c] - p00[c]) * tx;
+		const float bottom = p01[c] + (p11[c] - p01[c]) * tx;
+		out[c] = top + (bottom - top) * ty;
+	}
+}
+
+// Direction through a point on a face, u and v in -1..1 with v down the face
+static void GetCubeDirection(uint32_t face, float u, float v, float& x, float& y, float& z)
+{
+	switch (face)
+	{
+	case 0: x = 1.0f; y = -v; z = -u; break;
+	case 1: x = -1.0f; y = -v; z = u; break;
+	case 2: x = u; y = 1.0f; z = v; break;
+	case 3: x = u; y = -1.0f; z = -v; break;
+	case 4: x = u; y = -v; z = 1.0f; break;
+	default: x = -u; y = -v; z = -1.0f; break;
+	}
+
+	const float invLength = 1.0f / sqrtf(x * x + y * y + z * z);
+	x *= invLength;
+	y *= invLength;
+	z *= invLength;
+}
+
+void TextureHdr_EquirectToCube(const float* pixels, uint32_t width, uint32_t height, uint32_t faceSize, uint32_t mipCount, TextureMipChain& cube)
+{
+	PROFILE_ZONE("Equirect To Cube");
+
+	cube.Allocate(faceSize, faceSize, mipCount, tpr::RenderFormat::R32G32B32A32_FLOAT, 6u);
+
+	const uint32_t tasksPerFace = (faceSize + KCubeRowsPerTask - 1u) / KCubeRowsPerTask;
+
+	Concurrency::parallel_for(0u, tasksPerFace * 6u, [&](uint32_t task)
+	{
+		const uint32_t face = task / tasksPerFace;
+		const uint32_t rowStart = (task % tasksPerFace) * KCubeRowsPerTask;
+		const uint32_t rowEnd = std::min(rowStart + KCubeRowsPerTask, faceSize);
+
+		float* dst = (float*)cube.GetMip(0, face) + (size_t)rowStart * faceSize * 4u;
+
+		for (uint32_t y = rowStart; y < rowEnd; y++)
+		{
+			const float v = 2.0f * (y + 0.5f) / faceSize - 1.0f;
+			for (uint32_t x = 0; x < faceSize; x++, dst += 4)
+			{
+				const float u = 2.0f * (x + 0.5f) / faceSize - 1.0f;
+
+				float dx, dy, dz;
+				GetCubeDirection(face, u, v, dx, dy, dz);
+				SampleEquirect(pixels, width, height, dx, dy, dz, dst);
+			}
+		}
+	});
+}
+
+void TextureHdr_Encode(const TextureMipChain& source, HdrEncoding encoding, TextureMipChain& out)
+{
+	PROFILE_ZONE("Encode HDR Texture");
+
+	if (encoding == HdrEncoding::FLOAT32)
+	{
+		out = source;
+		return;
+	}
+
+	// Refinement costs little next to the decode for the one sky a scene has, and the result is cached
+	if (encoding == HdrEncoding::BC6H)
+	{
+		TextureCompress_Encode(source, tpr::RenderFormat::BC6H_UF16, TextureCompressionPreset::QUALITY, out);
+		return;
+	}
+
+	const tpr::RenderFormat format = encoding == HdrEncoding::FLOAT16 ? tpr::RenderFormat::R16G16B16A16_FLOAT : tpr::RenderFormat::R9G9B9E5_SHAREDEXP;
+	out.Allocate(source.Width, source.Height, source.MipCount, format, source.ArraySize);
+
+	const uint32_t levelCount = source.MipCount * source.ArraySize;
+
+	Concurrency::parallel_for(0u, levelCount, [&](uint32_t level)
+	{
+		const uint32_t mip = level % source.MipCount;
+		const uint32_t slice = level / source.MipCount;
+		const size_t texelCount = (size_t)source.GetMipWidth(mip) * source.GetMipHeight(mip);
+
+		const float* src = (const float*)source.GetMip(mip, slice);
+
+		if (encoding == HdrEncoding::FLOAT16)
+		{
+			uint16_t* dst = (uint16_t*)out.GetMip(mip, slice);
+			for (size_t i = 0; i < texelCount * 4u; i++)
+				dst[i] = TextureHdr_FloatToHalf(src[i]);
+		}
+		else
+		{
+			uint32_t* dst = (uint32_t*)out.GetMip(mip, slice);
+			for (size_t i = 0; i < texelCount; i++)
+				dst[i] = TextureHdr_PackRgb9e5(src + i * 4u);
+		}
+	});
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "TextureCompress.h"
+
+#include <cstdint>
+
+struct TextureMipChain;
+
+// How an HDR image is stored on the GPU. Float32 is 16 bytes a texel, the others trade precision for memory and
+// bandwidth: FP16 is 8 bytes, RGB9E5 4 bytes with a shared exponent and BC6H 1 byte, unsigned only.
+enum class HdrEncoding : uint8_t
+{
+	FLOAT32,
+	FLOAT16,
+	RGB9E5,
+	BC6H,
+};
+
+// Rounds to nearest even, values past the largest half (65504) clamp to it rather than becoming infinity
+uint16_t TextureHdr_FloatToHalf(float value);
+
+// Negative components clamp to 0, the largest representable component is 65408
+uint32_t TextureHdr_PackRgb9e5(const float rgb[3]);
+
+// Resamples an RGBA32F equirectangular image into the 6 faces of a cube, +X -X +Y -Y +Z -Z in D3D order, using the
+// mapping SkyDome.hlsl samples with. Fills level 0 of `cube`, faces are resampled in parallel.
+void TextureHdr_EquirectToCube(const float* pixels, uint32_t width, uint32_t height, uint32_t faceSize, uint32_t mipCount, TextureMipChain& cube);
+
+// Converts every level and slice of an RGBA32F chain. BC6H needs 4x4 aligned sizes, see TextureCompress_CanCompress.
+void TextureHdr_Encode(const TextureMipChain& source, HdrEncoding encoding, TextureMipChain& out);
@@ -0,0 +1,411 @@
+#include "TextureIbl.h"
+
+#include "TextureMips.h"
+
+#include "../Profiler/Profiler.h"
+
+#include <ParallelFor.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define TEXTURE_IBL_SSE 1
+#include <emmintrin.h>
+#else
+#define TEXTURE_IBL_SSE 0
+#endif
+
+static constexpr float KPi = 3.14159265359f;
+
+// Cube face rows in one prefilter task
+static constexpr uint32_t KIblRowsPerTask = 8u;
+
+static float RadicalInverse(uint32_t bits)
+{
+	bits = (bits << 16u) | (bits >> 16u);
+	bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+	bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+	bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+	bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+	return (float)bits * 2.3283064365386963e-10f;
+}
+
+// Half vector around +Z for the i'th of `count` Hammersley points, alpha is roughness squared like the shader
+static void ImportanceSampleGgx(uint32_t i, uint32_t count, float alpha, float h[3])
+{
+	const float phi = 2.0f * KPi * ((float)i / (float)count);
+	const float u = RadicalInverse(i);
+
+	const float cosTheta = sqrtf((1.0f - u) / (1.0f + (alpha * alpha - 1.0f) * u));
+	const float sinTheta = sqrtf(std::max(1.0f - cosTheta * cosTheta, 0.0f));
+
+	h[0] = sinTheta * cosf(phi);
+	h[1] = sinTheta * sinf(phi);
+	h[2] = cosTheta;
+}
+
+static float DistributionGgx(float nDotH, float alpha)
+{
+	const float alphaSq = alpha * alpha;
+	const float f = nDotH * nDotH * (alphaSq - 1.0f) + 1.0f;
+	return alphaSq / (KPi * f * f);
+}
+
+// V_GGX in GltfMesh.hlsl
+static float VisibilityGgx(float nDotL, float nDotV, float alpha)
+{
+	const float alphaSq = alpha * alpha;
+	const float ggxV = nDotL * sqrtf(nDotV * nDotV * (1.0f - alphaSq) + alphaSq);
+	const float ggxL = nDotV * sqrtf(nDotL * nDotL * (1.0f - alphaSq) + alphaSq);
+	const float ggx = ggxV + ggxL;
+	return ggx > 0.0f ? 0.5f / ggx : 0.0f;
+}
+
+void TextureIbl_ProjectIrradiance(const float* pixels, uint32_t width, uint32_t height, IblIrradianceSh& out)
+{
+	PROFILE_ZONE("Project Irradiance");
+
+	// Per row sums added up in order afterwards, so the result does not depend on scheduling
+	std::vector<float> rowSums((size_t)height * 27u);
+
+	Concurrency::parallel_for(0u, height, [&](uint32_t y)
+	{
+		// Inverse of the sky dome mapping, v = asin(-y) / pi + 0.5 and u = atan2(z, x) / 2pi + 0.5
+		const float latitude = ((y + 0.5f) / height - 0.5f) * KPi;
+		const float dirY = -sinf(latitude);
+		const float cosLatitude = cosf(latitude);
+
+		const float solidAngle = (2.0f * KPi / width) * (KPi / height) * cosLatitude;
+
+		float sums[27] = {};
+		const float* texel = pixels + (size_t)y * width * 4u;
+		for (uint32_t x = 0; x < width; x++, texel += 4)
+		{
+			const float phi = ((x + 0.5f) / width - 0.5f) * 2.0f * KPi;
+			const float dirX = cosf(phi) * cosLatitude;
+			const float dirZ = sinf(phi) * cosLatitude;
+
+			// Real SH basis without its constants, those are folded in below
+			const float basis[9] = {
+				1.0f,
+				dirY, dirZ, dirX,
+				dirX * dirY, dirY * dirZ, 3.0f * dirZ * dirZ - 1.0f, dirX * dirZ, dirX * dirX - dirY * dirY,
+			};
+
+			for (uint32_t i = 0; i < 9u; i++)
+				for (uint32_t c = 0; c < 3u; c++)
+					sums[i * 3u + c] += texel[c] * basis[i] * solidAngle;
+		}
+
+		std::copy(sums, sums + 27, rowSums.begin() + (size_t)y * 27u);
+	});
+
+	// Basis constant squared, once to project and once to evaluate, times the clamped cosine band (pi, 2pi/3, pi/4)
+	// and the 1/pi of the Lambertian BRDF
+	static constexpr float KBasis[9] = { 0.282095f, 0.488603f, 0.488603f, 0.488603f, 1.092548f, 1.092548f, 0.315392f, 1.092548f, 0.546274f };
+	static constexpr float KBand[9] = { 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+
+	out = {};
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t i = 0; i < 9u; i++)
+			for (uint32_t c = 0; c < 3u; c++)
+				out.Coefficients[i][c] += rowSums[(size_t)y * 27u + i * 3u + c];
+
+	for (uint32_t i = 0; i < 9u; i++)
+		for (uint32_t c = 0; c < 3u; c++)
+			out.Coefficients[i][c] *= KBasis[i] * KBasis[i] * KBand[i];
+}
+
+// Face and texel position of a direction, the inverse of the face directions in TextureHdr_EquirectToCube
+static void GetCubeFaceCoords(float x, float y, float z, uint32_t& face, float& u, float& v)
+{
+	const float ax = fabsf(x);
+	const float ay = fabsf(y);
+	const float az = fabsf(z);
+
+	if (ax >= ay && ax >= az)
+	{
+		face = x > 0.0f ? 0u : 1u;
+		u = (x > 0.0f ? -z : z) / ax;
+		v = -y / ax;
+	}
+	else if (ay >= az)
+	{
+		face = y > 0.0f ? 2u : 3u;
+		u = x / ay;
+		v = (y > 0.0f ? z : -z) / ay;
+	}
+	else
+	{
+		face = z > 0.0f ? 4u : 5u;
+		u = (z > 0.0f ? x : -x) / az;
+		v = -y / az;
+	}
+}
+
+// Bilinear within one face, samples near an edge clamp rather than reading the neighbouring face
+static void SampleCubeLevel(const TextureMipChain& cube, uint32_t face, uint32_t mip, float u, float v, float out[3])
+{
+	const uint32_t size = cube.GetMipWidth(mip);
+	const float* pixels = (const float*)cube.GetMip(mip, face);
+
+	const float fx = std::clamp((u * 0.5f + 0.5f) * size - 0.5f, 0.0f, (float)(size - 1u));
+	const float fy = std::clamp((v * 0.5f + 0.5f) * size - 0.5f, 0.0f, (float)(size - 1u));
+
+	const uint32_t x0 = (uint32_t)fx;
+	const uint32_t y0 = (uint32_t)fy;
+	const uint32_t x1 = std::min(x0 + 1u, size - 1u);
+	const uint32_t y1 = std::min(y0 + 1u, size - 1u);
+	const float tx = fx - x0;
+	const float ty = fy - y0;
+
+	const float* p00 = pixels + ((size_t)y0 * size + x0) * 4u;
+	const float* p10 = pixels + ((size_t)y0 * size + x1) * 4u;
+	const float* p01 = pixels + ((size_t)y1 * size + x0) * 4u;
+	const float* p11 = pixels + ((size_t)y1 * size + x1) * 4u;
+
+	for (uint32_t c = 0; c < 3u; c++)
+	{
+		const float top = p00[c] + (p10[c] - p00[c]) * tx;
+		const float bottom = p01[c] + (p11[c] - p01[c]) * tx;
+		out[c] = top + (bottom - top) * ty;
+	}
+}
+
+static void SampleCube(const TextureMipChain& cube, float x, float y, float z, float lod, float out[3])
+{
+	uint32_t face;
+	float u, v;
+	GetCubeFaceCoords(x, y, z, face, u, v);
+
+	lod = std::clamp(lod, 0.0f, (float)(cube.MipCount - 1u));
+	const uint32_t mip0 = (uint32_t)lod;
+	const uint32_t mip1 = std::min(mip0 + 1u, cube.MipCount - 1u);
+	const float t = lod - mip0;
+
+	SampleCubeLevel(cube, face, mip0, u, v, out);
+	if (t > 0.0f && mip1 != mip0)
+	{
+		float upper[3];
+		SampleCubeLevel(cube, face, mip1, u, v, upper);
+		for (uint32_t c = 0; c < 3u; c++)
+			out[c] += (upper[c] - out[c]) * t;
+	}
+}
+
+// Light directions around +Z for one roughness, structure of arrays padded to a multiple of 4 with zero weight
+struct IblSampleSet
+{
+	std::vector<float> X, Y, Z;
+	std::vector<float> Weight;
+	std::vector<float> Lod;
+	float TotalWeight = 0.0f;
+};
+
+static void BuildSampleSet(float roughness, uint32_t sampleCount, uint32_t sourceSize, IblSampleSet& set)
+{
+	const float alpha = std::max(roughness * roughness, 1e-4f);
+
+	// Solid angle of one texel of the source's top level
+	const float texelSolidAngle = 4.0f * KPi / (6.0f * sourceSize * sourceSize);
+
+	for (uint32_t i = 0; i < sampleCount; i++)
+	{
+		float h[3];
+		ImportanceSampleGgx(i, sampleCount, alpha, h);
+
+		// N = V = +Z, so L is H reflected about V and NdotH == VdotH
+		const float nDotH = h[2];
+		const float l[3] = { 2.0f * nDotH * h[0], 2.0f * nDotH * h[1], 2.0f * nDotH * nDotH - 1.0f };
+		if (l[2] <= 0.0f)
+			continue;
+
+		// Filtered importance sampling: read the mip whose texels cover the solid angle this sample stands for
+		const float pdf = DistributionGgx(nDotH, alpha) * 0.25f;
+		const float sampleSolidAngle = 1.0f / (sampleCount * pdf + 1e-6f);
+		const float lod = 0.5f * log2f(sampleSolidAngle / texelSolidAngle) + 1.0f;
+
+		set.X.push_back(l[0]);
+		set.Y.push_back(l[1]);
+		set.Z.push_back(l[2]);
+		set.Weight.push_back(l[2]);
+		set.Lod.push_back(lod);
+		set.TotalWeight += l[2];
+	}
+
+	while (set.X.size() % 4u)
+	{
+		set.X.push_back(0.0f);
+		set.Y.push_back(0.0f);
+		set.Z.push_back(1.0f);
+		set.Weight.push_back(0.0f);
+		set.Lod.push_back(0.0f);
+	}
+}
+
+static void PrefilterTexel(const TextureMipChain& source, const IblSampleSet& set, const float n[3], float out[4])
+{
+	// Tangent frame around the normal, samples are rotated into it 4 at a time
+	const float up[3] = { fabsf(n[2]) < 0.999f ? 0.0f : 1.0f, 0.0f, fabsf(n[2]) < 0.999f ? 1.0f : 0.0f };
+
+	float t[3] = { up[1] * n[2] - up[2] * n[1], up[2] * n[0] - up[0] * n[2], up[0] * n[1] - up[1] * n[0] };
+	const float tLength = 1.0f / sqrtf(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+	t[0] *= tLength;
+	t[1] *= tLength;
+	t[2] *= tLength;
+
+	const float b[3] = { n[1] * t[2] - n[2] * t[1], n[2] * t[0] - n[0] * t[2], n[0] * t[1] - n[1] * t[0] };
+
+	float sum[3] = {};
+
+	const size_t count = set.X.size();
+	for (size_t i = 0; i < count; i += 4u)
+	{
+		alignas(16) float dir[3][4];
+
+#if TEXTURE_IBL_SSE
+		const __m128 sx = _mm_loadu_ps(&set.X[i]);
+		const __m128 sy = _mm_loadu_ps(&set.Y[i]);
+		const __m128 sz = _mm_loadu_ps(&set.Z[i]);
+
+		for (uint32_t c = 0; c < 3u; c++)
+		{
+			const __m128 world = _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, _mm_set1_ps(t[c])), _mm_mul_ps(sy, _mm_set1_ps(b[c]))), _mm_mul_ps(sz, _mm_set1_ps(n[c])));
+			_mm_store_ps(dir[c], world);
+		}
+#else
+		for (uint32_t s = 0; s < 4u; s++)
+			for (uint32_t c = 0; c < 3u; c++)
+				dir[c][s] = set.X[i + s] * t[c] + set.Y[i + s] * b[c] + set.Z[i + s] * n[c];
+#endif
+
+		for (uint32_t s = 0; s < 4u; s++)
+		{
+			const float weight = set.Weight[i + s];
+			if (weight <= 0.0f)
+				continue;
+
+			float radiance[3];
+			SampleCube(source, dir[0][s], dir[1][s], dir[2][s], set.Lod[i + s], radiance);
+
+			for (uint32_t c = 0; c < 3u; c++)
+				sum[c] += radiance[c] * weight;
+		}
+	}
+
+	const float scale = set.TotalWeight > 0.0f ? 1.0f / set.TotalWeight : 0.0f;
+	out[0] = sum[0] * scale;
+	out[1] = sum[1] * scale;
+	out[2] = sum[2] * scale;
+	out[3] = 1.0f;
+}
+
+void TextureIbl_PrefilterSpecular(const TextureMipChain& source, uint32_t faceSize, uint32_t mipCount, uint32_t sampleCount, TextureMipChain& out)
+{
+	PROFILE_ZONE("Prefilter Specular");
+
+	out.Allocate(faceSize, faceSize, mipCount, tpr::RenderFormat::R32G32B32A32_FLOAT, 6u);
+
+	std::vector<IblSampleSet> sampleSets(mipCount);
+	for (uint32_t mip = 0; mip < mipCount; mip++)
+	{
+		const float roughness = mipCount > 1u ? (float)mip / (float)(mipCount - 1u) : 0.0f;
+
+		// A mirror only ever sees one direction
+		BuildSampleSet(roughness, mip == 0u ? 1u : sampleCount, source.Width, sampleSets[mip]);
+	}
+
+	// Rows of every face and mip in one list so the small mips ride along with the large ones
+	std::vector<uint32_t> firstTask(mipCount + 1u);
+	for (uint32_t mip = 0; mip < mipCount; mip++)
+		firstTask[mip + 1u] = firstTask[mip] + 6u * ((out.GetMipHeight(mip) + KIblRowsPerTask - 1u) / KIblRowsPerTask);
+
+	Concurrency::parallel_for(0u, firstTask.back(), [&](uint32_t task)
+	{
+		const uint32_t mip = (uint32_t)(std::upper_bound(firstTask.begin(), firstTask.end(), task) - firstTask.begin()) - 1u;
+		const uint32_t size = out.GetMipWidth(mip);
+		const uint32_t tasksPerFace = (size + KIblRowsPerTask - 1u) / KIblRowsPerTask;
+
+		const uint32_t face = (task - firstTask[mip]) / tasksPerFace;
+		const uint32_t rowStart = ((task - firstTask[mip]) % tasksPerFace) * KIblRowsPerTask;
+		const uint32_t rowEnd = std::min(rowStart + KIblRowsPerTask, size);
+
+		float* dst = (float*)out.GetMip(mip, face) + (size_t)rowStart * size * 4u;
+
+		for (uint32_t y = rowStart; y < rowEnd; y++)
+		{
+			const float v = 2.0f * (y + 0.5f) / size - 1.0f;
+			for (uint32_t x = 0; x < size; x++, dst += 4)
+			{
+				const float u = 2.0f * (x + 0.5f) / size - 1.0f;
+
+				// Face directions from TextureHdr_EquirectToCube
+				float n[3];
+				switch (face)
+				{
+				case 0: n[0] = 1.0f; n[1] = -v; n[2] = -u; break;
+				case 1: n[0] = -1.0f; n[1] = -v; n[2] = u; break;
+				case 2: n[0] = u; n[1] = 1.0f; n[2] = v; break;
+				case 3: n[0] = u; n[1] = -1.0f; n[2] = -v; break;
+				case 4: n[0] = u; n[1] = -v; n[2] = 1.0f; break;
+				default: n[0] = -u; n[1] = -v; n[2] = -1.0f; break;
+				}
+
+				const float invLength = 1.0f / sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				n[0] *= invLength;
+				n[1] *= invLength;
+				n[2] *= invLength;
+
+				PrefilterTexel(source, sampleSets[mip], n, dst);
+			}
+		}
+	});
+}
+
+void TextureIbl_BuildBrdfLut(uint32_t size, uint32_t sampleCount, TextureMipChain& out)
+{
+	PROFILE_ZONE("Build BRDF LUT");
+
+	out.Allocate(size, size, 1u, tpr::RenderFormat::R32G32_FLOAT);
+
+	Concurrency::parallel_for(0u, size, [&](uint32_t y)
+	{
+		const float roughness = (y + 0.5f) / size;
+		const float alpha = roughness * roughness;
+
+		float* dst = (float*)out.GetMip(0) + (size_t)y * size * 2u;
+
+		for (uint32_t x = 0; x < size; x++, dst += 2)
+		{
+			const float nDotV = (x + 0.5f) / size;
+			const float view[3] = { sqrtf(1.0f - nDotV * nDotV), 0.0f, nDotV };
+
+			float scale = 0.0f;
+			float bias = 0.0f;
+
+			for (uint32_t i = 0; i < sampleCount; i++)
+			{
+				float h[3];
+				ImportanceSampleGgx(i, sampleCount, alpha, h);
+
+				const float vDotH = view[0] * h[0] + view[1] * h[1] + view[2] * h[2];
+				const float nDotL = 2.0f * vDotH * h[2] - nDotV;
+				if (nDotL <= 0.0f || vDotH <= 0.0f)
+					continue;
+
+				// D cancels against the pdf, D * NdotH / (4 * VdotH), leaving the visibility term
+				const float nDotH = std::max(h[2], 1e-4f);
+				const float visibility = VisibilityGgx(nDotL, nDotV, alpha) * 4.0f * nDotL * vDotH / nDotH;
+				const float fresnel = powf(1.0f - vDotH, 5.0f);
+
+				scale += (1.0f - fresnel) * visibility;
+				bias += fresnel * visibility;
+			}
+
+			dst[0] = scale / sampleCount;
+			dst[1] = bias / sampleCount;
+		}
+	});
+}
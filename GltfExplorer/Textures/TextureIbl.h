@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+struct TextureMipChain;
+
+// Image based lighting baked from an HDR environment on the CPU. Diffuse is third order spherical harmonics, specular
+// the split sum approximation: a GGX prefiltered cubemap with one roughness per mip and a BRDF lookup table.
+
+// Cosine convolved irradiance divided by pi with the basis constants folded in, so the shader only evaluates the
+// polynomial. RGB per coefficient, W is padding for the constant buffer.
+struct IblIrradianceSh
+{
+	float Coefficients[9][4] = {};
+};
+
+// Projects an RGBA32F equirectangular image, mapped the way SkyDome.hlsl samples it. Rows are spread over the worker
+// threads, a few hundred texels across is plenty for 9 coefficients.
+void TextureIbl_ProjectIrradiance(const float* pixels, uint32_t width, uint32_t height, IblIrradianceSh& out);
+
+// Prefilters an RGBA32F cubemap with mips into `out`, roughness 0 in mip 0 to 1 in the last. Samples are GGX importance
+// sampled and read from the source mip matching their solid angle, 4 at a time with SSE.
+void TextureIbl_PrefilterSpecular(const TextureMipChain& source, uint32_t faceSize, uint32_t mipCount, uint32_t sampleCount, TextureMipChain& out);
+
+// R32G32 scale and bias applied to F0 by NdotV across and roughness down, using the same height correlated Smith term
+// as the direct lighting
+void TextureIbl_BuildBrdfLut(uint32_t size, uint32_t sampleCount, TextureMipChain& out);
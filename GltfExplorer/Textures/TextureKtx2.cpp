@@ -0,0 +1,304 @@
+#include "TextureKtx2.h"
+
+#include "TextureMips.h"
+
+#include "../Logging.h"
+#include "../Profiler/Profiler.h"
+
+#include <ParallelFor.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#ifndef GLTF_EXPLORER_BASISU
+#define GLTF_EXPLORER_BASISU 0
+#endif
+
+#if GLTF_EXPLORER_BASISU
+#include <basisu_transcoder.h>
+#include <zstd.h>
+
+#include <mutex>
+#endif
+
+static constexpr uint8_t KKtx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+enum class Ktx2Supercompression : uint32_t
+{
+	NONE = 0,
+	BASIS_LZ = 1,
+	ZSTD = 2,
+};
+
+struct Ktx2Header
+{
+	uint8_t Identifier[12];
+	uint32_t VkFormat;
+	uint32_t TypeSize;
+	uint32_t PixelWidth;
+	uint32_t PixelHeight;
+	uint32_t PixelDepth;
+	uint32_t LayerCount;
+	uint32_t FaceCount;
+	uint32_t LevelCount;
+	uint32_t SupercompressionScheme;
+
+	uint32_t DfdByteOffset;
+	uint32_t DfdByteLength;
+	uint32_t KvdByteOffset;
+	uint32_t KvdByteLength;
+	uint64_t SgdByteOffset;
+	uint64_t SgdByteLength;
+};
+static_assert(sizeof(Ktx2Header) == 80u, "KTX2 header must match the file layout");
+
+struct Ktx2LevelIndex
+{
+	uint64_t ByteOffset;
+	uint64_t ByteLength;
+	uint64_t UncompressedByteLength;
+};
+
+// The Vulkan formats gltf tooling writes for data that needs no transcoding. sRGB variants load as UNORM like every other
+// texture, the shader does its own conversion.
+static tpr::RenderFormat GetRenderFormat(uint32_t vkFormat)
+{
+	switch (vkFormat)
+	{
+	case 37u:  // VK_FORMAT_R8G8B8A8_UNORM
+	case 43u:  // VK_FORMAT_R8G8B8A8_SRGB
+		return tpr::RenderFormat::R8G8B8A8_UNORM;
+	case 131u: // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+	case 132u: // VK_FORMAT_BC1_RGB_SRGB_BLOCK
+	case 133u: // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+	case 134u: // VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+		return tpr::RenderFormat::BC1_UNORM;
+	case 137u: // VK_FORMAT_BC3_UNORM_BLOCK
+	case 138u: // VK_FORMAT_BC3_SRGB_BLOCK
+		return tpr::RenderFormat::BC3_UNORM;
+	case 139u: // VK_FORMAT_BC4_UNORM_BLOCK
+		return tpr::RenderFormat::BC4_UNORM;
+	case 141u: // VK_FORMAT_BC5_UNORM_BLOCK
+		return tpr::RenderFormat::BC5_UNORM;
+	case 145u: // VK_FORMAT_BC7_UNORM_BLOCK
+	case 146u: // VK_FORMAT_BC7_SRGB_BLOCK
+		return tpr::RenderFormat::BC7_UNORM;
+	default:
+		return tpr::RenderFormat::UNKNOWN;
+	}
+}
+
+static bool ReadHeader(const uint8_t* bytes, size_t size, Ktx2Header& header, const Ktx2LevelIndex*& levels)
+{
+	if (!Ktx2_IsKtx2(bytes, size) || size < sizeof(Ktx2Header))
+		return false;
+
+	memcpy(&header, bytes, sizeof(header));
+
+	if (header.PixelWidth == 0u || header.PixelHeight == 0u)
+		return false;
+
+	// A level count of 0 asks the loader to generate mips, only level 0 is stored. More levels than the chain down to 1x1
+	// would shift the size by 32 or more.
+	const uint32_t levelCount = std::max(header.LevelCount, 1u);
+	if (levelCount > TextureMips_GetFullMipCount(header.PixelWidth, header.PixelHeight))
+		return false;
+
+	if (size < sizeof(Ktx2Header) + levelCount * sizeof(Ktx2LevelIndex))
+		return false;
+
+	levels = (const Ktx2LevelIndex*)(bytes + sizeof(Ktx2Header));
+
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		if (levels[level].ByteOffset > size || levels[level].ByteLength > size - levels[level].ByteOffset)
+			return false;
+	}
+
+	return true;
+}
+
+static bool LoadRawLevels(const uint8_t* bytes, const Ktx2Header& header, const Ktx2LevelIndex* levels, TextureMipChain& chain)
+{
+	const tpr::RenderFormat format = GetRenderFormat(header.VkFormat);
+	if (format == tpr::RenderFormat::UNKNOWN)
+	{
+		LOGERROR("Ktx2_Load : vkFormat %u is not supported", header.VkFormat);
+		return false;
+	}
+
+	const Ktx2Supercompression scheme = (Ktx2Supercompression)header.SupercompressionScheme;
+	if (scheme != Ktx2Supercompression::NONE && (scheme != Ktx2Supercompression::ZSTD || !GLTF_EXPLORER_BASISU))
+	{
+		LOGERROR("Ktx2_Load : supercompression scheme %u is not supported", header.SupercompressionScheme);
+		return false;
+	}
+
+	const uint32_t levelCount = std::max(header.LevelCount, 1u);
+
+	// Every level has to hold exactly its image before anything is allocated for the chain
+	for (uint32_t mip = 0; mip < levelCount; mip++)
+	{
+		const size_t expected = TextureMips_GetLevelSize(format, std::max(header.PixelWidth >> mip, 1u), std::max(header.PixelHeight >> mip, 1u));
+		const uint64_t stored = scheme == Ktx2Supercompression::NONE ? levels[mip].ByteLength : levels[mip].UncompressedByteLength;
+
+		if (stored != expected)
+		{
+			LOGERROR("Ktx2_Load : level %u holds %llu bytes, a %ux%u image needs %zu", mip, (unsigned long long)stored,
+				std::max(header.PixelWidth >> mip, 1u), std::max(header.PixelHeight >> mip, 1u), expected);
+			return false;
+		}
+	}
+
+	chain.Allocate(header.PixelWidth, header.PixelHeight, levelCount, format);
+
+	std::atomic<bool> ok = true;
+
+	Concurrency::parallel_for(0u, chain.MipCount, [&](uint32_t mip)
+	{
+		const Ktx2LevelIndex& level = levels[mip];
+		const uint8_t* src = bytes + level.ByteOffset;
+		const size_t expected = chain.GetMipSize(mip);
+
+		if (scheme == Ktx2Supercompression::NONE)
+		{
+			memcpy(chain.GetMip(mip), src, expected);
+		}
+#if GLTF_EXPLORER_BASISU
+		else
+		{
+			const size_t written = ZSTD_decompress(chain.GetMip(mip), expected, src, (size_t)level.ByteLength);
+			if (ZSTD_isError(written) || written != expected)
+				ok = false;
+		}
+#endif
+	});
+
+	if (!ok)
+		LOGERROR("Ktx2_Load : level data does not match a %ux%u image", header.PixelWidth, header.PixelHeight);
+
+	return ok;
+}
+
+#if GLTF_EXPLORER_BASISU
+
+static void InitTranscoder()
+{
+	static std::once_flag initialised;
+	std::call_once(initialised, [] { basist::basisu_transcoder_init(); });
+}
+
+static basist::transcoder_texture_format GetTranscoderFormat(tpr::RenderFormat format)
+{
+	switch (format)
+	{
+	case tpr::RenderFormat::BC1_UNORM: return basist::transcoder_texture_format::cTFBC1_RGB;
+	case tpr::RenderFormat::BC3_UNORM: return basist::transcoder_texture_format::cTFBC3_RGBA;
+	case tpr::RenderFormat::BC7_UNORM: return basist::transcoder_texture_format::cTFBC7_RGBA;
+	default: return basist::transcoder_texture_format::cTFRGBA32;
+	}
+}
+
+static bool TranscodeBasisLevels(const uint8_t* bytes, size_t size, TextureUsage usage, TextureCompressionPreset preset, TextureMipChain& chain)
+{
+	InitTranscoder();
+
+	basist::ktx2_transcoder transcoder;
+	if (!transcoder.init(bytes, (uint32_t)size) || !transcoder.start_transcoding())
+	{
+		LOGERROR("Ktx2_Load : Basis payload failed to initialise");
+		return false;
+	}
+
+	const uint32_t width = transcoder.get_width();
+	const uint32_t height = transcoder.get_height();
+
+	// Data images come back as RGBA8, the loader moves their channels and encodes them
+	tpr::RenderFormat format = tpr::RenderFormat::R8G8B8A8_UNORM;
+	if (usage == TextureUsage::COLOR && TextureCompress_CanCompress(width, height))
+		format = TextureCompress_ChooseFormat(usage, preset, transcoder.get_has_alpha());
+
+	const basist::transcoder_texture_format target = GetTranscoderFormat(format);
+
+	chain.Allocate(width, height, std::max(transcoder.get_levels(), 1u), format);
+
+	std::atomic<bool> ok = true;
+
+	Concurrency::parallel_for(0u, chain.MipCount, [&](uint32_t mip)
+	{
+		// Each thread needs its own state, the transcoder itself is read only once started
+		basist::ktx2_transcoder_state state;
+
+		const bool block = target != basist::transcoder_texture_format::cTFRGBA32;
+		const uint32_t outputSize = (uint32_t)(chain.GetMipSize(mip) / (block ? basist::basis_get_bytes_per_block_or_pixel(target) : 4u));
+
+		if (!transcoder.transcode_image_level(mip, 0u, 0u, chain.GetMip(mip), outputSize, target, 0u, 0u, 0u, -1, -1, &state))
+			ok = false;
+	});
+
+	if (!ok)
+		LOGERROR("Ktx2_Load : failed to transcode a %ux%u Basis image", width, height);
+
+	return ok;
+}
+
+#endif
+
+bool Ktx2_IsKtx2(const void* pData, size_t size)
+{
+	return size >= sizeof(KKtx2Identifier) && memcmp(pData, KKtx2Identifier, sizeof(KKtx2Identifier)) == 0;
+}
+
+bool Ktx2_GetSize(const void* pData, size_t size, uint32_t& width, uint32_t& height)
+{
+	Ktx2Header header;
+	const Ktx2LevelIndex* levels = nullptr;
+	if (!ReadHeader((const uint8_t*)pData, size, header, levels))
+		return false;
+
+	width = header.PixelWidth;
+	height = header.PixelHeight;
+	return true;
+}
+
+bool Ktx2_CanTranscodeBasis()
+{
+	return GLTF_EXPLORER_BASISU != 0;
+}
+
+bool Ktx2_Load(const void* pData, size_t size, TextureUsage usage, TextureCompressionPreset preset, TextureMipChain& chain)
+{
+	PROFILE_ZONE("Load Ktx2");
+
+	const uint8_t* bytes = (const uint8_t*)pData;
+
+	Ktx2Header header;
+	const Ktx2LevelIndex* levels = nullptr;
+	if (!ReadHeader(bytes, size, header, levels))
+	{
+		LOGERROR("Ktx2_Load : not a valid KTX2 file");
+		return false;
+	}
+
+	if (header.PixelDepth > 1u || header.LayerCount > 1u || header.FaceCount != 1u)
+	{
+		LOGERROR("Ktx2_Load : only single 2D images are supported");
+		return false;
+	}
+
+	// Basis payloads have no Vulkan format, the data format descriptor says ETC1S or UASTC
+	if (header.VkFormat == 0u)
+	{
+#if GLTF_EXPLORER_BASISU
+		return TranscodeBasisLevels(bytes, size, usage, preset, chain);
+#else
+		(void)usage;
+		(void)preset;
+		LOGERROR("Ktx2_Load : Basis payload needs the transcoder, configure with GLTF_EXPLORER_BASISU_DIR");
+		return false;
+#endif
+	}
+
+	return LoadRawLevels(bytes, header, levels, chain);
+}
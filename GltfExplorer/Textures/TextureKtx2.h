@@ -0,0 +1,24 @@
+#pragma once
+
+#include "TextureCompress.h"
+
+#include <cstddef>
+#include <cstdint>
+
+struct TextureMipChain;
+
+// KTX2 containers holding one 2D image. Uncompressed RGBA8 and BC payloads are copied out as they are, Basis Universal
+// payloads (BasisLZ/ETC1S and UASTC) need the transcoder, compiled in when GLTF_EXPLORER_BASISU_DIR is set.
+
+bool Ktx2_IsKtx2(const void* pData, size_t size);
+
+// Size of level 0 from the header alone, false when it is not a container this loader reads
+bool Ktx2_GetSize(const void* pData, size_t size, uint32_t& width, uint32_t& height);
+
+// False when Basis payloads cannot be read, gltf textures then use their fallback image instead
+bool Ktx2_CanTranscodeBasis();
+
+// Fills `chain` with every level stored in the container, levels are transcoded in parallel. Colour images are
+// transcoded straight to the block format the preset picks, data images to RGBA8 so the loader can swizzle and encode
+// them. Returns false for containers this loader does not handle.
+bool Ktx2_Load(const void* pData, size_t size, TextureUsage usage, TextureCompressionPreset preset, TextureMipChain& chain);
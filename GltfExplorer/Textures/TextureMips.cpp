@@ -0,0 +1,459 @@
+#include "TextureMips.h"
+
+#include "../Profiler/Profiler.h"
+
+#include <ParallelFor.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define TEXTURE_MIPS_SSE 1
+#include <emmintrin.h>
+#else
+#define TEXTURE_MIPS_SSE 0
+#endif
+
+// Levels with fewer texels than this are not worth handing out to other threads
+static constexpr uint32_t KParallelMinTexels = 256u * 256u;
+static constexpr uint32_t KParallelRowsPerTask = 32u;
+
+struct SrgbTables
+{
+	float SrgbToLinear[256];
+
+	// Linear value halfway between each sRGB byte and the next, encoding rounds to the nearest byte in sRGB space
+	float SrgbMidpoints[255];
+
+	// First guess at the encoded byte for linear values in 1/4096 steps, corrected against the midpoints
+	uint8_t LinearToSrgbGuess[4097];
+};
+
+static SrgbTables BuildSrgbTables()
+{
+	SrgbTables tables;
+
+	auto Decode = [](double s)
+	{
+		return s <= 0.04045 ? s / 12.92 : pow((s + 0.055) / 1.055, 2.4);
+	};
+
+	for (uint32_t i = 0; i < 256; i++)
+		tables.SrgbToLinear[i] = (float)Decode(i / 255.0);
+
+	for (uint32_t i = 0; i < 255; i++)
+		tables.SrgbMidpoints[i] = (float)Decode((i + 0.5) / 255.0);
+
+	uint32_t guess = 0;
+	for (uint32_t i = 0; i <= 4096; i++)
+	{
+		while (guess < 255 && tables.SrgbMidpoints[guess] <= i / 4096.0f)
+			guess++;
+		tables.LinearToSrgbGuess[i] = (uint8_t)guess;
+	}
+
+	return tables;
+}
+
+static const SrgbTables GSrgbTables = BuildSrgbTables();
+
+static inline uint8_t EncodeSrgb(float linear)
+{
+	linear = std::clamp(linear, 0.0f, 1.0f);
+
+	// The guess is the byte for the start of the 1/4096 step, a step can span a couple of bytes near black
+	uint32_t s = GSrgbTables.LinearToSrgbGuess[(uint32_t)(linear * 4096.0f)];
+	while (s < 255 && GSrgbTables.SrgbMidpoints[s] <= linear)
+		s++;
+
+	return (uint8_t)s;
+}
+
+static inline uint8_t EncodeUnorm(float value)
+{
+	return (uint8_t)(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+// Up to three source texels feed one destination texel along each axis
+struct MipTaps
+{
+	uint32_t Index[3];
+	float Weight[3];
+	uint32_t Count;
+};
+
+static MipTaps GetMipTaps(uint32_t dst, uint32_t srcSize, uint32_t dstSize)
+{
+	if (srcSize == 1u)
+		return { { 0u, 0u, 0u }, { 1.0f, 0.0f, 0.0f }, 1u };
+
+	if ((srcSize & 1u) && dst == dstSize - 1u)
+		return { { 2u * dst, 2u * dst + 1u, 2u * dst + 2u }, { 1.0f / 3.0f, 1.0f / 3.0f, 1.0f / 3.0f }, 3u };
+
+	return { { 2u * dst, 2u * dst + 1u, 0u }, { 0.5f, 0.5f, 0.0f }, 2u };
+}
+
+#if TEXTURE_MIPS_SSE
+
+struct MipTexel
+{
+	__m128 V;
+};
+
+static inline MipTexel MipTexel_Zero() { return { _mm_setzero_ps() }; }
+
+static inline MipTexel MipTexel_MulAdd(MipTexel acc, const MipTexel& t, float w)
+{
+	return { _mm_add_ps(acc.V, _mm_mul_ps(t.V, _mm_set1_ps(w))) };
+}
+
+static inline void MipTexel_Store(const MipTexel& t, float out[4])
+{
+	_mm_storeu_ps(out, t.V);
+}
+
+static inline MipTexel MipTexel_Set(float r, float g, float b, float a)
+{
+	return { _mm_setr_ps(r, g, b, a) };
+}
+
+static inline MipTexel MipTexel_Load(const float in[4])
+{
+	return { _mm_loadu_ps(in) };
+}
+
+#else
+
+struct MipTexel
+{
+	float V[4];
+};
+
+static inline MipTexel MipTexel_Zero() { return { { 0.0f, 0.0f, 0.0f, 0.0f } }; }
+
+static inline MipTexel MipTexel_MulAdd(MipTexel acc, const MipTexel& t, float w)
+{
+	for (uint32_t c = 0; c < 4; c++)
+		acc.V[c] += t.V[c] * w;
+	return acc;
+}
+
+static inline void MipTexel_Store(const MipTexel& t, float out[4])
+{
+	memcpy(out, t.V, sizeof(t.V));
+}
+
+static inline MipTexel MipTexel_Set(float r, float g, float b, float a)
+{
+	return { { r, g, b, a } };
+}
+
+static inline MipTexel MipTexel_Load(const float in[4])
+{
+	return { { in[0], in[1], in[2], in[3] } };
+}
+
+#endif
+
+static void DecodeRow(const uint8_t* src, uint32_t width, bool srgb, MipTexel* out)
+{
+	constexpr float InvByte = 1.0f / 255.0f;
+
+	if (srgb)
+	{
+		for (uint32_t x = 0; x < width; x++, src += 4)
+			out[x] = MipTexel_Set(GSrgbTables.SrgbToLinear[src[0]], GSrgbTables.SrgbToLinear[src[1]], GSrgbTables.SrgbToLinear[src[2]], src[3] * InvByte);
+	}
+	else
+	{
+		for (uint32_t x = 0; x < width; x++, src += 4)
+			out[x] = MipTexel_Set(src[0] * InvByte, src[1] * InvByte, src[2] * InvByte, src[3] * InvByte);
+	}
+}
+
+// Filters destination rows [rowStart, rowEnd) of one level
+static void FilterRows(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight,
+	bool srgb, uint32_t rowStart, uint32_t rowEnd)
+{
+	std::vector<MipTexel> rows[3];
+	for (std::vector<MipTexel>& row : rows)
+		row.resize(srcWidth);
+
+	std::vector<MipTexel> filtered(srcWidth);
+
+	for (uint32_t y = rowStart; y < rowEnd; y++)
+	{
+		const MipTaps vertical = GetMipTaps(y, srcHeight, dstHeight);
+
+		for (uint32_t t = 0; t < vertical.Count; t++)
+			DecodeRow(src + (size_t)vertical.Index[t] * srcWidth * 4u, srcWidth, srgb, rows[t].data());
+
+		for (uint32_t x = 0; x < srcWidth; x++)
+		{
+			MipTexel sum = MipTexel_Zero();
+			for (uint32_t t = 0; t < vertical.Count; t++)
+				sum = MipTexel_MulAdd(sum, rows[t][x], vertical.Weight[t]);
+			filtered[x] = sum;
+		}
+
+		uint8_t* out = dst + (size_t)y * dstWidth * 4u;
+		for (uint32_t x = 0; x < dstWidth; x++, out += 4)
+		{
+			const MipTaps horizontal = GetMipTaps(x, srcWidth, dstWidth);
+
+			MipTexel sum = MipTexel_Zero();
+			for (uint32_t t = 0; t < horizontal.Count; t++)
+				sum = MipTexel_MulAdd(sum, filtered[horizontal.Index[t]], horizontal.Weight[t]);
+
+			float texel[4];
+			MipTexel_Store(sum, texel);
+
+			if (srgb)
+			{
+				out[0] = EncodeSrgb(texel[0]);
+				out[1] = EncodeSrgb(texel[1]);
+				out[2] = EncodeSrgb(texel[2]);
+			}
+			else
+			{
+				out[0] = EncodeUnorm(texel[0]);
+				out[1] = EncodeUnorm(texel[1]);
+				out[2] = EncodeUnorm(texel[2]);
+			}
+			out[3] = EncodeUnorm(texel[3]);
+		}
+	}
+}
+
+// FilterRows for RGBA32F levels, HDR data is linear and needs no conversion either way
+static void FilterRowsFloat(const float* src, uint32_t srcWidth, uint32_t srcHeight, float* dst, uint32_t dstWidth, uint32_t dstHeight,
+	uint32_t rowStart, uint32_t rowEnd)
+{
+	std::vector<MipTexel> filtered(srcWidth);
+
+	for (uint32_t y = rowStart; y < rowEnd; y++)
+	{
+		const MipTaps vertical = GetMipTaps(y, srcHeight, dstHeight);
+
+		for (uint32_t x = 0; x < srcWidth; x++)
+		{
+			MipTexel sum = MipTexel_Zero();
+			for (uint32_t t = 0; t < vertical.Count; t++)
+				sum = MipTexel_MulAdd(sum, MipTexel_Load(src + ((size_t)vertical.Index[t] * srcWidth + x) * 4u), vertical.Weight[t]);
+			filtered[x] = sum;
+		}
+
+		float* out = dst + (size_t)y * dstWidth * 4u;
+		for (uint32_t x = 0; x < dstWidth; x++, out += 4)
+		{
+			const MipTaps horizontal = GetMipTaps(x, srcWidth, dstWidth);
+
+			MipTexel sum = MipTexel_Zero();
+			for (uint32_t t = 0; t < horizontal.Count; t++)
+				sum = MipTexel_MulAdd(sum, filtered[horizontal.Index[t]], horizontal.Weight[t]);
+
+			MipTexel_Store(sum, out);
+		}
+	}
+}
+
+static void CountAlpha(const uint8_t* pixels, size_t texelCount, uint64_t histogram[256])
+{
+	memset(histogram, 0, sizeof(uint64_t) * 256u);
+	for (size_t i = 0; i < texelCount; i++)
+		histogram[pixels[i * 4u + 3u]]++;
+}
+
+// Scales alpha so the share of texels passing the test matches `targetCoverage`. With a scale of cutoff / t every texel with alpha at or
+// above t passes, so the search is for the t whose count is closest.
+static void PreserveAlphaCoverage(uint8_t* pixels, size_t texelCount, float cutoff, double targetCoverage)
+{
+	uint64_t histogram[256];
+	CountAlpha(pixels, texelCount, histogram);
+
+	const double target = targetCoverage * (double)texelCount;
+
+	uint32_t bestThreshold = 0;
+	double bestError = DBL_MAX;
+	uint64_t passing = 0;
+	for (uint32_t t = 255; t >= 1; t--)
+	{
+		passing += histogram[t];
+
+		const double error = fabs((double)passing - target);
+		if (error < bestError)
+		{
+			bestError = error;
+			bestThreshold = t;
+		}
+	}
+
+	if (bestThreshold == 0)
+		return;
+
+	const float scale = cutoff * 255.0f / (float)bestThreshold;
+	const uint8_t firstPassing = (uint8_t)ceilf(cutoff * 255.0f);
+
+	// Rounding must not move a texel across the cutoff
+	uint8_t remap[256];
+	for (uint32_t a = 0; a < 256; a++)
+	{
+		const uint8_t scaled = EncodeUnorm(a * scale / 255.0f);
+		remap[a] = a >= bestThreshold ? std::max(scaled, firstPassing) : std::min(scaled, (uint8_t)(firstPassing - 1u));
+	}
+
+	for (size_t i = 0; i < texelCount; i++)
+		pixels[i * 4u + 3u] = remap[pixels[i * 4u + 3u]];
+}
+
+size_t TextureMipChain::GetMipSize(uint32_t mip) const
+{
+	return TextureMips_GetLevelSize(Format, GetMipWidth(mip), GetMipHeight(mip));
+}
+
+void TextureMipChain::Allocate(uint32_t width, uint32_t height, uint32_t mipCount, tpr::RenderFormat format, uint32_t arraySize)
+{
+	Width = width;
+	Height = height;
+	MipCount = mipCount;
+	ArraySize = arraySize;
+	Format = format;
+
+	Offsets.resize((size_t)mipCount * arraySize);
+
+	size_t size = 0;
+	for (uint32_t slice = 0; slice < arraySize; slice++)
+	{
+		for (uint32_t mip = 0; mip < mipCount; mip++)
+		{
+			Offsets[slice * mipCount + mip] = size;
+			size += GetMipSize(mip);
+		}
+	}
+
+	Pixels.resize(size);
+}
+
+uint32_t TextureMips_GetFullMipCount(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+	for (uint32_t size = std::max(width, height); size > 1u; size >>= 1u)
+		count++;
+	return count;
+}
+
+size_t TextureMips_GetLevelSize(tpr::RenderFormat format, uint32_t width, uint32_t height)
+{
+	const size_t blocks = (size_t)((width + 3u) / 4u) * ((height + 3u) / 4u);
+
+	switch (format)
+	{
+	case tpr::RenderFormat::BC1_UNORM:
+	case tpr::RenderFormat::BC4_UNORM:
+		return blocks * 8u;
+	case tpr::RenderFormat::BC3_UNORM:
+	case tpr::RenderFormat::BC5_UNORM:
+	case tpr::RenderFormat::BC6H_UF16:
+	case tpr::RenderFormat::BC7_UNORM:
+		return blocks * 16u;
+	case tpr::RenderFormat::R32G32B32A32_FLOAT:
+		return (size_t)width * height * 16u;
+	case tpr::RenderFormat::R16G16B16A16_FLOAT:
+	case tpr::RenderFormat::R32G32_FLOAT:
+		return (size_t)width * height * 8u;
+	case tpr::RenderFormat::R8G8_UNORM:
+		return (size_t)width * height * 2u;
+	case tpr::RenderFormat::R8_UNORM:
+		return (size_t)width * height;
+	default:
+		return (size_t)width * height * 4u;
+	}
+}
+
+void TextureMips_Generate(const uint8_t* pixels, uint32_t width, uint32_t height, const TextureMipParams& params, TextureMipChain& chain)
+{
+	PROFILE_ZONE("Generate Mips");
+
+	chain.Allocate(width, height, TextureMips_GetFullMipCount(width, height));
+	memcpy(chain.GetMip(0), pixels, (size_t)width * height * 4u);
+
+	const bool preserveCoverage = params.AlphaCutoff > 0.0f;
+
+	double coverage = 0.0;
+	if (preserveCoverage)
+	{
+		uint64_t histogram[256];
+		CountAlpha(pixels, (size_t)width * height, histogram);
+
+		const uint32_t threshold = (uint32_t)ceilf(std::min(params.AlphaCutoff, 1.0f) * 255.0f);
+
+		uint64_t passing = 0;
+		for (uint32_t a = threshold; a < 256; a++)
+			passing += histogram[a];
+
+		coverage = (double)passing / ((double)width * height);
+	}
+
+	for (uint32_t mip = 1; mip < chain.MipCount; mip++)
+	{
+		const uint32_t srcWidth = chain.GetMipWidth(mip - 1u);
+		const uint32_t srcHeight = chain.GetMipHeight(mip - 1u);
+		const uint32_t dstWidth = chain.GetMipWidth(mip);
+		const uint32_t dstHeight = chain.GetMipHeight(mip);
+
+		const uint8_t* src = chain.GetMip(mip - 1u);
+		uint8_t* dst = chain.GetMip(mip);
+
+		if (dstWidth * dstHeight >= KParallelMinTexels)
+		{
+			const uint32_t taskCount = (dstHeight + KParallelRowsPerTask - 1u) / KParallelRowsPerTask;
+			Concurrency::parallel_for(0u, taskCount, [&](uint32_t task)
+			{
+				const uint32_t rowStart = task * KParallelRowsPerTask;
+				FilterRows(src, srcWidth, srcHeight, dst, dstWidth, dstHeight, params.Srgb, rowStart, std::min(rowStart + KParallelRowsPerTask, dstHeight));
+			});
+		}
+		else
+		{
+			FilterRows(src, srcWidth, srcHeight, dst, dstWidth, dstHeight, params.Srgb, 0u, dstHeight);
+		}
+
+		if (preserveCoverage)
+			PreserveAlphaCoverage(dst, (size_t)dstWidth * dstHeight, std::min(params.AlphaCutoff, 1.0f), coverage);
+	}
+}
+
+void TextureMips_GenerateFloatLevels(TextureMipChain& chain)
+{
+	PROFILE_ZONE("Generate Float Mips");
+
+	for (uint32_t slice = 0; slice < chain.ArraySize; slice++)
+	{
+		for (uint32_t mip = 1; mip < chain.MipCount; mip++)
+		{
+			const uint32_t srcWidth = chain.GetMipWidth(mip - 1u);
+			const uint32_t srcHeight = chain.GetMipHeight(mip - 1u);
+			const uint32_t dstWidth = chain.GetMipWidth(mip);
+			const uint32_t dstHeight = chain.GetMipHeight(mip);
+
+			const float* src = (const float*)chain.GetMip(mip - 1u, slice);
+			float* dst = (float*)chain.GetMip(mip, slice);
+
+			if (dstWidth * dstHeight >= KParallelMinTexels)
+			{
+				const uint32_t taskCount = (dstHeight + KParallelRowsPerTask - 1u) / KParallelRowsPerTask;
+				Concurrency::parallel_for(0u, taskCount, [&](uint32_t task)
+				{
+					const uint32_t rowStart = task * KParallelRowsPerTask;
+					FilterRowsFloat(src, srcWidth, srcHeight, dst, dstWidth, dstHeight, rowStart, std::min(rowStart + KParallelRowsPerTask, dstHeight));
+				});
+			}
+			else
+			{
+				FilterRowsFloat(src, srcWidth, srcHeight, dst, dstWidth, dstHeight, 0u, dstHeight);
+			}
+		}
+	}
+}
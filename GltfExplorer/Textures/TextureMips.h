@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Render/RenderTypes.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Every level of a texture, level 0 first, packed one after the other. Arrays and cubemaps store every level of a slice
+// before the next slice, the order D3D numbers subresources in. RGBA8 unless block compressed, a two channel data image or HDR.
+struct TextureMipChain
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t MipCount = 0;
+	uint32_t ArraySize = 1;
+	tpr::RenderFormat Format = tpr::RenderFormat::R8G8B8A8_UNORM;
+
+	std::vector<size_t> Offsets;
+	std::vector<uint8_t> Pixels;
+
+	uint32_t GetMipWidth(uint32_t mip) const { return Width >> mip ? Width >> mip : 1u; }
+	uint32_t GetMipHeight(uint32_t mip) const { return Height >> mip ? Height >> mip : 1u; }
+
+	const uint8_t* GetMip(uint32_t mip, uint32_t slice = 0) const { return Pixels.data() + Offsets[slice * MipCount + mip]; }
+	uint8_t* GetMip(uint32_t mip, uint32_t slice = 0) { return Pixels.data() + Offsets[slice * MipCount + mip]; }
+
+	size_t GetMipSize(uint32_t mip) const;
+
+	// Sizes every level for a texture of this size, the pixels are left uninitialised
+	void Allocate(uint32_t width, uint32_t height, uint32_t mipCount, tpr::RenderFormat format = tpr::RenderFormat::R8G8B8A8_UNORM, uint32_t arraySize = 1u);
+};
+
+struct TextureMipParams
+{
+	// Colour data, RGB is filtered in linear space and stored back as sRGB. Alpha is always linear.
+	bool Srgb = false;
+
+	// Above zero, every level keeps the share of texels passing this alpha test that level 0 has, so alpha tested
+	// foliage does not thin out with distance
+	float AlphaCutoff = 0.0f;
+};
+
+uint32_t TextureMips_GetFullMipCount(uint32_t width, uint32_t height);
+
+// Bytes in one level, block compressed formats round up to whole 4x4 blocks
+size_t TextureMips_GetLevelSize(tpr::RenderFormat format, uint32_t width, uint32_t height);
+
+// Builds the full chain down to 1x1 from `pixels`, each level a 2x2 box of the one above, 3 taps across odd sizes so
+// no texel is dropped. Large levels are filtered in parallel across rows.
+void TextureMips_Generate(const uint8_t* pixels, uint32_t width, uint32_t height, const TextureMipParams& params, TextureMipChain& chain);
+
+// Fills every level below the first of an R32G32B32A32_FLOAT chain with the same box filter, level 0 of each slice must
+// already be set
+void TextureMips_GenerateFloatLevels(TextureMipChain& chain);
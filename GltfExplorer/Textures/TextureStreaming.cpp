@@ -0,0 +1,235 @@
+#include "TextureStreaming.h"
+
+#include "TextureMips.h"
+
+#include "../Profiler/Profiler.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+uint32_t TextureStreamer::AddTexture(uint32_t width, uint32_t height, uint32_t mipCount, tpr::RenderFormat format)
+{
+	StreamedTexture texture;
+	texture.MipCount = std::clamp(mipCount, 1u, KMaxMips);
+	texture.RequestedMip = FLT_MAX;
+
+	// Block compressed textures can only start at a level that is still whole 4x4 blocks
+	const bool blockCompressed = TextureMips_GetLevelSize(format, 1u, 1u) == TextureMips_GetLevelSize(format, 4u, 4u);
+
+	uint32_t lastTop = 0u;
+	while (lastTop + 1u < texture.MipCount)
+	{
+		const uint32_t mipWidth = std::max(width >> (lastTop + 1u), 1u);
+		const uint32_t mipHeight = std::max(height >> (lastTop + 1u), 1u);
+
+		if (blockCompressed && (mipWidth % 4u || mipHeight % 4u))
+			break;
+
+		lastTop++;
+	}
+
+	uint32_t tailMip = 0u;
+	while (tailMip < lastTop && std::max(width >> tailMip, height >> tailMip) > Params.TailSize)
+		tailMip++;
+
+	texture.TailMip = tailMip;
+	texture.ResidentMip = tailMip;
+	texture.WantedMip = tailMip;
+
+	for (uint32_t mip = 0; mip < texture.MipCount; mip++)
+	{
+		texture.MipBytes[mip] = TextureMips_GetLevelSize(format, std::max(width >> mip, 1u), std::max(height >> mip, 1u));
+
+		if (mip >= tailMip)
+			Stats.ResidentBytes += texture.MipBytes[mip];
+	}
+
+	Stats.PeakResidentBytes = std::max(Stats.PeakResidentBytes, Stats.ResidentBytes);
+
+	Textures.push_back(texture);
+
+	return (uint32_t)Textures.size() - 1u;
+}
+
+void TextureStreamer::Request(uint32_t texture, float mip) noexcept
+{
+	StreamedTexture& streamed = Textures[texture];
+	streamed.RequestedMip = std::min(streamed.RequestedMip, mip);
+	streamed.Requested = true;
+}
+
+void TextureStreamer::StreamIn(StreamedTexture& texture)
+{
+	texture.ResidentMip--;
+	texture.Changed = true;
+
+	const uint64_t bytes = texture.MipBytes[texture.ResidentMip];
+
+	Stats.ResidentBytes += bytes;
+	Stats.PeakResidentBytes = std::max(Stats.PeakResidentBytes, Stats.ResidentBytes);
+	Stats.StreamedInBytes += bytes;
+	Stats.StreamedInMips++;
+}
+
+void TextureStreamer::Evict(StreamedTexture& texture)
+{
+	const uint64_t bytes = texture.MipBytes[texture.ResidentMip];
+
+	texture.ResidentMip++;
+	texture.Changed = true;
+
+	Stats.ResidentBytes -= bytes;
+	Stats.EvictedBytes += bytes;
+	Stats.EvictedMips++;
+}
+
+// Only levels finer than a texture asked for this update are given up, least recently requested first. Detail that is
+// wanted is never traded for another texture's, the one asking goes without instead.
+bool TextureStreamer::EvictFor(uint64_t bytes)
+{
+	if (EvictableBytes < bytes)
+		return false;
+
+	uint64_t freed = 0u;
+
+	while (freed < bytes && EvictionCursor < EvictionOrder.size())
+	{
+		StreamedTexture& victim = Textures[EvictionOrder[EvictionCursor]];
+
+		if (victim.ResidentMip >= victim.WantedMip)
+		{
+			EvictionCursor++;
+			continue;
+		}
+
+		const uint64_t victimBytes = victim.MipBytes[victim.ResidentMip];
+		freed += victimBytes;
+		EvictableBytes -= victimBytes;
+		Evict(victim);
+	}
+
+	return freed >= bytes;
+}
+
+void TextureStreamer::Update(std::vector<TextureResidencyChange>& changes)
+{
+	PROFILE_ZONE("Texture Streaming Update");
+
+	UpdateIndex++;
+
+	Stats.RequestedBytes = 0u;
+	Stats.RequestedTextures = 0u;
+	Stats.StarvedTextures = 0u;
+
+	for (StreamedTexture& texture : Textures)
+	{
+		texture.WantedMip = texture.TailMip;
+
+		if (texture.Requested)
+		{
+			const float mip = floorf(texture.RequestedMip + Params.MipBias);
+			texture.WantedMip = mip <= 0.0f ? 0u : std::min((uint32_t)mip, texture.TailMip);
+			texture.LastRequestUpdate = UpdateIndex;
+
+			Stats.RequestedTextures++;
+		}
+
+		texture.Requested = false;
+		texture.RequestedMip = FLT_MAX;
+
+		for (uint32_t mip = texture.WantedMip; mip < texture.MipCount; mip++)
+			Stats.RequestedBytes += texture.MipBytes[mip];
+	}
+
+	auto LeastRecentlyRequested = [this](uint32_t a, uint32_t b)
+	{
+		return Textures[a].LastRequestUpdate < Textures[b].LastRequestUpdate;
+	};
+
+	// A lowered budget takes detail from the least recently requested textures until it fits, wanted or not
+	if (Stats.ResidentBytes > Params.BudgetBytes)
+	{
+		EvictionOrder.clear();
+		for (uint32_t i = 0; i < (uint32_t)Textures.size(); i++)
+		{
+			if (Textures[i].ResidentMip < Textures[i].TailMip)
+				EvictionOrder.push_back(i);
+		}
+
+		std::stable_sort(EvictionOrder.begin(), EvictionOrder.end(), LeastRecentlyRequested);
+
+		for (const uint32_t i : EvictionOrder)
+		{
+			StreamedTexture& texture = Textures[i];
+			while (Stats.ResidentBytes > Params.BudgetBytes && texture.ResidentMip < texture.TailMip)
+				Evict(texture);
+		}
+	}
+
+	EvictionOrder.clear();
+	EvictionCursor = 0u;
+	EvictableBytes = 0u;
+
+	// Biggest shortfall first, one level at a time so a single texture cannot take the whole budget
+	StreamQueue.clear();
+
+	for (uint32_t i = 0; i < (uint32_t)Textures.size(); i++)
+	{
+		const StreamedTexture& texture = Textures[i];
+
+		if (texture.ResidentMip < texture.WantedMip)
+		{
+			EvictionOrder.push_back(i);
+
+			for (uint32_t mip = texture.ResidentMip; mip < texture.WantedMip; mip++)
+				EvictableBytes += texture.MipBytes[mip];
+		}
+		else if (texture.ResidentMip > texture.WantedMip)
+			StreamQueue.emplace_back(texture.ResidentMip - texture.WantedMip, i);
+	}
+
+	std::make_heap(StreamQueue.begin(), StreamQueue.end());
+
+	std::stable_sort(EvictionOrder.begin(), EvictionOrder.end(), LeastRecentlyRequested);
+
+	uint64_t streamedBytes = 0u;
+
+	while (!StreamQueue.empty())
+	{
+		std::pop_heap(StreamQueue.begin(), StreamQueue.end());
+		const uint32_t i = StreamQueue.back().second;
+		StreamQueue.pop_back();
+
+		StreamedTexture& texture = Textures[i];
+		const uint64_t bytes = texture.MipBytes[texture.ResidentMip - 1u];
+
+		// At least one level goes in every update, however big
+		if (streamedBytes > 0u && streamedBytes + bytes > Params.MaxStreamInBytesPerUpdate)
+			break;
+
+		if (Stats.ResidentBytes + bytes > Params.BudgetBytes && !EvictFor(Stats.ResidentBytes + bytes - Params.BudgetBytes))
+		{
+			Stats.StarvedTextures++;
+			continue;
+		}
+
+		StreamIn(texture);
+		streamedBytes += bytes;
+
+		if (texture.ResidentMip > texture.WantedMip)
+		{
+			StreamQueue.emplace_back(texture.ResidentMip - texture.WantedMip, i);
+			std::push_heap(StreamQueue.begin(), StreamQueue.end());
+		}
+	}
+
+	for (uint32_t i = 0; i < (uint32_t)Textures.size(); i++)
+	{
+		if (Textures[i].Changed)
+		{
+			Textures[i].Changed = false;
+			changes.push_back(TextureResidencyChange{ i, Textures[i].ResidentMip });
+		}
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <Render/RenderTypes.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Decides which mips of each streamed texture should be in device memory. Callers request the most detailed mip every
+// texture needs each frame, Update streams in the largest shortfalls first and evicts the detail of the least recently
+// requested textures when the budget runs out. Nothing here touches the render API, the changes it returns are applied
+// by the owner, so the policy runs the same against the null backend.
+
+struct TextureStreamingParams
+{
+	// Device memory streamed textures may use, resident tails count towards it
+	uint64_t BudgetBytes = 512ull << 20u;
+
+	// Caps the bytes streamed in by one update so a camera cut spreads its uploads over several frames
+	uint64_t MaxStreamInBytesPerUpdate = 32ull << 20u;
+
+	// Mips this size and smaller are resident from the start and never evicted
+	uint32_t TailSize = 64u;
+
+	// Added to every requested mip, positive values trade sharpness for memory
+	float MipBias = 0.0f;
+};
+
+struct TextureStreamingStats
+{
+	uint64_t ResidentBytes = 0;
+	uint64_t PeakResidentBytes = 0;
+
+	// Bytes every requested mip would need if they all fit
+	uint64_t RequestedBytes = 0;
+
+	// Totals since the streamer was created
+	uint64_t StreamedInBytes = 0;
+	uint64_t EvictedBytes = 0;
+	uint64_t StreamedInMips = 0;
+	uint64_t EvictedMips = 0;
+
+	// Last update
+	uint32_t RequestedTextures = 0;
+	uint32_t StarvedTextures = 0;
+};
+
+// A texture whose top resident level changed, it should be recreated from FirstMip down
+struct TextureResidencyChange
+{
+	uint32_t Texture = 0;
+	uint32_t FirstMip = 0;
+};
+
+class TextureStreamer
+{
+public:
+
+	void SetParams(const TextureStreamingParams& params) noexcept { Params = params; }
+	const TextureStreamingParams& GetParams() const noexcept { return Params; }
+
+	// Returns the texture's index. Its tail is resident straight away, GetResidentMip says which level to create it from.
+	uint32_t AddTexture(uint32_t width, uint32_t height, uint32_t mipCount, tpr::RenderFormat format);
+
+	uint32_t GetTextureCount() const noexcept { return (uint32_t)Textures.size(); }
+	uint32_t GetResidentMip(uint32_t texture) const noexcept { return Textures[texture].ResidentMip; }
+	uint32_t GetTailMip(uint32_t texture) const noexcept { return Textures[texture].TailMip; }
+
+	// Keeps the most detailed of every request made since the last update
+	void Request(uint32_t texture, float mip) noexcept;
+
+	// Ends the frame's requests and appends a change for every texture whose residency moved
+	void Update(std::vector<TextureResidencyChange>& changes);
+
+	const TextureStreamingStats& GetStats() const noexcept { return Stats; }
+
+private:
+
+	static constexpr uint32_t KMaxMips = 16u;
+
+	struct StreamedTexture
+	{
+		uint32_t MipCount = 1u;
+		uint32_t TailMip = 0u;
+		uint32_t ResidentMip = 0u;
+		uint32_t WantedMip = 0u;
+		float RequestedMip = 0.0f;
+		bool Requested = false;
+		bool Changed = false;
+		uint64_t LastRequestUpdate = 0u;
+		uint64_t MipBytes[KMaxMips] = {};
+	};
+
+	bool EvictFor(uint64_t bytes);
+	void StreamIn(StreamedTexture& texture);
+	void Evict(StreamedTexture& texture);
+
+	TextureStreamingParams Params;
+	TextureStreamingStats Stats;
+
+	std::vector<StreamedTexture> Textures;
+	uint64_t UpdateIndex = 0u;
+
+	// Kept between updates so they stop allocating. The queue is a max heap of shortfall in levels and texture index.
+	std::vector<std::pair<uint32_t, uint32_t>> StreamQueue;
+	std::vector<uint32_t> EvictionOrder;
+	size_t EvictionCursor = 0u;
+	uint64_t EvictableBytes = 0u;
+};
@@ -0,0 +1,779 @@
+// Writes synthetic glb scenes for loader, scene build, culling and submission scaling tests. Everything is generated
+// from the seed, the same options always produce the same file byte for byte. Geometry only uses sqrt so the output does
+// not depend on the platform's trig functions either.
+//
+// Each element draws from its own random stream keyed by seed and index, so growing one count (say --nodes) leaves the
+// meshes, materials and textures of a smaller run untouched and scaling curves compare like with like.
+
+#include <OpenFile.h>
+
+#include "../Logging.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cfloat>
+#include <cmath>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct SceneGenOptions
+{
+	const char* OutPath = nullptr;
+	uint64_t Seed = 1;
+	uint32_t Nodes = 1000;
+	uint32_t Instances = UINT32_MAX;
+	uint32_t Meshes = 16;
+	uint32_t PrimitivesPerMesh = 1;
+	uint32_t MinTriangles = 12;
+	uint32_t MaxTriangles = 2000;
+	uint32_t Materials = 16;
+	uint32_t Textures = 4;
+	uint32_t TextureSize = 64;
+	uint32_t Depth = 1;
+	uint32_t BlendPercent = 10;
+	float Extent = 0.0f;
+};
+
+// Streams keep the elements independent of each other, see the comment at the top
+enum class SceneGenStream : uint64_t
+{
+	NODE = 1,
+	MESH,
+	MATERIAL,
+	TEXTURE,
+};
+
+// SplitMix64, tiny and the same everywhere, unlike the std distributions
+struct SceneGenRandom
+{
+	uint64_t State = 0;
+
+	SceneGenRandom(uint64_t seed, SceneGenStream stream, uint64_t index)
+		: State(seed * 0x9E3779B97F4A7C15ull ^ ((uint64_t)stream << 56) ^ index)
+	{
+		Next();
+	}
+
+	uint64_t Next()
+	{
+		uint64_t z = (State += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	// [0, 1) with 24 bits, exactly representable
+	float Float() { return (float)(Next() >> 40) * (1.0f / 16777216.0f); }
+	float Range(float lo, float hi) { return lo + (hi - lo) * Float(); }
+	uint32_t Below(uint32_t n) { return n ? (uint32_t)(Next() % n) : 0u; }
+};
+
+// For short formatted pieces, anything past the buffer is cut off. Long strings are appended directly.
+static void Appendf(std::string& str, const char* fmt, ...)
+{
+	char buf[512];
+
+	va_list ap;
+	va_start(ap, fmt);
+	const int len = vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+
+	str.append(buf, (size_t)std::clamp(len, 0, (int)sizeof(buf) - 1));
+}
+
+static void AlignBinary(std::vector<uint8_t>& bin)
+{
+	bin.resize((bin.size() + 3u) & ~(size_t)3u, 0u);
+}
+
+static void AppendBinary(std::vector<uint8_t>& bin, const void* data, size_t size)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	bin.insert(bin.end(), bytes, bytes + size);
+}
+
+// Accumulates the buffer views and accessors as geometry and images are appended to the binary chunk
+struct SceneGenBuffers
+{
+	std::vector<uint8_t> Bin;
+	std::string BufferViews;
+	std::string Accessors;
+	uint32_t BufferViewCount = 0;
+	uint32_t AccessorCount = 0;
+
+	uint32_t AddBufferView(const void* data, size_t size)
+	{
+		AlignBinary(Bin);
+		Appendf(BufferViews, "%s{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}", BufferViewCount ? "," : "", Bin.size(), size);
+		AppendBinary(Bin, data, size);
+		return BufferViewCount++;
+	}
+
+	uint32_t AddAccessor(const void* data, size_t size, uint32_t componentType, size_t count, const char* type, const float* min = nullptr, const float* max = nullptr)
+	{
+		const uint32_t view = AddBufferView(data, size);
+
+		Appendf(Accessors, "%s{\"bufferView\":%u,\"componentType\":%u,\"count\":%zu,\"type\":\"%s\"", AccessorCount ? "," : "", view, componentType, count, type);
+		if (min && max)
+		{
+			Appendf(Accessors, ",\"min\":[%.9g,%.9g,%.9g],\"max\":[%.9g,%.9g,%.9g]", min[0], min[1], min[2], max[0], max[1], max[2]);
+		}
+		Accessors += '}';
+
+		return AccessorCount++;
+	}
+};
+
+struct SceneGenVertex
+{
+	float Position[3];
+	float Normal[3];
+	float Tangent[4];
+	float Uv[2];
+};
+
+// Cube projected onto a sphere, 12 * n * n triangles. Faces do not share vertices so each keeps its own uvs and tangents.
+static void BuildCubeSphere(uint32_t triangles, float radius, std::vector<SceneGenVertex>& vertices, std::vector<uint32_t>& indices)
+{
+	const uint32_t n = std::max(1u, (uint32_t)std::lround(std::sqrt((double)triangles / 12.0)));
+
+	// Face normal, u axis, v axis
+	static constexpr float Faces[6][3][3] =
+	{
+		{ { 1, 0, 0 }, { 0, 0,-1 }, { 0,-1, 0 } },
+		{ {-1, 0, 0 }, { 0, 0, 1 }, { 0,-1, 0 } },
+		{ { 0, 1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+		{ { 0,-1, 0 }, { 1, 0, 0 }, { 0, 0,-1 } },
+		{ { 0, 0, 1 }, { 1, 0, 0 }, { 0,-1, 0 } },
+		{ { 0, 0,-1 }, {-1, 0, 0 }, { 0,-1, 0 } },
+	};
+
+	vertices.clear();
+	indices.clear();
+	vertices.reserve(6u * (n + 1u) * (n + 1u));
+	indices.reserve(36u * n * n);
+
+	for (const auto& face : Faces)
+	{
+		const uint32_t base = (uint32_t)vertices.size();
+
+		for (uint32_t y = 0; y <= n; y++)
+		{
+			for (uint32_t x = 0; x <= n; x++)
+			{
+				const float u = (float)x / (float)n;
+				const float v = (float)y / (float)n;
+
+				float p[3];
+				for (uint32_t c = 0; c < 3; c++)
+					p[c] = face[0][c] + face[1][c] * (u * 2.0f - 1.0f) + face[2][c] * (v * 2.0f - 1.0f);
+
+				const float invLen = 1.0f / std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+
+				SceneGenVertex vertex = {};
+				for (uint32_t c = 0; c < 3; c++)
+				{
+					vertex.Normal[c] = p[c] * invLen;
+					vertex.Position[c] = vertex.Normal[c] * radius;
+				}
+
+				// Face u axis with the normal part removed
+				const float d = face[1][0] * vertex.Normal[0] + face[1][1] * vertex.Normal[1] + face[1][2] * vertex.Normal[2];
+				float t[3];
+				for (uint32_t c = 0; c < 3; c++)
+					t[c] = face[1][c] - vertex.Normal[c] * d;
+
+				const float invTLen = 1.0f / std::sqrt(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+				for (uint32_t c = 0; c < 3; c++)
+					vertex.Tangent[c] = t[c] * invTLen;
+				vertex.Tangent[3] = 1.0f;
+
+				vertex.Uv[0] = u;
+				vertex.Uv[1] = v;
+
+				vertices.push_back(vertex);
+			}
+		}
+
+		for (uint32_t y = 0; y < n; y++)
+		{
+			for (uint32_t x = 0; x < n; x++)
+			{
+				const uint32_t i0 = base + y * (n + 1u) + x;
+				const uint32_t i1 = i0 + 1u;
+				const uint32_t i2 = i0 + n + 1u;
+				const uint32_t i3 = i2 + 1u;
+
+				indices.insert(indices.end(), { i0, i1, i3, i0, i3, i2 });
+			}
+		}
+	}
+}
+
+static uint32_t AddPrimitiveGeometry(SceneGenBuffers& buffers, const std::vector<SceneGenVertex>& vertices, const std::vector<uint32_t>& indices, std::string& attributes)
+{
+	// Vertex streams are separate buffer views, the loader creates one vertex buffer per attribute
+	std::vector<float> stream;
+
+	auto AddStream = [&](size_t offset, uint32_t components, const char* type, bool bounds) -> uint32_t
+	{
+		stream.resize(vertices.size() * components);
+
+		float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		for (size_t v = 0; v < vertices.size(); v++)
+		{
+			const float* src = (const float*)((const uint8_t*)&vertices[v] + offset);
+			for (uint32_t c = 0; c < components; c++)
+			{
+				stream[v * components + c] = src[c];
+
+				if (bounds)
+				{
+					min[c] = std::min(min[c], src[c]);
+					max[c] = std::max(max[c], src[c]);
+				}
+			}
+		}
+
+		return buffers.AddAccessor(stream.data(), stream.size() * sizeof(float), 5126u, vertices.size(), type, bounds ? min : nullptr, bounds ? max : nullptr);
+	};
+
+	const uint32_t position = AddStream(offsetof(SceneGenVertex, Position), 3u, "VEC3", true);
+	const uint32_t normal = AddStream(offsetof(SceneGenVertex, Normal), 3u, "VEC3", false);
+	const uint32_t tangent = AddStream(offsetof(SceneGenVertex, Tangent), 4u, "VEC4", false);
+	const uint32_t uv = AddStream(offsetof(SceneGenVertex, Uv), 2u, "VEC2", false);
+
+	Appendf(attributes, "{\"POSITION\":%u,\"NORMAL\":%u,\"TANGENT\":%u,\"TEXCOORD_0\":%u}", position, normal, tangent, uv);
+
+	if (vertices.size() <= UINT16_MAX)
+	{
+		std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+		return buffers.AddAccessor(shortIndices.data(), shortIndices.size() * sizeof(uint16_t), 5123u, shortIndices.size(), "SCALAR");
+	}
+
+	return buffers.AddAccessor(indices.data(), indices.size() * sizeof(uint32_t), 5125u, indices.size(), "SCALAR");
+}
+
+static uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0u)
+{
+	static uint32_t table[256] = {};
+	if (table[1] == 0u)
+	{
+		for (uint32_t i = 0; i < 256u; i++)
+		{
+			uint32_t c = i;
+			for (uint32_t k = 0; k < 8u; k++)
+				c = c & 1u ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			table[i] = c;
+		}
+	}
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+		crc = table[(crc ^ data[i]) & 0xFFu] ^ (crc >> 8);
+	return ~crc;
+}
+
+static void AppendBigEndian(std::vector<uint8_t>& out, uint32_t value)
+{
+	out.insert(out.end(), { (uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value });
+}
+
+static void AppendPngChunk(std::vector<uint8_t>& png, const char type[4], const std::vector<uint8_t>& data)
+{
+	AppendBigEndian(png, (uint32_t)data.size());
+
+	const size_t start = png.size();
+	png.insert(png.end(), type, type + 4);
+	png.insert(png.end(), data.begin(), data.end());
+
+	AppendBigEndian(png, Crc32(png.data() + start, png.size() - start));
+}
+
+// RGB png with stored (uncompressed) deflate blocks. Bigger than it needs to be but decodes with any png reader and keeps
+// the tool free of a zlib dependency.
+static void EncodePng(const std::vector<uint8_t>& rgb, uint32_t width, uint32_t height, std::vector<uint8_t>& png)
+{
+	std::vector<uint8_t> raw;
+	raw.reserve((width * 3u + 1u) * height);
+	for (uint32_t y = 0; y < height; y++)
+	{
+		raw.push_back(0u);
+		raw.insert(raw.end(), rgb.begin() + y * width * 3u, rgb.begin() + (y + 1u) * width * 3u);
+	}
+
+	std::vector<uint8_t> zlib = { 0x78, 0x01 };
+	for (size_t offset = 0; offset < raw.size() || offset == 0; )
+	{
+		const size_t len = std::min<size_t>(raw.size() - offset, 65535u);
+		const bool final = offset + len == raw.size();
+
+		zlib.insert(zlib.end(), { (uint8_t)(final ? 1u : 0u), (uint8_t)len, (uint8_t)(len >> 8), (uint8_t)~len, (uint8_t)(~len >> 8) });
+		zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + len);
+
+		offset += len;
+		if (final)
+			break;
+	}
+
+	uint32_t a = 1u, b = 0u;
+	for (uint8_t byte : raw)
+	{
+		a = (a + byte) % 65521u;
+		b = (b + a) % 65521u;
+	}
+	AppendBigEndian(zlib, (b << 16) | a);
+
+	std::vector<uint8_t> ihdr;
+	AppendBigEndian(ihdr, width);
+	AppendBigEndian(ihdr, height);
+	ihdr.insert(ihdr.end(), { 8u, 2u, 0u, 0u, 0u });
+
+	png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	AppendPngChunk(png, "IHDR", ihdr);
+	AppendPngChunk(png, "IDAT", zlib);
+	AppendPngChunk(png, "IEND", {});
+}
+
+// Checkerboard of two random colours, different cell sizes so mips and sampling have something to chew on
+static void BuildTexture(const SceneGenOptions& options, uint32_t index, std::vector<uint8_t>& rgb)
+{
+	SceneGenRandom rng(options.Seed, SceneGenStream::TEXTURE, index);
+
+	uint8_t colours[2][3];
+	for (auto& colour : colours)
+		for (uint8_t& c : colour)
+			c = (uint8_t)rng.Below(256u);
+
+	const uint32_t size = options.TextureSize;
+	const uint32_t cell = std::max(1u, size >> (1u + rng.Below(4u)));
+
+	rgb.resize(size * size * 3u);
+	for (uint32_t y = 0; y < size; y++)
+	{
+		for (uint32_t x = 0; x < size; x++)
+		{
+			const uint8_t* colour = colours[((x / cell) + (y / cell)) & 1u];
+			memcpy(&rgb[(y * size + x) * 3u], colour, 3u);
+		}
+	}
+}
+
+// Nodes are numbered breadth first. The first `RootCount` are scene roots, node p has children
+// [RootCount + p * Branching, RootCount + (p + 1) * Branching). Branching is picked so the tree fits in Depth levels.
+struct SceneGenHierarchy
+{
+	uint32_t RootCount = 0;
+	uint32_t Branching = 0;
+
+	explicit SceneGenHierarchy(const SceneGenOptions& options)
+	{
+		if (options.Depth <= 1u)
+		{
+			RootCount = options.Nodes;
+			Branching = 0u;
+			return;
+		}
+
+		Branching = std::max(2u, (uint32_t)std::ceil(std::pow((double)options.Nodes, 1.0 / options.Depth) - 1e-9));
+		RootCount = std::min(Branching, options.Nodes);
+	}
+
+	uint64_t FirstChild(uint32_t node) const { return (uint64_t)RootCount + (uint64_t)node * Branching; }
+};
+
+static void WriteNodes(const SceneGenOptions& options, const SceneGenHierarchy& hierarchy, std::string& json)
+{
+	const uint32_t firstInstance = options.Nodes - options.Instances;
+
+	// Level of the node being written, nodes are breadth first so it only ever goes up
+	uint32_t level = 0;
+	uint64_t levelEnd = hierarchy.RootCount;
+	uint64_t levelSize = hierarchy.RootCount;
+
+	json += "\"nodes\":[";
+
+	for (uint32_t n = 0; n < options.Nodes; n++)
+	{
+		while (n >= levelEnd)
+		{
+			level++;
+			levelSize *= std::max(hierarchy.Branching, 1u);
+			levelEnd += levelSize;
+		}
+
+		SceneGenRandom rng(options.Seed, SceneGenStream::NODE, n);
+
+		// Roots spread over the ground, children cluster closer to their parent the deeper they are
+		const float spread = options.Extent / (float)(1u << std::min(level * 2u, 30u));
+
+		const float t[3] = { rng.Range(-spread, spread), rng.Range(0.0f, spread * 0.1f), rng.Range(-spread, spread) };
+
+		// Normalised random vector is a uniform enough rotation and avoids trig
+		float q[4];
+		float len = 0.0f;
+		do
+		{
+			len = 0.0f;
+			for (float& c : q)
+			{
+				c = rng.Range(-1.0f, 1.0f);
+				len += c * c;
+			}
+		} while (len < 0.01f || len > 1.0f);
+
+		const float invLen = 1.0f / std::sqrt(len);
+
+		const float s = rng.Range(0.8f, 1.25f);
+
+		Appendf(json, "%s{\"translation\":[%.6g,%.6g,%.6g],\"rotation\":[%.6g,%.6g,%.6g,%.6g],\"scale\":[%.6g,%.6g,%.6g]",
+			n ? "," : "", t[0], t[1], t[2], q[0] * invLen, q[1] * invLen, q[2] * invLen, q[3] * invLen, s, s, s);
+
+		if (n >= firstInstance)
+		{
+			Appendf(json, ",\"mesh\":%u", rng.Below(options.Meshes));
+		}
+
+		const uint64_t firstChild = hierarchy.FirstChild(n);
+		if (hierarchy.Branching && firstChild < options.Nodes)
+		{
+			const uint64_t lastChild = std::min<uint64_t>(firstChild + hierarchy.Branching, options.Nodes);
+
+			json += ",\"children\":[";
+			for (uint64_t c = firstChild; c < lastChild; c++)
+			{
+				Appendf(json, "%s%llu", c != firstChild ? "," : "", (unsigned long long)c);
+			}
+			json += ']';
+		}
+
+		json += '}';
+	}
+
+	json += ']';
+}
+
+static void WriteMeshes(const SceneGenOptions& options, SceneGenBuffers& buffers, std::string& json, uint64_t& triangleCount)
+{
+	std::vector<SceneGenVertex> vertices;
+	std::vector<uint32_t> indices;
+
+	json += "\"meshes\":[";
+
+	for (uint32_t m = 0; m < options.Meshes; m++)
+	{
+		SceneGenRandom rng(options.Seed, SceneGenStream::MESH, m);
+
+		Appendf(json, "%s{\"primitives\":[", m ? "," : "");
+
+		for (uint32_t p = 0; p < options.PrimitivesPerMesh; p++)
+		{
+			const uint32_t triangles = options.MinTriangles + rng.Below(options.MaxTriangles - options.MinTriangles + 1u);
+			const float radius = rng.Range(0.5f, 2.0f);
+
+			BuildCubeSphere(triangles, radius, vertices, indices);
+			triangleCount += indices.size() / 3u;
+
+			std::string attributes;
+			const uint32_t indexAccessor = AddPrimitiveGeometry(buffers, vertices, indices, attributes);
+
+			json += p ? ",{\"attributes\":" : "{\"attributes\":";
+			json += attributes;
+			Appendf(json, ",\"indices\":%u", indexAccessor);
+			Appendf(json, ",\"material\":%u", rng.Below(options.Materials));
+			json += '}';
+		}
+
+		json += "]}";
+	}
+
+	json += ']';
+}
+
+static void WriteMaterials(const SceneGenOptions& options, std::string& json)
+{
+	json += "\"materials\":[";
+
+	for (uint32_t m = 0; m < options.Materials; m++)
+	{
+		SceneGenRandom rng(options.Seed, SceneGenStream::MATERIAL, m);
+
+		// One draw per statement, argument evaluation order would make the output compiler dependent
+		const bool blend = rng.Below(100u) < options.BlendPercent;
+		const float alpha = blend ? rng.Range(0.25f, 0.75f) : 1.0f;
+		const float colour[3] = { rng.Float(), rng.Float(), rng.Float() };
+		const float metallic = rng.Float();
+		const float roughness = rng.Range(0.1f, 1.0f);
+
+		Appendf(json, "%s{\"pbrMetallicRoughness\":{\"baseColorFactor\":[%.6g,%.6g,%.6g,%.6g],\"metallicFactor\":%.6g,\"roughnessFactor\":%.6g",
+			m ? "," : "", colour[0], colour[1], colour[2], alpha, metallic, roughness);
+
+		if (options.Textures > 0)
+		{
+			Appendf(json, ",\"baseColorTexture\":{\"index\":%u}", rng.Below(options.Textures));
+		}
+		json += '}';
+
+		if (blend)
+		{
+			json += ",\"alphaMode\":\"BLEND\"";
+		}
+		json += '}';
+	}
+
+	json += ']';
+}
+
+// Writes nothing without textures, glTF does not allow empty arrays
+static void WriteTextures(const SceneGenOptions& options, SceneGenBuffers& buffers, std::string& json)
+{
+	if (options.Textures == 0)
+		return;
+
+	std::vector<uint8_t> rgb;
+	std::vector<uint8_t> png;
+
+	json += "\"images\":[";
+	for (uint32_t t = 0; t < options.Textures; t++)
+	{
+		BuildTexture(options, t, rgb);
+		EncodePng(rgb, options.TextureSize, options.TextureSize, png);
+
+		Appendf(json, "%s{\"bufferView\":%u,\"mimeType\":\"image/png\"}", t ? "," : "", buffers.AddBufferView(png.data(), png.size()));
+	}
+	json += "],";
+
+	json += "\"samplers\":[{\"magFilter\":9729,\"minFilter\":9987,\"wrapS\":10497,\"wrapT\":10497}],";
+
+	json += "\"textures\":[";
+	for (uint32_t t = 0; t < options.Textures; t++)
+	{
+		Appendf(json, "%s{\"sampler\":0,\"source\":%u}", t ? "," : "", t);
+	}
+	json += ']';
+}
+
+static bool WriteGlb(const char* path, std::string& json, std::vector<uint8_t>& bin)
+{
+	// Chunks are 4 byte aligned, json pads with spaces and binary with zeros
+	json.resize((json.size() + 3u) & ~(size_t)3u, ' ');
+	AlignBinary(bin);
+
+	const uint64_t totalSize = 12u + 8u + json.size() + 8u + bin.size();
+	if (!ENSUREMSG(totalSize <= UINT32_MAX, "Scene is too big for a glb (%llu bytes)", (unsigned long long)totalSize))
+		return false;
+
+	FILE* fp = OpenFile(path, "wb");
+
+	if (!ENSUREMSG(fp, "Failed to open %s for writing", path))
+		return false;
+
+	const uint32_t header[3] = { 0x46546C67u, 2u, (uint32_t)totalSize };
+	const uint32_t jsonChunk[2] = { (uint32_t)json.size(), 0x4E4F534Au };
+	const uint32_t binChunk[2] = { (uint32_t)bin.size(), 0x004E4942u };
+
+	fwrite(header, sizeof(header), 1, fp);
+	fwrite(jsonChunk, sizeof(jsonChunk), 1, fp);
+	fwrite(json.data(), 1, json.size(), fp);
+	fwrite(binChunk, sizeof(binChunk), 1, fp);
+	fwrite(bin.data(), 1, bin.size(), fp);
+
+	const bool ok = ferror(fp) == 0;
+	fclose(fp);
+
+	return ENSUREMSG(ok, "Failed to write %s", path);
+}
+
+static void PrintUsage()
+{
+	printf(
+		"GltfExplorerSceneGen <out.glb> [options]\n"
+		"  --seed <n>           Random seed (default 1)\n"
+		"  --nodes <n>          Scene nodes (default 1000)\n"
+		"  --instances <n>      Nodes that draw a mesh, the rest only carry a transform (default all)\n"
+		"  --meshes <n>         Unique meshes (default 16)\n"
+		"  --primitives <n>     Primitives per mesh (default 1)\n"
+		"  --min-triangles <n>  Smallest primitive (default 12)\n"
+		"  --max-triangles <n>  Largest primitive (default 2000)\n"
+		"  --materials <n>      Materials (default 16)\n"
+		"  --blend <n>          Percentage of materials that alpha blend (default 10)\n"
+		"  --textures <n>       Base colour textures shared by the materials, 0 for none (default 4)\n"
+		"  --texture-size <n>   Texture width and height (default 64)\n"
+		"  --depth <n>          Levels in the node hierarchy, 1 is flat (default 1)\n"
+		"  --extent <n>         Half size of the area the roots spread over (default grows with the node count)\n");
+}
+
+// Whole decimal numbers only, strtoul alone reads "12abc" as 12 and "-1" as its largest value
+static bool ParseUint(const char* text, uint64_t maxValue, uint64_t& out)
+{
+	if (!text || text[0] < '0' || text[0] > '9')
+		return false;
+
+	errno = 0;
+	char* end = nullptr;
+	const unsigned long long value = strtoull(text, &end, 10);
+
+	if (errno == ERANGE || *end != '\0' || value > maxValue)
+		return false;
+
+	out = value;
+	return true;
+}
+
+static bool ParseOptions(int argc, char** argv, SceneGenOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		auto ReadUint = [&](uint32_t& out, uint32_t minValue, uint32_t maxValue) -> bool
+		{
+			if (!value)
+			{
+				LOGERROR("Missing value for %s", arg);
+				return false;
+			}
+
+			uint64_t parsed = 0;
+			if (!ParseUint(value, maxValue, parsed) || parsed < minValue)
+			{
+				LOGERROR("Invalid value %s for %s, expected a whole number from %u to %u", value, arg, minValue, maxValue);
+				return false;
+			}
+
+			out = (uint32_t)parsed;
+			i++;
+			return true;
+		};
+
+		bool ok = true;
+		if (strcmp(arg, "--seed") == 0)
+		{
+			ok = value && ParseUint(value, UINT64_MAX, options.Seed);
+			if (!ok)
+				LOGERROR("Invalid value %s for %s, expected a whole number", value ? value : "(none)", arg);
+			i++;
+		}
+		else if (strcmp(arg, "--nodes") == 0) ok = ReadUint(options.Nodes, 1u, UINT32_MAX);
+		else if (strcmp(arg, "--instances") == 0) ok = ReadUint(options.Instances, 0u, UINT32_MAX);
+		else if (strcmp(arg, "--meshes") == 0) ok = ReadUint(options.Meshes, 1u, UINT32_MAX);
+		else if (strcmp(arg, "--primitives") == 0) ok = ReadUint(options.PrimitivesPerMesh, 1u, UINT32_MAX);
+		else if (strcmp(arg, "--min-triangles") == 0) ok = ReadUint(options.MinTriangles, 1u, UINT32_MAX);
+		else if (strcmp(arg, "--max-triangles") == 0) ok = ReadUint(options.MaxTriangles, 1u, UINT32_MAX);
+		else if (strcmp(arg, "--materials") == 0) ok = ReadUint(options.Materials, 1u, UINT32_MAX);
+		else if (strcmp(arg, "--blend") == 0) ok = ReadUint(options.BlendPercent, 0u, 100u);
+		else if (strcmp(arg, "--textures") == 0) ok = ReadUint(options.Textures, 0u, UINT32_MAX);
+		else if (strcmp(arg, "--texture-size") == 0) ok = ReadUint(options.TextureSize, 1u, 8192u);
+		else if (strcmp(arg, "--depth") == 0) ok = ReadUint(options.Depth, 1u, UINT32_MAX);
+		else if (strcmp(arg, "--extent") == 0)
+		{
+			char* end = nullptr;
+			options.Extent = value ? strtof(value, &end) : 0.0f;
+			ok = value && end != value && *end == '\0' && options.Extent > 0.0f && options.Extent <= FLT_MAX;
+			if (!ok)
+				LOGERROR("Invalid value %s for %s, expected a positive number", value ? value : "(none)", arg);
+			i++;
+		}
+		else if (arg[0] != '-' && !options.OutPath) options.OutPath = arg;
+		else
+		{
+			LOGERROR("Unknown option %s", arg);
+			ok = false;
+		}
+
+		if (!ok)
+			return false;
+	}
+
+	if (!options.OutPath)
+	{
+		LOGERROR("No output path");
+		return false;
+	}
+
+	if (options.MinTriangles > options.MaxTriangles)
+	{
+		LOGERROR("--min-triangles %u is larger than --max-triangles %u", options.MinTriangles, options.MaxTriangles);
+		return false;
+	}
+
+	// The coarsest cube sphere has 12 triangles
+	options.Instances = std::min(options.Instances, options.Nodes);
+	options.MinTriangles = std::max(options.MinTriangles, 12u);
+	options.MaxTriangles = std::max(options.MaxTriangles, options.MinTriangles);
+
+	// Roughly constant density, a few units between neighbouring roots
+	if (options.Extent <= 0.0f)
+	{
+		options.Extent = 2.0f * std::sqrt((float)options.Nodes) + 10.0f;
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	SceneGenOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	const SceneGenHierarchy hierarchy(options);
+
+	SceneGenBuffers buffers;
+	uint64_t triangleCount = 0;
+
+	std::string meshes;
+	WriteMeshes(options, buffers, meshes, triangleCount);
+
+	std::string textures;
+	WriteTextures(options, buffers, textures);
+
+	std::string json;
+	json.reserve((size_t)options.Nodes * 160u + meshes.size() + buffers.Accessors.size() + buffers.BufferViews.size() + 4096u);
+
+	Appendf(json, "{\"asset\":{\"version\":\"2.0\",\"generator\":\"GltfExplorerSceneGen seed %llu\"},\"scene\":0,\"scenes\":[{\"nodes\":[",
+		(unsigned long long)options.Seed);
+	for (uint32_t r = 0; r < hierarchy.RootCount; r++)
+	{
+		Appendf(json, "%s%u", r ? "," : "", r);
+	}
+	json += "]}],";
+
+	WriteNodes(options, hierarchy, json);
+	json += ',';
+	json += meshes;
+	json += ',';
+	WriteMaterials(options, json);
+	if (!textures.empty())
+	{
+		json += ',';
+		json += textures;
+	}
+
+	json += ",\"accessors\":[";
+	json += buffers.Accessors;
+	json += "],\"bufferViews\":[";
+	json += buffers.BufferViews;
+	Appendf(json, "],\"buffers\":[{\"byteLength\":%zu}]}", (buffers.Bin.size() + 3u) & ~(size_t)3u);
+
+	if (!WriteGlb(options.OutPath, json, buffers.Bin))
+		return 1;
+
+	LOGINFO("Wrote %s: %u nodes (%u roots, depth %u), %u instances, %u meshes, %llu triangles, %u materials, %u textures",
+		options.OutPath, options.Nodes, hierarchy.RootCount, options.Depth, options.Instances, options.Meshes,
+		(unsigned long long)triangleCount, options.Materials, options.Textures);
+
+	return 0;
+}
@@ -0,0 +1,1187 @@
+// Checks the SurfMath routines the scene code leans on against double precision references, then times them. Every
+// routine is compared element by element and passes when it is within its ULP bound of the reference. Where cancellation
+// makes ULPs meaningless the result may instead be within a few epsilon of the rounding error its own operation allows,
+// the sum of the magnitudes of the terms it adds up. Benchmarks only run once every check passes, the exit code is non
+// zero when one fails so the tool can gate math changes.
+//
+// Timings come in up to three variants:
+//   scalar  - each call depends on the last, the latency seen by scattered callers
+//   batched - independent calls over arrays, the throughput seen by transform and culling loops
+//   sse     - hand written SSE2 over the same arrays, the target a SIMD SurfMath would have to beat
+
+#include <OpenFile.h>
+#include <SurfMath.h>
+
+#include "../Logging.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define SURFMATH_BENCH_SSE 1
+#include <emmintrin.h>
+#else
+#define SURFMATH_BENCH_SSE 0
+#endif
+
+struct DMatrix
+{
+	double m[4][4] = {};
+};
+
+static DMatrix ToDouble(const matrix& f)
+{
+	DMatrix d;
+	for (uint32_t r = 0; r < 4; r++)
+		for (uint32_t c = 0; c < 4; c++)
+			d.m[r][c] = f.m[r][c];
+	return d;
+}
+
+static DMatrix Multiply(const DMatrix& a, const DMatrix& b)
+{
+	DMatrix d;
+	for (uint32_t r = 0; r < 4; r++)
+		for (uint32_t c = 0; c < 4; c++)
+			for (uint32_t k = 0; k < 4; k++)
+				d.m[r][c] += a.m[r][k] * b.m[k][c];
+	return d;
+}
+
+// Gauss-Jordan with partial pivoting
+static DMatrix Inverse(const DMatrix& in, double* determinant = nullptr)
+{
+	double a[4][8] = {};
+	for (uint32_t r = 0; r < 4; r++)
+	{
+		for (uint32_t c = 0; c < 4; c++)
+			a[r][c] = in.m[r][c];
+		a[r][4 + r] = 1.0;
+	}
+
+	double det = 1.0;
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		uint32_t pivot = c;
+		for (uint32_t r = c + 1; r < 4; r++)
+			if (fabs(a[r][c]) > fabs(a[pivot][c]))
+				pivot = r;
+
+		if (pivot != c)
+		{
+			std::swap(a[pivot], a[c]);
+			det = -det;
+		}
+
+		const double p = a[c][c];
+		det *= p;
+
+		for (uint32_t k = 0; k < 8; k++)
+			a[c][k] /= p;
+
+		for (uint32_t r = 0; r < 4; r++)
+		{
+			if (r == c)
+				continue;
+
+			const double f = a[r][c];
+			for (uint32_t k = 0; k < 8; k++)
+				a[r][k] -= f * a[c][k];
+		}
+	}
+
+	if (determinant)
+		*determinant = det;
+
+	DMatrix out;
+	for (uint32_t r = 0; r < 4; r++)
+		for (uint32_t c = 0; c < 4; c++)
+			out.m[r][c] = a[r][4 + c];
+	return out;
+}
+
+// Row vector times matrix, the SurfMath convention
+static void Transform(const double v[4], const DMatrix& m, double out[4])
+{
+	for (uint32_t c = 0; c < 4; c++)
+		out[c] = v[0] * m.m[0][c] + v[1] * m.m[1][c] + v[2] * m.m[2][c] + v[3] * m.m[3][c];
+}
+
+static DMatrix Abs(const DMatrix& m)
+{
+	DMatrix d;
+	for (uint32_t r = 0; r < 4; r++)
+		for (uint32_t c = 0; c < 4; c++)
+			d.m[r][c] = fabs(m.m[r][c]);
+	return d;
+}
+
+// |A| * |B|, the magnitude of the terms each element of A * B sums
+static DMatrix AbsMultiply(const DMatrix& a, const DMatrix& b)
+{
+	return Multiply(Abs(a), Abs(b));
+}
+
+// |v| * |M|, the magnitude of the terms each element of v * M sums
+static void AbsTransform(const double v[4], const DMatrix& m, double out[4])
+{
+	const double a[4] = { fabs(v[0]), fabs(v[1]), fabs(v[2]), fabs(v[3]) };
+	Transform(a, Abs(m), out);
+}
+
+// Condition of inverting M. Cofactor inversion rounds each minor on its own, so it is only backward stable in norm: it
+// inverts M plus an error of a few epsilon times the largest element of M, anywhere in the matrix. Through the inverse
+// that moves element ij by |row i of M^-1| * max|M| * |column j of M^-1|, cond(M) * epsilon spread over the elements.
+static DMatrix InverseCondition(const DMatrix& m, const DMatrix& inverse)
+{
+	double maxAbs = 0.0;
+	double rows[4] = {}, columns[4] = {};
+	for (uint32_t r = 0; r < 4; r++)
+	{
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			maxAbs = std::max(maxAbs, fabs(m.m[r][c]));
+			rows[r] += fabs(inverse.m[r][c]);
+			columns[c] += fabs(inverse.m[r][c]);
+		}
+	}
+
+	DMatrix d;
+	for (uint32_t r = 0; r < 4; r++)
+		for (uint32_t c = 0; c < 4; c++)
+			d.m[r][c] = rows[r] * maxAbs * columns[c];
+	return d;
+}
+
+// Permanent of |M|, the sum of the magnitudes of every product a cofactor expansion of the determinant adds up
+static double AbsPermanent(const DMatrix& m)
+{
+	uint32_t p[4] = { 0, 1, 2, 3 };
+	double sum = 0.0;
+	do
+	{
+		sum += fabs(m.m[0][p[0]] * m.m[1][p[1]] * m.m[2][p[2]] * m.m[3][p[3]]);
+	} while (std::next_permutation(p, p + 4));
+	return sum;
+}
+
+// Condition of x / y, given the conditions of x and y
+static double RatioCondition(double x, double y, double xCondition, double yCondition)
+{
+	return (xCondition + fabs(x / y) * yCondition) / fabs(y) + fabs(x / y);
+}
+
+static int64_t OrderedBits(float f)
+{
+	int32_t i;
+	memcpy(&i, &f, sizeof(i));
+	const int64_t magnitude = i & 0x7FFFFFFF;
+	return i < 0 ? -magnitude : magnitude;
+}
+
+static uint64_t UlpDistance(float a, float b)
+{
+	const int64_t d = OrderedBits(a) - OrderedBits(b);
+	return (uint64_t)(d < 0 ? -d : d);
+}
+
+// Accumulates the worst error of one routine over all of its samples
+struct MathCheck
+{
+	const char* Name = nullptr;
+	uint64_t UlpBound = 0;
+	double EpsilonBound = 0.0;
+
+	uint64_t MaxUlp = 0;
+	double MaxError = 0.0;
+	double MaxEpsilons = 0.0;
+	uint64_t Samples = 0;
+	uint64_t Failures = 0;
+
+	// epsilonBound is in FLT_EPSILON times the condition each sample passes, 0 when only the ULP bound applies
+	MathCheck(const char* name, uint64_t ulpBound, double epsilonBound = 0.0)
+		: Name(name), UlpBound(ulpBound), EpsilonBound(epsilonBound)
+	{}
+
+	// condition is the magnitude of the terms the operation sums to get this result, the rounding error it can make is a
+	// small multiple of epsilon times that. Without one the ULP bound is a hard limit.
+	void Compare(float value, double reference, double condition = 0.0)
+	{
+		const uint64_t ulp = std::isfinite(value) ? UlpDistance(value, (float)reference) : UINT64_MAX;
+		const double error = fabs((double)value - reference);
+		const double epsilons = condition > 0.0 ? error / (FLT_EPSILON * condition) : 0.0;
+
+		MaxUlp = std::max(MaxUlp, ulp);
+		MaxError = std::max(MaxError, error);
+		Samples++;
+
+		if (ulp <= UlpBound)
+			return;
+
+		MaxEpsilons = std::max(MaxEpsilons, epsilons);
+
+		if (condition <= 0.0 || !(epsilons <= EpsilonBound))
+			Failures++;
+	}
+
+	void CompareMatrix(const matrix& value, const DMatrix& reference)
+	{
+		for (uint32_t r = 0; r < 4; r++)
+			for (uint32_t c = 0; c < 4; c++)
+				Compare(value.m[r][c], reference.m[r][c]);
+	}
+
+	void CompareMatrix(const matrix& value, const DMatrix& reference, const DMatrix& condition)
+	{
+		for (uint32_t r = 0; r < 4; r++)
+			for (uint32_t c = 0; c < 4; c++)
+				Compare(value.m[r][c], reference.m[r][c], condition.m[r][c]);
+	}
+
+	void Expect(bool condition)
+	{
+		Samples++;
+		if (!condition)
+			Failures++;
+	}
+};
+
+struct MathInputs
+{
+	std::vector<matrix> Affine;
+	std::vector<matrix> Projections;
+	std::vector<float4> Quaternions;
+	std::vector<float3> Points;
+	std::vector<AABB> Boxes;
+};
+
+static float3 RandomUnit(std::mt19937& rng)
+{
+	std::uniform_real_distribution<float> d(-1.0f, 1.0f);
+	for (;;)
+	{
+		const float3 v(d(rng), d(rng), d(rng));
+		const float l = LengthSqrF3(v);
+		if (l > 0.01f && l <= 1.0f)
+			return NormalizeF3(v);
+	}
+}
+
+static float4 RandomQuaternion(std::mt19937& rng)
+{
+	std::uniform_real_distribution<float> d(-1.0f, 1.0f);
+	for (;;)
+	{
+		const float4 q(d(rng), d(rng), d(rng), d(rng));
+		const float l = DotF4(q, q);
+		if (l > 0.01f && l <= 1.0f)
+			return q * (1.0f / sqrtf(l));
+	}
+}
+
+// Scale, rotate, translate, the kind of matrix node transforms are made of
+static matrix RandomAffine(std::mt19937& rng)
+{
+	std::uniform_real_distribution<float> scale(0.25f, 4.0f);
+	std::uniform_real_distribution<float> translation(-1000.0f, 1000.0f);
+
+	matrix m = MakeMatrixScaling(scale(rng), scale(rng), scale(rng)) * MakeMatrixRotationFromQuaternion(RandomQuaternion(rng));
+	m.r[3] = float4(translation(rng), translation(rng), translation(rng), 1.0f);
+	return m;
+}
+
+static void CreateInputs(MathInputs& inputs, size_t count, uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> point(-1000.0f, 1000.0f);
+	std::uniform_real_distribution<float> extent(0.01f, 50.0f);
+	std::uniform_real_distribution<float> fov(0.2f, 1.2f);
+	std::uniform_real_distribution<float> aspect(0.5f, 3.0f);
+	std::uniform_real_distribution<float> nearZ(0.01f, 1.0f);
+	std::uniform_real_distribution<float> farZ(100.0f, 10000.0f);
+
+	inputs = {};
+	for (size_t i = 0; i < count; i++)
+	{
+		inputs.Affine.push_back(RandomAffine(rng));
+		inputs.Quaternions.push_back(RandomQuaternion(rng));
+		inputs.Points.push_back(float3(point(rng), point(rng), point(rng)));
+
+		const float3 centre(point(rng), point(rng), point(rng));
+		const float3 ext(extent(rng), extent(rng), extent(rng));
+		inputs.Boxes.push_back(AABB(centre - ext, centre + ext));
+
+		const matrix view = MakeMatrixLookToLH(float3(point(rng), point(rng), point(rng)), RandomUnit(rng), float3(0, 1, 0));
+		inputs.Projections.push_back(view * MakeMatrixPerspectiveFovLH(fov(rng), aspect(rng), nearZ(rng), farZ(rng)));
+	}
+}
+
+#if SURFMATH_BENCH_SSE
+
+static inline __m128 LoadRow(const float4& r) { return _mm_loadu_ps(r.v); }
+
+static inline __m128 TransformRow(__m128 x, __m128 y, __m128 z, __m128 w, __m128 r0, __m128 r1, __m128 r2, __m128 r3)
+{
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, r0), _mm_mul_ps(y, r1)), _mm_add_ps(_mm_mul_ps(z, r2), _mm_mul_ps(w, r3)));
+}
+
+static void MultiplyMatrices_SSE(const matrix* a, const matrix* b, matrix* out, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		const __m128 b0 = LoadRow(b[i].r[0]), b1 = LoadRow(b[i].r[1]), b2 = LoadRow(b[i].r[2]), b3 = LoadRow(b[i].r[3]);
+
+		for (uint32_t r = 0; r < 4; r++)
+		{
+			const float4& row = a[i].r[r];
+			_mm_storeu_ps(out[i].r[r].v, TransformRow(_mm_set1_ps(row.x), _mm_set1_ps(row.y), _mm_set1_ps(row.z), _mm_set1_ps(row.w), b0, b1, b2, b3));
+		}
+	}
+}
+
+static void TransformPoints_SSE(const float3* points, float3* out, size_t count, const matrix& m)
+{
+	const __m128 r0 = LoadRow(m.r[0]), r1 = LoadRow(m.r[1]), r2 = LoadRow(m.r[2]), r3 = LoadRow(m.r[3]);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const __m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(points[i].x), r0), _mm_mul_ps(_mm_set1_ps(points[i].y), r1)),
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(points[i].z), r2), r3));
+
+		float result[4];
+		_mm_storeu_ps(result, v);
+		out[i] = float3(result[0], result[1], result[2]);
+	}
+}
+
+// Arvo's method, the centre goes through the matrix and the extents through its absolute value. Same box as transforming
+// the eight corners for a quarter of the work.
+static void TransformBoxes_SSE(const AABB* boxes, AABB* out, size_t count, const matrix& m)
+{
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	const __m128 half = _mm_set1_ps(0.5f);
+
+	const __m128 r0 = LoadRow(m.r[0]), r1 = LoadRow(m.r[1]), r2 = LoadRow(m.r[2]), r3 = LoadRow(m.r[3]);
+	const __m128 a0 = _mm_and_ps(r0, absMask), a1 = _mm_and_ps(r1, absMask), a2 = _mm_and_ps(r2, absMask);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const __m128 mins = _mm_setr_ps(boxes[i].mins.x, boxes[i].mins.y, boxes[i].mins.z, 0.0f);
+		const __m128 maxs = _mm_setr_ps(boxes[i].maxs.x, boxes[i].maxs.y, boxes[i].maxs.z, 0.0f);
+
+		const __m128 c = _mm_mul_ps(_mm_add_ps(mins, maxs), half);
+		const __m128 e = _mm_mul_ps(_mm_sub_ps(maxs, mins), half);
+
+		const __m128 centre = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(c, c, 0x00), r0), _mm_mul_ps(_mm_shuffle_ps(c, c, 0x55), r1)),
+			_mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(c, c, 0xAA), r2), r3));
+		const __m128 extents = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(e, e, 0x00), a0), _mm_mul_ps(_mm_shuffle_ps(e, e, 0x55), a1)),
+			_mm_mul_ps(_mm_shuffle_ps(e, e, 0xAA), a2));
+
+		float lo[4], hi[4];
+		_mm_storeu_ps(lo, _mm_sub_ps(centre, extents));
+		_mm_storeu_ps(hi, _mm_add_ps(centre, extents));
+		out[i] = AABB(float3(lo[0], lo[1], lo[2]), float3(hi[0], hi[1], hi[2]));
+	}
+}
+
+// Planes transposed so four are tested at once, the last two lanes of the second group repeat plane 5
+struct FrustumPlanesSoA
+{
+	__m128 Nx[2], Ny[2], Nz[2], D[2];
+
+	explicit FrustumPlanesSoA(const FrustumPlanes& f)
+	{
+		for (uint32_t g = 0; g < 2; g++)
+		{
+			float4 p[4];
+			for (uint32_t l = 0; l < 4; l++)
+				p[l] = f.planes[std::min<size_t>(g * 4u + l, FrustumPlanes::PlaneCount - 1u)];
+
+			Nx[g] = _mm_setr_ps(p[0].x, p[1].x, p[2].x, p[3].x);
+			Ny[g] = _mm_setr_ps(p[0].y, p[1].y, p[2].y, p[3].y);
+			Nz[g] = _mm_setr_ps(p[0].z, p[1].z, p[2].z, p[3].z);
+			D[g] = _mm_setr_ps(p[0].w, p[1].w, p[2].w, p[3].w);
+		}
+	}
+};
+
+static uint32_t CountVisible_SSE(const FrustumPlanesSoA& planes, const AABB* boxes, size_t count)
+{
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+	uint32_t visible = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		const float3 c = boxes[i].Origin();
+		const float3 e = boxes[i].Extents();
+
+		const __m128 cx = _mm_set1_ps(c.x), cy = _mm_set1_ps(c.y), cz = _mm_set1_ps(c.z);
+		const __m128 ex = _mm_set1_ps(e.x), ey = _mm_set1_ps(e.y), ez = _mm_set1_ps(e.z);
+
+		int outside = 0;
+		for (uint32_t g = 0; g < 2; g++)
+		{
+			const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes.Nx[g], cx), _mm_mul_ps(planes.Ny[g], cy)), _mm_add_ps(_mm_mul_ps(planes.Nz[g], cz), planes.D[g]));
+			const __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_and_ps(planes.Nx[g], absMask), ex), _mm_mul_ps(_mm_and_ps(planes.Ny[g], absMask), ey)),
+				_mm_mul_ps(_mm_and_ps(planes.Nz[g], absMask), ez));
+
+			outside |= _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(d, r), _mm_setzero_ps()));
+		}
+
+		visible += outside == 0 ? 1u : 0u;
+	}
+
+	return visible;
+}
+
+#endif
+
+static void CheckMultiply(const MathInputs& in, std::vector<MathCheck>& checks)
+{
+	MathCheck check("matrix * matrix", 4u, 4.0);
+#if SURFMATH_BENCH_SSE
+	MathCheck checkSse("matrix * matrix (sse)", 4u, 4.0);
+#endif
+
+	for (size_t i = 0; i + 1 < in.Affine.size(); i++)
+	{
+		const matrix& a = in.Affine[i];
+		const matrix& b = in.Affine[i + 1];
+
+		const DMatrix reference = Multiply(ToDouble(a), ToDouble(b));
+		const DMatrix condition = AbsMultiply(ToDouble(a), ToDouble(b));
+
+		check.CompareMatrix(a * b, reference, condition);
+
+#if SURFMATH_BENCH_SSE
+		matrix sse;
+		MultiplyMatrices_SSE(&a, &b, &sse, 1u);
+		checkSse.CompareMatrix(sse, reference, condition);
+#endif
+	}
+
+	checks.push_back(check);
+#if SURFMATH_BENCH_SSE
+	checks.push_back(checkSse);
+#endif
+}
+
+static void CheckTransforms(const MathInputs& in, std::vector<MathCheck>& checks)
+{
+	MathCheck checkF3("TransformF3", 4u, 4.0);
+	MathCheck checkF4("TransformF4", 4u, 4.0);
+#if SURFMATH_BENCH_SSE
+	MathCheck checkSse("TransformF3 (sse)", 4u, 4.0);
+#endif
+
+	for (size_t i = 0; i < in.Affine.size(); i++)
+	{
+		const matrix& m = in.Affine[i];
+		const float3 p = in.Points[i];
+
+		const DMatrix dm = ToDouble(m);
+		const double v[4] = { p.x, p.y, p.z, 1.0 };
+		double reference[4], condition[4];
+		Transform(v, dm, reference);
+		AbsTransform(v, dm, condition);
+
+		const float3 f3 = TransformF3(p, m);
+		const float4 f4 = TransformF4(float4(p, 1.0f), m);
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			checkF3.Compare(f3.v[c], reference[c], condition[c]);
+			checkF4.Compare(f4.v[c], reference[c], condition[c]);
+		}
+		checkF4.Compare(f4.w, reference[3], condition[3]);
+
+#if SURFMATH_BENCH_SSE
+		float3 sse;
+		TransformPoints_SSE(&p, &sse, 1u, m);
+		for (uint32_t c = 0; c < 3; c++)
+			checkSse.Compare(sse.v[c], reference[c], condition[c]);
+#endif
+	}
+
+	checks.push_back(checkF3);
+	checks.push_back(checkF4);
+#if SURFMATH_BENCH_SSE
+	checks.push_back(checkSse);
+#endif
+}
+
+// Every element of a cofactor inverse goes through a few roundings, each within InverseCondition
+static constexpr double KInverseEpsilons = 4.0;
+
+static void CheckInverse(const MathInputs& in, std::vector<MathCheck>& checks)
+{
+	MathCheck checkAffine("InverseMatrix (affine)", 64u, KInverseEpsilons);
+	MathCheck checkProjection("InverseMatrix (view projection)", 64u, KInverseEpsilons);
+	MathCheck checkDeterminant("InverseMatrix determinant", 64u, 4.0);
+
+	auto Check = [&](const matrix& m, MathCheck& check)
+	{
+		double determinant;
+		const DMatrix dm = ToDouble(m);
+		const DMatrix reference = Inverse(dm, &determinant);
+
+		float outDeterminant = 0.0f;
+		check.CompareMatrix(InverseMatrix(m, &outDeterminant), reference, InverseCondition(dm, reference));
+		checkDeterminant.Compare(outDeterminant, determinant, AbsPermanent(dm));
+	};
+
+	for (const matrix& m : in.Affine)
+		Check(m, checkAffine);
+
+	for (const matrix& m : in.Projections)
+		Check(m, checkProjection);
+
+	checks.push_back(checkAffine);
+	checks.push_back(checkProjection);
+	checks.push_back(checkDeterminant);
+}
+
+static void CheckRotations(const MathInputs& in, std::vector<MathCheck>& checks)
+{
+	MathCheck checkQuaternion("MakeMatrixRotationFromQuaternion", 8u, 8.0);
+	MathCheck checkAxis("MakeMatrixRotationAxis", 16u, 8.0);
+	MathCheck checkVector("MakeMatrixRotationFromVector", 16u, 8.0);
+
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> angle(-K_PI, K_PI);
+
+	for (size_t i = 0; i < in.Quaternions.size(); i++)
+	{
+		// Quaternion, the usual row vector form: v' = v * M rotates v by q
+		{
+			const float4 q = in.Quaternions[i];
+			const double x = q.x, y = q.y, z = q.z, w = q.w;
+
+			DMatrix reference;
+			reference.m[0][0] = 1.0 - 2.0 * (y * y + z * z); reference.m[0][1] = 2.0 * (x * y + z * w); reference.m[0][2] = 2.0 * (x * z - y * w);
+			reference.m[1][0] = 2.0 * (x * y - z * w); reference.m[1][1] = 1.0 - 2.0 * (x * x + z * z); reference.m[1][2] = 2.0 * (y * z + x * w);
+			reference.m[2][0] = 2.0 * (x * z + y * w); reference.m[2][1] = 2.0 * (y * z - x * w); reference.m[2][2] = 1.0 - 2.0 * (x * x + y * y);
+			reference.m[3][3] = 1.0;
+
+			DMatrix condition;
+			condition.m[0][0] = 1.0 + 2.0 * (y * y + z * z); condition.m[0][1] = 2.0 * (fabs(x * y) + fabs(z * w)); condition.m[0][2] = 2.0 * (fabs(x * z) + fabs(y * w));
+			condition.m[1][0] = condition.m[0][1]; condition.m[1][1] = 1.0 + 2.0 * (x * x + z * z); condition.m[1][2] = 2.0 * (fabs(y * z) + fabs(x * w));
+			condition.m[2][0] = condition.m[0][2]; condition.m[2][1] = condition.m[1][2]; condition.m[2][2] = 1.0 + 2.0 * (x * x + y * y);
+
+			checkQuaternion.CompareMatrix(MakeMatrixRotationFromQuaternion(q), reference, condition);
+		}
+
+		// Axis angle against Rodrigues' formula
+		{
+			const float3 axis = RandomUnit(rng);
+			const float a = angle(rng);
+
+			const double s = sin((double)a), c = cos((double)a), t = 1.0 - c;
+			const double x = axis.x, y = axis.y, z = axis.z;
+
+			DMatrix reference;
+			reference.m[0][0] = c + t * x * x;     reference.m[0][1] = t * x * y + s * z; reference.m[0][2] = t * x * z - s * y;
+			reference.m[1][0] = t * x * y - s * z; reference.m[1][1] = c + t * y * y;     reference.m[1][2] = t * y * z + s * x;
+			reference.m[2][0] = t * x * z + s * y; reference.m[2][1] = t * y * z - s * x; reference.m[2][2] = c + t * z * z;
+			reference.m[3][3] = 1.0;
+
+			// sin, cos and 1 - cos each carry an epsilon of their own, scaled by the axis terms they multiply
+			const double at = fabs(t) + 1.0, as = fabs(s) + 1.0, ac = fabs(c) + 1.0;
+
+			DMatrix condition;
+			condition.m[0][0] = ac + at * x * x;            condition.m[0][1] = at * fabs(x * y) + as * fabs(z); condition.m[0][2] = at * fabs(x * z) + as * fabs(y);
+			condition.m[1][0] = condition.m[0][1];           condition.m[1][1] = ac + at * y * y;            condition.m[1][2] = at * fabs(y * z) + as * fabs(x);
+			condition.m[2][0] = condition.m[0][2];           condition.m[2][1] = condition.m[1][2];           condition.m[2][2] = ac + at * z * z;
+
+			checkAxis.CompareMatrix(MakeMatrixRotationAxis(axis, a), reference, condition);
+		}
+
+		// Pitch, yaw, roll applied as roll then pitch then yaw
+		{
+			const float3 v(angle(rng), angle(rng), angle(rng));
+
+			const double cp = cos((double)v.x), sp = sin((double)v.x);
+			const double cy = cos((double)v.y), sy = sin((double)v.y);
+			const double cr = cos((double)v.z), sr = sin((double)v.z);
+
+			DMatrix rx, ry, rz;
+			rx.m[0][0] = 1.0; rx.m[1][1] = cp; rx.m[1][2] = sp; rx.m[2][1] = -sp; rx.m[2][2] = cp; rx.m[3][3] = 1.0;
+			ry.m[0][0] = cy; ry.m[0][2] = -sy; ry.m[1][1] = 1.0; ry.m[2][0] = sy; ry.m[2][2] = cy; ry.m[3][3] = 1.0;
+			rz.m[0][0] = cr; rz.m[0][1] = sr; rz.m[1][0] = -sr; rz.m[1][1] = cr; rz.m[2][2] = 1.0; rz.m[3][3] = 1.0;
+
+			// Each sin and cos is a term of its own, |Rz| * |Rx| * |Ry| counts every one the product sums
+			checkVector.CompareMatrix(MakeMatrixRotationFromVector(v), Multiply(Multiply(rz, rx), ry), AbsMultiply(AbsMultiply(rz, rx), ry));
+		}
+	}
+
+	checks.push_back(checkQuaternion);
+	checks.push_back(checkAxis);
+	checks.push_back(checkVector);
+}
+
+static void CheckCamera(std::vector<MathCheck>& checks)
+{
+	MathCheck checkLookTo("MakeMatrixLookToLH", 16u, 8.0);
+	MathCheck checkPerspective("MakeMatrixPerspectiveFovLH", 8u);
+	MathCheck checkFrustum("BoundingFrustum", 64u, KInverseEpsilons);
+	MathCheck checkSlopes("BoundingFrustum slopes", 64u);
+
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> point(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> fov(0.2f, 1.2f);
+	std::uniform_real_distribution<float> aspect(0.5f, 3.0f);
+	std::uniform_real_distribution<float> nearZ(0.01f, 1.0f);
+	std::uniform_real_distribution<float> farZ(100.0f, 10000.0f);
+
+	for (uint32_t i = 0; i < 1000u; i++)
+	{
+		// A view matrix takes the eye to the origin and the look direction to +z
+		{
+			const float3 eye(point(rng), point(rng), point(rng));
+			const float3 dir = RandomUnit(rng);
+			if (fabsf(dir.y) > 0.99f)
+				continue;
+
+			const matrix view = MakeMatrixLookToLH(eye, dir, float3(0, 1, 0));
+			const DMatrix dv = ToDouble(view);
+
+			// The translation is the eye dotted with each axis, the point transformed sums the same terms again
+			const double e[4] = { eye.x, eye.y, eye.z, 1.0 };
+			double eyeCondition[4];
+			AbsTransform(e, dv, eyeCondition);
+
+			const float3 forward = eye + dir;
+			const double f[4] = { forward.x, forward.y, forward.z, 1.0 };
+			double forwardCondition[4];
+			AbsTransform(f, dv, forwardCondition);
+
+			const float3 eyeView = TransformF3(eye, view);
+			checkLookTo.Compare(eyeView.x, 0.0, eyeCondition[0] + eyeCondition[3]);
+			checkLookTo.Compare(eyeView.y, 0.0, eyeCondition[1] + eyeCondition[3]);
+			checkLookTo.Compare(eyeView.z, 0.0, eyeCondition[2] + eyeCondition[3]);
+
+			const float3 forwardView = TransformF3(forward, view);
+			checkLookTo.Compare(forwardView.x, 0.0, forwardCondition[0] + eyeCondition[0]);
+			checkLookTo.Compare(forwardView.y, 0.0, forwardCondition[1] + eyeCondition[1]);
+			checkLookTo.Compare(forwardView.z, 1.0, forwardCondition[2] + eyeCondition[2]);
+
+			// Rotation part stays orthonormal
+			for (uint32_t r = 0; r < 3; r++)
+			{
+				const float3 row(view.m[0][r], view.m[1][r], view.m[2][r]);
+				checkLookTo.Compare(LengthF3(row), 1.0);
+			}
+		}
+
+		// SurfMath takes the half angle, the vertical field of view is 2 * fovRadians
+		const float f = fov(rng), a = aspect(rng), n = nearZ(rng), z = farZ(rng);
+		{
+			const double height = 1.0 / tan((double)f);
+
+			DMatrix reference;
+			reference.m[0][0] = height / a;
+			reference.m[1][1] = height;
+			reference.m[2][2] = (double)z / ((double)z - n);
+			reference.m[2][3] = 1.0;
+			reference.m[3][2] = -(double)n * z / ((double)z - n);
+
+			checkPerspective.CompareMatrix(MakeMatrixPerspectiveFovLH(f, a, n, z), reference);
+		}
+
+		// Far from the near plane a float projection no longer pins down its planes, the reference is what the float matrix
+		// itself describes, worked through in double
+		{
+			const matrix projection = MakeMatrixPerspectiveFovLH(f, a, n, z);
+			const BoundingFrustum frustum(projection);
+			const DMatrix dp = ToDouble(projection);
+			const DMatrix inverse = Inverse(dp);
+
+			// The corners carry the inverse's own error on top of the terms of the transform
+			DMatrix unprojectCondition = InverseCondition(dp, inverse);
+			for (uint32_t r = 0; r < 4; r++)
+				for (uint32_t c = 0; c < 4; c++)
+					unprojectCondition.m[r][c] += fabs(inverse.m[r][c]);
+
+			double p[4], pc[4];
+			auto Unproject = [&](double x, double y, double depth)
+			{
+				const double v[4] = { x, y, depth, 1.0 };
+				Transform(v, inverse, p);
+				AbsTransform(v, unprojectCondition, pc);
+			};
+
+			// The far plane divides two nearly equal terms, so its condition grows with far / near through the ratio
+			Unproject(1.0, 0.0, 1.0);
+			checkFrustum.Compare(frustum.right, p[0] / p[2], RatioCondition(p[0], p[2], pc[0], pc[2]));
+			Unproject(-1.0, 0.0, 1.0);
+			checkFrustum.Compare(frustum.left, p[0] / p[2], RatioCondition(p[0], p[2], pc[0], pc[2]));
+			Unproject(0.0, 1.0, 1.0);
+			checkFrustum.Compare(frustum.top, p[1] / p[2], RatioCondition(p[1], p[2], pc[1], pc[2]));
+			Unproject(0.0, -1.0, 1.0);
+			checkFrustum.Compare(frustum.bottom, p[1] / p[2], RatioCondition(p[1], p[2], pc[1], pc[2]));
+			Unproject(0.0, 0.0, 0.0);
+			checkFrustum.Compare(frustum.nearZ, p[2] / p[3], RatioCondition(p[2], p[3], pc[2], pc[3]));
+			Unproject(0.0, 0.0, 1.0);
+			checkFrustum.Compare(frustum.farZ, p[2] / p[3], RatioCondition(p[2], p[3], pc[2], pc[3]));
+
+			// Slopes are well conditioned, they should match the parameters whatever the depth range
+			const double t = tan((double)f);
+			checkSlopes.Compare(frustum.right, t * a);
+			checkSlopes.Compare(frustum.top, t);
+		}
+	}
+
+	checks.push_back(checkLookTo);
+	checks.push_back(checkPerspective);
+	checks.push_back(checkFrustum);
+	checks.push_back(checkSlopes);
+}
+
+// Centre and extents are rounded before they go through the matrix
+static constexpr double KBoundsEpsilons = 8.0;
+
+static void CheckBounds(const MathInputs& in, std::vector<MathCheck>& checks)
+{
+	MathCheck checkTransform("AABB::Transform", 8u, KBoundsEpsilons);
+	MathCheck checkContains("AABB::Transform contains corners", 0u);
+	MathCheck checkCull("FrustumPlanes::Intersects", 0u);
+#if SURFMATH_BENCH_SSE
+	MathCheck checkTransformSse("AABB::Transform (sse)", 8u, KBoundsEpsilons);
+	MathCheck checkCullSse("FrustumPlanes::Intersects (sse)", 0u);
+#endif
+
+	for (size_t i = 0; i < in.Boxes.size(); i++)
+	{
+		const AABB& box = in.Boxes[i];
+		const matrix& m = in.Affine[i];
+		const DMatrix dm = ToDouble(m);
+
+		// Corners through the matrix in double
+		double mins[3] = { DBL_MAX, DBL_MAX, DBL_MAX };
+		double maxs[3] = { -DBL_MAX, -DBL_MAX, -DBL_MAX };
+		for (uint32_t c = 0; c < 8; c++)
+		{
+			const double v[4] = { c & 1u ? box.maxs.x : box.mins.x, c & 2u ? box.maxs.y : box.mins.y, c & 4u ? box.maxs.z : box.mins.z, 1.0 };
+			double out[4];
+			Transform(v, dm, out);
+
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				mins[k] = std::min(mins[k], out[k]);
+				maxs[k] = std::max(maxs[k], out[k]);
+			}
+		}
+
+		// Every corner sums the terms of the centre and the extents through the matrix
+		const float3 origin = box.Origin(), extents = box.Extents();
+		const double corner[4] = { fabs(origin.x) + extents.x, fabs(origin.y) + extents.y, fabs(origin.z) + extents.z, 1.0 };
+		double condition[4];
+		AbsTransform(corner, dm, condition);
+
+		AABB transformed = box;
+		transformed.Transform(m);
+		for (uint32_t k = 0; k < 3; k++)
+		{
+			checkTransform.Compare(transformed.mins.v[k], mins[k], condition[k]);
+			checkTransform.Compare(transformed.maxs.v[k], maxs[k], condition[k]);
+		}
+
+		// Culling relies on the transformed box holding every transformed corner, allowing for rounding
+		for (uint32_t k = 0; k < 3; k++)
+		{
+			const double slack = KBoundsEpsilons * FLT_EPSILON * condition[k];
+			checkContains.Expect(transformed.mins.v[k] <= mins[k] + slack && transformed.maxs.v[k] >= maxs[k] - slack);
+		}
+
+#if SURFMATH_BENCH_SSE
+		AABB sse;
+		TransformBoxes_SSE(&box, &sse, 1u, m);
+		for (uint32_t k = 0; k < 3; k++)
+		{
+			checkTransformSse.Compare(sse.mins.v[k], mins[k], condition[k]);
+			checkTransformSse.Compare(sse.maxs.v[k], maxs[k], condition[k]);
+		}
+#endif
+
+		// Plane test in double, disagreements are only allowed right on a plane
+		const FrustumPlanes planes(in.Projections[i]);
+		const DMatrix dp = ToDouble(in.Projections[i]);
+
+		bool referenceVisible = true;
+		bool onPlane = false;
+		for (uint32_t p = 0; p < 6; p++)
+		{
+			double plane[4], planeCondition[4];
+			const uint32_t axis = p < 4 ? p / 2u : 2u;
+			for (uint32_t k = 0; k < 4; k++)
+			{
+				const double col = dp.m[k][axis];
+				const double w = dp.m[k][3];
+				plane[k] = p == 4 ? col : (p % 2u == 0u && p < 4 ? w + col : w - col);
+				planeCondition[k] = p == 4 ? fabs(col) : fabs(w) + fabs(col);
+			}
+
+			const double length = sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+			const float3 c = box.Origin(), e = box.Extents();
+			const double d = (plane[0] * c.x + plane[1] * c.y + plane[2] * c.z + plane[3]) / length
+				+ (fabs(plane[0]) * e.x + fabs(plane[1]) * e.y + fabs(plane[2]) * e.z) / length;
+
+			// Extracting, normalizing and testing the plane each round its terms, the float test may only disagree that close
+			const double condition = (planeCondition[0] * (fabs(c.x) + e.x) + planeCondition[1] * (fabs(c.y) + e.y) + planeCondition[2] * (fabs(c.z) + e.z)
+				+ planeCondition[3]) / length + fabs(d);
+			onPlane |= fabs(d) <= KBoundsEpsilons * FLT_EPSILON * condition;
+
+			if (d < 0.0)
+				referenceVisible = false;
+		}
+
+		checkCull.Expect(planes.Intersects(box) == referenceVisible || onPlane);
+
+#if SURFMATH_BENCH_SSE
+		const FrustumPlanesSoA soa(planes);
+		checkCullSse.Expect((CountVisible_SSE(soa, &box, 1u) == 1u) == planes.Intersects(box));
+#endif
+	}
+
+	checks.push_back(checkTransform);
+	checks.push_back(checkContains);
+	checks.push_back(checkCull);
+#if SURFMATH_BENCH_SSE
+	checks.push_back(checkTransformSse);
+	checks.push_back(checkCullSse);
+#endif
+}
+
+static void CheckVectors(const MathInputs& in, std::vector<MathCheck>& checks)
+{
+	MathCheck checkNormalize("NormalizeF3", 4u);
+	MathCheck checkCross("CrossF3", 4u, 2.0);
+	MathCheck checkDot("DotF3", 4u, 2.0);
+
+	for (size_t i = 0; i + 1 < in.Points.size(); i++)
+	{
+		const float3 a = in.Points[i];
+		const float3 b = in.Points[i + 1];
+
+		const double length = sqrt((double)a.x * a.x + (double)a.y * a.y + (double)a.z * a.z);
+		const float3 n = NormalizeF3(a);
+		for (uint32_t c = 0; c < 3; c++)
+			checkNormalize.Compare(n.v[c], a.v[c] / length);
+
+		const float3 cross = CrossF3(a, b);
+		checkCross.Compare(cross.x, (double)a.y * b.z - (double)a.z * b.y, fabs((double)a.y * b.z) + fabs((double)a.z * b.y));
+		checkCross.Compare(cross.y, (double)a.z * b.x - (double)a.x * b.z, fabs((double)a.z * b.x) + fabs((double)a.x * b.z));
+		checkCross.Compare(cross.z, (double)a.x * b.y - (double)a.y * b.x, fabs((double)a.x * b.y) + fabs((double)a.y * b.x));
+
+		checkDot.Compare(DotF3(a, b), (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z,
+			fabs((double)a.x * b.x) + fabs((double)a.y * b.y) + fabs((double)a.z * b.z));
+	}
+
+	checks.push_back(checkNormalize);
+	checks.push_back(checkCross);
+	checks.push_back(checkDot);
+}
+
+struct BenchResult
+{
+	const char* Name;
+	const char* Variant;
+	double NanosecondsPerOp;
+};
+
+// Keeps results alive without the optimizer seeing through them
+static volatile float GSink = 0.0f;
+
+// Best of several runs of `body`, each run long enough to swamp the clock
+template<typename Func>
+static double TimeNanosecondsPerOp(size_t opsPerCall, const Func& body)
+{
+	using Clock = std::chrono::steady_clock;
+
+	size_t calls = 1;
+	for (;;)
+	{
+		const Clock::time_point start = Clock::now();
+		for (size_t c = 0; c < calls; c++)
+			body();
+		if (std::chrono::duration<double, std::milli>(Clock::now() - start).count() > 10.0)
+			break;
+		calls *= 2u;
+	}
+
+	double best = DBL_MAX;
+	for (uint32_t run = 0; run < 5u; run++)
+	{
+		const Clock::time_point start = Clock::now();
+		for (size_t c = 0; c < calls; c++)
+			body();
+		best = std::min(best, std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (double)(calls * opsPerCall));
+	}
+
+	return best;
+}
+
+static void RunBenchmarks(const MathInputs& in, std::vector<BenchResult>& results)
+{
+	const size_t count = in.Affine.size();
+
+	std::vector<matrix> matrices(count);
+	std::vector<float3> points(count);
+	std::vector<AABB> boxes(count);
+
+	// matrix * matrix
+	{
+		results.push_back({ "matrix * matrix", "scalar", TimeNanosecondsPerOp(count, [&]()
+		{
+			matrix acc = MakeMatrixIdentity();
+			for (size_t i = 0; i < count; i++)
+				acc = acc * in.Affine[i];
+			GSink = GSink + acc._11;
+		}) });
+
+		results.push_back({ "matrix * matrix", "batched", TimeNanosecondsPerOp(count - 1u, [&]()
+		{
+			for (size_t i = 0; i + 1 < count; i++)
+				matrices[i] = in.Affine[i] * in.Affine[i + 1];
+			GSink = GSink + matrices[count / 2]._11;
+		}) });
+
+#if SURFMATH_BENCH_SSE
+		results.push_back({ "matrix * matrix", "sse", TimeNanosecondsPerOp(count - 1u, [&]()
+		{
+			MultiplyMatrices_SSE(in.Affine.data(), in.Affine.data() + 1, matrices.data(), count - 1u);
+			GSink = GSink + matrices[count / 2]._11;
+		}) });
+#endif
+	}
+
+	// TransformF3
+	{
+		const matrix& m = in.Affine[0];
+
+		results.push_back({ "TransformF3", "scalar", TimeNanosecondsPerOp(count, [&]()
+		{
+			float3 p = in.Points[0];
+			for (size_t i = 0; i < count; i++)
+				p = TransformF3(p, in.Affine[i]) * 1e-3f;
+			GSink = GSink + p.x;
+		}) });
+
+		results.push_back({ "TransformF3", "batched", TimeNanosecondsPerOp(count, [&]()
+		{
+			for (size_t i = 0; i < count; i++)
+				points[i] = TransformF3(in.Points[i], m);
+			GSink = GSink + points[count / 2].x;
+		}) });
+
+#if SURFMATH_BENCH_SSE
+		results.push_back({ "TransformF3", "sse", TimeNanosecondsPerOp(count, [&]()
+		{
+			TransformPoints_SSE(in.Points.data(), points.data(), count, m);
+			GSink = GSink + points[count / 2].x;
+		}) });
+#endif
+	}
+
+	// InverseMatrix
+	{
+		results.push_back({ "InverseMatrix", "scalar", TimeNanosecondsPerOp(count, [&]()
+		{
+			matrix acc = in.Affine[0];
+			for (size_t i = 0; i < count; i++)
+				acc = InverseMatrix(acc);
+			GSink = GSink + acc._11;
+		}) });
+
+		results.push_back({ "InverseMatrix", "batched", TimeNanosecondsPerOp(count, [&]()
+		{
+			for (size_t i = 0; i < count; i++)
+				matrices[i] = InverseMatrix(in.Affine[i]);
+			GSink = GSink + matrices[count / 2]._11;
+		}) });
+	}
+
+	// MakeMatrixRotationFromQuaternion
+	{
+		results.push_back({ "MakeMatrixRotationFromQuaternion", "batched", TimeNanosecondsPerOp(count, [&]()
+		{
+			for (size_t i = 0; i < count; i++)
+				matrices[i] = MakeMatrixRotationFromQuaternion(in.Quaternions[i]);
+			GSink = GSink + matrices[count / 2]._11;
+		}) });
+	}
+
+	// AABB::Transform
+	{
+		const matrix& m = in.Affine[0];
+
+		results.push_back({ "AABB::Transform", "batched", TimeNanosecondsPerOp(count, [&]()
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				boxes[i] = in.Boxes[i];
+				boxes[i].Transform(m);
+			}
+			GSink = GSink + boxes[count / 2].mins.x;
+		}) });
+
+#if SURFMATH_BENCH_SSE
+		results.push_back({ "AABB::Transform", "sse", TimeNanosecondsPerOp(count, [&]()
+		{
+			TransformBoxes_SSE(in.Boxes.data(), boxes.data(), count, m);
+			GSink = GSink + boxes[count / 2].mins.x;
+		}) });
+#endif
+	}
+
+	// FrustumPlanes::Intersects, boxes near the camera so a good share of them pass
+	{
+		const FrustumPlanes planes(MakeMatrixLookToLH(float3(0, 0, -1500.0f), float3(0, 0, 1), float3(0, 1, 0))
+			* MakeMatrixPerspectiveFovLH(ConvertToRadians(30.0f), 16.0f / 9.0f, 0.1f, 3000.0f));
+
+		results.push_back({ "FrustumPlanes::Intersects", "batched", TimeNanosecondsPerOp(count, [&]()
+		{
+			uint32_t visible = 0;
+			for (size_t i = 0; i < count; i++)
+				visible += planes.Intersects(in.Boxes[i]) ? 1u : 0u;
+			GSink = GSink + (float)visible;
+		}) });
+
+#if SURFMATH_BENCH_SSE
+		const FrustumPlanesSoA soa(planes);
+		results.push_back({ "FrustumPlanes::Intersects", "sse", TimeNanosecondsPerOp(count, [&]()
+		{
+			GSink = GSink + (float)CountVisible_SSE(soa, in.Boxes.data(), count);
+		}) });
+#endif
+	}
+
+	// BoundingFrustum, once per camera change
+	{
+		results.push_back({ "BoundingFrustum", "scalar", TimeNanosecondsPerOp(1u, [&]()
+		{
+			const BoundingFrustum frustum(in.Projections[0]);
+			GSink = GSink + frustum.right;
+		}) });
+	}
+}
+
+static bool WriteJson(const char* path, const std::vector<MathCheck>& checks, const std::vector<BenchResult>& results)
+{
+	FILE* fp = OpenFile(path, "w");
+
+	if (!ENSUREMSG(fp, "Failed to open %s for writing", path))
+		return false;
+
+	fprintf(fp, "{\n  \"checks\": [");
+	for (size_t i = 0; i < checks.size(); i++)
+	{
+		const MathCheck& c = checks[i];
+		fprintf(fp, "%s\n    { \"name\": \"%s\", \"samples\": %llu, \"failures\": %llu, \"max_ulp\": %llu, \"ulp_bound\": %llu, \"max_epsilons\": %.4g, \"epsilon_bound\": %g, \"max_error\": %.9g }",
+			i ? "," : "", c.Name, (unsigned long long)c.Samples, (unsigned long long)c.Failures, (unsigned long long)std::min<uint64_t>(c.MaxUlp, INT64_MAX),
+			(unsigned long long)c.UlpBound, c.MaxEpsilons, c.EpsilonBound, c.MaxError);
+	}
+	fprintf(fp, "\n  ],\n  \"benchmarks\": [");
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		fprintf(fp, "%s\n    { \"name\": \"%s\", \"variant\": \"%s\", \"ns_per_op\": %.3f }", i ? "," : "", results[i].Name, results[i].Variant, results[i].NanosecondsPerOp);
+	}
+	fprintf(fp, "\n  ]\n}\n");
+
+	const bool ok = ferror(fp) == 0;
+	fclose(fp);
+
+	return ENSUREMSG(ok, "Failed to write %s", path);
+}
+
+static void PrintUsage()
+{
+	printf(
+		"SurfMathBench [options]\n"
+		"  --verify-only     Run the checks and skip the benchmarks\n"
+		"  --count <n>       Random inputs per routine (default 4096)\n"
+		"  --seed <n>        Random seed (default 1)\n"
+		"  --json <path>     Write check results and timings\n");
+}
+
+int main(int argc, char** argv)
+{
+	bool verifyOnly = false;
+	uint32_t count = 4096;
+	uint32_t seed = 1;
+	const char* jsonPath = nullptr;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (strcmp(arg, "--verify-only") == 0) verifyOnly = true;
+		else if (strcmp(arg, "--count") == 0 && value) { count = (uint32_t)strtoul(value, nullptr, 10); i++; }
+		else if (strcmp(arg, "--seed") == 0 && value) { seed = (uint32_t)strtoul(value, nullptr, 10); i++; }
+		else if (strcmp(arg, "--json") == 0 && value) { jsonPath = value; i++; }
+		else
+		{
+			LOGERROR("Unknown option %s", arg);
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	MathInputs inputs;
+	CreateInputs(inputs, std::max(count, 2u), seed);
+
+	std::vector<MathCheck> checks;
+	CheckMultiply(inputs, checks);
+	CheckTransforms(inputs, checks);
+	CheckInverse(inputs, checks);
+	CheckRotations(inputs, checks);
+	CheckCamera(checks);
+	CheckBounds(inputs, checks);
+	CheckVectors(inputs, checks);
+
+	bool passed = true;
+	LOGINFO("  %-36s %10s %10s %12s %12s %12s", "check", "samples", "failures", "max ulp", "max eps", "max error");
+	for (const MathCheck& c : checks)
+	{
+		char ulp[32];
+		snprintf(ulp, sizeof(ulp), c.UlpBound || c.MaxUlp ? "%llu/%llu" : "-", (unsigned long long)std::min<uint64_t>(c.MaxUlp, 999999999u), (unsigned long long)c.UlpBound);
+
+		// Epsilons of the condition, only for samples past the ULP bound
+		char eps[32];
+		snprintf(eps, sizeof(eps), c.EpsilonBound > 0.0 ? "%.2g/%g" : "-", c.MaxEpsilons, c.EpsilonBound);
+
+		LOGINFO("  %-36s %10llu %10llu %12s %12s %12.3g%s", c.Name, (unsigned long long)c.Samples, (unsigned long long)c.Failures, ulp, eps, c.MaxError,
+			c.Failures ? "  FAILED" : "");
+
+		passed &= c.Failures == 0;
+	}
+
+	std::vector<BenchResult> results;
+	if (passed && !verifyOnly)
+	{
+		RunBenchmarks(inputs, results);
+
+		LOGINFO("  %-36s %-8s %10s", "routine", "variant", "ns/op");
+		for (const BenchResult& r : results)
+		{
+			LOGINFO("  %-36s %-8s %10.2f", r.Name, r.Variant, r.NanosecondsPerOp);
+		}
+	}
+
+	if (!passed)
+	{
+		LOGERROR("SurfMath checks failed, benchmarks skipped");
+	}
+
+	if (jsonPath)
+	{
+		WriteJson(jsonPath, checks, results);
+	}
+
+	return passed ? 0 : 1;
+}
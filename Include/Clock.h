@@ -1,9 +1,259 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "OpenFile.h"
+
+// Zone names are free text, they are escaped by the logger every program using the clock links, see Logging.h
+void Log_WriteJsonString(FILE* fp, const char* str);
+
+struct FrameTimeSummary
+{
+	uint32_t SampleCount = 0;
+	float MinMilliseconds = 0.0f;
+	float AvgMilliseconds = 0.0f;
+	float MaxMilliseconds = 0.0f;
+	float P50Milliseconds = 0.0f;
+	float P95Milliseconds = 0.0f;
+	float P99Milliseconds = 0.0f;
+	float P999Milliseconds = 0.0f;
+};
+
+struct FrameHitch
+{
+	uint64_t Frame = 0;
+	float Milliseconds = 0.0f;
+	float ThresholdMilliseconds = 0.0f;
+
+	// Filled in by whoever knows where the time went, usually the profiler zone with the most exclusive time
+	const char* Zone = nullptr;
+	float ZoneMilliseconds = 0.0f;
+};
+
+// Rolling frame time statistics. Percentiles cover the last WindowSize frames, the histogram covers every frame since the
+// last Reset. Histogram buckets are atomics so another thread can read them while frames are being added.
+class FrameTimeStats
+{
+public:
+	// Log spaced, four buckets per doubling starting at HistogramMinMilliseconds. The last bucket is a few seconds wide.
+	static constexpr uint32_t HistogramBucketCount = 64u;
+	static constexpr float HistogramMinMilliseconds = 0.125f;
+	static constexpr uint32_t MaxHitches = 64u;
+
+	explicit FrameTimeStats(uint32_t windowSize = 1024u)
+	{
+		SetWindowSize(windowSize);
+	}
+
+	void SetWindowSize(uint32_t windowSize)
+	{
+		Window.assign(std::max(windowSize, 1u), 0.0f);
+		Reset();
+	}
+
+	uint32_t GetWindowSize() const { return (uint32_t)Window.size(); }
+
+	// A frame is a hitch when it is more than `factor` times the window average and longer than `minMilliseconds`
+	void SetHitchThreshold(float factor, float minMilliseconds)
+	{
+		HitchFactor = factor;
+		HitchMinMilliseconds = minMilliseconds;
+	}
+
+	void Reset()
+	{
+		std::fill(Window.begin(), Window.end(), 0.0f);
+		WindowSum = 0.0;
+		FrameCount = 0;
+		HitchCount = 0;
+
+		for (std::atomic<uint32_t>& bucket : Histogram)
+			bucket.store(0u, std::memory_order_relaxed);
+	}
+
+	// Returns true when the frame was recorded as a hitch
+	bool AddFrame(float milliseconds)
+	{
+		const uint32_t windowSize = (uint32_t)Window.size();
+		const uint32_t samples = (uint32_t)std::min<uint64_t>(FrameCount, windowSize);
+
+		// Needs a few frames of history before anything can stand out against it
+		const float threshold = std::max(HitchFactor * (float)(WindowSum / std::max(samples, 1u)), HitchMinMilliseconds);
+		const bool isHitch = samples >= std::min(windowSize, 16u) && milliseconds > threshold;
+
+		float& slot = Window[FrameCount % windowSize];
+		WindowSum += (double)milliseconds - slot;
+		slot = milliseconds;
+
+		Histogram[GetHistogramBucket(milliseconds)].fetch_add(1u, std::memory_order_relaxed);
+
+		if (isHitch)
+		{
+			FrameHitch& hitch = Hitches[HitchCount % MaxHitches];
+			hitch = {};
+			hitch.Frame = FrameCount;
+			hitch.Milliseconds = milliseconds;
+			hitch.ThresholdMilliseconds = threshold;
+			HitchCount++;
+		}
+
+		FrameCount++;
+
+		return isHitch;
+	}
+
+	void SetLastHitchZone(const char* zone, float zoneMilliseconds)
+	{
+		if (HitchCount == 0)
+			return;
+
+		FrameHitch& hitch = Hitches[(HitchCount - 1u) % MaxHitches];
+		hitch.Zone = zone;
+		hitch.ZoneMilliseconds = zoneMilliseconds;
+	}
+
+	uint64_t GetFrameCount() const { return FrameCount; }
+	uint64_t GetHitchCount() const { return HitchCount; }
+
+	// index 0 is the most recent hitch, only the last MaxHitches are kept
+	uint32_t GetStoredHitchCount() const { return (uint32_t)std::min<uint64_t>(HitchCount, MaxHitches); }
+	const FrameHitch& GetHitch(uint32_t index) const { return Hitches[(HitchCount - 1u - index) % MaxHitches]; }
+
+	// Sorts a copy of the window, cheap enough for once a frame at the default window size
+	FrameTimeSummary Summarize() const
+	{
+		FrameTimeSummary summary;
+
+		summary.SampleCount = (uint32_t)std::min<uint64_t>(FrameCount, Window.size());
+		if (summary.SampleCount == 0)
+			return summary;
+
+		Sorted.assign(Window.begin(), Window.begin() + summary.SampleCount);
+		std::sort(Sorted.begin(), Sorted.end());
+
+		// Nearest rank, p99.9 of a short window is simply the max
+		auto Percentile = [&](double p)
+		{
+			const size_t rank = (size_t)std::ceil(p * Sorted.size());
+			return Sorted[std::clamp<size_t>(rank, 1u, Sorted.size()) - 1u];
+		};
+
+		summary.MinMilliseconds = Sorted.front();
+		summary.MaxMilliseconds = Sorted.back();
+		summary.AvgMilliseconds = (float)(WindowSum / summary.SampleCount);
+		summary.P50Milliseconds = Percentile(0.5);
+		summary.P95Milliseconds = Percentile(0.95);
+		summary.P99Milliseconds = Percentile(0.99);
+		summary.P999Milliseconds = Percentile(0.999);
+
+		return summary;
+	}
+
+	static uint32_t GetHistogramBucket(float milliseconds)
+	{
+		if (!(milliseconds > HistogramMinMilliseconds))
+			return 0u;
+
+		const float bucket = std::log2(milliseconds / HistogramMinMilliseconds) * 4.0f;
+		return std::min((uint32_t)bucket, HistogramBucketCount - 1u);
+	}
+
+	static float GetHistogramBucketMinMilliseconds(uint32_t bucket)
+	{
+		return bucket == 0 ? 0.0f : HistogramMinMilliseconds * std::exp2((float)bucket * 0.25f);
+	}
+
+	uint32_t GetHistogramCount(uint32_t bucket) const { return Histogram[bucket].load(std::memory_order_relaxed); }
+
+	// One row per frame still in the window, oldest first
+	bool WriteCsv(const char* path) const
+	{
+		FILE* fp = OpenFile(path, "w");
+		if (!fp)
+			return false;
+
+		fprintf(fp, "frame,milliseconds\n");
+
+		const uint64_t samples = std::min<uint64_t>(FrameCount, Window.size());
+		for (uint64_t frame = FrameCount - samples; frame < FrameCount; frame++)
+		{
+			fprintf(fp, "%llu,%.4f\n", (unsigned long long)frame, Window[frame % Window.size()]);
+		}
+
+		return CloseAfterWrite(fp);
+	}
+
+	// Summary, non empty histogram buckets and the stored hitches
+	bool WriteJson(const char* path) const
+	{
+		FILE* fp = OpenFile(path, "w");
+		if (!fp)
+			return false;
+
+		const FrameTimeSummary summary = Summarize();
+
+		fprintf(fp, "{\n  \"frames\": %llu,\n  \"window\": %u,\n", (unsigned long long)FrameCount, summary.SampleCount);
+		fprintf(fp, "  \"min_ms\": %.4f,\n  \"avg_ms\": %.4f,\n  \"max_ms\": %.4f,\n", summary.MinMilliseconds, summary.AvgMilliseconds, summary.MaxMilliseconds);
+		fprintf(fp, "  \"p50_ms\": %.4f,\n  \"p95_ms\": %.4f,\n  \"p99_ms\": %.4f,\n  \"p999_ms\": %.4f,\n",
+			summary.P50Milliseconds, summary.P95Milliseconds, summary.P99Milliseconds, summary.P999Milliseconds);
+
+		fprintf(fp, "  \"histogram\": [");
+		bool first = true;
+		for (uint32_t b = 0; b < HistogramBucketCount; b++)
+		{
+			const uint32_t count = GetHistogramCount(b);
+			if (count == 0)
+				continue;
+
+			fprintf(fp, "%s\n    { \"min_ms\": %.4f, \"count\": %u }", first ? "" : ",", GetHistogramBucketMinMilliseconds(b), count);
+			first = false;
+		}
+		fprintf(fp, "\n  ],\n");
+
+		fprintf(fp, "  \"hitch_count\": %llu,\n  \"hitches\": [", (unsigned long long)HitchCount);
+		for (uint32_t h = 0; h < GetStoredHitchCount(); h++)
+		{
+			const FrameHitch& hitch = GetHitch(h);
+			fprintf(fp, "%s\n    { \"frame\": %llu, \"ms\": %.4f, \"threshold_ms\": %.4f, \"zone\": ", h == 0 ? "" : ",",
+				(unsigned long long)hitch.Frame, hitch.Milliseconds, hitch.ThresholdMilliseconds);
+			Log_WriteJsonString(fp, hitch.Zone ? hitch.Zone : "");
+			fprintf(fp, ", \"zone_ms\": %.4f }", hitch.ZoneMilliseconds);
+		}
+		fprintf(fp, "\n  ]\n}\n");
+
+		return CloseAfterWrite(fp);
+	}
+
+private:
+	static bool CloseAfterWrite(FILE* fp)
+	{
+		const bool ok = ferror(fp) == 0;
+		fclose(fp);
+		return ok;
+	}
+
+	std::vector<float> Window;
+	mutable std::vector<float> Sorted;
+	double WindowSum = 0.0;
+	uint64_t FrameCount = 0;
+
+	std::atomic<uint32_t> Histogram[HistogramBucketCount] = {};
+
+	FrameHitch Hitches[MaxHitches] = {};
+	uint64_t HitchCount = 0;
+
+	float HitchFactor = 2.0f;
+	float HitchMinMilliseconds = 1.0f;
+};
 
 class Clock
-{	
+{
 	using Duration = std::chrono::high_resolution_clock::duration;
 	using HighResolutionClock = std::chrono::high_resolution_clock;
 	using TimePoint = std::chrono::high_resolution_clock::time_point;
@@ -16,18 +266,36 @@ public:
 		LastFrameTime = HighResolutionClock::now();
 	}
 
-	void Tick()
+	// Starts timing from now, frames measured before are forgotten
+	void Reset()
+	{
+		LastFrameTime = HighResolutionClock::now();
+		DeltaTime = Duration(0);
+		TotalTime = Duration(0);
+		Stats.Reset();
+	}
+
+	// Returns true when the frame that just ended was a hitch, see FrameTimeStats::SetHitchThreshold
+	bool Tick()
 	{
 		TimePoint CurrentTime = HighResolutionClock::now();
 		DeltaTime = CurrentTime - LastFrameTime;
 		TotalTime += DeltaTime;
 		LastFrameTime = CurrentTime;
+
+		return Stats.AddFrame(GetDeltaMilliseconds());
 	}
 
-	float GetDeltaSeconds() const { return static_cast<float>(DeltaTime.count() * 1e-9); }
+	float GetDeltaSeconds() const { return std::chrono::duration<float>(DeltaTime).count(); }
+	float GetDeltaMilliseconds() const { return std::chrono::duration<float, std::milli>(DeltaTime).count(); }
+
+	FrameTimeStats& GetStats() { return Stats; }
+	const FrameTimeStats& GetStats() const { return Stats; }
 
 private:
 	TimePoint LastFrameTime;
 	Duration DeltaTime;
 	Duration TotalTime;
-};
\ No newline at end of file
+
+	FrameTimeStats Stats;
+};
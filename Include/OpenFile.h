@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdio>
+
+// fopen without the MSVC deprecation warning, nullptr when the file cannot be opened
+inline FILE* OpenFile(const char* path, const char* mode)
+{
+	FILE* fp = nullptr;
+#ifdef _WIN32
+	if (fopen_s(&fp, path, mode) != 0)
+		fp = nullptr;
+#else
+	fp = fopen(path, mode);
+#endif
+	return fp;
+}
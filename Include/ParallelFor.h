@@ -0,0 +1,218 @@
+#pragma once
+
+// Concurrency::parallel_for comes from the MSVC runtime, other platforms get a minimal stand in built on a pool of
+// std::threads so the same loops compile for headless builds.
+
+#if defined(_WIN32)
+
+#include <ppl.h>
+
+#else
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Concurrency
+{
+	// One loop handed to the pool. Slots are preallocated so running a loop never touches the heap.
+	struct ParallelForJob
+	{
+		void (*Run)(const void* context, size_t index) = nullptr;
+		const void* Context = nullptr;
+		size_t Count = 0;
+
+		std::atomic<size_t> Next = 0;
+		std::atomic<size_t> Completed = 0;
+
+		// Guarded by the pool lock. Workers still inside the loop keep the slot from being reused.
+		uint32_t Workers = 0;
+		bool Active = false;
+
+		void Execute()
+		{
+			for (size_t i = Next.fetch_add(1); i < Count; i = Next.fetch_add(1))
+			{
+				Run(Context, i);
+				Completed.fetch_add(1, std::memory_order_release);
+			}
+		}
+
+		bool HasWork() const
+		{
+			return Active && Next.load(std::memory_order_relaxed) < Count;
+		}
+	};
+
+	// Workers are started the first time a loop runs, once per process, and help with whichever loops have items left.
+	// The calling thread works through its own loop too, so loops nested inside a loop always finish even when every
+	// worker is busy. Loops that find every slot taken run on the calling thread alone.
+	class ParallelForPool
+	{
+	public:
+
+		static constexpr size_t MaxJobs = 64;
+
+		explicit ParallelForPool(uint32_t workerCount)
+		{
+			Threads.reserve(workerCount);
+			for (uint32_t t = 0; t < workerCount; t++)
+			{
+				Threads.emplace_back([this]() { WorkerLoop(); });
+			}
+		}
+
+		~ParallelForPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(Lock);
+				Stopping = true;
+			}
+
+			WorkReady.notify_all();
+
+			for (std::thread& thread : Threads)
+			{
+				thread.join();
+			}
+		}
+
+		ParallelForPool(const ParallelForPool&) = delete;
+		ParallelForPool& operator=(const ParallelForPool&) = delete;
+
+		size_t GetWorkerCount() const noexcept { return Threads.size(); }
+
+		void Run(void (*run)(const void*, size_t), const void* context, size_t count)
+		{
+			ParallelForJob* job = nullptr;
+
+			{
+				std::lock_guard<std::mutex> lock(Lock);
+
+				for (ParallelForJob& slot : Jobs)
+				{
+					if (!slot.Active && slot.Workers == 0)
+					{
+						job = &slot;
+						break;
+					}
+				}
+
+				if (job)
+				{
+					job->Run = run;
+					job->Context = context;
+					job->Count = count;
+					job->Next.store(0, std::memory_order_relaxed);
+					job->Completed.store(0, std::memory_order_relaxed);
+					job->Active = true;
+				}
+			}
+
+			if (!job)
+			{
+				for (size_t i = 0; i < count; i++)
+					run(context, i);
+				return;
+			}
+
+			WorkReady.notify_all();
+
+			job->Execute();
+
+			std::unique_lock<std::mutex> lock(Lock);
+			JobDone.wait(lock, [job]() { return job->Workers == 0 && job->Completed.load(std::memory_order_acquire) == job->Count; });
+			job->Active = false;
+		}
+
+	private:
+
+		ParallelForJob* FindJob()
+		{
+			for (ParallelForJob& job : Jobs)
+			{
+				if (job.HasWork())
+					return &job;
+			}
+			return nullptr;
+		}
+
+		void WorkerLoop()
+		{
+			std::unique_lock<std::mutex> lock(Lock);
+
+			while (true)
+			{
+				ParallelForJob* job = nullptr;
+				WorkReady.wait(lock, [&]() { return Stopping || (job = FindJob()) != nullptr; });
+
+				if (Stopping)
+					return;
+
+				job->Workers++;
+				lock.unlock();
+
+				job->Execute();
+
+				lock.lock();
+				job->Workers--;
+
+				JobDone.notify_all();
+			}
+		}
+
+		std::mutex Lock;
+		std::condition_variable WorkReady;
+		std::condition_variable JobDone;
+		ParallelForJob Jobs[MaxJobs];
+		bool Stopping = false;
+
+		std::vector<std::thread> Threads;
+	};
+
+	// One worker per hardware thread, less the thread calling parallel_for
+	inline ParallelForPool& ParallelFor_GetPool()
+	{
+		static ParallelForPool pool(std::max(std::thread::hardware_concurrency(), 1u) - 1u);
+		return pool;
+	}
+
+	template<typename Index, typename Func>
+	void parallel_for(Index first, Index last, const Func& func)
+	{
+		if (!(first < last))
+			return;
+
+		const size_t count = static_cast<size_t>(last - first);
+
+		ParallelForPool& pool = ParallelFor_GetPool();
+
+		if (count == 1 || pool.GetWorkerCount() == 0)
+		{
+			for (Index i = first; i < last; i++)
+				func(i);
+			return;
+		}
+
+		struct Context
+		{
+			const Func* Body;
+			Index First;
+		};
+
+		const Context context = { &func, first };
+
+		pool.Run([](const void* p, size_t i)
+		{
+			const Context& c = *static_cast<const Context*>(p);
+			(*c.Body)(static_cast<Index>(c.First + static_cast<Index>(i)));
+		}, &context, count);
+	}
+}
+
+#endif
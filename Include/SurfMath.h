@@ -1,6 +1,10 @@
 #pragma once
 
 #include <assert.h>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <memory>
 
 typedef uint32_t u32;
@@ -205,7 +209,6 @@ struct Vector4Component
         struct
         {
             Vector3Component<T> xyz;
-            T w;
         };
         T v[4];
     };
@@ -1218,6 +1221,58 @@ struct BoundingFrustum
     }
 };
 
+// Inward facing planes of a view projection frustum, extracted from the combined matrix. Expects D3D clip space with depth in
+// [0, 1] and planes are normalized so distances are in world units.
+struct FrustumPlanes
+{
+    static constexpr size_t PlaneCount = 6;
+
+    float4 planes[PlaneCount];
+
+    FrustumPlanes() = default;
+
+    explicit FrustumPlanes(const matrix& viewProjection)
+    {
+        CreateFromMatrix(viewProjection);
+    }
+
+    inline void CreateFromMatrix(const matrix& m) noexcept
+    {
+        const float4 c0(m._11, m._21, m._31, m._41);
+        const float4 c1(m._12, m._22, m._32, m._42);
+        const float4 c2(m._13, m._23, m._33, m._43);
+        const float4 c3(m._14, m._24, m._34, m._44);
+
+        planes[0] = c3 + c0; // left
+        planes[1] = c3 - c0; // right
+        planes[2] = c3 + c1; // bottom
+        planes[3] = c3 - c1; // top
+        planes[4] = c2;      // near
+        planes[5] = c3 - c2; // far
+
+        for (size_t i = 0; i < PlaneCount; i++)
+            planes[i] = planes[i] * (1.0f / LengthF3(planes[i].xyz));
+    }
+
+    // Conservative, boxes near a corner of the frustum can pass while being outside it
+    inline bool Intersects(const AABB& box) const noexcept
+    {
+        const float3 centre = box.Origin();
+        const float3 extents = box.Extents();
+
+        for (size_t i = 0; i < PlaneCount; i++)
+        {
+            const float3 normal = planes[i].xyz;
+            const float3 absNormal = float3(fabsf(normal.x), fabsf(normal.y), fabsf(normal.z));
+
+            if (DotF3(normal, centre) + planes[i].w + DotF3(extents, absNormal) < 0.0f)
+                return false;
+        }
+
+        return true;
+    }
+};
+
 template<typename T>
 static constexpr T AlignUp(T size, T alignment)
 {
@@ -0,0 +1,313 @@
+#include "RenderNullInternal.h"
+
+#include <Render/Render.h>
+
+#include <algorithm>
+
+namespace tpr
+{
+	static uint32_t GetFormatBytesPerPixel(RenderFormat format)
+	{
+		switch (format)
+		{
+		case RenderFormat::R32G32B32A32_FLOAT: return 16u;
+		case RenderFormat::R32G32B32_FLOAT: return 12u;
+		case RenderFormat::R32G32_FLOAT: return 8u;
+		case RenderFormat::R16G16B16A16_FLOAT: return 8u;
+		case RenderFormat::R16_UINT: return 2u;
+		case RenderFormat::R8G8_UNORM: return 2u;
+		case RenderFormat::R8_UNORM: return 1u;
+		default: return 4u;
+		}
+	}
+
+	static size_t GetSurfaceBytes(RenderFormat format, uint32_t width, uint32_t height)
+	{
+		const size_t blocks = (size_t)((width + 3u) / 4u) * ((height + 3u) / 4u);
+
+		switch (format)
+		{
+		case RenderFormat::BC1_UNORM:
+		case RenderFormat::BC4_UNORM: return blocks * 8u;
+		case RenderFormat::BC3_UNORM:
+		case RenderFormat::BC5_UNORM:
+		case RenderFormat::BC6H_UF16:
+		case RenderFormat::BC7_UNORM: return blocks * 16u;
+		default: return (size_t)width * height * GetFormatBytesPerPixel(format);
+		}
+	}
+
+	static void RecordUpload(size_t size)
+	{
+		RenderNull_GetState().UploadBytes.fetch_add(size, std::memory_order_relaxed);
+	}
+
+	static void RecordResource()
+	{
+		RenderNull_GetState().ResourcesCreated.fetch_add(1u, std::memory_order_relaxed);
+	}
+
+	static DynamicBuffer_t AllocDynamicBuffer(size_t size)
+	{
+		RenderNull_GetState().DynamicBytes.fetch_add(size, std::memory_order_relaxed);
+		return RenderNull_AllocHandle<DynamicBuffer_t>();
+	}
+
+	RenderNullState& RenderNull_GetState()
+	{
+		static RenderNullState State;
+		return State;
+	}
+
+	const char* NullCommandType_GetName(NullCommandType type)
+	{
+		switch (type)
+		{
+		case NullCommandType::SET_ROOT_SIGNATURE: return "SetRootSignature";
+		case NullCommandType::SET_PIPELINE_STATE: return "SetPipelineState";
+		case NullCommandType::SET_ROOT_CBV: return "SetGraphicsRootCBV";
+		case NullCommandType::SET_ROOT_DESCRIPTOR_TABLE: return "SetGraphicsRootDescriptorTable";
+		case NullCommandType::SET_ROOT_VALUE: return "SetGraphicsRootValue";
+		case NullCommandType::BIND_VERTEX_CBVS: return "BindVertexCBVs";
+		case NullCommandType::BIND_PIXEL_CBVS: return "BindPixelCBVs";
+		case NullCommandType::BIND_VERTEX_SRVS: return "BindVertexSRVs";
+		case NullCommandType::BIND_PIXEL_SRVS: return "BindPixelSRVs";
+		case NullCommandType::SET_INDEX_BUFFER: return "SetIndexBuffer";
+		case NullCommandType::SET_VERTEX_BUFFERS: return "SetVertexBuffers";
+		case NullCommandType::SET_VIEWPORTS: return "SetViewports";
+		case NullCommandType::SET_SCISSORS: return "SetScissors";
+		case NullCommandType::SET_RENDER_TARGETS: return "SetRenderTargets";
+		case NullCommandType::CLEAR_RENDER_TARGET: return "ClearRenderTarget";
+		case NullCommandType::CLEAR_DEPTH: return "ClearDepth";
+		case NullCommandType::TRANSITION_RESOURCE: return "TransitionResource";
+		case NullCommandType::DRAW_INDEXED_INSTANCED: return "DrawIndexedInstanced";
+		case NullCommandType::DRAW_INSTANCED: return "DrawInstanced";
+		default: return "Unknown";
+		}
+	}
+
+	RenderNullStats& RenderNullStats::operator+=(const RenderNullStats& other) noexcept
+	{
+		for (uint8_t i = 0; i < (uint8_t)NullCommandType::COUNT; i++)
+		{
+			Commands[i] += other.Commands[i];
+		}
+
+		Draws += other.Draws;
+		Primitives += other.Primitives;
+		StateChanges += other.StateChanges;
+		UploadBytes += other.UploadBytes;
+		DynamicBytes += other.DynamicBytes;
+		CommandListsSubmitted += other.CommandListsSubmitted;
+		ResourcesCreated += other.ResourcesCreated;
+
+		return *this;
+	}
+
+	const RenderNullStats& RenderNull_GetFrameStats()
+	{
+		RenderNullState& state = RenderNull_GetState();
+
+		std::lock_guard<std::mutex> lock(state.SubmitLock);
+
+		state.FrameStats.UploadBytes = state.UploadBytes.load(std::memory_order_relaxed);
+		state.FrameStats.DynamicBytes = state.DynamicBytes.load(std::memory_order_relaxed);
+		state.FrameStats.ResourcesCreated = state.ResourcesCreated.load(std::memory_order_relaxed);
+
+		return state.FrameStats;
+	}
+
+	const std::vector<NullCommand>& RenderNull_GetFrameCommands()
+	{
+		return RenderNull_GetState().FrameCommands;
+	}
+
+	void RenderNull_SetRecordCommands(bool record)
+	{
+		RenderNull_GetState().RecordCommands = record;
+	}
+
+	void RenderNull_SetBindless(bool bindless)
+	{
+		RenderNull_GetState().Bindless = bindless;
+	}
+
+	bool Render_Init(const RenderInitParams&)
+	{
+		RenderNull_GetState().Initialised = true;
+		return true;
+	}
+
+	bool Render_Initialised()
+	{
+		return RenderNull_GetState().Initialised;
+	}
+
+	void Render_ShutDown()
+	{
+		RenderNull_GetState().Initialised = false;
+	}
+
+	void Render_BeginFrame()
+	{
+		RenderNullState& state = RenderNull_GetState();
+
+		std::lock_guard<std::mutex> lock(state.SubmitLock);
+
+		state.FrameStats = {};
+		state.FrameCommands.clear();
+
+		state.UploadBytes.store(0u, std::memory_order_relaxed);
+		state.DynamicBytes.store(0u, std::memory_order_relaxed);
+		state.ResourcesCreated.store(0u, std::memory_order_relaxed);
+	}
+
+	void Render_BeginRenderFrame()
+	{
+	}
+
+	void Render_EndFrame()
+	{
+	}
+
+	bool Render_IsBindless()
+	{
+		return RenderNull_GetState().Bindless;
+	}
+
+	RootSignature_t CreateRootSignature(const RootSignatureDesc&)
+	{
+		RecordResource();
+		return RenderNull_AllocHandle<RootSignature_t>();
+	}
+
+	VertexShader_t CreateVertexShader(const char*, const ShaderMacros&)
+	{
+		RecordResource();
+		return RenderNull_AllocHandle<VertexShader_t>();
+	}
+
+	PixelShader_t CreatePixelShader(const char*, const ShaderMacros&)
+	{
+		RecordResource();
+		return RenderNull_AllocHandle<PixelShader_t>();
+	}
+
+	GraphicsPipelineState_t CreateGraphicsPipelineState(const GraphicsPipelineStateDesc&, const InputElementDesc*, size_t)
+	{
+		RecordResource();
+		return RenderNull_AllocHandle<GraphicsPipelineState_t>();
+	}
+
+	VertexBuffer_t CreateVertexBuffer(const void* data, size_t size)
+	{
+		RecordResource();
+		if (data)
+			RecordUpload(size);
+		return RenderNull_AllocHandle<VertexBuffer_t>();
+	}
+
+	IndexBuffer_t CreateIndexBuffer(const void* data, size_t size)
+	{
+		RecordResource();
+		if (data)
+			RecordUpload(size);
+		return RenderNull_AllocHandle<IndexBuffer_t>();
+	}
+
+	ConstantBuffer_t CreateConstantBuffer(const void* data, size_t size)
+	{
+		RecordResource();
+		if (data)
+			RecordUpload(size);
+		return RenderNull_AllocHandle<ConstantBuffer_t>();
+	}
+
+	StructuredBuffer_t CreateStructuredBuffer(const void* data, size_t size, size_t)
+	{
+		RecordResource();
+		if (data)
+			RecordUpload(size);
+		return RenderNull_AllocHandle<StructuredBuffer_t>();
+	}
+
+	void UpdateStructuredBuffer(StructuredBuffer_t, const void*, size_t size, size_t)
+	{
+		RecordUpload(size);
+	}
+
+	DynamicBuffer_t CreateDynamicConstantBuffer(const void*, size_t size)
+	{
+		return AllocDynamicBuffer(size);
+	}
+
+	DynamicBuffer_t CreateDynamicVertexBuffer(const void*, size_t size)
+	{
+		return AllocDynamicBuffer(size);
+	}
+
+	DynamicBuffer_t CreateDynamicIndexBuffer(const void*, size_t size)
+	{
+		return AllocDynamicBuffer(size);
+	}
+
+	Texture_t CreateTexture(const TextureCreateDesc& desc)
+	{
+		RecordResource();
+		if (desc.Data)
+		{
+			for (uint32_t slice = 0; slice < std::max(desc.ArraySize, 1u); slice++)
+				for (uint32_t mip = 0; mip < std::max(desc.MipCount, 1u); mip++)
+					RecordUpload(GetSurfaceBytes(desc.Format, std::max(desc.Width >> mip, 1u), std::max(desc.Height >> mip, 1u)));
+		}
+		return RenderNull_AllocHandle<Texture_t>();
+	}
+
+	ShaderResourceView_t CreateTextureSRV(Texture_t, RenderFormat, TextureDimension, uint32_t, uint32_t)
+	{
+		RecordResource();
+		return RenderNull_AllocHandle<ShaderResourceView_t>();
+	}
+
+	ShaderResourceView_t CreateStructuredBufferSRV(StructuredBuffer_t, uint32_t, uint32_t, uint32_t)
+	{
+		RecordResource();
+		return RenderNull_AllocHandle<ShaderResourceView_t>();
+	}
+
+	DepthStencilView_t CreateTextureDSV(Texture_t, RenderFormat, TextureDimension, uint32_t)
+	{
+		RecordResource();
+		return RenderNull_AllocHandle<DepthStencilView_t>();
+	}
+
+	RenderTargetView_t RenderNull_CreateRenderTargetView()
+	{
+		RecordResource();
+		return RenderNull_AllocHandle<RenderTargetView_t>();
+	}
+
+	uint32_t GetDescriptorIndex(ShaderResourceView_t srv)
+	{
+		// Handles are unique across every resource type so they double as descriptor indices
+		return static_cast<uint32_t>(srv);
+	}
+
+	void UploadBuffers(CommandList*)
+	{
+	}
+
+	// Handles are never reused so there is nothing to give back
+	void RenderRelease(Texture_t) {}
+	void RenderRelease(ShaderResourceView_t) {}
+	void RenderRelease(DepthStencilView_t) {}
+	void RenderRelease(RenderTargetView_t) {}
+	void RenderRelease(GraphicsPipelineState_t) {}
+	void RenderRelease(RootSignature_t) {}
+	void RenderRelease(VertexShader_t) {}
+	void RenderRelease(PixelShader_t) {}
+	void RenderRelease(VertexBuffer_t) {}
+	void RenderRelease(IndexBuffer_t) {}
+	void RenderRelease(ConstantBuffer_t) {}
+	void RenderRelease(StructuredBuffer_t) {}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Render/RenderTypes.h>
+
+#include <cstdint>
+#include <vector>
+
+// Null implementation of the tpr backend. Resources are handle counters with no storage and command lists record a compact
+// stream of the calls made on them, so the whole CPU side of a frame can run and be measured without a GPU or a window.
+// Render views are not implemented beyond placeholder handles, headless programs render into nothing and never present.
+
+namespace tpr
+{
+	enum class NullCommandType : uint8_t
+	{
+		SET_ROOT_SIGNATURE,
+		SET_PIPELINE_STATE,
+		SET_ROOT_CBV,
+		SET_ROOT_DESCRIPTOR_TABLE,
+		SET_ROOT_VALUE,
+		BIND_VERTEX_CBVS,
+		BIND_PIXEL_CBVS,
+		BIND_VERTEX_SRVS,
+		BIND_PIXEL_SRVS,
+		SET_INDEX_BUFFER,
+		SET_VERTEX_BUFFERS,
+		SET_VIEWPORTS,
+		SET_SCISSORS,
+		SET_RENDER_TARGETS,
+		CLEAR_RENDER_TARGET,
+		CLEAR_DEPTH,
+		TRANSITION_RESOURCE,
+		DRAW_INDEXED_INSTANCED,
+		DRAW_INSTANCED,
+		COUNT,
+	};
+
+	const char* NullCommandType_GetName(NullCommandType type);
+
+	// One recorded call. Array arguments keep their count and first element which is enough to tell calls apart and replay
+	// the stream with the same shape.
+	struct NullCommand
+	{
+		NullCommandType Type = NullCommandType::COUNT;
+		uint8_t Flags = 0;
+		uint16_t Count = 0;
+		uint32_t Slot = 0;
+		uint32_t Args[5] = {};
+	};
+
+	enum NullCommandFlags : uint8_t
+	{
+		NULL_CMD_DYNAMIC = 1 << 0,
+	};
+
+	struct RenderNullStats
+	{
+		uint64_t Commands[(uint8_t)NullCommandType::COUNT] = {};
+		uint64_t Draws = 0;
+		uint64_t Primitives = 0;
+		uint64_t StateChanges = 0;
+		uint64_t UploadBytes = 0;
+		uint64_t DynamicBytes = 0;
+		uint32_t CommandListsSubmitted = 0;
+		uint32_t ResourcesCreated = 0;
+
+		RenderNullStats& operator+=(const RenderNullStats& other) noexcept;
+	};
+
+	// Everything submitted since the last Render_BeginFrame, command lists appear in submission order
+	const RenderNullStats& RenderNull_GetFrameStats();
+	const std::vector<NullCommand>& RenderNull_GetFrameCommands();
+
+	// Copying the stream costs a few bytes per call, benchmarks that only want the stats can turn it off
+	void RenderNull_SetRecordCommands(bool record);
+
+	void RenderNull_SetBindless(bool bindless);
+
+	// Stands in for a render target view, the handle is unique but there is no texture behind it to render into
+	RenderTargetView_t RenderNull_CreateRenderTargetView();
+}
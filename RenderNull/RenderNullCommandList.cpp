@@ -0,0 +1,345 @@
+#include "RenderNullInternal.h"
+
+#include <Render/Render.h>
+
+namespace tpr
+{
+	// Command list objects handed out by this backend are NullCommandLists, CommandList is only ever used through pointers
+	static inline NullCommandList* ToNull(CommandList* cl)
+	{
+		return reinterpret_cast<NullCommandList*>(cl);
+	}
+
+	// Lists are chained through themselves, open ones in creation order so a group submits them in the order it made them.
+	// A frame only has a handful open so groups find theirs by walking the chain, nothing is allocated once lists are reused.
+	static struct NullCommandListPool
+	{
+		std::mutex Lock;
+		NullCommandList* FreeLists = nullptr;
+		NullCommandList* OpenLists = nullptr;
+		NullCommandList** OpenTail = &OpenLists;
+
+		~NullCommandListPool()
+		{
+			for (NullCommandList* lists : { FreeLists, OpenLists })
+			{
+				while (lists)
+				{
+					NullCommandList* next = lists->Next;
+					delete lists;
+					lists = next;
+				}
+			}
+		}
+
+		// Unlinks every open list of the group in order, hands it to fn and moves it to the free chain
+		template<typename Fn>
+		void TakeGroup(const void* group, const Fn& fn)
+		{
+			NullCommandList** link = &OpenLists;
+			while (NullCommandList* cl = *link)
+			{
+				if (cl->Group != group)
+				{
+					link = &cl->Next;
+					continue;
+				}
+
+				*link = cl->Next;
+				if (OpenTail == &cl->Next)
+					OpenTail = link;
+
+				fn(cl);
+
+				cl->Group = nullptr;
+				cl->Next = FreeLists;
+				FreeLists = cl;
+			}
+		}
+	} GCommandLists;
+
+	void NullCommandList::Reset()
+	{
+		Commands.clear();
+		Stats = {};
+		PreviousPSO = GraphicsPipelineState_t::INVALID;
+	}
+
+	NullCommand& NullCommandList::Record(NullCommandType type)
+	{
+		Stats.Commands[(uint8_t)type]++;
+
+		if (type != NullCommandType::DRAW_INDEXED_INSTANCED && type != NullCommandType::DRAW_INSTANCED
+			&& type != NullCommandType::CLEAR_RENDER_TARGET && type != NullCommandType::CLEAR_DEPTH)
+		{
+			Stats.StateChanges++;
+		}
+
+		// Written even when the stream is off so callers always have somewhere to put arguments
+		if (!RenderNull_GetState().RecordCommands)
+		{
+			Commands.resize(1);
+			Commands[0] = {};
+			Commands[0].Type = type;
+			return Commands[0];
+		}
+
+		NullCommand& cmd = Commands.emplace_back();
+		cmd.Type = type;
+		return cmd;
+	}
+
+	CommandListSubmissionGroup::CommandListSubmissionGroup(CommandListType)
+	{
+	}
+
+	CommandListSubmissionGroup::~CommandListSubmissionGroup()
+	{
+		std::lock_guard<std::mutex> lock(GCommandLists.Lock);
+
+		// Lists that were never submitted are dropped
+		GCommandLists.TakeGroup(this, [](NullCommandList*) {});
+	}
+
+	CommandList* CommandListSubmissionGroup::CreateCommandList()
+	{
+		std::lock_guard<std::mutex> lock(GCommandLists.Lock);
+
+		NullCommandList* cl = GCommandLists.FreeLists;
+		if (cl)
+		{
+			GCommandLists.FreeLists = cl->Next;
+		}
+		else
+		{
+			cl = new NullCommandList();
+		}
+
+		cl->Reset();
+		cl->Group = this;
+		cl->Next = nullptr;
+
+		*GCommandLists.OpenTail = cl;
+		GCommandLists.OpenTail = &cl->Next;
+
+		return reinterpret_cast<CommandList*>(cl);
+	}
+
+	void CommandListSubmissionGroup::Submit()
+	{
+		RenderNullState& state = RenderNull_GetState();
+
+		std::scoped_lock lock(GCommandLists.Lock, state.SubmitLock);
+
+		GCommandLists.TakeGroup(this, [&](NullCommandList* cl)
+		{
+			state.FrameStats += cl->Stats;
+			state.FrameStats.CommandListsSubmitted++;
+
+			if (state.RecordCommands)
+			{
+				state.FrameCommands.insert(state.FrameCommands.end(), cl->Commands.begin(), cl->Commands.end());
+			}
+		});
+	}
+
+	void CommandList::SetRootSignature(RootSignature_t rootSignature)
+	{
+		NullCommand& cmd = ToNull(this)->Record(NullCommandType::SET_ROOT_SIGNATURE);
+		cmd.Args[0] = static_cast<uint32_t>(rootSignature);
+	}
+
+	void CommandList::SetPipelineState(GraphicsPipelineState_t pso)
+	{
+		NullCommandList* cl = ToNull(this);
+
+		NullCommand& cmd = cl->Record(NullCommandType::SET_PIPELINE_STATE);
+		cmd.Args[0] = static_cast<uint32_t>(pso);
+
+		cl->PreviousPSO = pso;
+	}
+
+	GraphicsPipelineState_t CommandList::GetPreviousPSO()
+	{
+		return ToNull(this)->PreviousPSO;
+	}
+
+	void CommandList::SetGraphicsRootCBV(uint32_t slot, DynamicBuffer_t buf)
+	{
+		NullCommand& cmd = ToNull(this)->Record(NullCommandType::SET_ROOT_CBV);
+		cmd.Flags = NULL_CMD_DYNAMIC;
+		cmd.Slot = slot;
+		cmd.Args[0] = static_cast<uint32_t>(buf);
+	}
+
+	void CommandList::SetGraphicsRootCBV(uint32_t slot, ConstantBuffer_t buf)
+	{
+		NullCommand& cmd = ToNull(this)->Record(NullCommandType::SET_ROOT_CBV);
+		cmd.Slot = slot;
+		cmd.Args[0] = static_cast<uint32_t>(buf);
+	}
+
+	void CommandList::SetGraphicsRootDescriptorTable(uint32_t slot)
+	{
+		NullCommand& cmd = ToNull(this)->Record(NullCommandType::SET_ROOT_DESCRIPTOR_TABLE);
+		cmd.Slot = slot;
+	}
+
+	void CommandList::SetGraphicsRootValue(uint32_t slot, uint32_t value)
+	{
+		NullCommand& cmd = ToNull(this)->Record(NullCommandType::SET_ROOT_VALUE);
+		cmd.Slot = slot;
+		cmd.Args[0] = value;
+	}
+
+	template<typename T>
+	static void RecordArray(CommandList* cl, NullCommandType type, uint8_t flags, uint32_t startSlot, size_t count, const T* items)
+	{
+		NullCommand& cmd = ToNull(cl)->Record(type);
+		cmd.Flags = flags;
+		cmd.Slot = startSlot;
+		cmd.Count = (uint16_t)count;
+		cmd.Args[0] = count > 0 ? static_cast<uint32_t>(items[0]) : 0u;
+	}
+
+	void CommandList::BindVertexCBVs(uint32_t startSlot, uint32_t count, const DynamicBuffer_t* bufs)
+	{
+		RecordArray(this, NullCommandType::BIND_VERTEX_CBVS, NULL_CMD_DYNAMIC, startSlot, count, bufs);
+	}
+
+	void CommandList::BindVertexCBVs(uint32_t startSlot, uint32_t count, const ConstantBuffer_t* bufs)
+	{
+		RecordArray(this, NullCommandType::BIND_VERTEX_CBVS, 0, startSlot, count, bufs);
+	}
+
+	void CommandList::BindPixelCBVs(uint32_t startSlot, uint32_t count, const DynamicBuffer_t* bufs)
+	{
+		RecordArray(this, NullCommandType::BIND_PIXEL_CBVS, NULL_CMD_DYNAMIC, startSlot, count, bufs);
+	}
+
+	void CommandList::BindPixelCBVs(uint32_t startSlot, uint32_t count, const ConstantBuffer_t* bufs)
+	{
+		RecordArray(this, NullCommandType::BIND_PIXEL_CBVS, 0, startSlot, count, bufs);
+	}
+
+	void CommandList::BindVertexSRVs(uint32_t startSlot, size_t count, const ShaderResourceView_t* srvs)
+	{
+		RecordArray(this, NullCommandType::BIND_VERTEX_SRVS, 0, startSlot, count, srvs);
+	}
+
+	void CommandList::BindPixelSRVs(uint32_t startSlot, size_t count, const ShaderResourceView_t* srvs)
+	{
+		RecordArray(this, NullCommandType::BIND_PIXEL_SRVS, 0, startSlot, count, srvs);
+	}
+
+	void CommandList::SetIndexBuffer(IndexBuffer_t buf, RenderFormat format, uint32_t offset)
+	{
+		NullCommand& cmd = ToNull(this)->Record(NullCommandType::SET_INDEX_BUFFER);
+		cmd.Args[0] = static_cast<uint32_t>(buf);
+		cmd.Args[1] = static_cast<uint32_t>(format);
+		cmd.Args[2] = offset;
+	}
+
+	void CommandList::SetIndexBuffer(DynamicBuffer_t buf, RenderFormat format, uint32_t offset)
+	{
+		NullCommand& cmd = ToNull(this)->Record(NullCommandType::SET_INDEX_BUFFER);
+		cmd.Flags = NULL_CMD_DYNAMIC;
+		cmd.Args[0] = static_cast<uint32_t>(buf);
+		cmd.Args[1] = static_cast<uint32_t>(format);
+		cmd.Args[2] = offset;
+	}
+
+	void CommandList::SetVertexBuffers(uint32_t startSlot, uint32_t count, const VertexBuffer_t* bufs, const uint32_t*, const uint32_t*)
+	{
+		RecordArray(this, NullCommandType::SET_VERTEX_BUFFERS, 0, startSlot, count, bufs);
+	}
+
+	void CommandList::SetVertexBuffers(uint32_t startSlot, uint32_t count, const DynamicBuffer_t* bufs, const uint32_t*, const uint32_t*)
+	{
+		RecordArray(this, NullCommandType::SET_VERTEX_BUFFERS, NULL_CMD_DYNAMIC, startSlot, count, bufs);
+	}
+
+	void CommandList::SetVertexBuffer(uint32_t slot, VertexBuffer_t buf, uint32_t stride, uint32_t offset)
+	{
+		SetVertexBuffers(slot, 1u, &buf, &stride, &offset);
+	}
+
+	void CommandList::SetVertexBuffer(uint32_t slot, DynamicBuffer_t buf, uint32_t stride, uint32_t offset)
+	{
+		SetVertexBuffers(slot, 1u, &buf, &stride, &offset);
+	}
+
+	void CommandList::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, uint32_t baseVertex, uint32_t startInstance)
+	{
+		NullCommandList* cl = ToNull(this);
+
+		NullCommand& cmd = cl->Record(NullCommandType::DRAW_INDEXED_INSTANCED);
+		cmd.Args[0] = indexCount;
+		cmd.Args[1] = instanceCount;
+		cmd.Args[2] = startIndex;
+		cmd.Args[3] = baseVertex;
+		cmd.Args[4] = startInstance;
+
+		cl->Stats.Draws++;
+		cl->Stats.Primitives += (uint64_t)(indexCount / 3u) * instanceCount;
+	}
+
+	void CommandList::DrawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance)
+	{
+		NullCommandList* cl = ToNull(this);
+
+		NullCommand& cmd = cl->Record(NullCommandType::DRAW_INSTANCED);
+		cmd.Args[0] = vertexCount;
+		cmd.Args[1] = instanceCount;
+		cmd.Args[2] = startVertex;
+		cmd.Args[3] = startInstance;
+
+		cl->Stats.Draws++;
+		cl->Stats.Primitives += (uint64_t)(vertexCount / 3u) * instanceCount;
+	}
+
+	void CommandList::SetViewports(const Viewport*, uint32_t count)
+	{
+		NullCommand& cmd = ToNull(this)->Record(NullCommandType::SET_VIEWPORTS);
+		cmd.Count = (uint16_t)count;
+	}
+
+	void CommandList::SetDefaultScissor()
+	{
+		ToNull(this)->Record(NullCommandType::SET_SCISSORS);
+	}
+
+	void CommandList::SetScissors(const ScissorRect*, uint32_t count)
+	{
+		NullCommand& cmd = ToNull(this)->Record(NullCommandType::SET_SCISSORS);
+		cmd.Count = (uint16_t)count;
+	}
+
+	void CommandList::SetRenderTargets(const RenderTargetView_t* rtvs, uint32_t count, DepthStencilView_t dsv)
+	{
+		NullCommand& cmd = ToNull(this)->Record(NullCommandType::SET_RENDER_TARGETS);
+		cmd.Count = (uint16_t)count;
+		cmd.Args[0] = count > 0 ? static_cast<uint32_t>(rtvs[0]) : 0u;
+		cmd.Args[1] = static_cast<uint32_t>(dsv);
+	}
+
+	void CommandList::ClearRenderTarget(RenderTargetView_t rtv, const float*)
+	{
+		NullCommand& cmd = ToNull(this)->Record(NullCommandType::CLEAR_RENDER_TARGET);
+		cmd.Args[0] = static_cast<uint32_t>(rtv);
+	}
+
+	void CommandList::ClearDepth(DepthStencilView_t dsv, float)
+	{
+		NullCommand& cmd = ToNull(this)->Record(NullCommandType::CLEAR_DEPTH);
+		cmd.Args[0] = static_cast<uint32_t>(dsv);
+	}
+
+	void CommandList::TransitionResource(Texture_t texture, ResourceTransitionState from, ResourceTransitionState to)
+	{
+		NullCommand& cmd = ToNull(this)->Record(NullCommandType::TRANSITION_RESOURCE);
+		cmd.Args[0] = static_cast<uint32_t>(texture);
+		cmd.Args[1] = static_cast<uint32_t>(from);
+		cmd.Args[2] = static_cast<uint32_t>(to);
+	}
+}
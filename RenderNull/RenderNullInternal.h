@@ -0,0 +1,49 @@
+#pragma once
+
+#include "RenderNull.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace tpr
+{
+	struct NullCommandList
+	{
+		std::vector<NullCommand> Commands;
+		RenderNullStats Stats;
+		GraphicsPipelineState_t PreviousPSO = GraphicsPipelineState_t::INVALID;
+
+		// Group the list was created from while it is open, and the next list in the open or free chain
+		const void* Group = nullptr;
+		NullCommandList* Next = nullptr;
+
+		void Reset();
+		NullCommand& Record(NullCommandType type);
+	};
+
+	struct RenderNullState
+	{
+		bool Initialised = false;
+		bool Bindless = true;
+		bool RecordCommands = true;
+
+		std::atomic<uint32_t> NextHandle = 1u;
+
+		// Resource creation and dynamic allocation can happen on any thread
+		std::atomic<uint64_t> UploadBytes = 0u;
+		std::atomic<uint64_t> DynamicBytes = 0u;
+		std::atomic<uint32_t> ResourcesCreated = 0u;
+
+		std::mutex SubmitLock;
+		RenderNullStats FrameStats;
+		std::vector<NullCommand> FrameCommands;
+	};
+
+	RenderNullState& RenderNull_GetState();
+
+	template<typename T>
+	inline T RenderNull_AllocHandle()
+	{
+		return static_cast<T>(RenderNull_GetState().NextHandle.fetch_add(1u, std::memory_order_relaxed));
+	}
+}
@@ -12,10 +12,7 @@ struct PS_INPUT
 
 #ifdef _VS
 
-cbuffer modelData : register(b1) 
-{
-    row_major float4x4 ModelMatrix; 
-};
+#include "Shaders/ObjectData.h"
 
 struct VS_INPUT
 {
@@ -30,6 +27,8 @@ PS_INPUT main(VS_INPUT input)
 {
     PS_INPUT output;
 
+    const float4x4 ModelMatrix = GetObjectTransform().Current;
+
     output.worldPos = mul(float4(input.pos, 1.f), ModelMatrix).xyz;
     output.pos = mul(float4(output.worldPos, 1.0f), View.ViewProjectionMatrix);
     output.normal = mul(float4(input.normal, 0.0f), ModelMatrix).xyz;
@@ -65,25 +64,48 @@ cbuffer MaterialData : register(b2)
     float RoughnessFactor;
 
     float2 pad1;
+
+    // xy scale and zw offset into an atlas page, identity for textures that are not packed
+    float4 BaseColorUvTransform;
+    float4 NormalUvTransform;
+    float4 MetallicRoughnessUvTransform;
+    float4 EmissiveUvTransform;
 };
 
 #if _BINDLESS
 
 Texture2D<float4> t_tex2d[512] : register(t0, space0);
+TextureCube<float4> t_texCube[512] : register(t0, space2);
 
 #define MTL_TEX(BoundTex, BindlessIndex) t_tex2d[BindlessIndex]
 
+#define IBL_SPECULAR t_texCube[View.SpecularSrvIndex]
+#define IBL_BRDF_LUT t_tex2d[View.BrdfLutSrvIndex]
+
 #else
 
 Texture2D<float4> BaseColorTexture : register(t0);
 Texture2D<float4> NormalTexture : register(t1);
 Texture2D<float4> MetallicRoughnessTexture : register(t2);
 Texture2D<float4> EmissiveTexture : register(t3);
+TextureCube<float4> SpecularEnvironment : register(t4);
+Texture2D<float4> BrdfLut : register(t5);
 
 #define MTL_TEX(BoundTex, BindlessIndex) BoundTex
 
+#define IBL_SPECULAR SpecularEnvironment
+#define IBL_BRDF_LUT BrdfLut
+
 #endif // _BINDLESS
 
+// Atlased textures repeat inside their cell. Gradients come from the unwrapped UVs so the wrap does not pick the
+// smallest mip along the seam.
+float4 SampleMaterialTexture(Texture2D<float4> tex, float4 uvTransform, float2 uv)
+{
+    const float2 scale = uvTransform.xy;
+    return tex.SampleGrad(TrilinearSampler, uvTransform.zw + frac(uv) * scale, ddx(uv) * scale, ddy(uv) * scale);
+}
+
 static const float M_PI = 3.14159265359;
 
 float3 F_Schlick(float3 f0, float3 f90, float VdotH)
@@ -138,6 +160,21 @@ float3 BRDF_specularGGX(float3 f0, float3 f90, float alphaRoughness, float specu
     return specularWeight * F * Vis * D;
 }
 
+// Irradiance over pi from the baked coefficients, the basis constants are already folded in
+float3 EvaluateIrradianceSh(float3 n)
+{
+    float3 irradiance = View.IrradianceSh[0].rgb;
+    irradiance += View.IrradianceSh[1].rgb * n.y;
+    irradiance += View.IrradianceSh[2].rgb * n.z;
+    irradiance += View.IrradianceSh[3].rgb * n.x;
+    irradiance += View.IrradianceSh[4].rgb * (n.x * n.y);
+    irradiance += View.IrradianceSh[5].rgb * (n.y * n.z);
+    irradiance += View.IrradianceSh[6].rgb * (3.0f * n.z * n.z - 1.0f);
+    irradiance += View.IrradianceSh[7].rgb * (n.x * n.z);
+    irradiance += View.IrradianceSh[8].rgb * (n.x * n.x - n.y * n.y);
+    return max(irradiance, 0.0f);
+}
+
 float3 Tonemap(float3 x)
 {
     const float a = 2.51f;
@@ -153,7 +190,7 @@ float4 main(PS_INPUT input, bool frontFace : SV_IsFrontFace) : SV_Target
     float4 baseColor = BaseColorFactor;
     if(BaseColorTextureIndex)
     {
-        baseColor *= MTL_TEX(BaseColorTexture, BaseColorTextureIndex).Sample(TrilinearSampler, input.texcoord[BaseColorUvIndex]);
+        baseColor *= SampleMaterialTexture(MTL_TEX(BaseColorTexture, BaseColorTextureIndex), BaseColorUvTransform, input.texcoord[BaseColorUvIndex]);
     }
 
 #if MAT_TWOSIDED
@@ -169,9 +206,12 @@ float4 main(PS_INPUT input, bool frontFace : SV_IsFrontFace) : SV_Target
     float3 normal = vertexNormal;
     if(NormalTextureIndex)
     {
-        float3 texNormal = MTL_TEX(NormalTexture, NormalTextureIndex).Sample(TrilinearSampler, input.texcoord[NormalUvIndex]).rgb;
+        // Only XY is stored when the normal map is block compressed, Z is rebuilt for every format
+        float2 texNormalXY = SampleMaterialTexture(MTL_TEX(NormalTexture, NormalTextureIndex), NormalUvTransform, input.texcoord[NormalUvIndex]).rg;
+
+        texNormalXY = (2.0f * texNormalXY) - float(1.0f).rr;
 
-        texNormal = (2.0f * texNormal) - float(1.0f).rrr;
+        float3 texNormal = float3(texNormalXY, sqrt(saturate(1.0f - dot(texNormalXY, texNormalXY))));
 
         float3x3 tangentMatrix = float3x3(input.tangent, input.bitangent, vertexNormal);
 
@@ -182,7 +222,8 @@ float4 main(PS_INPUT input, bool frontFace : SV_IsFrontFace) : SV_Target
     float roughness = RoughnessFactor;
     if(MetallicRoughnessTextureIndex)
     {
-        float2 texMetallicRoughness = MTL_TEX(MetallicRoughnessTexture, MetallicRoughnessTextureIndex).Sample(TrilinearSampler, input.texcoord[MetallicRoughnessUvIndex]).gb;
+        // Roughness and metallic are moved from G and B to R and G at load
+        float2 texMetallicRoughness = SampleMaterialTexture(MTL_TEX(MetallicRoughnessTexture, MetallicRoughnessTextureIndex), MetallicRoughnessUvTransform, input.texcoord[MetallicRoughnessUvIndex]).rg;
 
         metallic *= texMetallicRoughness.y;
         roughness *= texMetallicRoughness.x;    
@@ -191,7 +232,7 @@ float4 main(PS_INPUT input, bool frontFace : SV_IsFrontFace) : SV_Target
     float3 emissive = EmissiveFactor;
     if(EmissiveTextureIndex)
     {
-        emissive *= MTL_TEX(EmissiveTexture, EmissiveTextureIndex).Sample(TrilinearSampler, input.texcoord[EmissiveUvIndex]).rgb;
+        emissive *= SampleMaterialTexture(MTL_TEX(EmissiveTexture, EmissiveTextureIndex), EmissiveUvTransform, input.texcoord[EmissiveUvIndex]).rgb;
     }
 
     const float3 LightAmbient = float3(0.3f, 0.3f, 0.3f);
@@ -217,7 +258,21 @@ float4 main(PS_INPUT input, bool frontFace : SV_IsFrontFace) : SV_Target
     float3 spec = 0;
     float3 diff = 0;
 
-    diff += LightAmbient * baseColor.rgb;
+    if(View.SpecularMipCount > 0.0f)
+    {
+        // Split sum, v points from the camera so reflect gives the mirror direction directly
+        const float perceptualRoughness = saturate(roughness);
+        const float2 lutUv = clamp(float2(saturate(dot(n, -v)), perceptualRoughness), 0.01f, 0.99f);
+        const float2 brdf = IBL_BRDF_LUT.SampleLevel(TrilinearSampler, lutUv, 0.0f).rg;
+        const float3 prefiltered = IBL_SPECULAR.SampleLevel(TrilinearSampler, reflect(v, n), perceptualRoughness * (View.SpecularMipCount - 1.0f)).rgb;
+
+        diff += EvaluateIrradianceSh(n) * baseColor.rgb * (1.0f - metallic);
+        spec += prefiltered * (f0 * brdf.x + brdf.y);
+    }
+    else
+    {
+        diff += LightAmbient * baseColor.rgb;
+    }
 
     if(ndl > 0 || ndv > 0)
     {   
@@ -0,0 +1,34 @@
+struct ObjectTransform
+{
+    row_major float4x4 Current;
+    row_major float4x4 Previous;
+};
+
+cbuffer ObjectCBuf : register(b1)
+{
+    uint ObjectIndex;
+};
+
+#if _BINDLESS
+
+cbuffer ObjectBufferCBuf : register(b3)
+{
+    uint ObjectTransformBufferIndex;
+};
+
+StructuredBuffer<ObjectTransform> t_objectTransforms[512] : register(t0, space1);
+
+#define OBJECT_TRANSFORMS t_objectTransforms[ObjectTransformBufferIndex]
+
+#else
+
+StructuredBuffer<ObjectTransform> ObjectTransforms : register(t0);
+
+#define OBJECT_TRANSFORMS ObjectTransforms
+
+#endif // _BINDLESS
+
+ObjectTransform GetObjectTransform()
+{
+    return OBJECT_TRANSFORMS[ObjectIndex];
+}
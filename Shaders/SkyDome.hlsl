@@ -60,10 +60,16 @@ float4 main(PS_INPUT input) : SV_Target
 
     input.uv = float2(atan2(input.uvw.z, input.uvw.x), asin(-input.uvw.y)) * float2(0.1591, 0.3183) + float2(0.5, 0.5);
 
+    // U jumps from 1 to 0 across the atan2 seam, wrapping the gradient stops the sky dropping to its smallest mip there
+    float2 uvDx = ddx(input.uv);
+    float2 uvDy = ddy(input.uv);
+    uvDx.x = frac(uvDx.x + 0.5f) - 0.5f;
+    uvDy.x = frac(uvDy.x + 0.5f) - 0.5f;
+
 #if _BINDLESS
-    float3 color = t_tex2d[SrvIndex].Sample(TrilinearSampler, input.uv).rgb;
+    float3 color = t_tex2d[SrvIndex].SampleGrad(TrilinearSampler, input.uv, uvDx, uvDy).rgb;
 #else
-    float3 color = Texture.Sample(TrilinearSampler, input.uv).rgb;
+    float3 color = Texture.SampleGrad(TrilinearSampler, input.uv, uvDx, uvDy).rgb;
 #endif
 
     return float4(Tonemap(color), 1.0f);
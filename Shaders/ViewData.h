@@ -7,6 +7,13 @@ struct ViewData
     float pad1;
     float3 SunRadiance;
     float pad2;
+
+    // Image based lighting baked from the sky, see TextureIbl.h. SpecularMipCount is 0 when there is none.
+    float4 IrradianceSh[9];
+    uint SpecularSrvIndex;
+    uint BrdfLutSrvIndex;
+    float SpecularMipCount;
+    float pad3;
 };
 
 cbuffer ViewCBuf : register(b0)